@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+#include <QtCore/QRegExp>
+#include "BenchmarkSuite.h" // class definition
+
+namespace bench
+{
+  // ====================================================
+  //  JSON STRING (local)
+  // ====================================================
+  static QString jsonString(const QString& str)
+  {
+    QString escaped = str;
+    escaped.replace("\\", "\\\\");
+    escaped.replace("\"", "\\\"");
+    escaped.replace("\n", "\\n");
+    return "\"" + escaped + "\"";
+  } // jsonString
+
+  // ---------------------------------------------------------------------
+  //                                RESULT
+  // ---------------------------------------------------------------------
+
+  // ====================================================
+  //  CTOR
+  // ====================================================
+  Result::Result()
+    : bytes(0)
+  {
+  } // ctor
+
+  // ====================================================
+  //  MEAN
+  // ====================================================
+  double Result::mean(void) const
+  {
+    if (samples.isEmpty())
+      return 0.0;
+
+    double total = 0.0;
+    foreach (double sample, samples)
+      total += sample;
+    return total / samples.size();
+  } // mean
+
+  // ====================================================
+  //  PERCENTILE
+  // ====================================================
+  double Result::percentile(double p) const
+  {
+    if (samples.isEmpty())
+      return 0.0;
+
+    QVector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+
+    int index = static_cast<int>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[qBound(0, index, sorted.size() - 1)];
+  } // percentile
+
+  // ====================================================
+  //  THROUGHPUT
+  // ====================================================
+  double Result::throughput(void) const
+  {
+    double ms = mean();
+    if (bytes <= 0 || ms <= 0.0)
+      return 0.0;
+    return (bytes / (1024.0 * 1024.0)) / (ms / 1000.0);
+  } // throughput
+
+  // ---------------------------------------------------------------------
+  //                           BENCHMARK SUITE
+  // ---------------------------------------------------------------------
+
+  // ====================================================
+  //  CTOR
+  // ====================================================
+  BenchmarkSuite::BenchmarkSuite(void)
+  {
+  } // ctor
+
+  // ====================================================
+  //  DTOR
+  // ====================================================
+  BenchmarkSuite::~BenchmarkSuite(void)
+  {
+    qDeleteAll(mResults);
+  } // dtor
+
+  // ====================================================
+  //  ADD
+  // ====================================================
+  Result& BenchmarkSuite::add(const QString& name, qint64 bytes)
+  {
+    Result* result = new Result;
+    result->name = name;
+    result->bytes = bytes;
+    mResults.push_back(result);
+    return *result;
+  } // add
+
+  // ====================================================
+  //  SET INFO
+  // ====================================================
+  void BenchmarkSuite::setInfo(const QString& key, const QString& value)
+  {
+    mInfo[key] = value;
+  } // setInfo
+
+  // ====================================================
+  //  PRINT
+  // ====================================================
+  void BenchmarkSuite::print(QTextStream& out) const
+  {
+    out << QString("%1 %2 %3 %4 %5 %6\n")
+           .arg("benchmark", -40).arg("n", 6).arg("mean ms", 12)
+           .arg("p99 ms", 12).arg("max ms", 12).arg("MB/s", 10);
+
+    foreach (const Result* r, mResults)
+    {
+      out << QString("%1 %2 %3 %4 %5 %6\n")
+             .arg(r->name, -40).arg(r->samples.size(), 6)
+             .arg(r->mean(), 12, 'f', 4).arg(r->percentile(99), 12, 'f', 4)
+             .arg(r->percentile(100), 12, 'f', 4).arg(r->throughput(), 10, 'f', 2);
+    }
+    out.flush();
+  } // print
+
+  // ====================================================
+  //  WRITE JSON
+  // ====================================================
+  bool BenchmarkSuite::writeJson(const QString& path) const
+  {
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly | QFile::Text))
+      return false;
+
+    QTextStream out(&file);
+    out << "{\n  \"info\": {";
+
+    QMap<QString, QString>::const_iterator citr = mInfo.begin();
+    for (; citr != mInfo.end(); ++citr)
+    {
+      out << (citr == mInfo.begin() ? "\n" : ",\n");
+      out << "    " << jsonString(citr.key()) << ": " << jsonString(*citr);
+    }
+
+    out << "\n  },\n  \"benchmarks\": [";
+
+    for (int i = 0; i < mResults.size(); ++i)
+    {
+      const Result* r = mResults[i];
+      out << (i == 0 ? "\n" : ",\n");
+      out << "    {\"name\": " << jsonString(r->name)
+          << ", \"samples\": " << r->samples.size()
+          << ", \"mean_ms\": " << QString::number(r->mean(), 'g', 8)
+          << ", \"p50_ms\": " << QString::number(r->percentile(50), 'g', 8)
+          << ", \"p99_ms\": " << QString::number(r->percentile(99), 'g', 8)
+          << ", \"max_ms\": " << QString::number(r->percentile(100), 'g', 8)
+          << ", \"bytes\": " << r->bytes
+          << ", \"mb_per_s\": " << QString::number(r->throughput(), 'g', 8)
+          << "}";
+    }
+
+    out << "\n  ]\n}\n";
+    return true;
+  } // writeJson
+
+  // ====================================================
+  //  COMPARE
+  // ====================================================
+  int BenchmarkSuite::compare(const QString& path, double threshold, QTextStream& out) const
+  {
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+      return -1;
+    QString text = QTextStream(&file).readAll();
+
+    // The baseline is written by writeJson(), one benchmark per line, so a
+    // regular expression is all that's needed to read it back.
+    QMap<QString, double> baseline;
+    QRegExp entry("\\{\"name\": \"([^\"]*)\"[^}]*\"mean_ms\": ([-+0-9.eE]+)");
+    int pos = 0;
+    while ((pos = entry.indexIn(text, pos)) >= 0)
+    {
+      baseline[entry.cap(1)] = entry.cap(2).toDouble();
+      pos += entry.matchedLength();
+    }
+
+    int regressions = 0;
+    foreach (const Result* r, mResults)
+    {
+      QMap<QString, double>::const_iterator citr = baseline.find(r->name);
+      if (citr == baseline.end() || *citr <= 0.0)
+        continue;
+
+      double change = (r->mean() - *citr) / *citr * 100.0;
+      bool regressed = (change > threshold);
+      if (regressed)
+        ++regressions;
+
+      out << QString("%1 %2 -> %3 ms (%4%5%)%6\n")
+             .arg(r->name, -40)
+             .arg(*citr, 0, 'f', 4).arg(r->mean(), 0, 'f', 4)
+             .arg(change >= 0 ? "+" : "").arg(change, 0, 'f', 1)
+             .arg(regressed ? "  REGRESSION" : "");
+    }
+    out.flush();
+
+    return regressions;
+  } // compare
+} // namespace bench
\ No newline at end of file
@@ -0,0 +1,89 @@
+#ifndef _BENCHMARKSUITE_H_
+#define _BENCHMARKSUITE_H_
+#include <QtCore/QString>
+#include <QtCore/QVector>
+#include <QtCore/QMap>
+#include <QtCore/QElapsedTimer>
+
+// FORWARD DECLARATIONS
+class QTextStream;
+
+namespace bench
+{
+  /** The timings collected for one benchmark. */
+  struct Result
+  {
+    Result();
+
+    /// @returns The mean time of a single sample, in milliseconds.
+    double mean(void) const;
+
+    /// @returns The p-th percentile (0-100) of the samples, in milliseconds.
+    double percentile(double p) const;
+
+    /// @returns The throughput in MB/s, or 0 if no byte count was given.
+    double throughput(void) const;
+
+    QString         name;
+    QVector<double> samples;  ///< Time of each sample, in milliseconds
+    qint64          bytes;    ///< Bytes processed per sample, or 0
+  };
+
+  /** Measures a block of code.  Construct one just before the code being
+   * measured; the time is recorded into the Result when it is destroyed. */
+  class Sample
+  {
+  public:
+    Sample(Result& result) : mResult(result) { mTimer.start(); }
+    ~Sample(void) { mResult.samples.push_back(mTimer.nsecsElapsed() / 1000000.0); }
+
+  private:
+    Result&       mResult;
+    QElapsedTimer mTimer;
+  };
+
+  /** Collects the Results of a benchmark run, writes them to JSON and compares
+   * them against a baseline from a previous run. */
+  class BenchmarkSuite
+  {
+  public:
+    BenchmarkSuite(void);
+    ~BenchmarkSuite(void);
+
+    /** @param name The name of the benchmark.
+     * @param bytes The number of bytes processed in each sample, used to
+     *        report throughput.  Pass 0 if throughput doesn't apply.
+     * @returns The Result to record samples into.  It stays valid for the
+     *          lifetime of the suite. */
+    Result& add(const QString& name, qint64 bytes = 0);
+
+    /** Adds a value that describes the run, such as the corpus size.  These
+     * are written to the "info" section of the JSON. */
+    void setInfo(const QString& key, const QString& value);
+
+    /// Prints a human readable table of the results.
+    void print(QTextStream& out) const;
+
+    /** Writes the results to \e path as JSON.
+     * @returns TRUE if the file was written, FALSE otherwise. */
+    bool writeJson(const QString& path) const;
+
+    /** Compares the mean of each benchmark against a previous run.
+     * @param path The JSON file written by a previous run.
+     * @param threshold How much slower (in percent) a benchmark may get
+     *        before it counts as a regression.
+     * @param out Where to print the comparison.
+     * @returns The number of regressions, or -1 if the baseline can't be read. */
+    int compare(const QString& path, double threshold, QTextStream& out) const;
+
+  private:
+    BenchmarkSuite(const BenchmarkSuite&);
+    BenchmarkSuite& operator=(const BenchmarkSuite&);
+
+  private:
+    QVector<Result*>        mResults;
+    QMap<QString, QString>  mInfo;
+  };
+}
+
+#endif // _BENCHMARKSUITE_H_
\ No newline at end of file
@@ -0,0 +1,345 @@
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTextStream>
+#include <QtCore/QStringList>
+#include "Corpus.h" // class definition
+
+namespace bench
+{
+  // Attributes written in each kind of block.  They are all real Ogre
+  // attributes so the highlighter has keywords to match.
+  static const char* const MATERIAL_ATTRIBUTES[] = {
+    "lod_distance 100",
+    "receive_shadows on",
+    "transparency_casts_shadows off"
+  };
+
+  static const char* const TECHNIQUE_ATTRIBUTES[] = {
+    "scheme Default",
+    "lod_index 0"
+  };
+
+  static const char* const PASS_ATTRIBUTES[] = {
+    "ambient 0.5 0.5 0.5 1",
+    "diffuse 1 1 1 1",
+    "specular 0.2 0.2 0.2 1 12.5",
+    "emissive 0 0 0",
+    "scene_blend alpha_blend",
+    "depth_write off",
+    "depth_check on",
+    "lighting off",
+    "cull_hardware none",
+    "alpha_rejection greater 128",
+    "// A comment that mentions pass and lighting",
+    "max_lights 8"
+  };
+
+  static const char* const TEXTURE_UNIT_ATTRIBUTES[] = {
+    "texture \"bench diffuse.png\"",
+    "tex_address_mode clamp",
+    "filtering trilinear",
+    "max_anisotropy 4",
+    "colour_op modulate",
+    "scroll_anim 0.1 0",
+    "tex_coord_set 0"
+  };
+
+  static const char* const OVERLAY_ATTRIBUTES[] = {
+    "metrics_mode pixels",
+    "left 10",
+    "top 20",
+    "width 200",
+    "height 32",
+    "material Bench/Material_0",
+    "caption \"Benchmark\""
+  };
+
+  #define NUM_ELEMENTS(a) static_cast<int>(sizeof(a) / sizeof(a[0]))
+
+  // ====================================================
+  //  CORPUS OPTIONS CTOR
+  // ====================================================
+  CorpusOptions::CorpusOptions()
+    : count(2000), depth(4), attributes(6), seed(12345)
+  {
+  } // ctor
+
+  // ====================================================
+  //  CTOR
+  // ====================================================
+  CorpusGenerator::CorpusGenerator(const CorpusOptions& options)
+    : mOptions(options), mState(options.seed)
+  {
+  } // ctor
+
+  // ====================================================
+  //  RANDOM
+  // ====================================================
+  int CorpusGenerator::random(int range)
+  {
+    // Simple LCG.  Good enough for picking attributes, and it gives the same
+    // corpus on every platform.
+    mState = mState * 1103515245u + 12345u;
+    return static_cast<int>((mState >> 16) % static_cast<unsigned>(range));
+  } // random
+
+  // ====================================================
+  //  WRITE ATTRIBUTES
+  // ====================================================
+  void CorpusGenerator::writeAttributes(QString& out, const char* const* attributes, int numAttributes, int indent)
+  {
+    QString spaces(indent, ' ');
+    for (int i = 0; i < mOptions.attributes; ++i)
+      out += spaces + attributes[random(numAttributes)] + "\n";
+  } // writeAttributes
+
+  // ====================================================
+  //  MATERIALS
+  // ====================================================
+  QString CorpusGenerator::materials(void)
+  {
+    QString out;
+    int depth = qBound(1, mOptions.depth, 4);
+
+    for (int i = 0; i < mOptions.count; ++i)
+    {
+      // Every tenth material inherits from the one before it
+      if (i > 0 && i % 10 == 0)
+        out += QString("material Bench/Material_%1 : Bench/Material_%2\n{\n").arg(i).arg(i-1);
+      else
+        out += QString("material Bench/Material_%1\n{\n").arg(i);
+      writeAttributes(out, MATERIAL_ATTRIBUTES, NUM_ELEMENTS(MATERIAL_ATTRIBUTES), 2);
+
+      if (depth > 1)
+      {
+        out += "  technique\n  {\n";
+        writeAttributes(out, TECHNIQUE_ATTRIBUTES, NUM_ELEMENTS(TECHNIQUE_ATTRIBUTES), 4);
+
+        if (depth > 2)
+        {
+          out += "    pass\n    {\n";
+          writeAttributes(out, PASS_ATTRIBUTES, NUM_ELEMENTS(PASS_ATTRIBUTES), 6);
+
+          if (depth > 3)
+          {
+            out += "      texture_unit\n      {\n";
+            writeAttributes(out, TEXTURE_UNIT_ATTRIBUTES, NUM_ELEMENTS(TEXTURE_UNIT_ATTRIBUTES), 8);
+            out += "      }\n";
+          }
+          out += "    }\n";
+        }
+        out += "  }\n";
+      }
+      out += "}\n\n";
+    }
+
+    return out;
+  } // materials
+
+  // ====================================================
+  //  WRITE OVERLAY ELEMENT
+  // ====================================================
+  void CorpusGenerator::writeOverlayElement(QString& out, int index, int level, int indent)
+  {
+    QString spaces(indent, ' ');
+    bool leaf = (level >= mOptions.depth);
+
+    out += spaces + QString("%1 %2(Bench/Element_%3_%4)\n")
+                    .arg(leaf ? "element" : "container")
+                    .arg(leaf ? "TextArea" : "Panel")
+                    .arg(index).arg(level);
+    out += spaces + "{\n";
+    writeAttributes(out, OVERLAY_ATTRIBUTES, NUM_ELEMENTS(OVERLAY_ATTRIBUTES), indent + 2);
+    if (!leaf)
+      writeOverlayElement(out, index, level + 1, indent + 2);
+    out += spaces + "}\n";
+  } // writeOverlayElement
+
+  // ====================================================
+  //  OVERLAYS
+  // ====================================================
+  QString CorpusGenerator::overlays(void)
+  {
+    QString out;
+
+    for (int i = 0; i < mOptions.count; ++i)
+    {
+      out += QString("Bench/Overlay_%1\n{\n  zorder %2\n").arg(i).arg(100 + i % 500);
+      writeOverlayElement(out, i, 2, 2);
+      out += "}\n\n";
+    }
+
+    return out;
+  } // overlays
+
+  // ====================================================
+  //  WRITE CONFIG (static)
+  // ====================================================
+  bool CorpusGenerator::writeConfig(const QString& dir, const QString& dataDir)
+  {
+    QDir data(dataDir);
+    QString text = QString(
+      "<Config>\n"
+      "\t<OgreManualPath>%1</OgreManualPath>\n"
+      "\t<Formats>\n"
+      "\t\t<Format highlights_file=\"%2\" words_file=\"%3\" file_extensions=\"material\">materials</Format>\n"
+      "\t\t<Format highlights_file=\"%4\" words_file=\"%5\" file_extensions=\"overlay\">overlays</Format>\n"
+      "\t</Formats>\n"
+      "</Config>\n")
+      .arg(QDir(dir).absoluteFilePath("manual"))
+      .arg(data.absoluteFilePath("materials.highlights"))
+      .arg(data.absoluteFilePath("materials.words"))
+      .arg(data.absoluteFilePath("overlays.highlights"))
+      .arg(data.absoluteFilePath("overlays.words"));
+
+    return writeFile(QDir(dir).absoluteFilePath("config.xml"), text);
+  } // writeConfig
+
+  // ====================================================
+  //  WRITE MANUAL (static)
+  // ====================================================
+  bool CorpusGenerator::writeManual(const QString& dir, const config::FormatWordMap& words)
+  {
+    QDir manual(dir);
+    if (!manual.mkpath("manual") || !manual.cd("manual"))
+      return false;
+
+    // Group the words by the manual page that documents them
+    QMap<QString, QString> pages;
+    config::FormatWordMap::const_iterator citr = words.begin();
+    for (; citr != words.end(); ++citr)
+    {
+      if (citr->doc.isEmpty())
+        continue;
+
+      // Pad each page so that the lookup has some text to search through
+      QString& page = pages[citr->doc];
+      page += QString("<P>Lorem ipsum dolor sit amet, consectetur adipiscing elit.</P>\n"
+                      "Format: %1 &lt;value&gt;<BR>\n"
+                      "Format2: %1 &lt;value&gt; &lt;value&gt;<BR>\n").arg(citr->word);
+    }
+
+    QMap<QString, QString>::const_iterator pitr = pages.begin();
+    for (; pitr != pages.end(); ++pitr)
+    {
+      if (!writeFile(manual.absoluteFilePath(pitr.key()), "<HTML><BODY>\n" + *pitr + "</BODY></HTML>\n"))
+        return false;
+    }
+
+    return true;
+  } // writeManual
+
+  // ====================================================
+  //  WRITE FILE (static)
+  // ====================================================
+  bool CorpusGenerator::writeFile(const QString& path, const QString& text)
+  {
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly | QFile::Text))
+      return false;
+
+    QTextStream stream(&file);
+    stream << text;
+    return true;
+  } // writeFile
+
+  // ====================================================
+  //  REMOVE DIR (static)
+  // ====================================================
+  void CorpusGenerator::removeDir(const QString& path)
+  {
+    QDir dir(path);
+    foreach (QFileInfo fi, dir.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+      if (fi.isDir())
+        removeDir(fi.absoluteFilePath());
+      else
+        dir.remove(fi.fileName());
+    }
+    dir.rmdir(path);
+  } // removeDir
+
+  // ====================================================
+  //  SCRATCH DIRECTORY
+  // ====================================================
+  ScratchDirectory::ScratchDirectory(const QString& path)
+    : mPath(QDir(path).absolutePath())
+  {
+    QDir().mkpath(mPath);
+    QDir::setCurrent(mPath);
+  } // ScratchDirectory
+
+  ScratchDirectory::~ScratchDirectory(void)
+  {
+    // A directory can't be removed while it is the working directory
+    QDir::setCurrent(QDir::tempPath());
+    CorpusGenerator::removeDir(mPath);
+  } // ~ScratchDirectory
+
+  // ====================================================
+  //  OPTION PARSER
+  // ====================================================
+  void OptionParser::add(const QString& name, int* value)
+  {
+    add(name, OPTION_INT, value);
+  } // add
+
+  void OptionParser::add(const QString& name, double* value)
+  {
+    add(name, OPTION_DOUBLE, value);
+  } // add
+
+  void OptionParser::add(const QString& name, QString* value)
+  {
+    add(name, OPTION_STRING, value);
+  } // add
+
+  void OptionParser::addPath(const QString& name, QString* value)
+  {
+    add(name, OPTION_PATH, value);
+  } // addPath
+
+  void OptionParser::add(const QString& name, Kind kind, void* value)
+  {
+    Option option = { kind, value };
+    mOptions.insert(name, option);
+  } // add
+
+  bool OptionParser::parse(const QStringList& args, QString& error) const
+  {
+    for (int i = 1; i < args.size(); i += 2)
+    {
+      const QString& opt = args[i];
+      QHash<QString, Option>::const_iterator citr = mOptions.find(opt);
+      if (citr == mOptions.end())
+      {
+        error = "Unknown option " + opt;
+        return false;
+      }
+      if (i + 1 == args.size())
+      {
+        error = "Option " + opt + " needs a value";
+        return false;
+      }
+
+      const QString& val = args[i + 1];
+      switch (citr->kind)
+      {
+      case OPTION_INT:
+        *static_cast<int*>(citr->value) = val.toInt();
+        break;
+      case OPTION_DOUBLE:
+        *static_cast<double*>(citr->value) = val.toDouble();
+        break;
+      case OPTION_STRING:
+        *static_cast<QString*>(citr->value) = val;
+        break;
+      case OPTION_PATH:
+        *static_cast<QString*>(citr->value) = QDir::current().absoluteFilePath(val);
+        break;
+      }
+    }
+    return true;
+  } // parse
+} // namespace bench
\ No newline at end of file
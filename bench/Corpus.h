@@ -0,0 +1,137 @@
+#ifndef _CORPUS_H_
+#define _CORPUS_H_
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QHash>
+#include "ConfigFile.h"
+
+namespace bench
+{
+  /** Settings for a synthetic corpus. */
+  struct CorpusOptions
+  {
+    CorpusOptions();
+
+    /// Number of top-level materials or overlays to generate
+    int       count;
+
+    /** Nesting depth of each script.  For materials this is capped at 4
+     * (material, technique, pass, texture_unit).  Overlays nest containers
+     * to any depth. */
+    int       depth;
+
+    /// Number of attributes written in each block
+    int       attributes;
+
+    /// Seed for the random generator, so that a corpus can be reproduced
+    unsigned  seed;
+  };
+
+  /** Generates synthetic .material and .overlay scripts, along with the
+   * files the editor expects around them (config.xml and a fake Ogre manual),
+   * so that every hot path can be measured without any real assets. */
+  class CorpusGenerator
+  {
+  public:
+    CorpusGenerator(const CorpusOptions& options);
+
+    /// @returns The text of a .material script built from the options.
+    QString materials(void);
+
+    /// @returns The text of a .overlay script built from the options.
+    QString overlays(void);
+
+    /** Writes a config.xml into \e dir that points at the words and highlights
+     * files in \e dataDir, and at a fake manual inside \e dir.
+     * @returns TRUE if the file was written, FALSE otherwise. */
+    static bool writeConfig(const QString& dir, const QString& dataDir);
+
+    /** Writes a fake Ogre manual into \e dir containing a "Format: <word>"
+     * entry for every word in \e words, so IDE::setKeyword() has something
+     * to find.
+     * @returns TRUE if the manual was written, FALSE otherwise. */
+    static bool writeManual(const QString& dir, const config::FormatWordMap& words);
+
+    /** Writes \e text to \e path.
+     * @returns TRUE if the file was written, FALSE otherwise. */
+    static bool writeFile(const QString& path, const QString& text);
+
+    /** Deletes a directory and everything in it. */
+    static void removeDir(const QString& path);
+
+  private:
+    /// @returns A pseudo-random number in [0, range).
+    int random(int range);
+
+    void writeAttributes(QString& out, const char* const* attributes, int numAttributes, int indent);
+    void writeOverlayElement(QString& out, int index, int level, int indent);
+
+  private:
+    CorpusOptions mOptions;
+    unsigned      mState;
+  };
+
+  /** A scratch directory that is the working directory while it exists.  It
+   * is deleted, along with everything in it, when it goes out of scope, so a
+   * run that stops early does not leave it behind in the temp directory. */
+  class ScratchDirectory
+  {
+  public:
+    /** Creates \e path and makes it the working directory. */
+    ScratchDirectory(const QString& path);
+    ~ScratchDirectory(void);
+
+    /// @returns The absolute path of the directory.
+    const QString& path(void) const { return mPath; }
+
+  private:
+    ScratchDirectory(const ScratchDirectory&);
+    ScratchDirectory& operator=(const ScratchDirectory&);
+
+  private:
+    QString mPath;
+  };
+
+  /** The "--name value" options of a harness's command line.  Each option
+   * is tied to the variable it sets, which keeps its default unless the
+   * option is given. */
+  class OptionParser
+  {
+  public:
+    void add(const QString& name, int* value);
+    void add(const QString& name, double* value);
+    void add(const QString& name, QString* value);
+
+    /** Adds an option whose value is a path, made absolute against the
+     * working directory. */
+    void addPath(const QString& name, QString* value);
+
+    /** Sets the variables of the options in \e args.
+     * @param args The command line, starting with the program.
+     * @param error Receives what is wrong with it.
+     * @returns FALSE if an option is unknown or has no value. */
+    bool parse(const QStringList& args, QString& error) const;
+
+  private:
+    enum Kind
+    {
+      OPTION_INT,
+      OPTION_DOUBLE,
+      OPTION_STRING,
+      OPTION_PATH
+    };
+
+    struct Option
+    {
+      Kind    kind;
+      void*   value;
+    };
+
+    void add(const QString& name, Kind kind, void* value);
+
+  private:
+    QHash<QString, Option> mOptions;
+  };
+}
+
+#endif // _CORPUS_H_
\ No newline at end of file
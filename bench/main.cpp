@@ -0,0 +1,2094 @@
+/* Benchmark for the editor's hot paths.  It generates a synthetic corpus,
+ * runs each benchmark against it and writes the results to JSON.
+ *
+ * Usage: benchmark [options]
+ *   --count N          Number of materials/overlays to generate (2000)
+ *   --depth N          Nesting depth of each script (4)
+ *   --attributes N     Attributes per block (6)
+ *   --iterations N     Samples taken of whole-document benchmarks (5)
+ *   --keystrokes N     Samples taken of per-keystroke benchmarks (200)
+ *   --selection N      Lines selected for the indentation benchmarks (2000)
+ *   --large-mb N       Size of the file opened in large file mode (64)
+ *   --data DIR         Directory with the .words/.highlights files (exe dir)
+ *   --output FILE      Where to write the JSON results (benchmark.json)
+ *   --baseline FILE    JSON from a previous run to compare against
+ *   --threshold PCT    Allowed slowdown before a regression is reported (10)
+ *   --label TEXT       Free text stored with the results, e.g. a commit id
+ *
+ * The benchmark never shows a window.  It asks for the QPA offscreen
+ * platform unless QT_QPA_PLATFORM is already set; on X11 builds of Qt it
+ * needs a display, which can be a virtual one such as Xvfb.
+ * Returns 1 if any benchmark regressed against the baseline. */
+#include <QtGui/QApplication>
+#include <QtGui/QClipboard>
+#include <QtGui/QTextDocument>
+#include <QtGui/QTextCursor>
+#include <QtGui/QTextBlock>
+#include <QtGui/QKeyEvent>
+#include <QtGui/QImage>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+#include "ConfigFile.h"
+#include "Highlighter.h"
+#include "TextEditor.h"
+#include "LargeFileEditor.h"
+#include "Journal.h"
+#include "Outline.h"
+#include "Diagnostics.h"
+#include "ResourceResolver.h"
+#include "MaterialFlattener.h"
+#include "ScriptDiff.h"
+#include "DuplicateFinder.h"
+#include "ScriptBundle.h"
+#include "ManualIndex.h"
+#include "IDE.h"
+#include "ScriptParser.h"
+#include "Corpus.h"
+#include "BenchmarkSuite.h"
+
+/** Exposes the protected parts of TextEditor that are measured. */
+class BenchEditor : public TextEditor
+{
+public:
+  using TextEditor::getNumIndent;
+  using TextEditor::matchBraces;
+};
+
+/** Exposes the protected parts of LargeFileEditor that are measured. */
+class BenchLargeEditor : public LargeFileEditor
+{
+public:
+  using LargeFileEditor::keyPressEvent;
+  using LargeFileEditor::getNumIndent;
+  using LargeFileEditor::insertText;
+  using LargeFileEditor::removeText;
+  using LargeFileEditor::updateRows;
+  using LargeFileEditor::findLineStart;
+
+  qint64 topLine(void) const {return mTopLine;}
+  const QVector<qint64>& rowEnds(void) const {return mRowEnds;}
+};
+
+/** Exposes the protected parts of Outline that are checked. */
+class BenchOutline : public Outline
+{
+public:
+  using Outline::onItemClicked;
+};
+
+/** Exposes the protected parts of IDE that are measured. */
+class BenchIDE : public IDE
+{
+public:
+  using IDE::setKeyword;
+  using IDE::openFile;
+
+  void showTab(int tab) {mpTabs->setCurrentIndex(tab);}
+  QWidget* currentWidget(void) const {return mpTabs->currentWidget();}
+  bool currentIsLarge(void) const {return mpCurrentEditor && mpCurrentEditor->largeEditor;}
+};
+
+/// Number of files open in the session benchmarks
+static const int SESSION_FILES = 40;
+
+// ====================================================
+//  SELECT LINES (local)
+// ====================================================
+static void selectLines(TextEditor& editor, int first, int count)
+{
+  QTextDocument* doc = editor.document();
+  QTextBlock start = doc->findBlockByNumber(first);
+  QTextBlock end = doc->findBlockByNumber(qMin(first + count, doc->blockCount()) - 1);
+
+  QTextCursor cursor(doc);
+  cursor.setPosition(start.position());
+  cursor.setPosition(end.position() + end.length() - 1, QTextCursor::KeepAnchor);
+  editor.setTextCursor(cursor);
+} // selectLines
+
+// ====================================================
+//  BENCH HIGHLIGHTER (local)
+// ====================================================
+static void benchHighlighter(bench::BenchmarkSuite& suite, const QString& format, const QString& text, int iterations)
+{
+  QTextDocument doc;
+  doc.setPlainText(text);
+  Highlighter highlighter(&doc);
+  highlighter.setFileFormat(format);
+
+  bench::Result& r = suite.add("highlighter/rehighlight_" + format, text.toUtf8().size());
+  for (int i = 0; i < iterations; ++i)
+  {
+    bench::Sample s(r);
+    highlighter.rehighlight();
+  }
+} // benchHighlighter
+
+// ====================================================
+//  BENCH PARSER (local)
+// ====================================================
+static void benchParser(bench::BenchmarkSuite& suite, const QString& format, const QString& path, int iterations)
+{
+  script::KeywordTable keywords(config::ConfigFile::instance()->getWordsByFormat(format));
+  script::ScriptFile file(&keywords);
+
+  bench::Result& r = suite.add("parser/open_" + format, QFileInfo(path).size());
+  for (int i = 0; i < iterations; ++i)
+  {
+    bench::Sample s(r);
+    file.open(path);
+  }
+} // benchParser
+
+// ====================================================
+//  CHECK PARSER (local)
+// ====================================================
+/** Checks the parser on scripts that aren't well formed: nesting deep
+ * enough to exhaust the stack, comment markers inside words, and a block
+ * comment that runs to the end of the file.
+ * @returns What went wrong, or an empty string. */
+static QString checkParser(void)
+{
+  QByteArray deep = "material Deep\n" + QByteArray(100000, '{') + QByteArray(100000, '}') + "\nmaterial After\n{\n}\n";
+  script::ScriptFile deepScript;
+  deepScript.parse(deep.constData(), deep.size());
+  if (deepScript.errors().isEmpty())
+    return "deep nesting wasn't reported";
+  const script::Node* last = deepScript.root()->lastChild;
+  if (last == NULL || last->name() != "After")
+    return "the material after the deep nesting was lost";
+
+  QByteArray paths = "texture textures//stone.png a/*b\n/* comment } */ scale 1";
+  script::ScriptFile pathScript;
+  pathScript.parse(paths.constData(), paths.size());
+  const script::Node* texture = pathScript.root()->firstChild;
+  if (texture == NULL || texture->numArgs != 2 || texture->args[0] != "textures//stone.png" || texture->args[1] != "a/*b")
+    return "a comment marker inside a word ended it";
+  if (texture->next == NULL || texture->next->keyword != "scale" || !pathScript.errors().isEmpty())
+    return "the block comment after the words wasn't skipped";
+
+  // Cut off at every point of the comment, "*/" included
+  QByteArray comment = "* never closed */";
+  for (int cut = 0; cut < comment.size(); ++cut)
+  {
+    QByteArray unterminated = "scale 1 /" + comment.left(cut);
+    script::ScriptFile openScript;
+    openScript.parse(unterminated.constData(), unterminated.size());
+    if (openScript.root()->firstChild == NULL || openScript.root()->firstChild->keyword != "scale")
+      return "an unterminated block comment lost the statement before it";
+  }
+  return QString();
+} // checkParser
+
+// ====================================================
+//  CHECK JOURNALS (local)
+// ====================================================
+/** Checks that journals are read back the way a crash leaves them: up to a
+ * record that was cut short, from the journal rather than a compacted copy
+ * that wasn't swapped in yet, and from the copy when the journal is gone.
+ * @param directory An empty directory to work in.
+ * @returns What went wrong, or an empty string. */
+static QString checkJournals(const QString& directory)
+{
+  QString written = QDir(directory).absoluteFilePath("written");
+  QString journal;
+  {
+    JournalWriter writer(written);
+    int id = writer.begin("check.material", "check.material", "materials", "hello");
+    writer.change(id, 5, 0, " world");
+    writer.flush();
+    writer.change(id, 0, 5, "HELLO");
+    writer.flush();
+
+    // The writer keeps journals it didn't end
+    QStringList names = QDir(written).entryList(QStringList() << "*.journal", QDir::Files);
+    if (names.size() != 1)
+      return QString("expected 1 journal, found %1").arg(names.size());
+    journal = QDir(written).absoluteFilePath(names.first());
+  }
+
+  // Copies named as if other editors that crashed wrote them: one whole,
+  // one cut short in its last record, one beside a compacted copy and one
+  // left with only the compacted copy
+  QDir dir(directory);
+  QFile::copy(journal, dir.absoluteFilePath("1-0.journal"));
+  QFile::copy(journal, dir.absoluteFilePath("2-0.journal"));
+  QFile::copy(journal, dir.absoluteFilePath("3-0.journal"));
+  QFile::copy(journal, dir.absoluteFilePath("3-0.journal.tmp"));
+  QFile::copy(journal, dir.absoluteFilePath("4-0.journal.tmp"));
+  {
+    QFile cut(dir.absoluteFilePath("2-0.journal"));
+    cut.resize(cut.size() - 1);
+    QFile tmp(dir.absoluteFilePath("3-0.journal.tmp"));
+    tmp.resize(tmp.size() - 1);
+  }
+
+  QMap<QString, QString> expected;
+  expected["1-0.journal"] = "HELLO world";
+  expected["2-0.journal"] = "hello world";
+  expected["3-0.journal"] = "HELLO world";
+  expected["4-0.journal.tmp"] = "HELLO world";
+
+  QList<RecoveredDocument> docs = JournalWriter::recover(directory);
+  if (docs.size() != expected.size())
+    return QString("expected %1 recovered documents, found %2").arg(expected.size()).arg(docs.size());
+  foreach (const RecoveredDocument& doc, docs)
+  {
+    QString name = QFileInfo(doc.journal).fileName();
+    if (!expected.contains(name))
+      return QString("recovered %1").arg(name);
+    if (doc.text != expected[name])
+      return QString("%1 read back as \"%2\"").arg(name, doc.text);
+    if (name == "3-0.journal" && QFileInfo(doc.temp).fileName() != "3-0.journal.tmp")
+      return QString("%1 doesn't know about its compacted copy").arg(name);
+    if (!JournalWriter::discard(doc))
+      return QString("%1 couldn't be discarded").arg(name);
+  }
+
+  QStringList left = dir.entryList(QStringList() << "*.journal" << "*.journal.tmp" << "*.lock", QDir::Files);
+  if (!left.isEmpty())
+    return QString("left behind %1").arg(left.join(", "));
+
+  // The journals of a writer that is running are never removed
+  {
+    JournalWriter writer(written);
+    writer.begin("live.material", "live.material", "materials", "live");
+    writer.flush();
+
+    RecoveredDocument doc;
+    doc.journal = QDir(written).absoluteFilePath(QString("%1-0.journal").arg(QCoreApplication::applicationPid()));
+    if (JournalWriter::discard(doc) || !QFileInfo(doc.journal).exists())
+      return "removed the journal of a running writer";
+  }
+  return QString();
+} // checkJournals
+
+// ====================================================
+//  CHECK PIECE TABLE (local)
+// ====================================================
+/** Checks a PieceTable against a plain copy of the document through a run
+ * of edits that split pieces and cross their boundaries.
+ * @returns What went wrong, or an empty string. */
+static QString checkPieceTable(void)
+{
+  // Taking back an insert that split a piece leaves the text as it was, as
+  // does taking back a remove that spans pieces
+  PieceTable split;
+  split.setData("abcdef");
+  split.insert(3, "XYZ");
+  split.remove(3, 3);
+  if (split.read(0, split.size()) != "abcdef")
+    return "taking back an insert gave \"" + QString(split.read(0, split.size())) + "\"";
+  split.insert(2, "12");
+  split.insert(6, "34");
+  split.remove(1, 8);
+  split.insert(1, "b12cd34e");
+  if (split.read(0, split.size()) != "ab12cd34ef")
+    return "taking back a remove gave \"" + QString(split.read(0, split.size())) + "\"";
+
+  QByteArray model("material A\n{\n  technique\n  {\n  }\n}\n");
+  PieceTable table;
+  table.setData(model);
+
+  // The same edits every run
+  quint32 seed = 12345;
+  for (int i = 0; i < 2000; ++i)
+  {
+    seed = seed * 1103515245u + 12345u;
+    int pos = static_cast<int>((seed >> 8) % (model.size() + 1));
+    seed = seed * 1103515245u + 12345u;
+    if ((seed >> 16) % 3 != 0 || model.size() < 8)
+    {
+      QByteArray text = (i % 5 == 0 ? QByteArray("\n") : QByteArray(1 + (seed >> 4) % 6, static_cast<char>('a' + i % 26)));
+      table.insert(pos, text);
+      model.insert(pos, text);
+    }
+    else
+    {
+      int length = qMin(static_cast<int>((seed >> 4) % 12), model.size() - pos);
+      table.remove(pos, length);
+      model.remove(pos, length);
+    }
+
+    if (table.size() != model.size() || table.read(0, table.size()) != model)
+      return QString("the document differs after edit %1").arg(i);
+  }
+
+  for (int pos = 0; pos < model.size(); ++pos)
+  {
+    int start = (pos == 0 ? 0 : model.lastIndexOf('\n', pos - 1) + 1);
+    int end = model.indexOf('\n', pos);
+    if (table.at(pos) != model[pos])
+      return QString("at(%1) differs").arg(pos);
+    if (table.lineStart(pos) != start)
+      return QString("lineStart(%1) differs").arg(pos);
+    if (table.lineEnd(pos) != (end < 0 ? model.size() : end))
+      return QString("lineEnd(%1) differs").arg(pos);
+    if (table.read(pos, 7) != model.mid(pos, 7))
+      return QString("read(%1) differs").arg(pos);
+  }
+  return QString();
+} // checkPieceTable
+
+// ====================================================
+//  CHECK ROWS (local)
+// ====================================================
+/** Checks the line ends LargeFileEditor keeps for the rows in view against
+ * a plain copy of the document, through a run of edits and scrolls.
+ * @param dir The directory to write the document to.
+ * @returns What went wrong, or an empty string. */
+static QString checkRows(const QString& dir)
+{
+  QByteArray model;
+  for (int i = 0; i < 200; ++i)
+    model += "material M" + QByteArray::number(i) + "\n{\n  technique\n  {\n  }\n}\n";
+  QString path = QDir(dir).absoluteFilePath("rows.material");
+  QFile file(path);
+  if (!file.open(QFile::WriteOnly) || file.write(model) != model.size())
+    return "could not write " + path;
+  file.close();
+
+  BenchLargeEditor editor;
+  editor.resize(400, 300);
+  if (!editor.load(path))
+    return "could not load " + path;
+
+  // The same edits every run
+  quint32 seed = 54321;
+  for (int i = 0; i < 2000; ++i)
+  {
+    seed = seed * 1103515245u + 12345u;
+    int pos = static_cast<int>((seed >> 8) % (model.size() + 1));
+    seed = seed * 1103515245u + 12345u;
+    if (i % 7 == 0)
+    {
+      editor.setCursorPosition(pos);
+    }
+    else if ((seed >> 16) % 3 != 0 || model.size() < 8)
+    {
+      QByteArray text = (i % 4 == 0 ? QByteArray("\n  x\n") : QByteArray(1 + (seed >> 4) % 6, static_cast<char>('a' + i % 26)));
+      editor.setCursorPosition(pos);
+      editor.insertText(text);
+      model.insert(pos, text);
+    }
+    else
+    {
+      int length = qMin(static_cast<int>((seed >> 4) % 40), model.size() - pos);
+      editor.removeText(pos, length);
+      model.remove(pos, length);
+    }
+
+    editor.updateRows();
+    qint64 line = editor.topLine();
+    const QVector<qint64>& ends = editor.rowEnds();
+    for (int row = 0; row < ends.size(); ++row)
+    {
+      int end = model.indexOf('\n', static_cast<int>(line));
+      if (ends[row] != (end < 0 ? model.size() : end))
+        return QString("row %1 ends at %2 rather than %3 after edit %4").arg(row).arg(ends[row]).arg(end).arg(i);
+      line = ends[row] + 1;
+    }
+
+    qint64 cursor = editor.cursorPosition();
+    int start = (cursor == 0 ? 0 : model.lastIndexOf('\n', static_cast<int>(cursor) - 1) + 1);
+    if (editor.findLineStart(cursor) != start)
+      return QString("the cursor's line starts at %1 rather than %2 after edit %3").arg(editor.findLineStart(cursor)).arg(start).arg(i);
+  }
+  return QString();
+} // checkRows
+
+// ====================================================
+//  CHECK LARGE EDITING (local)
+// ====================================================
+/** Checks selection, the clipboard and undo in LargeFileEditor, which files
+ * with long lines are opened in.
+ * @param dir The directory to write the document to.
+ * @returns What went wrong, or an empty string. */
+static QString checkLargeEditing(const QString& dir)
+{
+  QByteArray original = "material A\n{\n  technique\n  {\n  }\n}\n";
+  QString path = QDir(dir).absoluteFilePath("editing.material");
+  if (!bench::CorpusGenerator::writeFile(path, QString::fromLatin1(original)))
+    return "could not write " + path;
+
+  BenchLargeEditor editor;
+  editor.resize(400, 300);
+  if (!editor.load(path))
+    return "could not load " + path;
+
+  QKeyEvent x(QEvent::KeyPress, Qt::Key_X, Qt::NoModifier, "x");
+  QKeyEvent y(QEvent::KeyPress, Qt::Key_Y, Qt::NoModifier, "y");
+  QKeyEvent enter(QEvent::KeyPress, Qt::Key_Return, Qt::NoModifier, "\r");
+  QKeyEvent selectRight(QEvent::KeyPress, Qt::Key_Right, Qt::ShiftModifier);
+  QKeyEvent right(QEvent::KeyPress, Qt::Key_Right, Qt::NoModifier);
+
+  // A run of typing is undone at once, and made again
+  editor.setCursorPosition(0);
+  editor.keyPressEvent(&x);
+  editor.keyPressEvent(&y);
+  editor.keyPressEvent(&x);
+  if (editor.buffer().read(0, editor.buffer().size()) != "xyx" + original)
+    return "typing at the start went wrong";
+  editor.undo();
+  if (editor.buffer().read(0, editor.buffer().size()) != original || editor.cursorPosition() != 0)
+    return "undoing the typing didn't bring the document back";
+  editor.redo();
+  if (editor.buffer().read(0, editor.buffer().size()) != "xyx" + original || editor.cursorPosition() != 3)
+    return "redoing the typing didn't make it again";
+  editor.undo();
+
+  // SHIFT extends the selection, typing replaces it, and both are undone
+  // together
+  editor.setCursorPosition(0);
+  for (int i = 0; i < 8; ++i)
+    editor.keyPressEvent(&selectRight);
+  if (editor.selectedText() != "material")
+    return "the selection is \"" + QString::fromLatin1(editor.selectedText()) + "\" rather than \"material\"";
+  editor.keyPressEvent(&y);
+  if (editor.buffer().read(0, editor.buffer().size()) != "y A" + original.mid(10) || editor.hasSelection())
+    return "typing didn't replace the selection";
+  editor.undo();
+  if (editor.buffer().read(0, editor.buffer().size()) != original)
+    return "undoing a replaced selection didn't bring it back";
+
+  // Cut and paste move text through the clipboard
+  editor.setCursorPosition(0);
+  for (int i = 0; i < 9; ++i)
+    editor.keyPressEvent(&selectRight);
+  editor.cut();
+  if (editor.buffer().read(0, editor.buffer().size()) != original.mid(9) || QApplication::clipboard()->text() != "material ")
+    return "cutting didn't move the selection to the clipboard";
+  editor.keyPressEvent(&right);
+  editor.paste();
+  if (editor.buffer().read(0, editor.buffer().size()) != "Amaterial " + original.mid(10))
+    return "pasting didn't insert the clipboard at the cursor";
+  editor.undo();
+  editor.undo();
+  if (editor.buffer().read(0, editor.buffer().size()) != original)
+    return "undoing a cut and paste didn't bring the document back";
+
+  // The line break and indentation of ENTER are one edit
+  editor.setCursorPosition(original.indexOf("technique") + 9);
+  editor.keyPressEvent(&enter);
+  if (editor.buffer().size() != original.size() + 3)
+    return "ENTER didn't indent the new line";
+  editor.undo();
+  if (editor.buffer().read(0, editor.buffer().size()) != original)
+    return "undoing ENTER left some of its edit behind";
+
+  // Files with long lines go to LargeFileEditor, whatever their size
+  QString longPath = QDir(dir).absoluteFilePath("editing-long.material");
+  if (!bench::CorpusGenerator::writeFile(longPath, QString(TextEditor::MAX_LINE_LENGTH + 1, 'a') + "\nb\n"))
+    return "could not write " + longPath;
+  bool longLines = false;
+  if (TextEditor::canLayOut(longPath, &longLines) || !longLines)
+    return "a line longer than TextEditor::MAX_LINE_LENGTH wasn't found";
+  if (!TextEditor::canLayOut(path, &longLines) || longLines)
+    return "a script with short lines was turned away";
+  return QString();
+} // checkLargeEditing
+
+// ====================================================
+//  SHOWN LINES (local)
+// ====================================================
+/** @returns A 1 for each block of \e doc that is shown, and a 0 for each
+ * that a fold hides. */
+static QString shownLines(const QTextDocument* doc)
+{
+  QString shown;
+  for (QTextBlock block = doc->begin(); block.isValid(); block = block.next())
+    shown += (block.isVisible() ? '1' : '0');
+  return shown;
+} // shownLines
+
+// ====================================================
+//  CHECK FOLDING (local)
+// ====================================================
+/** Checks the scopes TextEditor finds to fold, what folding and unfolding
+ * them hides, and that the scopes follow edits.
+ * @param dir The directory to write the script to.
+ * @returns What went wrong, or an empty string. */
+static QString checkFolding(const QString& dir)
+{
+  QString path = QDir(dir).absoluteFilePath("folding.material");
+  QFile file(path);
+  QByteArray text("material A\n{\n  technique\n  {\n    pass\n    {\n      lighting off\n    }\n  }\n}\n"
+                  "material B {\n  receive_shadows on\n}");
+  if (!file.open(QFile::WriteOnly) || file.write(text) != text.size())
+    return "could not write " + path;
+  file.close();
+
+  TextEditor editor;
+  if (!editor.load(path))
+    return "could not load " + path;
+  QTextDocument* doc = editor.document();
+
+  // Headers and where their scopes end, -1 for lines that aren't headers
+  const int ends[] = {9, -1, 8, -1, 7, -1, -1, -1, -1, -1, 12, -1, -1};
+  for (int i = 0; i < doc->blockCount(); ++i)
+  {
+    QTextBlock end = editor.foldEnd(doc->findBlockByNumber(i));
+    if ((end.isValid() ? end.blockNumber() : -1) != ends[i])
+      return QString("the scope of line %1 ends at %2").arg(i).arg(end.blockNumber());
+  }
+
+  editor.setFolded(doc->findBlockByNumber(2), true);
+  if (shownLines(doc) != "1110000001111")
+    return "folding the technique shows " + shownLines(doc);
+
+  // A fold inside a folded one stays folded when the outer one is opened
+  editor.setFolded(doc->findBlockByNumber(4), true);
+  editor.setFolded(doc->findBlockByNumber(2), false);
+  if (shownLines(doc) != "1111100011111")
+    return "unfolding around a folded pass shows " + shownLines(doc);
+
+  editor.foldAll();
+  if (shownLines(doc) != "1000000000100")
+    return "folding everything shows " + shownLines(doc);
+  editor.unfoldAll();
+  if (shownLines(doc) != "1111111111111")
+    return "unfolding everything shows " + shownLines(doc);
+
+  // Typing in a folded scope opens it
+  editor.setFolded(doc->findBlockByNumber(4), true);
+  QTextCursor cursor(doc->findBlockByNumber(6));
+  cursor.movePosition(QTextCursor::EndOfBlock);
+  cursor.insertText(" // edited");
+  if (shownLines(doc) != "1111111111111" || editor.isFolded(doc->findBlockByNumber(4)))
+    return "editing a folded pass shows " + shownLines(doc);
+
+  // A new pass moves the end of the technique and is a scope of its own
+  cursor.setPosition(doc->findBlockByNumber(8).position());
+  cursor.insertText("    pass\n    {\n    }\n");
+  if (editor.foldEnd(doc->findBlockByNumber(2)).blockNumber() != 11)
+    return QString("the technique ends at %1 after a pass was added").arg(editor.foldEnd(doc->findBlockByNumber(2)).blockNumber());
+  if (editor.foldEnd(doc->findBlockByNumber(8)).blockNumber() != 10)
+    return QString("the added pass ends at %1").arg(editor.foldEnd(doc->findBlockByNumber(8)).blockNumber());
+  return QString();
+} // checkFolding
+
+// ====================================================
+//  OUTLINE TEXT (local)
+// ====================================================
+/** Adds a line for \e item and each entry under it to \e out, indented by
+ * two spaces a level. */
+static void outlineText(const QTreeWidgetItem* item, int depth, QString& out)
+{
+  out += QString(depth * 2, ' ') + item->text(0) + "\n";
+  for (int i = 0; i < item->childCount(); ++i)
+    outlineText(item->child(i), depth + 1, out);
+} // outlineText
+
+/** @returns The entries of \e outline, a line each. */
+static QString outlineText(const Outline& outline)
+{
+  QString out;
+  for (int i = 0; i < outline.topLevelItemCount(); ++i)
+    outlineText(outline.topLevelItem(i), 0, out);
+  return out;
+} // outlineText
+
+// ====================================================
+//  CHECK OUTLINE (local)
+// ====================================================
+/** Checks the entries Outline finds in a material script, that clicking one
+ * moves the cursor to it, and that patching the tree after each of a run of
+ * edits leaves it the same as building it again.
+ * @param dir The directory to write the script to.
+ * @returns What went wrong, or an empty string. */
+static QString checkOutline(const QString& dir)
+{
+  QString path = QDir(dir).absoluteFilePath("outline.material");
+  QFile file(path);
+  QByteArray text("material A\n{\n  technique\n  {\n    pass First\n    {\n      texture_unit\n      {\n"
+                  "        texture a.png\n      }\n    }\n  }\n}\n"
+                  "material B : A\n{\n  technique\n  {\n    pass\n    {\n    }\n  }\n}\n");
+  if (!file.open(QFile::WriteOnly) || file.write(text) != text.size())
+    return "could not write " + path;
+  file.close();
+
+  TextEditor editor;
+  if (!editor.load(path))
+    return "could not load " + path;
+  QTextDocument* doc = editor.document();
+
+  BenchOutline outline;
+  outline.setEditor(&editor);
+  QString expected("material A\n  technique\n    pass First\n      texture_unit\nmaterial B : A\n  technique\n    pass\n");
+  if (outlineText(outline) != expected)
+    return "the outline is \"" + outlineText(outline) + "\"";
+
+  QTreeWidgetItem* pass = outline.topLevelItem(1)->child(0)->child(0);
+  outline.onItemClicked(pass, 0);
+  if (editor.textCursor().block().text().trimmed() != "pass")
+    return "clicking the pass of B moved to \"" + editor.textCursor().block().text() + "\"";
+
+  // Each edit only touches the materials around it
+  QStringList edits;
+  QTextCursor cursor(doc);
+  for (int i = 0; i < 4; ++i)
+  {
+    if (i == 0)
+    {
+      // A second pass in A
+      cursor.setPosition(doc->findBlockByNumber(11).position());
+      cursor.insertText("    pass Second\n    {\n    }\n");
+    }
+    else if (i == 1)
+    {
+      // B is gone
+      cursor.setPosition(doc->findBlockByNumber(16).position());
+      cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+      cursor.removeSelectedText();
+    }
+    else if (i == 2)
+    {
+      // A material with its braces on its statements' lines
+      cursor.movePosition(QTextCursor::End);
+      cursor.insertText("material C {\n  technique {\n    pass {\n    }\n  }\n}\n");
+    }
+    else
+    {
+      // A renamed
+      cursor.setPosition(doc->begin().position() + 9);
+      cursor.deleteChar();
+      cursor.insertText("Renamed");
+    }
+    outline.refresh();
+
+    BenchOutline rebuilt;
+    rebuilt.setEditor(&editor);
+    if (outlineText(outline) != outlineText(rebuilt))
+      return QString("after edit %1 the outline is \"%2\" instead of \"%3\"").arg(i).arg(outlineText(outline), outlineText(rebuilt));
+  }
+
+  expected = "material Renamed\n  technique\n    pass First\n      texture_unit\n    pass Second\n"
+             "material C\n  technique\n    pass\n";
+  if (outlineText(outline) != expected)
+    return "after the edits the outline is \"" + outlineText(outline) + "\"";
+
+  // Entries are found from their top-level scope, which moved
+  outline.onItemClicked(outline.topLevelItem(1)->child(0), 0);
+  if (editor.textCursor().block().text().trimmed() != "technique {")
+    return "clicking the technique of C moved to \"" + editor.textCursor().block().text() + "\"";
+  return QString();
+} // checkOutline
+
+// ====================================================
+//  READ MATERIALS (local)
+// ====================================================
+/** @returns The materials defined in the script \e text. */
+static QVector<MaterialDefinition> readMaterials(const QByteArray& text)
+{
+  QVector<MaterialDefinition> definitions;
+  script::ScriptFile file;
+  file.parse(text.constData(), text.size());
+  MaterialDefinition::fromScript(file.root(), definitions);
+  return definitions;
+} // readMaterials
+
+// ====================================================
+//  CHECK FLATTENER (local)
+// ====================================================
+/** Checks the effective material MaterialFlattener works out for a chain
+ * of three materials, and that changing a definition forgets exactly the
+ * materials it reaches.
+ * @returns What went wrong, or an empty string. */
+static QString checkFlattener(void)
+{
+  QByteArray library("material A\n{\n  receive_shadows on\n  technique\n  {\n    pass Base\n    {\n"
+                     "      ambient 1 1 1\n      diffuse 1 1 1\n      param_named a float 1\n      param_named b float 2\n"
+                     "    }\n  }\n}\n"
+                     "material B : A\n{\n  technique\n  {\n    pass Base\n    {\n      diffuse 0.5 0.5 0.5\n    }\n"
+                     "    pass Glow\n    {\n      scene_blend add\n    }\n  }\n}\n"
+                     "material C : B\n{\n  receive_shadows off\n  technique\n  {\n    pass Base\n    {\n"
+                     "      param_named b float 3\n      texture_unit\n      {\n        texture c.png\n      }\n"
+                     "    }\n  }\n}\n"
+                     "material D\n{\n}\n");
+  QByteArray effective("material C\n{\n  receive_shadows off\n  technique\n  {\n    pass Base\n    {\n"
+                       "      ambient 1 1 1\n      diffuse 0.5 0.5 0.5\n      param_named a float 1\n      param_named b float 3\n"
+                       "      texture_unit\n      {\n        texture c.png\n      }\n    }\n"
+                       "    pass Glow\n    {\n      scene_blend add\n    }\n  }\n}\n");
+
+  MaterialFlattener flattener;
+  flattener.addScript("library.material", readMaterials(library));
+
+  MaterialStatement flattened;
+  QString error;
+  if (!flattener.flatten("C", flattened, &error))
+    return "C couldn't be flattened: " + error;
+  if (flattened != readMaterials(effective).first().body)
+    return "C flattened to \"" + flattened.toString() + "\"";
+  if (flattener.ancestry("c") != (QStringList() << "C" << "B" << "A"))
+    return "the ancestry of C is " + flattener.ancestry("c").join(" : ");
+
+  // Moving the materials down the script changes none of them, and changing
+  // A forgets the chain but not D
+  flattener.flatten("D", flattened);
+  if (flattener.flattenedCount() != 4)
+    return QString("%1 materials are kept instead of 4").arg(flattener.flattenedCount());
+  flattener.addScript("library.material", readMaterials("\n\n" + library));
+  if (flattener.flattenedCount() != 4)
+    return QString("moving the materials left %1 of them kept").arg(flattener.flattenedCount());
+  flattener.addScript("library.material", readMaterials(QByteArray(library).replace("ambient 1 1 1", "ambient 0 0 0")));
+  if (flattener.flattenedCount() != 1)
+    return QString("changing A left %1 materials kept instead of 1").arg(flattener.flattenedCount());
+  if (!flattener.flatten("C", flattened) ||
+      flattened != readMaterials(QByteArray(effective).replace("ambient 1 1 1", "ambient 0 0 0")).first().body)
+    return "after changing A, C flattened to \"" + flattened.toString() + "\"";
+
+  // Chains that can't be worked out
+  flattener.addScript("broken.material", readMaterials("material X : Y\n{\n}\nmaterial Y : X\n{\n}\nmaterial Z : Missing\n{\n}\n"));
+  if (flattener.flatten("X", flattened, &error) || !error.contains("cycle"))
+    return "a cycle flattened, or gave \"" + error + "\"";
+  if (flattener.flatten("Z", flattened, &error) || !error.contains("Missing"))
+    return "a missing parent flattened, or gave \"" + error + "\"";
+  return QString();
+} // checkFlattener
+
+// ====================================================
+//  CHECK SCRIPT DIFF (local)
+// ====================================================
+/** Checks the changes ScriptDiff finds between two versions of a script
+ * that also reorder its materials, reindent it and add a comment, none of
+ * which are changes.
+ * @returns What went wrong, or an empty string. */
+static QString checkScriptDiff(void)
+{
+  QByteArray before("material A\n{\n  technique\n  {\n    pass\n    {\n      ambient 1 1 1\n      diffuse 1 1 1\n"
+                    "      specular 1 1 1 8\n    }\n  }\n}\n"
+                    "material B\n{\n  receive_shadows on\n}\n"
+                    "material Old\n{\n  technique\n  {\n  }\n}\n"
+                    "material C : A\n{\n}\n");
+  QByteArray after("// B goes first now\nmaterial B\n{\n\treceive_shadows on\n}\n"
+                   "material A\n{\n  technique\n  {\n    pass\n    {\n      diffuse 1 1 1\n      ambient 0.5 0.5 0.5\n"
+                   "      lighting off\n    }\n    pass\n    {\n    }\n  }\n}\n"
+                   "material New\n{\n  technique\n  {\n  }\n}\n"
+                   "material C : B\n{\n}\n");
+
+  script::ScriptFile oldScript, newScript;
+  oldScript.parse(before.constData(), before.size());
+  newScript.parse(after.constData(), after.size());
+
+  QVector<ScriptChange> changes;
+  ScriptDiff::diff(oldScript.root(), oldScript.root(), changes);
+  if (!changes.isEmpty())
+    return "a script differs from itself: " + changes.first().toString();
+
+  QStringList expected;
+  expected << "~ material A > technique #1 > pass #1: ambient 1 1 1 -> ambient 0.5 0.5 0.5"
+           << "+ material A > technique #1 > pass #1: lighting off"
+           << "- material A > technique #1 > pass #1: specular 1 1 1 8"
+           << "+ material A > technique #1: pass"
+           << "= material Old -> material New"
+           << "~ material C : A -> material C : B";
+  ScriptDiff::diff(oldScript.root(), newScript.root(), changes);
+  QStringList found;
+  foreach (const ScriptChange& change, changes)
+    found << change.toString();
+  if (found != expected)
+    return "the changes found are \"" + found.join("\", \"") + "\"";
+  return QString();
+} // checkScriptDiff
+
+// ====================================================
+//  CHECK DUPLICATES (local)
+// ====================================================
+/** Checks the groups DuplicateFinder makes of a copy of a material under
+ * another name and laid out differently, a copy with one attribute changed,
+ * a copy that inherits from it, and an unrelated material.
+ * @returns What went wrong, or an empty string. */
+static QString checkDuplicates(void)
+{
+  QByteArray body("\n{\n  receive_shadows on\n  technique\n  {\n    pass\n    {\n      ambient 1 1 1\n      diffuse 1 1 1\n"
+                  "      specular 0 0 0 1\n      emissive 0 0 0\n      lighting off\n      depth_write off\n"
+                  "      scene_blend alpha_blend\n      texture_unit\n      {\n        texture m.png\n"
+                  "        filtering trilinear\n      }\n    }\n  }\n}\n");
+  QByteArray text = "material M1" + body;
+  text += "material M2" + QByteArray(body).replace("  ", "\t").replace("lighting off\n", "").replace("ambient", "lighting off\n\t\t\tambient");
+  text += "material M3" + QByteArray(body).replace("diffuse 1 1 1", "diffuse 0.5 0.5 0.5");
+  text += "material M4\n{\n  technique\n  {\n    pass\n    {\n      cull_hardware none\n    }\n  }\n}\n";
+  text += "material M5\n{\n}\n";
+  text += "material M6 : M1" + body;
+
+  script::ScriptFile parsed;
+  parsed.parse(text.constData(), text.size());
+  QVector<MaterialFingerprint> fingerprints;
+  MaterialFingerprint::fromScript(parsed.root(), "dupes.material", fingerprints);
+  if (fingerprints.size() != 5)
+    return QString("%1 materials were fingerprinted instead of 5").arg(fingerprints.size());
+
+  QVector<DuplicateGroup> groups;
+  DuplicateFinder::find(fingerprints, 0.8, groups);
+  if (groups.size() != 2)
+    return QString("%1 groups were found instead of 2").arg(groups.size());
+  if (!groups[0].exact || groups[0].members != (QVector<int>() << 0 << 1))
+    return "M1 and M2 aren't the identical group";
+  if (groups[1].exact || groups[1].members != (QVector<int>() << 0 << 1 << 2 << 4))
+    return "M1, M2, M3 and M6 aren't the similar group";
+  if (!groups[1].common.contains("technique #1/pass #1/lighting off") ||
+      groups[1].common.contains("technique #1/pass #1/diffuse 1 1 1"))
+    return "the similar group has \"" + groups[1].common.join("\", \"") + "\" in common";
+  return QString();
+} // checkDuplicates
+
+// ====================================================
+//  CHECK BUNDLE (local)
+// ====================================================
+/** Checks that scripts packed into a bundle come back out as they went in,
+ * that a damaged entry fails its checksum and a cut off bundle doesn't
+ * open, and that minifying a script keeps its statements.
+ * @param dir The directory to write the bundle to.
+ * @returns What went wrong, or an empty string. */
+static QString checkBundle(const QString& dir)
+{
+  QByteArray script("// A comment\nmaterial A\n{\n\ttechnique\n\t{\n\t\tpass\n\t\t{\n"
+                    "\t\t\ttexture_unit\n\t\t\t{\n\t\t\t\ttexture \"with space.png\"\n\t\t\t}\n\t\t}\n\t}\n}\n"
+                    "material B : A\n{\n}\n");
+  QVector<BundleEntry> entries(4);
+  entries[0].name = "scripts/b.material";
+  entries[0].data = script;
+  entries[1].name = "a.overlay";
+  entries[1].data = "Panel\n{\n\tzorder 100\n}\nMARKER\n";
+  entries[2].name = "scripts/a.material";
+  entries[2].data = "";
+  entries[3].name = "scripts/ab.material";
+  entries[3].data = "material AB\n{\n}\n";
+
+  QString path = QDir(dir).absoluteFilePath("check.bundle");
+  if (!ScriptBundle::write(path, entries))
+    return "could not write " + path;
+
+  ScriptBundle bundle;
+  if (!bundle.open(path))
+    return "could not open " + path;
+  if (bundle.count() != entries.size())
+    return QString("the bundle has %1 entries instead of %2").arg(bundle.count()).arg(entries.size());
+  foreach (const BundleEntry& entry, entries)
+  {
+    int index = bundle.find(entry.name);
+    if (index < 0 || bundle.name(index) != entry.name)
+      return entry.name + " isn't in the bundle";
+    if (QByteArray(bundle.data(index), bundle.size(index)) != entry.data || !bundle.verify(index))
+      return entry.name + " came back different";
+  }
+  if (bundle.find("scripts") >= 0 || bundle.find("A.overlay") >= 0)
+    return "a name that isn't in the bundle was found";
+  if (ScriptBundle::checksum("Wikipedia", 9) != 0x11E60398)
+    return QString("the checksum of \"Wikipedia\" is %1").arg(ScriptBundle::checksum("Wikipedia", 9), 0, 16);
+  bundle.close();
+
+  // Damage the data of one entry, then cut the bundle short
+  QFile file(path);
+  if (!file.open(QFile::ReadOnly))
+    return "could not read " + path;
+  QByteArray packed = file.readAll();
+  file.close();
+  QByteArray damaged = packed;
+  damaged.replace("MARKER", "MARKET");
+  if (!file.open(QFile::WriteOnly | QFile::Truncate) || file.write(damaged) != damaged.size())
+    return "could not write " + path;
+  file.close();
+  if (!bundle.open(path))
+    return "a bundle with damaged data didn't open";
+  if (bundle.verify(bundle.find("a.overlay")) || !bundle.verify(bundle.find("scripts/b.material")))
+    return "the checksums didn't find the damaged entry";
+  bundle.close();
+
+  if (!file.open(QFile::WriteOnly | QFile::Truncate) || file.write(packed.left(packed.size() - 1)) != packed.size() - 1)
+    return "could not write " + path;
+  file.close();
+  if (bundle.open(path))
+    return "a bundle that was cut short opened";
+
+  // Minified, the script has the same statements, and minifying it again
+  // changes nothing
+  script::ScriptFile original;
+  original.parse(script.constData(), script.size());
+  QByteArray minified = ScriptBundle::minify(original.root());
+  script::ScriptFile reparsed;
+  reparsed.parse(minified.constData(), minified.size());
+  QVector<ScriptChange> changes;
+  ScriptDiff::diff(original.root(), reparsed.root(), changes);
+  if (!changes.isEmpty())
+    return "minifying changed " + changes.first().toString();
+  if (ScriptBundle::minify(reparsed.root()) != minified || minified.contains("comment"))
+    return "the script minified to \"" + QString(minified) + "\"";
+  return QString();
+} // checkBundle
+
+// ====================================================
+//  CHECK RELOAD (local)
+// ====================================================
+/** Checks that TextEditor::reload() leaves the document matching the file
+ * through a run of versions that insert, remove and change lines, at the
+ * start and end of the file too, with and without a final line break.
+ * Each reload must also be taken back by a single undo.
+ * @param dir The directory to write the versions to.
+ * @returns What went wrong, or an empty string. */
+static QString checkReload(const QString& dir)
+{
+  QString base;
+  for (int i = 0; i < 5; ++i)
+    base += QString("material M%1\n{\n  technique\n  {\n  }\n}\n").arg(i);
+
+  QStringList versions;
+  versions << base;
+  versions << QString(base).replace("material M2\n{\n  technique\n", "material M2\n{\n  lod_distances 10\n  technique\n");
+  versions << QString(base).remove("material M1\n{\n  technique\n  {\n  }\n}\n");
+  versions << "// header\n" + base + "material M5\n{\n}\n";
+  versions << base.left(base.size() - 1);
+  versions << base.left(base.size() - 1) + " // last";
+  versions << base.left(base.lastIndexOf("material M4"));
+  versions << "";
+  versions << "material Only";
+  versions << base;
+
+  QString path = QDir(dir).absoluteFilePath("reload.material");
+  TextEditor editor;
+  for (int i = 0; i < versions.size(); ++i)
+  {
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate) || file.write(versions[i].toAscii()) != versions[i].size())
+      return "could not write " + path;
+    file.close();
+
+    if (i == 0)
+    {
+      if (!editor.load(path))
+        return "could not load " + path;
+      continue;
+    }
+
+    if (editor.reload(path) < 0)
+      return "could not reload " + path;
+    if (editor.toPlainText() != versions[i])
+      return QString("version %1 reloaded as \"%2\"").arg(i).arg(editor.toPlainText());
+
+    editor.document()->undo();
+    if (editor.toPlainText() != versions[i - 1])
+      return QString("undoing version %1 gave \"%2\"").arg(i).arg(editor.toPlainText());
+    editor.document()->redo();
+    if (editor.toPlainText() != versions[i])
+      return QString("redoing version %1 gave \"%2\"").arg(i).arg(editor.toPlainText());
+  }
+  return QString();
+} // checkReload
+
+// ====================================================
+//  DIAGNOSE (local)
+// ====================================================
+/** Runs the checks Diagnostics makes on a whole script.
+ * @returns The diagnostics of every line, in order. */
+static QVector<Diagnostic> diagnose(const QString& format, const QString& text)
+{
+  DiagnosticJob job;
+  job.firstBlock = 0;
+  job.script = Atom::intern("script");
+  job.words = config::ConfigFile::instance()->getWordsByFormat(format);
+  job.suggestions = config::ConfigFile::instance()->getSuggestionsByFormat(format);
+  foreach (QString line, text.split('\n'))
+    job.lines.push_back(line);
+
+  DiagnosticResult result = Diagnostics::check(job);
+  QVector<Diagnostic> found;
+  for (int i = 0; i < result.lines.size(); ++i)
+    found += result.lines[i];
+  return found;
+} // diagnose
+
+// ====================================================
+//  CHECK DIAGNOSTICS (local)
+// ====================================================
+/** Checks that valid overlay scripts get no diagnostics, and that a
+ * material with a mistake of each kind gets one of each.
+ * @param overlays The generated overlay corpus.
+ * @returns What went wrong, or an empty string. */
+static QString checkDiagnostics(const QString& overlays)
+{
+  QString overlay =
+    "overlay Bench/Check\n"
+    "{\n"
+    "  zorder 200\n"
+    "  container BorderPanel(Bench/Check/Panel)\n"
+    "  {\n"
+    "    metrics_mode pixels\n"
+    "    left 10\n"
+    "    top 10\n"
+    "    width 200\n"
+    "    height 100\n"
+    "    material Bench/Material_0\n"
+    "    border_size 2 2 2 2\n"
+    "    border_material Bench/Material_1\n"
+    "    element TextArea(Bench/Check/Text)\n"
+    "    {\n"
+    "      caption \"Check\"\n"
+    "      font_name BlueHighway\n"
+    "      char_height 16\n"
+    "      colour_top 1 1 1\n"
+    "      colour_bottom 0.5 0.5 0.5\n"
+    "      alignment left\n"
+    "    }\n"
+    "  }\n"
+    "}\n"
+    "\n"
+    "template container Panel(Bench/Template)\n"
+    "{\n"
+    "  left 0\n"
+    "  transparent true\n"
+    "}\n";
+  foreach (QString script, QStringList() << overlays << overlay)
+  {
+    QVector<Diagnostic> found = diagnose("overlays", script);
+    if (!found.isEmpty())
+      return QString("a valid overlay script got %1 diagnostics, the first \"%2\"").arg(found.size()).arg(found.first().message);
+  }
+
+  QString material =
+    "material Bench/Check\n"
+    "{\n"
+    "  technique\n"
+    "  {\n"
+    "    ambient 1 1 1\n"
+    "    pass\n"
+    "    {\n"
+    "      lightning on\n"
+    "    }\n"
+    "  }\n"
+    "}\n"
+    "}\n";
+  QVector<Diagnostic> found = diagnose("materials", material);
+  if (found.size() != 3 || found[0].kind != Diagnostic::WRONG_SCOPE || found[1].kind != Diagnostic::UNKNOWN_KEYWORD ||
+      found[2].kind != Diagnostic::UNMATCHED_BRACE)
+    return QString("a material with three mistakes got %1 diagnostics").arg(found.size());
+  return QString();
+} // checkDiagnostics
+
+// ====================================================
+//  MAIN
+// ====================================================
+int main(int argc, char** argv)
+{
+  if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+
+  QApplication app(argc, argv);
+  QTextStream out(stdout);
+
+  // Options
+  bench::CorpusOptions options;
+  int iterations = 5;
+  int keystrokes = 200;
+  int selection = 2000;
+  int largeMb = 64;
+  double threshold = 10.0;
+  QString dataDir = QCoreApplication::applicationDirPath();
+  QString output = "benchmark.json";
+  QString baseline;
+  QString label;
+
+  bench::OptionParser parser;
+  parser.add("--count", &options.count);
+  parser.add("--depth", &options.depth);
+  parser.add("--attributes", &options.attributes);
+  parser.add("--iterations", &iterations);
+  parser.add("--keystrokes", &keystrokes);
+  parser.add("--selection", &selection);
+  parser.add("--large-mb", &largeMb);
+  parser.addPath("--data", &dataDir);
+  parser.addPath("--output", &output);
+  parser.addPath("--baseline", &baseline);
+  parser.add("--threshold", &threshold);
+  parser.add("--label", &label);
+
+  QString error;
+  if (!parser.parse(QCoreApplication::arguments(), error))
+  {
+    out << error << endl;
+    return 2;
+  }
+  output = QDir::current().absoluteFilePath(output);
+
+  // Everything the benchmark writes goes into a scratch directory, which
+  // also becomes the working directory so ConfigFile picks up its config.xml.
+  // It is removed on every way out of main, including the failed checks.
+  bench::ScratchDirectory scratch(QDir::temp().absoluteFilePath(
+    QString("material-editor-bench-%1").arg(QCoreApplication::applicationPid())));
+  const QString& workDir = scratch.path();
+
+  bench::CorpusGenerator generator(options);
+  QString materials = generator.materials();
+  QString overlays = generator.overlays();
+  QString materialPath = QDir(workDir).absoluteFilePath("bench.material");
+  QString overlayPath = QDir(workDir).absoluteFilePath("bench.overlay");
+
+  if (!bench::CorpusGenerator::writeConfig(workDir, dataDir) ||
+      !bench::CorpusGenerator::writeFile(materialPath, materials) ||
+      !bench::CorpusGenerator::writeFile(overlayPath, overlays))
+  {
+    out << "Could not write the corpus to " << workDir << endl;
+    return 2;
+  }
+
+  bench::BenchmarkSuite suite;
+  suite.setInfo("label", label);
+  suite.setInfo("count", QString::number(options.count));
+  suite.setInfo("depth", QString::number(options.depth));
+  suite.setInfo("attributes", QString::number(options.attributes));
+  suite.setInfo("material_bytes", QString::number(QFileInfo(materialPath).size()));
+  suite.setInfo("overlay_bytes", QString::number(QFileInfo(overlayPath).size()));
+  suite.setInfo("qt_version", qVersion());
+
+  // ConfigFile
+  {
+    bench::Result& first = suite.add("config/first_load");
+    {
+      bench::Sample s(first);
+      config::ConfigFile::instance();
+    }
+
+    bench::Result& r = suite.add("config/reload");
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(r);
+      config::ConfigFile::instance()->reload();
+    }
+
+    // What saving a words file does while the editor runs: its format is
+    // loaded again into a copy of the rules, which takes their place
+    QStringList wordsFiles;
+    foreach (const QString& file, config::ConfigFile::instance()->getSourceFiles())
+    {
+      if (file.endsWith(".words") && QFileInfo(file).exists())
+        wordsFiles << file;
+    }
+    if (!wordsFiles.isEmpty())
+    {
+      bench::Result& hot = suite.add("config/hot_reload");
+      for (int i = 0; i < iterations; ++i)
+      {
+        bench::Sample s(hot);
+        config::ConfigFile* copy = config::ConfigFile::instance()->clone();
+        copy->reloadFiles(QStringList() << wordsFiles.first());
+        config::ConfigFile::instance()->replaceWith(copy);
+      }
+    }
+
+    if (config::ConfigFile::instance()->getWordsByFormat("materials").isEmpty())
+    {
+      out << "No words were loaded.  Is --data pointing at the bin directory?" << endl;
+      return 2;
+    }
+  }
+
+  bench::CorpusGenerator::writeManual(workDir, config::ConfigFile::instance()->getWordsByFormat("materials"));
+
+  // Parser
+  QString parserFailure = checkParser();
+  if (!parserFailure.isEmpty())
+  {
+    out << "Parser check failed: " << parserFailure << endl;
+    return 2;
+  }
+  benchParser(suite, "materials", materialPath, iterations);
+  benchParser(suite, "overlays", overlayPath, iterations);
+
+  // Highlighter
+  benchHighlighter(suite, "materials", materials, iterations);
+  benchHighlighter(suite, "overlays", overlays, iterations);
+
+  // TextEditor load/save
+  BenchEditor editor;
+  {
+    bench::Result& load = suite.add("editor/load", QFileInfo(materialPath).size());
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(load);
+      editor.load(materialPath);
+    }
+
+    QString savePath = QDir(workDir).absoluteFilePath("saved.material");
+    bench::Result& save = suite.add("editor/save", QFileInfo(materialPath).size());
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(save);
+      editor.save(savePath);
+    }
+  }
+
+  // Per keystroke work, sampled at positions spread through the document
+  {
+    QTextDocument* doc = editor.document();
+    int blocks = doc->blockCount();
+
+    bench::Result& indent = suite.add("editor/getNumIndent");
+    bench::Result& braces = suite.add("editor/matchBraces");
+    for (int i = 0; i < keystrokes; ++i)
+    {
+      QTextBlock block = doc->findBlockByNumber((blocks - 1) * (i + 1) / keystrokes);
+      QTextCursor cursor(block);
+      cursor.movePosition(QTextCursor::EndOfBlock);
+      editor.setTextCursor(cursor);
+
+      {
+        bench::Sample s(indent);
+        editor.getNumIndent();
+      }
+
+      // Type a new line and a closing brace, then undo both
+      cursor.beginEditBlock();
+      cursor.insertText("\n    ");
+      editor.setTextCursor(cursor);
+      {
+        bench::Sample s(braces);
+        editor.matchBraces();
+      }
+      cursor.endEditBlock();
+      doc->undo();
+    }
+  }
+
+  // Indentation of large selections
+  {
+    bench::Result& inc = suite.add("editor/increaseIndent");
+    bench::Result& dec = suite.add("editor/decreaseIndent");
+    for (int i = 0; i < iterations; ++i)
+    {
+      selectLines(editor, 0, selection);
+      {
+        bench::Sample s(inc);
+        editor.increaseIndent();
+      }
+
+      selectLines(editor, 0, selection);
+      {
+        bench::Sample s(dec);
+        editor.decreaseIndent();
+      }
+    }
+  }
+
+  // Folding: the largest scope on its own, then every scope at once.  Both
+  // should cost about the same however much text they hide.
+  {
+    QString failure = checkFolding(workDir);
+    if (!failure.isEmpty())
+    {
+      out << "Folding check failed: " << failure << endl;
+      return 2;
+    }
+
+    QTextDocument* doc = editor.document();
+    QTextBlock largest;
+    int largestLines = 0;
+    for (QTextBlock block = doc->begin(); block.isValid(); block = block.next())
+    {
+      QTextBlock end = editor.foldEnd(block);
+      if (end.isValid() && end.blockNumber() - block.blockNumber() > largestLines)
+      {
+        largest = block;
+        largestLines = end.blockNumber() - block.blockNumber();
+        block = end;
+      }
+    }
+
+    bench::Result& fold = suite.add("editor/fold");
+    bench::Result& unfold = suite.add("editor/unfold");
+    bench::Result& foldAll = suite.add("editor/foldAll");
+    bench::Result& unfoldAll = suite.add("editor/unfoldAll");
+    for (int i = 0; i < iterations; ++i)
+    {
+      {
+        bench::Sample s(fold);
+        editor.setFolded(largest, true);
+      }
+      {
+        bench::Sample s(unfold);
+        editor.setFolded(largest, false);
+      }
+      {
+        bench::Sample s(foldAll);
+        editor.foldAll();
+      }
+      {
+        bench::Sample s(unfoldAll);
+        editor.unfoldAll();
+      }
+    }
+    suite.setInfo("fold_lines", QString::number(largestLines));
+  }
+
+  // Outline: built in full, then patched after keystrokes spread through
+  // the document, each of which only touches the material it's typed in
+  {
+    QString failure = checkOutline(workDir);
+    if (!failure.isEmpty())
+    {
+      out << "Outline check failed: " << failure << endl;
+      return 2;
+    }
+
+    Outline outline;
+    bench::Result& build = suite.add("outline/build", QFileInfo(materialPath).size());
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(build);
+      outline.setEditor(&editor);
+    }
+    suite.setInfo("outline_entries", QString::number(outline.topLevelItemCount()));
+
+    QTextDocument* doc = editor.document();
+    int blocks = doc->blockCount();
+    bench::Result& patch = suite.add("outline/keystroke");
+    for (int i = 0; i < keystrokes; ++i)
+    {
+      QTextCursor cursor(doc->findBlockByNumber((blocks - 1) * (i + 1) / keystrokes));
+      cursor.movePosition(QTextCursor::EndOfBlock);
+      cursor.insertText("x");
+      {
+        bench::Sample s(patch);
+        outline.refresh();
+      }
+      doc->undo();
+      outline.refresh();
+    }
+  }
+
+  // Typo suggestions: every word of the format with one character changed,
+  // looked up in the format's suggestion index
+  {
+    const config::SuggestionIndex& index = config::ConfigFile::instance()->getSuggestionsByFormat("materials");
+    QStringList typos;
+    foreach (QString word, index.words())
+    {
+      word[word.size() / 2] = (word[word.size() / 2] == 'x' ? 'y' : 'x');
+      typos << word;
+    }
+
+    bench::Result& suggest = suite.add("suggest/query");
+    int found = 0;
+    for (int i = 0; i < keystrokes; ++i)
+    {
+      const QString& typo = typos[i % typos.size()];
+      QVector<int> nearest;
+      {
+        bench::Sample s(suggest);
+        index.suggest(typo, nearest, 3);
+      }
+      found += (nearest.isEmpty() ? 0 : 1);
+    }
+    suite.setInfo("suggest_words", QString::number(index.words().size()));
+    suite.setInfo("suggest_found_pct", QString::number(keystrokes ? 100 * found / keystrokes : 0));
+  }
+
+  // Resources: a tree of one material per script, with a texture beside
+  // each, listed and read into an index, then every name the material
+  // corpus refers to looked up in it
+  {
+    QString resourceDir = QDir(workDir).absoluteFilePath("resources");
+    QStringList chunks = materials.split("\nmaterial ");
+    qint64 scriptBytes = 0;
+    for (int i = 0; i < chunks.size(); ++i)
+    {
+      QDir dir(QString("%1/group%2").arg(resourceDir).arg(i % 20));
+      dir.mkpath(".");
+      QString text = (i == 0 ? chunks[i] : "material " + chunks[i]);
+      bench::CorpusGenerator::writeFile(dir.absoluteFilePath(QString("script%1.material").arg(i)), text);
+      bench::CorpusGenerator::writeFile(dir.absoluteFilePath(QString("texture%1.png").arg(i)), QString());
+      scriptBytes += text.toUtf8().size();
+    }
+    bench::CorpusGenerator::writeFile(QDir(resourceDir).absoluteFilePath("bench diffuse.png"), QString());
+
+    bench::Result& scan = suite.add("resources/scan", scriptBytes);
+    ResourceIndex index;
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(scan);
+      index.setDirectories(QStringList(resourceDir));
+      index.scan();
+    }
+
+    script::ScriptFile parsed;
+    parsed.open(materialPath);
+    QVector<ResourceReference> references;
+    ResourceIndex::findReferences(parsed.root(), references);
+
+    bench::Result& resolve = suite.add("resources/resolve_all");
+    int unresolved = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(resolve);
+      unresolved = 0;
+      foreach (const ResourceReference& reference, references)
+        unresolved += (index.resolve(reference) ? 0 : 1);
+    }
+    suite.setInfo("resources_files", QString::number(index.fileCount()));
+    suite.setInfo("resources_references", QString::number(references.size()));
+    suite.setInfo("resources_unresolved", QString::number(unresolved));
+
+    // The dependency graph of the same tree: built from nothing, brought up
+    // to date when nothing changed, and asked what a script reaches
+    bench::Result& build = suite.add("deps/build", scriptBytes);
+    DependencyGraph graph;
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(build);
+      graph = DependencyGraph();
+      graph.setDirectories(QStringList(resourceDir));
+      graph.refresh();
+    }
+
+    bench::Result& noop = suite.add("deps/refresh_noop");
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(noop);
+      graph.refresh();
+    }
+
+    DependencyNode file;
+    file.kind = DEPENDENCY_FILE;
+    file.name = QDir::cleanPath(QString("%1/group0/script0.material").arg(resourceDir));
+    bench::Result& affected = suite.add("deps/affected");
+    for (int i = 0; i < keystrokes; ++i)
+    {
+      QVector<DependencyNode> out;
+      bench::Sample s(affected);
+      graph.affectedBy(file, out);
+    }
+    suite.setInfo("deps_edges", QString::number(graph.edgeCount()));
+  }
+
+  // Inheritance: every material of the corpus worked out from nothing, then
+  // again after one of the parents changes, which only works out that
+  // parent's descendants
+  {
+    QString failure = checkFlattener();
+    if (!failure.isEmpty())
+    {
+      out << "Flattener check failed: " << failure << endl;
+      return 2;
+    }
+
+    script::ScriptFile parsed;
+    parsed.open(materialPath);
+    QVector<MaterialDefinition> definitions;
+    MaterialDefinition::fromScript(parsed.root(), definitions);
+
+    bench::Result& all = suite.add("flatten/all", QFileInfo(materialPath).size());
+    MaterialFlattener flattener;
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(all);
+      flattener = MaterialFlattener();
+      flattener.addScript(materialPath, definitions);
+      foreach (const MaterialDefinition& definition, definitions)
+      {
+        MaterialStatement effective;
+        flattener.flatten(definition.name, effective);
+      }
+    }
+
+    bench::Result& edit = suite.add("flatten/after_edit");
+    for (int i = 0; i < keystrokes && !definitions.isEmpty(); ++i)
+    {
+      QVector<MaterialDefinition> edited = definitions;
+      edited[0].body.children.push_back(MaterialStatement());
+      edited[0].body.children.last().keyword = QString("receive_shadows_%1").arg(i);
+
+      bench::Sample s(edit);
+      flattener.addScript(materialPath, edited);
+      foreach (const MaterialDefinition& definition, definitions)
+      {
+        MaterialStatement effective;
+        flattener.flatten(definition.name, effective);
+      }
+    }
+    suite.setInfo("flatten_materials", QString::number(definitions.size()));
+  }
+
+  // Structural diff: the corpus against itself, then against a copy with
+  // its materials in reverse order, reindented, and their lighting switched
+  {
+    QString failure = checkScriptDiff();
+    if (!failure.isEmpty())
+    {
+      out << "Script diff check failed: " << failure << endl;
+      return 2;
+    }
+
+    QStringList chunks = materials.split("\nmaterial ");
+    QString edited;
+    for (int i = chunks.size() - 1; i >= 0; --i)
+      edited += (i == 0 ? chunks[i] : "material " + chunks[i]).replace("\t", "    ") + "\n";
+    edited.replace("lighting off", "lighting on");
+    QByteArray before = materials.toUtf8();
+    QByteArray after = edited.toUtf8();
+
+    script::ScriptFile oldScript, newScript;
+    oldScript.parse(before.constData(), before.size());
+    newScript.parse(after.constData(), after.size());
+
+    bench::Result& same = suite.add("diff/identical", before.size());
+    for (int i = 0; i < iterations; ++i)
+    {
+      QVector<ScriptChange> changes;
+      bench::Sample s(same);
+      ScriptDiff::diff(oldScript.root(), oldScript.root(), changes);
+    }
+
+    bench::Result& changed = suite.add("diff/reordered_edited", after.size());
+    QVector<ScriptChange> changes;
+    for (int i = 0; i < iterations; ++i)
+    {
+      changes.clear();
+      bench::Sample s(changed);
+      ScriptDiff::diff(oldScript.root(), newScript.root(), changes);
+    }
+    suite.setInfo("diff_changes", QString::number(changes.size()));
+  }
+
+  // Duplicates: every material of the corpus fingerprinted, then grouped
+  {
+    QString failure = checkDuplicates();
+    if (!failure.isEmpty())
+    {
+      out << "Duplicate check failed: " << failure << endl;
+      return 2;
+    }
+
+    script::ScriptFile parsed;
+    parsed.open(materialPath);
+
+    bench::Result& fingerprint = suite.add("dupes/fingerprint", QFileInfo(materialPath).size());
+    QVector<MaterialFingerprint> fingerprints;
+    for (int i = 0; i < iterations; ++i)
+    {
+      fingerprints.clear();
+      bench::Sample s(fingerprint);
+      MaterialFingerprint::fromScript(parsed.root(), materialPath, fingerprints);
+    }
+
+    bench::Result& group = suite.add("dupes/group");
+    QVector<DuplicateGroup> groups;
+    for (int i = 0; i < iterations; ++i)
+    {
+      groups.clear();
+      bench::Sample s(group);
+      DuplicateFinder::find(fingerprints, 0.8, groups);
+    }
+    suite.setInfo("dupes_materials", QString::number(fingerprints.size()));
+    suite.setInfo("dupes_groups", QString::number(groups.size()));
+  }
+
+  // Bundles: the corpus split into a script per material, minified and
+  // packed, then the bundle opened and every script in it found and parsed
+  // where it lies in the mapping
+  {
+    QString failure = checkBundle(workDir);
+    if (!failure.isEmpty())
+    {
+      out << "Bundle check failed: " << failure << endl;
+      return 2;
+    }
+
+    QStringList chunks = materials.split("\nmaterial ");
+    QVector<BundleEntry> sources;
+    for (int i = 0; i < chunks.size(); ++i)
+    {
+      BundleEntry entry;
+      entry.name = QString("materials/%1.material").arg(i, 5, 10, QChar('0'));
+      entry.data = (i == 0 ? chunks[i] : "material " + chunks[i]).toUtf8();
+      sources.push_back(entry);
+    }
+    QString bundlePath = QDir(workDir).absoluteFilePath("bench.bundle");
+
+    bench::Result& packed = suite.add("bundle/pack", materials.size());
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(packed);
+      QVector<BundleEntry> entries = sources;
+      for (int k = 0; k < entries.size(); ++k)
+      {
+        script::ScriptFile parsed;
+        parsed.parse(entries[k].data.constData(), entries[k].data.size());
+        entries[k].data = ScriptBundle::minify(parsed.root());
+      }
+      ScriptBundle::write(bundlePath, entries);
+    }
+
+    bench::Result& opened = suite.add("bundle/open_all", QFileInfo(bundlePath).size());
+    int nodes = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(opened);
+      ScriptBundle bundle;
+      bundle.open(bundlePath);
+      nodes = 0;
+      foreach (const BundleEntry& source, sources)
+      {
+        int index = bundle.find(source.name);
+        script::ScriptFile parsed;
+        parsed.parse(bundle.data(index), bundle.size(index));
+        nodes += parsed.nodeCount();
+      }
+    }
+    suite.setInfo("bundle_bytes", QString::number(QFileInfo(bundlePath).size()));
+    suite.setInfo("bundle_nodes", QString::number(nodes));
+  }
+
+  // Manual search: the corpus's manual indexed from nothing, then searched
+  // as a keyword is typed one letter at a time
+  {
+    QString manualDir = QDir(workDir).absoluteFilePath("manual");
+    ManualIndex index;
+    bench::Result& build = suite.add("docs/index");
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(build);
+      index = ManualIndex();
+      index.setDirectory(manualDir);
+      index.refresh();
+    }
+
+    QStringList typed;
+    typed << "scene_blend" << "texture unit" << "lighting off";
+    bench::Result& query = suite.add("docs/search_as_you_type");
+    for (int i = 0; i < keystrokes; ++i)
+    {
+      const QString& text = typed[i % typed.size()];
+      QVector<ManualHit> found;
+      bench::Sample s(query);
+      index.search(text.left(1 + i / typed.size() % text.size()), 20, found);
+    }
+    suite.setInfo("docs_pages", QString::number(index.pageCount()));
+    suite.setInfo("docs_terms", QString::number(index.termCount()));
+  }
+
+  // Diagnostics: checking the whole document, as the worker thread does
+  // after a load, and how long after a keystroke its results land.  A few
+  // misspelt keywords are planted so there is something to find.
+  {
+    QString failure = checkDiagnostics(overlays);
+    if (!failure.isEmpty())
+    {
+      out << "Diagnostics check failed: " << failure << endl;
+      return 2;
+    }
+
+    QTextDocument* doc = editor.document();
+    int blocks = doc->blockCount();
+    QTextCursor cursor(doc);
+    for (int i = 1; i <= 5; ++i)
+    {
+      cursor.setPosition(doc->findBlockByNumber(blocks * i / 6).position());
+      cursor.insertText("lightning on\n");
+    }
+
+    DiagnosticJob job;
+    job.firstBlock = 0;
+    job.script = Atom::intern("script");
+    job.words = config::ConfigFile::instance()->getWordsByFormat("materials");
+    job.suggestions = config::ConfigFile::instance()->getSuggestionsByFormat("materials");
+    for (QTextBlock block = doc->begin(); block.isValid(); block = block.next())
+      job.lines.push_back(block.text());
+
+    bench::Result& check = suite.add("diagnostics/check", doc->characterCount());
+    int found = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(check);
+      DiagnosticResult result = Diagnostics::check(job);
+      found = 0;
+      for (int line = 0; line < result.lines.size(); ++line)
+        found += result.lines[line].size();
+    }
+    suite.setInfo("diagnostics_found", QString::number(found));
+
+    Diagnostics* diagnostics = editor.diagnostics();
+    while (diagnostics->isPending())
+      app.processEvents(QEventLoop::WaitForMoreEvents);
+
+    // Each of these waits out the delay before checking starts, so fewer
+    bench::Result& latency = suite.add("diagnostics/latency");
+    int count = qMax(1, keystrokes / 10);
+    for (int i = 0; i < count; ++i)
+    {
+      cursor.setPosition(doc->findBlockByNumber((blocks - 1) * (i + 1) / count).position());
+      {
+        bench::Sample s(latency);
+        cursor.insertText("x");
+        while (diagnostics->isPending())
+          app.processEvents(QEventLoop::WaitForMoreEvents);
+      }
+      doc->undo();
+    }
+    while (diagnostics->isPending())
+      app.processEvents(QEventLoop::WaitForMoreEvents);
+    editor.load(materialPath);
+  }
+
+  // Reloading after another program changes a few scattered lines, going
+  // back and forth between the two versions
+  {
+    QString failure = checkReload(workDir);
+    if (!failure.isEmpty())
+    {
+      out << "Reload check failed: " << failure << endl;
+      return 2;
+    }
+
+    QString changedPath = QDir(workDir).absoluteFilePath("changed.material");
+    QStringList lines = materials.split('\n');
+    for (int i = 0; i < lines.size(); i += 1000)
+      lines[i] += " // changed";
+    QFile file(changedPath);
+    if (file.open(QFile::WriteOnly))
+      file.write(lines.join("\n").toAscii());
+    file.close();
+
+    editor.load(materialPath);
+    bench::Result& reload = suite.add("editor/reload", QFileInfo(materialPath).size());
+    int changed = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(reload);
+      changed = editor.reload(i % 2 == 0 ? changedPath : materialPath);
+    }
+    suite.setInfo("reload_lines", QString::number(changed));
+    editor.load(materialPath);
+  }
+
+  // Autosave journal: what journaling costs a keystroke on the GUI thread,
+  // how long changes take to reach the disk and how many bytes are written
+  // for each one edited.  Typing moves to a new spot every 20 keystrokes.
+  {
+    QString journalDir = QDir(workDir).absoluteFilePath("journal");
+    JournalWriter writer(journalDir);
+    Journal* journal = new Journal(&editor, &writer);
+    journal->setFile(materialPath, "bench.material");
+
+    QTextDocument* doc = editor.document();
+    int blocks = doc->blockCount();
+    QTextCursor cursor(doc);
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText("\n");
+    app.processEvents();    // Takes the journal's snapshot
+
+    bench::Result& type = suite.add("journal/keystroke");
+    int count = keystrokes * 10;
+    for (int i = 0; i < count; ++i)
+    {
+      if (i % 20 == 0)
+        cursor.setPosition(doc->findBlockByNumber((blocks - 1) * i / count).position());
+
+      bench::Sample s(type);
+      cursor.insertText(i % 20 == 19 ? "\n" : "x");
+    }
+
+    bench::Result& flush = suite.add("journal/flush");
+    {
+      bench::Sample s(flush);
+      writer.flush();
+    }
+
+    JournalWriter::Stats stats = writer.stats();
+    suite.setInfo("journal_edit_bytes", QString::number(stats.editBytes));
+    suite.setInfo("journal_written_bytes", QString::number(stats.writtenBytes));
+    suite.setInfo("journal_write_amplification", QString::number(stats.writtenBytes / qMax(1.0, static_cast<double>(stats.editBytes)), 'f', 2));
+    suite.setInfo("journal_records", QString::number(stats.records));
+    suite.setInfo("journal_batches", QString::number(stats.batches));
+    suite.setInfo("journal_compactions", QString::number(stats.compactions));
+    suite.setInfo("journal_latency_mean_ms", QString::number(stats.meanLatencyMs, 'f', 2));
+    suite.setInfo("journal_latency_max_ms", QString::number(stats.maxLatencyMs, 'f', 2));
+
+    // Recovery skips the journals of the running process, so replay copies
+    // of them that look like another's
+    QString recoverDir = QDir(workDir).absoluteFilePath("recover");
+    QDir().mkpath(recoverDir);
+    qint64 journalBytes = 0;
+    foreach (QFileInfo fi, QDir(journalDir).entryInfoList(QStringList() << "*.journal", QDir::Files))
+    {
+      QFile::copy(fi.absoluteFilePath(), QDir(recoverDir).absoluteFilePath("0-" + fi.fileName()));
+      journalBytes += fi.size();
+    }
+
+    bench::Result& recover = suite.add("journal/recover", journalBytes);
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(recover);
+      JournalWriter::recover(recoverDir);
+    }
+
+    QString checkDir = QDir(workDir).absoluteFilePath("journal-check");
+    QDir().mkpath(checkDir);
+    QString failure = checkJournals(checkDir);
+    if (!failure.isEmpty())
+    {
+      out << "Journal check failed: " << failure << endl;
+      return 2;
+    }
+
+    delete journal;
+    editor.load(materialPath);
+  }
+
+  // Large file mode, on the material corpus repeated up to --large-mb
+  {
+    QString failure = checkPieceTable();
+    if (!failure.isEmpty())
+    {
+      out << "Piece table check failed: " << failure << endl;
+      return 2;
+    }
+    failure = checkRows(workDir);
+    if (!failure.isEmpty())
+    {
+      out << "Row check failed: " << failure << endl;
+      return 2;
+    }
+    failure = checkLargeEditing(workDir);
+    if (!failure.isEmpty())
+    {
+      out << "Large editing check failed: " << failure << endl;
+      return 2;
+    }
+
+    QString largePath = QDir(workDir).absoluteFilePath("large.material");
+    {
+      QFile file(largePath);
+      if (!file.open(QFile::WriteOnly))
+      {
+        out << "Could not write " << largePath << endl;
+        return 2;
+      }
+
+      QByteArray chunk = materials.toAscii();
+      for (qint64 written = 0; written < largeMb * Q_INT64_C(1024 * 1024); written += chunk.size())
+        file.write(chunk);
+    }
+    qint64 largeBytes = QFileInfo(largePath).size();
+    suite.setInfo("large_bytes", QString::number(largeBytes));
+
+    BenchLargeEditor large;
+    large.resize(800, 600);
+    bench::Result& open = suite.add("largefile/open", largeBytes);
+    for (int i = 0; i < iterations; ++i)
+    {
+      bench::Sample s(open);
+      large.load(largePath);
+    }
+
+    // Jump to positions spread through the file and type a line there
+    bench::Result& jump = suite.add("largefile/jump");
+    bench::Result& type = suite.add("largefile/keystroke");
+    bench::Result& indent = suite.add("largefile/getNumIndent");
+    QKeyEvent enter(QEvent::KeyPress, Qt::Key_Return, Qt::NoModifier, "\n");
+    QKeyEvent letter(QEvent::KeyPress, Qt::Key_A, Qt::NoModifier, "a");
+    for (int i = 0; i < keystrokes; ++i)
+    {
+      {
+        bench::Sample s(jump);
+        large.setCursorPosition(largeBytes * i / keystrokes);
+      }
+      {
+        bench::Sample s(indent);
+        large.getNumIndent();
+      }
+      {
+        bench::Sample s(type);
+        large.keyPressEvent(&enter);
+        large.keyPressEvent(&letter);
+      }
+    }
+    suite.setInfo("large_edit_memory", QString::number(large.estimatedMemory()));
+    suite.setInfo("large_pieces", QString::number(large.buffer().pieceCount()));
+
+    QString savePath = QDir(workDir).absoluteFilePath("large-saved.material");
+    bench::Result& save = suite.add("largefile/save", largeBytes);
+    {
+      bench::Sample s(save);
+      large.save(savePath);
+    }
+  }
+
+  // Long lines, on the material corpus written out as a single line the
+  // way some exporters do
+  {
+    QString longPath = QDir(workDir).absoluteFilePath("long.material");
+    QString oneLine = materials;
+    oneLine.replace('\n', ' ');
+    if (!bench::CorpusGenerator::writeFile(longPath, oneLine))
+    {
+      out << "Could not write " << longPath << endl;
+      return 2;
+    }
+    suite.setInfo("long_line_bytes", QString::number(oneLine.size()));
+
+    // Paint the view at columns spread along the line, which highlights
+    // the chunks there
+    BenchLargeEditor large;
+    large.resize(800, 600);
+    large.load(longPath);
+    QImage image(large.viewport()->size(), QImage::Format_RGB32);
+    bench::Result& paint = suite.add("longline/paint");
+    for (int i = 0; i < keystrokes; ++i)
+    {
+      large.setCursorPosition(static_cast<qint64>(oneLine.size()) * i / keystrokes);
+      bench::Sample s(paint);
+      large.viewport()->render(&image);
+    }
+
+    // Type in the middle of the line and paint, which shouldn't have to
+    // search the line for its ends
+    bench::Result& type = suite.add("longline/keystroke");
+    QKeyEvent letter(QEvent::KeyPress, Qt::Key_A, Qt::NoModifier, "a");
+    large.setCursorPosition(oneLine.size() / 2);
+    for (int i = 0; i < keystrokes; ++i)
+    {
+      bench::Sample s(type);
+      large.keyPressEvent(&letter);
+      large.viewport()->render(&image);
+    }
+
+    bench::Result& reflow = suite.add("longline/reflow", oneLine.size());
+    {
+      bench::Sample s(reflow);
+      large.reflow();
+    }
+
+    // Open a 5 MB script on a single line the way the user would, through
+    // the IDE, and paint it.  It has to land in a LargeFileEditor, since a
+    // TextEditor would lay out and highlight the whole line.
+    QString minifiedPath = QDir(workDir).absoluteFilePath("minified.material");
+    QString minified = oneLine;
+    while (minified.size() < 5 * 1024 * 1024)
+      minified += ' ' + oneLine;
+    if (!bench::CorpusGenerator::writeFile(minifiedPath, minified))
+    {
+      out << "Could not write " << minifiedPath << endl;
+      return 2;
+    }
+
+    bench::Result& open = suite.add("longline/open", minified.size());
+    for (int i = 0; i < iterations; ++i)
+    {
+      BenchIDE ide;
+      ide.resize(1024, 768);
+      {
+        bench::Sample s(open);
+        ide.openFile(minifiedPath);
+        QWidget* view = ide.currentWidget();
+        QImage page(view->size(), QImage::Format_RGB32);
+        view->render(&page);
+      }
+      if (!ide.currentIsLarge())
+      {
+        out << "A single-line script of " << minified.size() << " bytes was opened in a TextEditor" << endl;
+        return 2;
+      }
+    }
+  }
+
+  // Keyword documentation lookups
+  {
+    BenchIDE ide;
+    const config::FormatWordMap& words = config::ConfigFile::instance()->getWordsByFormat("materials");
+
+    bench::Result& r = suite.add("ide/setKeyword");
+    config::FormatWordMap::const_iterator citr = words.begin();
+    for (; citr != words.end(); ++citr)
+    {
+      bench::Sample s(r);
+      ide.setKeyword(citr->atom, "materials");
+    }
+  }
+
+  // Sessions: opening SESSION_FILES files one after another, against
+  // restoring them from a session, which only loads the current tab, and
+  // the first showing of another tab, which loads it from its saved
+  // highlighting
+  {
+    bench::CorpusOptions fileOptions = options;
+    fileOptions.count = qMax(1, options.count / 20);
+    QString text = bench::CorpusGenerator(fileOptions).materials();
+    QStringList paths;
+    for (int i = 0; i < SESSION_FILES; ++i)
+    {
+      paths << QDir(workDir).absoluteFilePath(QString("session%1.material").arg(i));
+      bench::CorpusGenerator::writeFile(paths.last(), text);
+    }
+    suite.setInfo("session_files", QString::number(SESSION_FILES));
+    suite.setInfo("session_file_bytes", QString::number(text.size()));
+
+    bench::Result& openAll = suite.add("session/open_all");
+    bench::Result& save = suite.add("session/save");
+    bench::Result& restore = suite.add("session/restore");
+    bench::Result& cached = suite.add("session/first_view_cached");
+    bench::Result& uncached = suite.add("session/first_view_uncached");
+    for (int i = 0; i < iterations; ++i)
+    {
+      QFile::remove("session.dat");
+      {
+        BenchIDE ide;
+        {
+          bench::Sample s(openAll);
+          foreach (QString path, paths)
+            ide.openFile(path);
+        }
+        {
+          bench::Sample s(save);
+          ide.saveSession();
+        }
+        suite.setInfo("session_bytes", QString::number(QFileInfo("session.dat").size()));
+      }
+      {
+        BenchIDE ide;
+        {
+          bench::Sample s(restore);
+          ide.restoreSession();
+        }
+        {
+          bench::Sample s(cached);
+          ide.showTab(0);
+        }
+      }
+      {
+        BenchIDE ide;
+        bench::Sample s(uncached);
+        ide.openFile(paths[0]);
+      }
+    }
+  }
+
+  suite.print(out);
+
+  int status = 0;
+  if (!suite.writeJson(output))
+  {
+    out << "Could not write " << output << endl;
+    status = 2;
+  }
+  else
+    out << "Results written to " << output << endl;
+
+  if (!baseline.isEmpty())
+  {
+    out << "\nCompared to " << baseline << " (threshold " << threshold << "%):\n";
+    int regressions = suite.compare(baseline, threshold, out);
+    if (regressions < 0)
+    {
+      out << "Could not read the baseline" << endl;
+      status = 2;
+    }
+    else if (regressions > 0)
+    {
+      out << regressions << " benchmark(s) regressed" << endl;
+      status = 1;
+    }
+  }
+
+  return status;
+}
\ No newline at end of file
@@ -0,0 +1,251 @@
+/* Keystroke replay harness.  Replays a recorded keystroke session (see
+ * Options > Record Keystrokes in the editor) into a headless IDE and measures
+ * how long each key press takes, from TextEditor::keyPressEvent until
+ * highlighting, the status bar and document layout have settled.
+ *
+ * Usage: replay [options]
+ *   --session FILE     Session to replay.  Without one, a built-in session
+ *                      covering typing, Enter, '}', Tab/Shift+Tab on a
+ *                      selection and Ctrl+Up/Down is used.
+ *   --file FILE        File to replay into, instead of the session's file
+ *   --lines N          Size of the generated file when neither the session
+ *                      nor --file name one (100000)
+ *   --rounds N         Repetitions of the built-in session (50)
+ *   --save-session F   Saves the built-in session, as a starting point for
+ *                      hand-written ones
+ *   --data DIR         Directory with the .words/.highlights files (exe dir)
+ *   --output FILE      Where to write the JSON results (replay.json)
+ *   --budget MS        Fails if any key type's p99 latency is over MS
+ *
+ * Returns 1 if the budget is exceeded. */
+#include <QtGui/QApplication>
+#include <QtGui/QKeyEvent>
+#include <QtGui/QTextBlock>
+#include <QtGui/QTextCursor>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+#include "ConfigFile.h"
+#include "IDE.h"
+#include "TextEditor.h"
+#include "KeystrokeSession.h"
+#include "Corpus.h"
+#include "BenchmarkSuite.h"
+
+/** Gives the harness access to the editors inside IDE. */
+class ReplayIDE : public IDE
+{
+public:
+  using IDE::onFileDropped;
+
+  TextEditor* currentEditor(void) const
+  {
+    return mpCurrentEditor ? mpCurrentEditor->editor : NULL;
+  }
+};
+
+// ====================================================
+//  TYPE TEXT (local)
+// ====================================================
+static void typeText(KeystrokeSession& session, const QString& text)
+{
+  // Printable ASCII keys share their code with the upper case character
+  foreach (QChar ch, text)
+    session.append(ch.toUpper().unicode(), 0, QString(ch));
+} // typeText
+
+// ====================================================
+//  BUILD SESSION (local)
+// ====================================================
+static void buildSession(KeystrokeSession& session, int rounds)
+{
+  for (int i = 0; i < rounds; ++i)
+  {
+    // Type a texture_unit block, with auto-indent and brace matching
+    session.append(Qt::Key_Return, 0, "\r");
+    typeText(session, "texture_unit");
+    session.append(Qt::Key_Return, 0, "\r");
+    typeText(session, "{");
+    session.append(Qt::Key_Return, 0, "\r");
+    typeText(session, "texture bench.png");
+    session.append(Qt::Key_Return, 0, "\r");
+    typeText(session, "filtering trilinear");
+    session.append(Qt::Key_Return, 0, "\r");
+    session.append(Qt::Key_BraceRight, 0, "}");
+
+    // Indent the block and take it back out again
+    for (int j = 0; j < 4; ++j)
+      session.append(Qt::Key_Up, Qt::ShiftModifier);
+    session.append(Qt::Key_Tab, 0, "\t");
+    session.append(Qt::Key_Backtab, Qt::ShiftModifier);
+    session.append(Qt::Key_Down);
+
+    // Cycle through the syntaxes of the keyword on this line
+    session.append(Qt::Key_Up, Qt::ControlModifier);
+    session.append(Qt::Key_Up, Qt::ControlModifier);
+    session.append(Qt::Key_Down, Qt::ControlModifier);
+    session.append(Qt::Key_End);
+  }
+} // buildSession
+
+// ====================================================
+//  FIND PASS (local)
+// ====================================================
+static int findPass(QTextDocument* doc)
+{
+  // The built-in session starts inside a pass halfway through the file
+  QTextBlock block = doc->findBlockByNumber(doc->blockCount() / 2);
+  for (; block.isValid(); block = block.next())
+  {
+    if (block.text().trimmed() == "pass" && block.next().isValid())
+      return block.next().position() + block.next().length() - 1;
+  }
+  return 0;
+} // findPass
+
+// ====================================================
+//  MAIN
+// ====================================================
+int main(int argc, char** argv)
+{
+  if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+
+  QApplication app(argc, argv);
+  QTextStream out(stdout);
+
+  // Options
+  QString sessionPath;
+  QString filePath;
+  QString saveSession;
+  QString dataDir = QCoreApplication::applicationDirPath();
+  QString output = "replay.json";
+  int lines = 100000;
+  int rounds = 50;
+  double budget = 0.0;
+
+  bench::OptionParser parser;
+  parser.addPath("--session", &sessionPath);
+  parser.addPath("--file", &filePath);
+  parser.add("--lines", &lines);
+  parser.add("--rounds", &rounds);
+  parser.addPath("--save-session", &saveSession);
+  parser.addPath("--data", &dataDir);
+  parser.addPath("--output", &output);
+  parser.add("--budget", &budget);
+
+  QString error;
+  if (!parser.parse(QCoreApplication::arguments(), error))
+  {
+    out << error << endl;
+    return 2;
+  }
+  output = QDir::current().absoluteFilePath(output);
+
+  // The session
+  KeystrokeSession session;
+  bool builtIn = sessionPath.isEmpty();
+  if (builtIn)
+  {
+    buildSession(session, rounds);
+    if (!saveSession.isEmpty())
+      session.save(saveSession);
+  }
+  else if (!session.load(sessionPath))
+  {
+    out << "Could not load " << sessionPath << endl;
+    return 2;
+  }
+
+  if (filePath.isEmpty() && QFileInfo(session.file).exists())
+    filePath = session.file;
+
+  // Scratch directory with a config.xml and manual, as in the benchmark
+  bench::ScratchDirectory scratch(QDir::temp().absoluteFilePath(
+    QString("material-editor-replay-%1").arg(QCoreApplication::applicationPid())));
+  const QString& workDir = scratch.path();
+  bench::CorpusGenerator::writeConfig(workDir, dataDir);
+  bench::CorpusGenerator::writeManual(workDir, config::ConfigFile::instance()->getWordsByFormat("materials"));
+
+  // Generate a file of roughly the requested size if there isn't one
+  if (filePath.isEmpty())
+  {
+    bench::CorpusOptions options;
+    options.count = 1;
+    int linesPerMaterial = qMax(1, bench::CorpusGenerator(options).materials().count('\n'));
+    options.count = qMax(1, lines / linesPerMaterial);
+
+    filePath = QDir(workDir).absoluteFilePath("replay.material");
+    bench::CorpusGenerator::writeFile(filePath, bench::CorpusGenerator(options).materials());
+  }
+
+  ReplayIDE ide;
+  ide.resize(1024, 768);
+  ide.show();
+  ide.onFileDropped(filePath);
+  app.processEvents();
+
+  TextEditor* editor = ide.currentEditor();
+  if (editor == NULL)
+  {
+    out << "Could not open " << filePath << endl;
+    return 2;
+  }
+
+  QTextCursor cursor = editor->textCursor();
+  cursor.setPosition(builtIn ? findPass(editor->document()) : qMin(session.cursorPosition, editor->document()->characterCount() - 1));
+  editor->setTextCursor(cursor);
+  app.processEvents();
+
+  // Replay
+  bench::BenchmarkSuite suite;
+  suite.setInfo("file", filePath);
+  suite.setInfo("lines", QString::number(editor->document()->blockCount()));
+  suite.setInfo("session", builtIn ? QString("built-in") : sessionPath);
+  suite.setInfo("keystrokes", QString::number(session.keystrokes.size()));
+
+  QMap<QString, bench::Result*> results;
+  foreach (const Keystroke& k, session.keystrokes)
+  {
+    QString category = KeystrokeSession::category(k);
+    bench::Result*& result = results[category];
+    if (result == NULL)
+      result = &suite.add("keystroke/" + category);
+
+    QKeyEvent press(QEvent::KeyPress, k.key, Qt::KeyboardModifiers(k.modifiers), k.text);
+    QKeyEvent release(QEvent::KeyRelease, k.key, Qt::KeyboardModifiers(k.modifiers), k.text);
+    {
+      // Highlighting and the status bar are updated synchronously, layout
+      // and repaints are posted, so flush them before stopping the clock
+      bench::Sample s(*result);
+      QApplication::sendEvent(editor, &press);
+      QApplication::sendEvent(editor, &release);
+      app.processEvents();
+    }
+  }
+
+  suite.print(out);
+  int status = 0;
+  if (!suite.writeJson(output))
+  {
+    out << "Could not write " << output << endl;
+    status = 2;
+  }
+
+  if (budget > 0.0)
+  {
+    QMap<QString, bench::Result*>::const_iterator citr = results.begin();
+    for (; citr != results.end(); ++citr)
+    {
+      double p99 = (*citr)->percentile(99);
+      if (p99 > budget)
+      {
+        out << citr.key() << ": p99 " << p99 << " ms is over the budget of " << budget << " ms" << endl;
+        status = 1;
+      }
+    }
+  }
+
+  return status;
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+# Benchmark for the editor's hot paths (see bench/main.cpp).
+#   cd build/qmake && qmake benchmark.pro && make
+# The executable is written to bin/ so it finds the .words and .highlights
+# files next to it.
+
+TEMPLATE = app
+TARGET = benchmark
+CONFIG += console release
+CONFIG -= app_bundle
+DESTDIR = ../../bin
+OBJECTS_DIR = benchmark-obj
+MOC_DIR = benchmark-obj
+
+include(editor.pri)
+INCLUDEPATH += ../../bench
+
+HEADERS += ../../bench/BenchmarkSuite.h \
+           ../../bench/Corpus.h
+
+SOURCES += ../../bench/BenchmarkSuite.cpp \
+           ../../bench/Corpus.cpp \
+           ../../bench/main.cpp
@@ -0,0 +1,73 @@
+# Editor sources shared by the tools built with qmake.  main.cpp and
+# MainWindow are left out; each tool provides its own main().
+
+QT += xml
+INCLUDEPATH += ../../include
+
+HEADERS += ../../include/Atom.h \
+           ../../include/Autocompleter.h \
+           ../../include/BuiltinFormats.h \
+           ../../include/ConfigFile.h \
+           ../../include/ConfigWatcher.h \
+           ../../include/DependencyGraph.h \
+           ../../include/Diagnostics.h \
+           ../../include/DiffView.h \
+           ../../include/DocsSearch.h \
+           ../../include/DuplicateFinder.h \
+           ../../include/EffectiveMaterial.h \
+           ../../include/Highlighter.h \
+           ../../include/IDE.h \
+           ../../include/Journal.h \
+           ../../include/KeystrokeSession.h \
+           ../../include/KeywordTrie.h \
+           ../../include/LargeFileEditor.h \
+           ../../include/LineDiff.h \
+           ../../include/ManualIndex.h \
+           ../../include/MaterialFlattener.h \
+           ../../include/Metrics.h \
+           ../../include/Outline.h \
+           ../../include/PerformanceHud.h \
+           ../../include/PieceTable.h \
+           ../../include/ProblemList.h \
+           ../../include/ResourceResolver.h \
+           ../../include/ScriptBundle.h \
+           ../../include/ScriptDiff.h \
+           ../../include/ScriptParser.h \
+           ../../include/Session.h \
+           ../../include/SuggestionIndex.h \
+           ../../include/TextEditor.h \
+           ../../include/Trace.h
+
+SOURCES += ../../source/Atom.cpp \
+           ../../source/Autocompleter.cpp \
+           ../../source/BuiltinFormats.cpp \
+           ../../source/ConfigFile.cpp \
+           ../../source/ConfigWatcher.cpp \
+           ../../source/DependencyGraph.cpp \
+           ../../source/Diagnostics.cpp \
+           ../../source/DiffView.cpp \
+           ../../source/DocsSearch.cpp \
+           ../../source/DuplicateFinder.cpp \
+           ../../source/EffectiveMaterial.cpp \
+           ../../source/Highlighter.cpp \
+           ../../source/IDE.cpp \
+           ../../source/Journal.cpp \
+           ../../source/KeystrokeSession.cpp \
+           ../../source/KeywordTrie.cpp \
+           ../../source/LargeFileEditor.cpp \
+           ../../source/LineDiff.cpp \
+           ../../source/ManualIndex.cpp \
+           ../../source/MaterialFlattener.cpp \
+           ../../source/Metrics.cpp \
+           ../../source/Outline.cpp \
+           ../../source/PerformanceHud.cpp \
+           ../../source/PieceTable.cpp \
+           ../../source/ProblemList.cpp \
+           ../../source/ResourceResolver.cpp \
+           ../../source/ScriptBundle.cpp \
+           ../../source/ScriptDiff.cpp \
+           ../../source/ScriptParser.cpp \
+           ../../source/Session.cpp \
+           ../../source/SuggestionIndex.cpp \
+           ../../source/TextEditor.cpp \
+           ../../source/Trace.cpp
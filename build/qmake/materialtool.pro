@@ -0,0 +1,16 @@
+# Batch checks of material and overlay scripts (see tools/materialtool.cpp).
+#   cd build/qmake && qmake materialtool.pro && make
+# The executable is written to bin/ so it finds config.xml and the .words
+# and .highlights files next to it.
+
+TEMPLATE = app
+TARGET = materialtool
+CONFIG += console release
+CONFIG -= app_bundle
+DESTDIR = ../../bin
+OBJECTS_DIR = materialtool-obj
+MOC_DIR = materialtool-obj
+
+include(editor.pri)
+
+SOURCES += ../../tools/materialtool.cpp
\ No newline at end of file
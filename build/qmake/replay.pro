@@ -0,0 +1,20 @@
+# Keystroke replay latency harness (see bench/replay.cpp).
+#   cd build/qmake && qmake replay.pro && make
+
+TEMPLATE = app
+TARGET = replay
+CONFIG += console release
+CONFIG -= app_bundle
+DESTDIR = ../../bin
+OBJECTS_DIR = replay-obj
+MOC_DIR = replay-obj
+
+include(editor.pri)
+INCLUDEPATH += ../../bench
+
+HEADERS += ../../bench/BenchmarkSuite.h \
+           ../../bench/Corpus.h
+
+SOURCES += ../../bench/BenchmarkSuite.cpp \
+           ../../bench/Corpus.cpp \
+           ../../bench/replay.cpp
@@ -0,0 +1,23 @@
+# Generates source/BuiltinFormats.inc, the keyword tables of the formats
+# compiled into the editor, from bin/config.xml and the .highlights and
+# .words files it lists.
+#   cd build/qmake && qmake wordsgen.pro && make
+# Building it runs the generator, which only rewrites the tables if they
+# changed.  The generated file is checked in, so the editor itself builds
+# without this step.
+
+TEMPLATE = app
+TARGET = wordsgen
+CONFIG += console release
+CONFIG -= app_bundle qt
+DESTDIR = ../../bin
+OBJECTS_DIR = wordsgen-obj
+
+INCLUDEPATH += ../../include
+
+HEADERS += ../../include/BuiltinFormats.h
+
+SOURCES += ../../tools/wordsgen.cpp
+
+win32: QMAKE_POST_LINK = ..\\..\\bin\\wordsgen.exe ..\\..\\bin\\config.xml ..\\..\\source\\BuiltinFormats.inc
+else:  QMAKE_POST_LINK = ../../bin/wordsgen ../../bin/config.xml ../../source/BuiltinFormats.inc
@@ -0,0 +1,64 @@
+#ifndef _ATOM_H_
+#define _ATOM_H_
+#include <QtCore/QString>
+#include <QtCore/QMetaType>
+
+/** An interned string: a small integer handle for a string that has been
+ * added to the global atom table.  Two atoms are equal exactly when their
+ * strings are, so comparing and hashing them is an integer operation, and
+ * the table holds a single copy of each string for the whole program.
+ *
+ * Keywords, highlight types and format names are interned when the config
+ * is loaded, and the highlighter, parser and IDE pass them around as atoms.
+ * Atoms are never removed, so only strings from a bounded vocabulary should
+ * be interned.  Interning and looking up are thread-safe. */
+class Atom
+{
+public:
+  /** Creates the null atom, which isn't equal to any interned string. */
+  Atom(void) : mId(0) {}
+
+  /** @returns The atom for \e str, which is added to the table if needed.
+   *      An empty string gives the null atom. */
+  static Atom intern(const QString& str);
+
+  /** @returns The atom for \e str (Latin-1), which is added to the table if needed. */
+  static Atom intern(const char* str);
+
+  /** Looks a string up without adding it.  Nothing is allocated.
+   * @returns The atom for the string, or the null atom if it was never interned. */
+  static Atom find(const QChar* data, int length);
+
+  /** @returns The atom for \e str, or the null atom if it was never interned. */
+  static Atom find(const QString& str);
+
+  /** @returns The interned string, or an empty string for the null atom. */
+  const QString& toString(void) const;
+
+  /** @returns The handle, which is 0 for the null atom. */
+  int id(void) const { return mId; }
+
+  /** @returns TRUE if this is the null atom. */
+  bool isNull(void) const { return mId == 0; }
+
+  bool operator==(Atom rhs) const { return mId == rhs.mId; }
+  bool operator!=(Atom rhs) const { return mId != rhs.mId; }
+
+  /// Orders by handle, which is the order atoms were interned in, not alphabetical
+  bool operator<(Atom rhs) const { return mId < rhs.mId; }
+
+private:
+  explicit Atom(int id) : mId(id) {}
+
+private:
+  int mId;
+};
+
+inline uint qHash(Atom atom)
+{
+  return static_cast<uint>(atom.id());
+}
+
+Q_DECLARE_METATYPE(Atom)
+
+#endif // _ATOM_H_
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef _AUTOCOMPLETER_H_
+#define _AUTOCOMPLETER_H_
+#include <QtCore/QObject>
+#include <QtCore/QList>
+#include <QtCore/QStringList>
+#include "Atom.h"
+
+// FORWARD DECLARATIONS
+class QCompleter;
+class QStringListModel;
+class TextEditor;
+
+/** Offers completions for the word being typed in a TextEditor.
+ *
+ * Keywords come from the completion trie the ConfigFile builds for each
+ * format, so a lookup only walks the characters typed plus the matches,
+ * however many words the format has.  They are ranked by how well they match
+ * (prefix first, then the start of '_' separated parts, then any characters
+ * in order), and filtered by scope: at the start of a statement only the
+ * attributes valid in the enclosing block are offered (pass attributes inside
+ * a pass, and so on), and elsewhere values and the names of the materials
+ * defined in every open document. */
+class Autocompleter : public QObject
+{
+  Q_OBJECT
+
+public:
+  /// Most suggestions shown at once
+  static const int MAX_SUGGESTIONS = 50;
+
+  /// Characters typed before the popup opens on its own
+  static const int MIN_PREFIX = 2;
+
+  Autocompleter(TextEditor* editor);
+  ~Autocompleter(void);
+
+  /** @returns TRUE if the popup of suggestions is showing. */
+  bool isPopupVisible(void) const;
+
+  /** Updates the suggestions for the word at the editor's cursor, showing
+   * or hiding the popup as needed.  Called after every keystroke.
+   * @param force If TRUE, the popup is shown even if the word is shorter
+   *        than MIN_PREFIX, or empty. */
+  void update(bool force = false);
+
+  /** Hides the popup. */
+  void hidePopup(void);
+
+  /** Ranks the completions for a word.
+   * @param format The format of the document.
+   * @param prefix What has been typed of the word.
+   * @param scope The keyword of the enclosing block ("script" at the top level).
+   * @param attribute TRUE if the word starts a statement.
+   * @param names Material names to offer where a value is expected.
+   * @returns The best completions, best first. */
+  static QStringList suggest(const QString& format, const QString& prefix, Atom scope,
+                             bool attribute, const QStringList& names);
+
+protected slots:
+  /** Replaces the word at the cursor with the chosen completion. */
+  void insertCompletion(const QString& completion);
+
+protected:
+  /** @returns The column where the word at the cursor starts. */
+  int wordStart(void) const;
+
+  /** @returns The names of the materials defined in every open document. */
+  static QStringList openMaterialNames(void);
+
+protected:
+  static QList<Autocompleter*> mAll;
+  TextEditor*                  mpEditor;
+  QCompleter*                  mpCompleter;
+  QStringListModel*            mpModel;
+};
+
+#endif // _AUTOCOMPLETER_H_
\ No newline at end of file
@@ -0,0 +1,97 @@
+#ifndef _BUILTINFORMATS_H_
+#define _BUILTINFORMATS_H_
+
+// The built-in formats are generated from the files in bin/ by wordsgen
+// (tools/wordsgen.cpp), which shares this header, so it must not use Qt.
+
+namespace config
+{
+  namespace builtin
+  {
+    /** A highlighting rule of a built-in format. */
+    struct Highlight
+    {
+      const char* name;
+      const char* color;
+      bool        bold;
+      bool        italics;
+    };
+
+    /** A word of a built-in format.  Words are ASCII. */
+    struct Word
+    {
+      const char* word;
+      int         length;
+      int         highlight;  ///< Index into Format::highlights
+      const char* doc;        ///< Documentation file, or ""
+      const char* scope;      ///< Comma separated scopes, or ""
+    };
+
+    /** A format compiled into the editor.  Its words are stored in a minimal
+     * perfect hash table: each word hashes to a bucket, and the bucket's
+     * displacement says where all of its words went, so a lookup is two
+     * hashes and one comparison whether or not the word is there.  A
+     * negative displacement d means the bucket's only word is in slot -d-1. */
+    struct Format
+    {
+      const char*       name;
+      const char*       extension;
+      const Highlight*  highlights;
+      int               numHighlights;
+      const Word*       words;          ///< numWords slots, every one used
+      int               numWords;
+      const int*        displacements;  ///< numBuckets displacements
+      int               numBuckets;
+    };
+
+    /** FNV-1a over the characters of a word, with a final mix so the low
+     * bits can be used for the table size. */
+    template <typename Char>
+    inline unsigned int hash(unsigned int seed, const Char* data, int length)
+    {
+      unsigned int h = 2166136261u ^ (seed * 16777619u);
+      for (int i = 0; i < length; ++i)
+      {
+        h ^= static_cast<unsigned short>(data[i]);
+        h *= 16777619u;
+      }
+      h ^= h >> 15;
+      h *= 0x2c1b3c6du;
+      h ^= h >> 12;
+      return h;
+    }
+
+    /** Looks up a word in a built-in format.  Nothing is allocated.
+     * @param format The format to look in.
+     * @param data The characters of the word (char, or ushort for QChar data).
+     * @param length The number of characters.
+     * @returns The word, or NULL if it isn't one of the format's words. */
+    template <typename Char>
+    inline const Word* find(const Format& format, const Char* data, int length)
+    {
+      if (format.numWords == 0)
+        return 0;
+
+      int d = format.displacements[hash(0, data, length) % format.numBuckets];
+      unsigned int slot = (d < 0 ? static_cast<unsigned int>(-d - 1) : hash(d, data, length) % format.numWords);
+
+      const Word& word = format.words[slot];
+      if (word.length != length)
+        return 0;
+      for (int i = 0; i < length; ++i)
+      {
+        if (static_cast<unsigned short>(data[i]) != static_cast<unsigned char>(word.word[i]))
+          return 0;
+      }
+      return &word;
+    }
+
+    /// @returns The built-in formats.
+    const Format* formats(void);
+
+    /// @returns The number of built-in formats.
+    int formatCount(void);
+  }
+}
+
+#endif // _BUILTINFORMATS_H_
\ No newline at end of file
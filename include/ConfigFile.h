@@ -1,100 +1,243 @@
-#ifndef _CONFIGFILE_H_
-#define _CONFIGFILE_H_
-#include <QtCore/QString>
-#include <QtCore/QMap>
-#include <QtGui/QTextFormat>
-#include <QtGui/QColor>
-
-namespace config
-{
-  // FORWARD DECLARATIONS
-  struct FormatHighlighting;
-  struct FormatWord;
-  typedef QMap<QString, FormatHighlighting> FormatHighlightingMap;
-  typedef QMap<QString, FormatWord> FormatWordMap;
-
-  /**
-   */
-  class ConfigFile
-  {
-  public:  
-    /// @returns A static pointer to the ConfigFile singleton.
-    static ConfigFile* instance();
-
-    /// @returns The path to the Ogre Manual.
-    const QString& getManualPath(void) const;
-
-    /** @param The file extension.  Should not include a "."
-     * @returns The supported format for the given file extension, or 
-     *       empty string if there is no known format for that extension. */
-    const QString& getFormatByExtension(const QString& extension) const;
-
-    /** @param format The format whose highlights you want to get.
-     * @returns A map of all of the FormatHighlightings for this format, or an 
-     *      empty map if the format is not supported. */
-    const FormatHighlightingMap& getHighlightsByFormat(const QString& format) const;
-
-    /** @param format The format whose words you want to get.
-     * @returns A map of all of the FormatWords for this format, or an empty
-     *     map if the format is not supported. */
-    const FormatWordMap& getWordsByFormat(const QString& format) const;
-
-    /** @returns a QStringList containing all valid format names. */
-    QStringList getAllFormatNames(void) const;
-
-  private:
-    /// Private ctor
-    ConfigFile(void);
-
-    /// Private dtor
-    ~ConfigFile(void);
-
-    /// Load the config file
-    void load(void);
-
-    /// Load a particular format
-    void loadFormat(const QString&, const QString&, const QString&);
-
-  private:
-    static ConfigFile*                    mpMe;
-    QString                               mManualPath;
-    QMap<QString, FormatHighlightingMap>  mHighlightsByFormat;
-    QMap<QString, FormatWordMap>          mWordsByFormat;
-    QMap<QString, QString>                mFormatsByExt;
-  };
-
-
-  /** Contains details about how to highlight a type of word or
-   * regular expression, such as a keyword or comment.  These 
-   * details are used by the syntax highlighter to know how to
-   * highlight different parts of a document based on the format. */
-  struct FormatHighlighting
-  {
-    /// Name of the highlighting rule
-    QString name;
-
-    /// Paterns that match this highlighting rule
-    QVector<QRegExp> patterns;
-
-    /// Format for this rule
-    QTextCharFormat format;
-  };
-
-  /** Contains details about a word that is recognized in a particular 
-   * format as one that should be highlighted.  This is used by the
-   * syntax highlighter and IDE to know how to highlight the word and 
-   * to lookup the documentation for that word, if it exists. */
-  struct FormatWord
-  {
-    /// The word that should be highlighted
-    QString word;
-
-    /// The type of highlighting that applies to this word
-    QString highlightType;
-
-    /// Documentation file where this word is defined (if it exists).
-    QString doc;
-  };
-}
-
+#ifndef _CONFIGFILE_H_
+#define _CONFIGFILE_H_
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QMap>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+#include <QtGui/QTextFormat>
+#include <QtGui/QColor>
+#include "KeywordTrie.h"
+#include "SuggestionIndex.h"
+#include "BuiltinFormats.h"
+#include "Atom.h"
+
+namespace config
+{
+  // FORWARD DECLARATIONS
+  struct FormatHighlighting;
+  struct FormatWord;
+  class WordTable;
+  typedef QMap<QString, FormatHighlighting> FormatHighlightingMap;
+  typedef QMap<QString, FormatWord> FormatWordMap;
+
+  /**
+   */
+  class ConfigFile
+  {
+  public:  
+    /// @returns A static pointer to the ConfigFile singleton.
+    static ConfigFile* instance();
+
+    /// @returns The path to the Ogre Manual.
+    const QString& getManualPath(void) const;
+
+    /** @returns The directories textures, programs and materials are looked
+     *     up in, as absolute paths, or an empty list if none are configured. */
+    const QStringList& getResourcePaths(void) const;
+
+    /** @param The file extension.  Should not include a "."
+     * @returns The supported format for the given file extension, or 
+     *       empty string if there is no known format for that extension. */
+    const QString& getFormatByExtension(const QString& extension) const;
+
+    /** @param format The format whose highlights you want to get.
+     * @returns A map of all of the FormatHighlightings for this format, or an 
+     *      empty map if the format is not supported. */
+    const FormatHighlightingMap& getHighlightsByFormat(const QString& format) const;
+
+    /** @param format The format whose words you want to get.
+     * @returns A map of all of the FormatWords for this format, or an empty
+     *     map if the format is not supported. */
+    const FormatWordMap& getWordsByFormat(const QString& format) const;
+
+    /** @param format The format to look in.
+     * @param word The word to look up.
+     * @returns The FormatWord for \e word, or NULL if it isn't a word of
+     *     the format.  This is a hash of the atom, with no string compares. */
+    const FormatWord* findWord(const QString& format, Atom word) const;
+
+    /** @param format The format whose completion trie you want to get.
+     * @returns A trie over all of the FormatWords for this format, built when
+     *     the format was loaded, or an empty trie if the format is not supported. */
+    const KeywordTrie& getTrieByFormat(const QString& format) const;
+
+    /** @param format The format whose suggestion index you want to get.
+     * @returns An index of the words of this format by edit distance, which
+     *     suggests what an unknown word was meant to be, built when the
+     *     format was loaded, or an empty index if the format is not supported. */
+    const SuggestionIndex& getSuggestionsByFormat(const QString& format) const;
+
+    /** @param format The format whose word table you want to get.
+     * @returns The table the highlighter classifies words with, or an empty
+     *     table if the format is not supported. */
+    const WordTable& getWordTableByFormat(const QString& format) const;
+
+    /** @returns a QStringList containing all valid format names. */
+    QStringList getAllFormatNames(void) const;
+
+    /** @returns A hash of the built-in formats and the contents of the files
+     *     the formats were loaded from, which changes whenever one of them
+     *     does.  Anything derived from the rules, such as saved highlighting,
+     *     is only good for the same stamp. */
+    quint64 getRulesStamp(void) const;
+
+    /** Discards all formats and loads the config file again. */
+    void reload(void);
+
+    /** @returns The config file and the highlights and words files it names,
+     *     as absolute paths.  Files that don't exist are included, so that
+     *     creating one is noticed. */
+    QStringList getSourceFiles(void) const;
+
+    /** @returns The files of getSourceFiles() that changed on disk since the
+     *     formats were loaded from them. */
+    QStringList getChangedFiles(void) const;
+
+    /** @returns A copy of the rules.  Copying is cheap, since the tables are
+     *     implicitly shared, and the copy can be reloaded on another thread
+     *     while this one is in use.  The caller owns it. */
+    ConfigFile* clone(void) const;
+
+    /** Loads the formats that \e files belong to again, or every format if
+     *     the config file is one of them.
+     * @param files Files of getSourceFiles(), as absolute paths.
+     * @returns The names of the formats that were loaded again. */
+    QStringList reloadFiles(const QStringList& files);
+
+    /** Takes the rules of \e other, and deletes it.  Readers never see half
+     *     of a reload, as long as this is called on the GUI thread, which
+     *     is the only one reading the rules in place. */
+    void replaceWith(ConfigFile* other);
+
+  private:
+    /// Private ctor
+    ConfigFile(void);
+
+    /// Private dtor
+    ~ConfigFile(void);
+
+    /// Load the config file
+    void load(void);
+
+    /// Load the formats compiled into the editor
+    void loadBuiltinFormats(void);
+
+    /// Load one of the formats compiled into the editor
+    void loadBuiltinFormat(const builtin::Format&);
+
+    /// Load a particular format, on top of the built-in one if there is one
+    void loadFormat(const QString&, const QString&, const QString&);
+
+    /// Build the lookups of a format's words, once its words are loaded
+    void finishFormat(const QString&);
+
+    /// Discard a format and load it again
+    void reloadFormat(const QString&);
+
+    /// Remember the stamp of a file the rules are loaded from
+    void stampFile(const QString&);
+
+    /// Work out the rules stamp from the stamps of the files
+    void updateRulesStamp(void);
+
+  private:
+    static ConfigFile*                    mpMe;
+    QString                               mManualPath;
+    QStringList                           mResourcePaths;
+    QMap<QString, FormatHighlightingMap>  mHighlightsByFormat;
+    QMap<QString, FormatWordMap>          mWordsByFormat;
+    QMap<QString, QHash<Atom, FormatWord> > mAtomWordsByFormat;
+    QMap<QString, KeywordTrie>            mTriesByFormat;
+    QMap<QString, SuggestionIndex>        mSuggestionsByFormat;
+    QMap<QString, WordTable>              mTablesByFormat;
+    QMap<QString, QString>                mFormatsByExt;
+    QMap<QString, QStringList>            mFilesByFormat; ///< Absolute paths of the files config.xml names for each format
+    QMap<QString, quint64>                mFileStamps;    ///< By absolute path, 0 for a file that doesn't exist
+    QString                               mConfigPath;
+    quint64                               mRulesStamp;
+  };
+
+
+  /** Contains details about how to highlight a type of word or
+   * regular expression, such as a keyword or comment.  These 
+   * details are used by the syntax highlighter to know how to
+   * highlight different parts of a document based on the format. */
+  struct FormatHighlighting
+  {
+    /// Name of the highlighting rule
+    QString name;
+
+    /// The name, interned
+    Atom atom;
+
+    /// Paterns that match this highlighting rule
+    QVector<QRegExp> patterns;
+
+    /// Format for this rule
+    QTextCharFormat format;
+  };
+
+  /** Contains details about a word that is recognized in a particular 
+   * format as one that should be highlighted.  This is used by the
+   * syntax highlighter and IDE to know how to highlight the word and 
+   * to lookup the documentation for that word, if it exists. */
+  struct FormatWord
+  {
+    /// The word that should be highlighted (shares the atom's string)
+    QString word;
+
+    /// The word, interned
+    Atom atom;
+
+    /// The type of highlighting that applies to this word
+    QString highlightType;
+
+    /// Documentation file where this word is defined (if it exists).
+    QString doc;
+
+    /// Keywords of the blocks this word may appear in as an attribute
+    /// ("script" for the top level), or empty if the word is a value.
+    QVector<Atom> scopes;
+  };
+
+  /** Classifies the words of a format for the syntax highlighter.  Words
+   * compiled into the editor are found with a perfect hash probe, and the
+   * words that the .words files add or change on top of them in a small
+   * open addressing table that is only probed if there are any.  Neither
+   * allocates. */
+  class WordTable
+  {
+  public:
+    WordTable(void);
+
+    /** Sets the built-in format whose words are the defaults. */
+    void setBuiltin(const builtin::Format* format);
+
+    /** Adds a word, or changes the highlight type of a built-in word. */
+    void addOverride(const QString& word, Atom highlightType);
+
+    /** @param data The characters of the word.
+     * @param length The number of characters.
+     * @returns The highlight type of the word, or the null atom if it isn't
+     *     one of the format's words. */
+    Atom classify(const QChar* data, int length) const;
+
+  private:
+    struct Override
+    {
+      QString word;
+      Atom    highlightType;
+    };
+
+    const Override* findOverride(const QChar* data, int length) const;
+
+  private:
+    const builtin::Format*  mpBuiltin;
+    QVector<Atom>           mBuiltinTypes;  ///< Highlight types by built-in index
+    QVector<Override>       mOverrides;     ///< Open addressing, a power of 2 in size
+    int                     mNumOverrides;
+  };
+}
+
 #endif // _CONFIGFILE_H_
\ No newline at end of file
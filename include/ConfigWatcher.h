@@ -0,0 +1,72 @@
+#ifndef _CONFIGWATCHER_H_
+#define _CONFIGWATCHER_H_
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QFileSystemWatcher>
+#include <QtCore/QTimer>
+#include <QtCore/QElapsedTimer>
+
+namespace config
+{
+  // FORWARD DECLARATIONS
+  class ConfigFile;
+
+  /** Keeps the rules of ConfigFile up to date with config.xml and the
+   * highlights and words files it names.  When they change on disk, the
+   * formats they belong to are loaded again into a copy of the rules off
+   * the GUI thread, and the copy then takes the place of the rules in one
+   * step, so nothing ever sees half of a reload. */
+  class ConfigWatcher : public QObject
+  {
+    Q_OBJECT
+
+  public:
+    /// @returns The watcher, which starts watching the first time it's needed.
+    static ConfigWatcher* instance(void);
+
+    /// @returns TRUE while the rules are being loaded again.
+    bool isReloading(void) const;
+
+  signals:
+    /** Emitted once new rules have taken the place of the old ones.
+     * @param formats The formats whose rules may have changed. */
+    void changed(const QStringList& formats);
+
+  protected slots:
+    void onReloadFinished(void);
+    void onPathChanged(const QString& path);
+
+    /** Starts loading the files that changed again, or once the current
+     * reload ends. */
+    void reload(void);
+
+  private:
+    struct Reload
+    {
+      ConfigFile*   config;
+      QStringList   formats;
+    };
+
+    ConfigWatcher(void);
+
+    /** Loads \e files again into \e config, a copy of the rules.  This is
+     * what runs on the thread pool. */
+    static Reload reloadFiles(ConfigFile* config, const QStringList& files);
+
+    /** Watches the files the rules are loaded from, and the directories
+     * they are in, so files that are replaced or created are noticed. */
+    void syncWatches(void);
+
+  private:
+    static ConfigWatcher*         mpMe;
+    QFutureWatcher<Reload>        mReload;
+    QFileSystemWatcher            mWatcher;
+    QTimer                        mTimer;
+    QElapsedTimer                 mSinceReload;
+    bool                          mPending;   ///< Files changed during the reload
+  };
+}
+
+#endif // _CONFIGWATCHER_H_
\ No newline at end of file
@@ -0,0 +1,158 @@
+#ifndef _DEPENDENCYGRAPH_H_
+#define _DEPENDENCYGRAPH_H_
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+// FORWARD DECLARATIONS
+namespace script
+{
+  struct Node;
+}
+
+/** What a node of a DependencyGraph stands for. */
+enum DependencyKind
+{
+  DEPENDENCY_FILE,              ///< A script, by absolute path
+  DEPENDENCY_MATERIAL,
+  DEPENDENCY_VERTEX_PROGRAM,
+  DEPENDENCY_FRAGMENT_PROGRAM,
+  DEPENDENCY_TEXTURE,           ///< By name, in lower case
+  DEPENDENCY_OVERLAY
+};
+
+/** A file, or something a script defines or refers to. */
+struct DependencyNode
+{
+  DependencyKind  kind;
+  QString         name;
+
+  /** @returns The node as "kind:name", as the command line takes it. */
+  QString toString(void) const;
+
+  /** Reads a node written as "kind:name".
+   * @returns FALSE if \e text doesn't start with a kind. */
+  static bool fromString(const QString& text, DependencyNode& node);
+
+  bool operator==(const DependencyNode& rhs) const { return kind == rhs.kind && name == rhs.name; }
+};
+
+/** That one node depends on another: a material on its parent, the
+ * programs and textures it uses and the script defining it, or an overlay
+ * on the materials of its elements. */
+struct DependencyEdge
+{
+  DependencyNode  from;   ///< The dependent
+  DependencyNode  to;     ///< What it depends on
+};
+
+/** The dependencies between the scripts under a set of directories, and the
+ * materials, programs, textures and overlays they define and refer to.
+ *
+ * The graph is kept as the edges each script contributes, so bringing it up
+ * to date after a script changes only costs reading that script: its old
+ * edges are taken out and its new ones put in.  refresh() finds the scripts
+ * that changed since the graph was saved by their time stamps and sizes,
+ * and only reads those.  Both directions of every edge are indexed, so a
+ * query walks exactly the nodes in its answer.
+ *
+ * Like ResourceIndex, the graph is made of implicitly shared containers, so
+ * copies are cheap. */
+class DependencyGraph
+{
+public:
+  DependencyGraph(void);
+
+  /** Sets the directories whose scripts are in the graph.  The graph is
+   * emptied if they aren't the ones it has. */
+  void setDirectories(const QStringList& directories);
+
+  /// @returns The directories whose scripts are in the graph.
+  const QStringList& directories(void) const;
+
+  /** Brings the graph up to date with the scripts in its directories,
+   * reading the ones that are new or changed in parallel and dropping the
+   * ones that are gone.
+   * @returns The number of scripts read or dropped. */
+  int refresh(void);
+
+  /** What the graph knows of one script. */
+  struct FileEntry
+  {
+    qint64                    modified; ///< In ms since the epoch
+    qint64                    size;
+    QVector<DependencyEdge>   edges;
+  };
+
+  /** Puts \e entry in the graph in place of what the script at \e path
+   * contributed so far.  The entry is made by readFile(), which is what
+   * keeps the parsing off the GUI thread. */
+  void setFile(const QString& path, const FileEntry& entry);
+
+  /** Drops the script at \e path, if the graph has it. */
+  void removeFile(const QString& path);
+
+  /** @returns TRUE if the graph has the script at \e path. */
+  bool hasFile(const QString& path) const;
+
+  /** Loads a graph saved by save().
+   * @returns FALSE if there isn't one, or it can't be read. */
+  bool load(const QString& path);
+
+  /** Saves the graph, so the next refresh() only has to read what changed
+   * in the meantime.  Saves that fail leave the last good graph alone. */
+  bool save(const QString& path);
+
+  /// @returns TRUE if the graph changed since it was loaded or saved.
+  bool isModified(void) const;
+
+  /** Finds everything that depends on \e node, directly or not.
+   * @param out Receives the nodes, nearest first. */
+  void affectedBy(const DependencyNode& node, QVector<DependencyNode>& out) const;
+
+  /** Finds everything \e node depends on, directly or not.
+   * @param out Receives the nodes, nearest first. */
+  void dependenciesOf(const DependencyNode& node, QVector<DependencyNode>& out) const;
+
+  /** @returns The scripts that define \e nodes. */
+  QStringList definingFiles(const QVector<DependencyNode>& nodes) const;
+
+  /// @returns The number of scripts in the graph.
+  int fileCount(void) const;
+
+  /// @returns The number of distinct edges in the graph.
+  int edgeCount(void) const;
+
+  /** @returns TRUE if the graph reads the script at \e path. */
+  static bool isScript(const QString& path);
+
+  /** Finds the edges a parsed script contributes.
+   * @param root The root of the script's AST.
+   * @param path The absolute path of the script. */
+  static void findEdges(const script::Node* root, const QString& path, QVector<DependencyEdge>& out);
+
+  /** Makes the entry setFile() takes for a script parsed elsewhere.  Only
+   * stats the script, so it's safe on any thread.
+   * @param root The root of the script's AST, or NULL if it can't be read.
+   * @returns FALSE if the graph doesn't read the script, or it's gone. */
+  static bool readFile(const QString& path, const script::Node* root, FileEntry& out);
+
+private:
+  int findId(const DependencyNode& node) const;
+  int addNode(const DependencyNode& node);
+  void addFile(const QString& path, const FileEntry& entry);
+  void walk(const QVector<QHash<int, int> >& edges, const DependencyNode& node, QVector<DependencyNode>& out) const;
+
+private:
+  QStringList                 mDirectories;
+  QHash<QString, FileEntry>   mFiles;
+  QHash<QString, int>         mIds;           ///< Of each node, by kind and name
+  QVector<DependencyNode>     mNodes;
+  QVector<QHash<int, int> >   mDependencies;  ///< Of each node, with how many scripts say so
+  QVector<QHash<int, int> >   mDependents;    ///< Of each node, with how many scripts say so
+  int                         mEdgeCount;
+  bool                        mModified;
+};
+
+#endif // _DEPENDENCYGRAPH_H_
\ No newline at end of file
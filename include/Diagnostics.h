@@ -0,0 +1,114 @@
+#ifndef _DIAGNOSTICS_H_
+#define _DIAGNOSTICS_H_
+#include <QtCore/QObject>
+#include <QtCore/QTimer>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QVector>
+#include <QtGui/QTextCursor>
+#include "ConfigFile.h"
+#include "Highlighter.h"
+#include "ResourceResolver.h"
+
+// FORWARD DECLARATIONS
+class TextEditor;
+
+/** Lines of a document copied out to be checked on another thread, along
+ * with everything checking them needs, so the document and the config can
+ * carry on changing while they are. */
+struct DiagnosticJob
+{
+  int                     firstBlock; ///< Number of the block of the first line
+  ScopeState              state;      ///< Scope state before the first line
+  QVector<QString>        lines;
+  QVector<int>            contexts;   ///< State of the block before each line
+  config::FormatWordMap   words;
+  config::SuggestionIndex suggestions;
+  Atom                    script;     ///< The scope of the top level
+  ResourceIndex           resources;  ///< Empty if names aren't to be resolved
+  NameIndex               materials;  ///< Materials the document itself defines
+};
+
+/** The diagnostics of each line of a DiagnosticJob. */
+struct DiagnosticResult
+{
+  int                           firstBlock;
+  QVector<QVector<Diagnostic> > lines;
+  ScopeState                    state;  ///< Scope state after the last line
+};
+
+/** Checks a TextEditor's document as it is edited: unknown keywords,
+ * attributes in the wrong scope, unbalanced braces, and textures, programs
+ * and materials that aren't in the resource directories.
+ *
+ * Edits are gathered into one range of the document.  Shortly after the
+ * last one, the range is taken a line past the edits for as long as the
+ * highlighter found a change of scope, and those lines are copied out with
+ * the scope state before them and checked with QtConcurrent, while typing
+ * carries on.  Only lines whose text or scope changed are checked again.
+ * Results are kept with each block in its BlockData, where the highlighter
+ * underlines them; results for lines edited in the meantime are dropped,
+ * and the lines checked again. */
+class Diagnostics : public QObject
+{
+  Q_OBJECT
+
+public:
+  /** @param editor The editor to check, which also owns the Diagnostics. */
+  Diagnostics(TextEditor* editor);
+  ~Diagnostics(void);
+
+  /** Checks lines of script.  This is what runs on the worker thread.
+   * @returns The diagnostics of each line of \e job. */
+  static DiagnosticResult check(const DiagnosticJob& job);
+
+  /** @returns TRUE while there are edits that haven't been checked yet. */
+  bool isPending(void) const;
+
+  /** @returns The number of diagnostics in the document.  They are counted
+   * through its blocks, so this is meant for the problems list rather than
+   * for every edit. */
+  int count(void) const;
+
+public slots:
+  /** Checks the whole document again, after its format or the resources it
+   * refers to change. */
+  void revalidate(void);
+
+signals:
+  /** Emitted whenever the diagnostics of the document change. */
+  void changed(void);
+
+protected slots:
+  /** Adds an edit to the range waiting to be checked. */
+  void onContentsChange(int position, int removed, int added);
+
+  /** Copies out the range waiting to be checked and starts checking it,
+   * unless a check is already running. */
+  void post(void);
+
+  /** Keeps the results of the check that finished. */
+  void onFinished(void);
+
+protected:
+  /** Adds a range of the document to the range waiting to be checked. */
+  void markDirty(int from, int to);
+
+  /** Moves the report of a '{' that's never closed to the brace that is,
+   * if there is one, from the brace depth at the end of the document. */
+  void updateUnclosedBrace(void);
+
+protected:
+  TextEditor*                       mpEditor;
+  QTimer                            mTimer;
+  QFutureWatcher<DiagnosticResult>  mWatcher;
+  QVector<int>                      mContexts;    ///< Of the lines being checked
+  QTextCursor                       mJobEnd;      ///< End of the lines being checked
+  int                               mEditedSince; ///< First position edited since they were copied, or -1
+  int                               mDirtyFrom;   ///< Start of the range waiting, or -1 if there isn't one
+  int                               mDirtyTo;     ///< End of the range waiting
+  QElapsedTimer                     mSinceEdit;   ///< Since the oldest edit that hasn't been checked
+  QTextCursor                       mUnclosed;    ///< Block with the unclosed brace, if any
+};
+
+#endif // _DIAGNOSTICS_H_
\ No newline at end of file
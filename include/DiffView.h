@@ -0,0 +1,38 @@
+#ifndef _DIFFVIEW_H_
+#define _DIFFVIEW_H_
+#include <QtGui/QTreeWidget>
+#include <QtCore/QPointer>
+#include "ScriptDiff.h"
+
+// FORWARD DECLARATIONS
+class TextEditor;
+
+/** The structural differences between the current document and another
+ * version of it, as a list meant to be docked beside the IDE's tabs.
+ * Clicking a difference that is in the document moves the cursor to it. */
+class DiffView : public QTreeWidget
+{
+  Q_OBJECT
+
+public:
+  DiffView(QWidget* parent = NULL);
+
+public slots:
+  /** Sets the editor the differences are in.
+   * @param editor The current editor, or NULL if there isn't one. */
+  void setEditor(TextEditor* editor);
+
+  /** Lists the differences of a comparison.
+   * @param title What was compared.
+   * @param changes The differences, as ScriptDiff found them. */
+  void setChanges(const QString& title, const QVector<ScriptChange>& changes);
+
+protected slots:
+  /** Moves the editor's cursor to the difference. */
+  void onItemClicked(QTreeWidgetItem* item, int column);
+
+protected:
+  QPointer<TextEditor>  mpEditor;
+};
+
+#endif // _DIFFVIEW_H_
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef _DOCSSEARCH_H_
+#define _DOCSSEARCH_H_
+#include <QtGui/QWidget>
+
+// FORWARD DECLARATIONS
+class QLineEdit;
+class QTreeWidget;
+class QTreeWidgetItem;
+class QTextBrowser;
+
+/** A search of the Ogre manual, meant to be docked beside the IDE's tabs.
+ * The pages with every word typed so far are listed best first as each
+ * letter is typed, and clicking one shows it below, at the first match.
+ * Searches run against ManualIndexer's index, so they never go to the
+ * disk; the list catches up by itself when the index is rebuilt. */
+class DocsSearch : public QWidget
+{
+  Q_OBJECT
+
+public:
+  DocsSearch(QWidget* parent = NULL);
+
+public slots:
+  /** Searches for \e query, as if it were typed. */
+  void setQuery(const QString& query);
+
+protected slots:
+  /** Lists the pages that match the query as it is now. */
+  void search(void);
+
+  /** Shows the page of a result. */
+  void onItemClicked(QTreeWidgetItem* item, int column);
+
+protected:
+  QLineEdit*      mpQuery;
+  QTreeWidget*    mpResults;
+  QTextBrowser*   mpPage;
+};
+
+#endif // _DOCSSEARCH_H_
\ No newline at end of file
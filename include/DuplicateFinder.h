@@ -0,0 +1,74 @@
+#ifndef _DUPLICATEFINDER_H_
+#define _DUPLICATEFINDER_H_
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+
+// FORWARD DECLARATIONS
+namespace script
+{
+  struct Node;
+}
+
+/** What a material is made of, whatever it is called.
+ *
+ * Each statement in the material becomes a feature: the objects it is in
+ * and the statement itself, as "technique #1/pass #1/ambient 1 1 1".
+ * Unnamed objects are told apart by position, and named ones by name, so
+ * the features don't depend on the order of attributes, the layout of the
+ * script, or the material's name. */
+struct MaterialFingerprint
+{
+  QString         name;
+  QString         path;
+  int             line;
+  QStringList     features;   ///< Sorted, without repeats
+  QVector<uint>   hashes;     ///< Of the features, sorted, without repeats
+  QByteArray      exact;      ///< Digest of the features, equal only for identical materials
+  QVector<uint>   signature;  ///< MinHash of the hashes
+
+  /** Fingerprints the materials a parsed script defines.  Materials with
+   * nothing in them are left out, since they are all alike. */
+  static void fromScript(const script::Node* root, const QString& path, QVector<MaterialFingerprint>& out);
+};
+
+/** Materials that are the same, or nearly. */
+struct DuplicateGroup
+{
+  bool          exact;        ///< Identical, rather than similar
+  QVector<int>  members;      ///< Indices of the fingerprints, in the order given
+  double        similarity;   ///< Features in common over features in any, from 0 to 1
+  QStringList   common;       ///< Features every member has
+};
+
+/** Finds the materials that are copies of each other, to be consolidated
+ * into a parent that they inherit from.
+ *
+ * Identical materials have the same digest, so they are grouped by it in
+ * one pass.  Similar materials are found by locality sensitive hashing:
+ * each MinHash signature is cut into bands, and materials that agree on a
+ * whole band share a bucket.  Materials whose features overlap by as much
+ * as the threshold very likely share a bucket, and ones that overlap
+ * little very likely don't, so only the pairs in a bucket are compared,
+ * rather than every pair.  Pairs that really are similar enough are then
+ * joined into groups. */
+class DuplicateFinder
+{
+public:
+  /** Finds the groups of identical materials and of similar ones.  A
+   * group of similar materials takes in the identical copies of its
+   * members.
+   * @param fingerprints The materials to look through.
+   * @param threshold The least similarity, from 0 to 1, of materials that
+   *        are reported as similar.
+   * @param out Receives the groups, identical ones first, each kind
+   *        largest first. */
+  static void find(const QVector<MaterialFingerprint>& fingerprints, double threshold, QVector<DuplicateGroup>& out);
+
+  /** @returns The features two materials have in common over the features
+   * either has, from 0 to 1. */
+  static double similarity(const MaterialFingerprint& a, const MaterialFingerprint& b);
+};
+
+#endif // _DUPLICATEFINDER_H_
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef _EFFECTIVEMATERIAL_H_
+#define _EFFECTIVEMATERIAL_H_
+#include <QtGui/QPlainTextEdit>
+#include <QtCore/QTimer>
+#include <QtCore/QPointer>
+#include "MaterialFlattener.h"
+
+// FORWARD DECLARATIONS
+class TextEditor;
+
+/** The effective material under the cursor, with everything it inherits
+ * laid in, as read-only text meant to be docked beside the IDE's tabs.
+ *
+ * The document's own materials take precedence over the ones on disk, so
+ * the view follows unsaved edits; parents outside the document come from
+ * the resource directories.  The view is only worked out while it is
+ * showing, shortly after the cursor moves or the document changes, and
+ * the flattener keeps every effective material it has worked out, so
+ * moving around a document only works out what changed. */
+class EffectiveMaterial : public QPlainTextEdit
+{
+  Q_OBJECT
+
+public:
+  EffectiveMaterial(QWidget* parent = NULL);
+
+public slots:
+  /** Sets the editor whose material is shown.
+   * @param editor The current editor, or NULL if there isn't one. */
+  void setEditor(TextEditor* editor);
+
+protected:
+  void showEvent(QShowEvent*);
+
+protected slots:
+  /** Shows the effective material under the cursor again. */
+  void refresh(void);
+
+  /** Catches up with the resource directories. */
+  void onResourcesChanged(void);
+
+  /** Refreshes shortly, if the view is showing. */
+  void schedule(void);
+
+protected:
+  QPointer<TextEditor>  mpEditor;
+  QString               mDocumentKey; ///< What the editor's document is added to the flattener as
+  MaterialFlattener     mFlattener;
+  QTimer                mTimer;
+  bool                  mStale;       ///< Something changed while the view was hidden
+};
+
+#endif // _EFFECTIVEMATERIAL_H_
\ No newline at end of file
@@ -1,28 +1,281 @@
-#ifndef _HIGHLIGHTER_H_
-#define _HIGHLIGHTER_H_
-#include <QtGui/QSyntaxHighlighter>
-#include <QtCore/QHash>
-#include <QtGui/QTextCharFormat>
-#include "ConfigFile.h"
-
-// FORWARD DECLARATIONS
-class QTextDocument;
-
-class Highlighter : public QSyntaxHighlighter
-{
-  Q_OBJECT
-
-public:
-  Highlighter(QTextDocument *parent = NULL);
-  void setFileFormat(const QString& format);
-
-protected:
-  void highlightBlock(const QString &text);
-  void loadRulesSettings(void);
-  void loadRule(const QString& ruleName);
-
-private:
-  config::FormatHighlightingMap mHighlightingRules;
-};
-
+#ifndef _HIGHLIGHTER_H_
+#define _HIGHLIGHTER_H_
+#include <QtGui/QSyntaxHighlighter>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+#include <QtCore/QSharedPointer>
+#include <QtGui/QTextCharFormat>
+#include <QtGui/QTextBlockUserData>
+#include <QtGui/QTextLayout>
+#include "ConfigFile.h"
+#include "Atom.h"
+
+// FORWARD DECLARATIONS
+class QTextDocument;
+class QTextBlock;
+class QDataStream;
+
+/** Splits a line of script into the tokens that matter to its scopes:
+ * words, quoted strings and braces, with the spaces and comments between
+ * them skipped.  A comment only starts where a token could, so a path
+ * with "//" in it stays one word.  A block comment may run on over several
+ * lines, so whether a line starts inside one is carried from the line
+ * before.  ScopeState and Diagnostics both read lines with it, so they
+ * agree on where scopes start and end. */
+class ScriptTokenizer
+{
+public:
+  enum Token
+  {
+    TOKEN_END,      ///< The end of the line, or a line comment
+    TOKEN_WORD,
+    TOKEN_STRING,   ///< A quoted string, quotes included
+    TOKEN_OPEN,     ///< '{'
+    TOKEN_CLOSE     ///< '}'
+  };
+
+  /** @param data The line.
+   * @param length How much of the line to read.
+   * @param inComment TRUE if the line starts inside a block comment. */
+  ScriptTokenizer(const QChar* data, int length, bool inComment = false);
+
+  /// @returns The next token, or TOKEN_END from then on once there's none.
+  Token next(void);
+
+  /// @returns Where the last token starts in the line.
+  int start(void) const;
+
+  /// @returns Where the last token ends in the line.
+  int end(void) const;
+
+  /// @returns TRUE if the text read so far ends inside a block comment.
+  bool inBlockComment(void) const;
+
+  /// @returns TRUE if the text read so far ends inside a comment of either kind.
+  bool inComment(void) const;
+
+private:
+  const QChar*  mpData;
+  int           mLength;
+  int           mStart;
+  int           mEnd;
+  bool          mBlockComment;
+  bool          mLineComment;
+};
+
+/** Where the parser is in the nesting of a script: the keywords of the
+ * blocks that enclose a position, and the keyword of the statement that
+ * will open the next block if a '{' follows.  Keywords are atoms; a block
+ * opened by anything that isn't a keyword has the null atom. */
+struct ScopeState
+{
+  /// Keywords of the enclosing blocks, outermost first
+  QVector<Atom> stack;
+
+  /// First word of the last statement, until a '{', '}' or another statement
+  Atom pending;
+
+  /// Inside a block comment, which carries on to the next line
+  bool inComment;
+
+  ScopeState(void) : inComment(false) {}
+
+  /// @returns The keyword of the innermost block, or "script" at the top level.
+  Atom current(void) const;
+
+  /** Advances the state over a line of script, skipping strings and comments.
+   * @param text The line.
+   * @param length How much of the line to scan.
+   * @param definedName Receives the name of a material defined on the line, if any.
+   * @param endsInComment Receives TRUE if the scan ended inside a comment
+   *        of either kind.
+   * @returns True if the scan ended at the start of a statement. */
+  bool scan(const QString& text, int length, QString* definedName = NULL, bool* endsInComment = NULL);
+};
+
+/** A problem found in a line of script by Diagnostics, kept with its block
+ * so the highlighter can underline it. */
+struct Diagnostic
+{
+  enum Kind
+  {
+    UNKNOWN_KEYWORD,  ///< A statement starts with a word the format doesn't have
+    WRONG_SCOPE,      ///< An attribute is used in a block it doesn't belong in
+    UNMATCHED_BRACE,  ///< A '}' closes a block that was never opened
+    UNCLOSED_BRACE,   ///< A '{' is still open at the end of the document
+    UNRESOLVED_NAME   ///< A texture, program or material that can't be found
+  };
+
+  Kind    kind;
+  int     start;    ///< Position in the line
+  int     length;
+  QString word;     ///< The word or brace at fault
+  QString message;
+
+  bool operator==(const Diagnostic& rhs) const
+  {
+    return kind == rhs.kind && start == rhs.start && length == rhs.length && message == rhs.message;
+  }
+};
+
+/// Number of blocks defining each name, shared by a highlighter and its blocks
+typedef QHash<QString, int> NameIndex;
+
+/** The parser state the highlighter keeps with every block, so a change
+ * only has to be parsed from the block it touches onwards. */
+class BlockData : public QTextBlockUserData
+{
+public:
+  BlockData(const QSharedPointer<NameIndex>& names);
+  ~BlockData(void);
+
+  /** Sets the name defined by this block, keeping the name index current. */
+  void setDefinedName(const QString& name);
+
+  /// The scope state at the end of the block.  Its depth is the number of
+  /// braces open after the block, which is all that folding needs.
+  ScopeState state;
+
+  /// The block starts a fold that is collapsed
+  bool folded;
+
+  /// The block was highlighted while it was folded away, or before the
+  /// rules were reloaded, so its formats are missing or out of date until
+  /// it is highlighted again
+  bool stale;
+
+  /// Problems found in the block, for the text whose hash is checkedText
+  QVector<Diagnostic> diagnostics;
+
+  /// qHash() of the text the diagnostics were found in
+  uint checkedText;
+
+  /// State of the block before this one when the diagnostics were found,
+  /// or -2 if they haven't been yet
+  int checkedContext;
+
+private:
+  QSharedPointer<NameIndex> mNames;
+  QString                   mDefinedName;
+};
+
+/** The highlighting rules of a format, applied one line at a time.  It
+ * doesn't need a QTextDocument, so the large file view can use it on the
+ * lines it paints, and Highlighter uses it for every block. */
+class LineHighlighter
+{
+public:
+  LineHighlighter(void);
+  void setFileFormat(const QString& format);
+
+  /** @returns An estimate of the memory used by the rules, in bytes. */
+  qint64 ruleMemory(void) const;
+
+  /** Highlights a line.
+   * @param text The line.
+   * @param ranges Receives the formatted ranges in the order they apply.
+   *        Where ranges overlap, the later one wins. */
+  void highlight(const QString& text, QVector<QTextLayout::FormatRange>& ranges) const;
+
+protected:
+  void applyPatterns(const config::FormatHighlighting& rule, const QString& text,
+                     QVector<QTextLayout::FormatRange>& ranges) const;
+
+private:
+  config::FormatHighlightingMap mHighlightingRules;
+  config::WordTable             mWordTable;
+  QHash<Atom, QTextCharFormat>  mWordFormats;   ///< Format of each highlight type
+  qint64                        mRuleMemory;
+};
+
+/** The highlighting of a file, kept with a saved session so that the file
+ * can be shown highlighted again without the rules being run.  It only
+ * applies to the same text, in the same format, under the same rules. */
+struct HighlightCache
+{
+  HighlightCache(void);
+
+  /// @returns TRUE if nothing was captured.
+  bool isEmpty(void) const;
+
+  /// @returns The hash that text is matched by.
+  static quint64 hash(const QString& text);
+
+  quint64                   fileHash;     ///< hash() of the text
+  QString                   format;
+  quint64                   rulesStamp;   ///< ConfigFile::getRulesStamp() when captured
+  QVector<QTextCharFormat>  formats;      ///< The distinct formats used
+  QVector<QVector<int> >    blocks;       ///< Start, length and format of each range, by block
+};
+
+QDataStream& operator<<(QDataStream& stream, const HighlightCache& cache);
+QDataStream& operator>>(QDataStream& stream, HighlightCache& cache);
+
+class Highlighter : public QSyntaxHighlighter
+{
+  Q_OBJECT
+
+public:
+  Highlighter(QTextDocument *parent = NULL);
+  void setFileFormat(const QString& format);
+
+  /** Takes up the rules of \e format again once ConfigFile reloaded them.
+   * Rather than highlighting the whole document again, every block is
+   * marked stale, so the editor can restyle the blocks in view first and
+   * the rest a few at a time. */
+  void reloadRules(const QString& format);
+
+  /** @returns An estimate of the memory used by the highlighting rules of
+   * the current format, in bytes. */
+  qint64 ruleMemory(void) const;
+
+  /** @returns The names of the materials defined in the document. */
+  QStringList definedNames(void) const;
+
+  /** @returns The names of the materials defined in the document, with the
+   * number of blocks defining each.  A copy is cheap, and can be read on
+   * another thread. */
+  NameIndex nameIndex(void) const;
+
+  /** @returns The highlighter's parser state for a block, or NULL if the
+   *  block hasn't been highlighted yet. */
+  static BlockData* blockData(const QTextBlock& block);
+
+  /** @param block The block to look in.
+   * @param column The column to find the scope of.
+   * @param atStatementStart Receives whether the column starts a statement.
+   * @param inComment Receives whether the column is inside a comment.
+   * @returns The scope state at a column of a block. */
+  static ScopeState scopeAt(const QTextBlock& block, int column, bool* atStatementStart = NULL, bool* inComment = NULL);
+
+  /** Highlights blocks with the ranges of \e cache rather than the rules,
+   * for as long as it is set.  The parser state is still worked out.  Used
+   * while a document is loaded that matches a saved highlighting.
+   * @param cache The highlighting to use, or NULL to go back to the rules. */
+  void setCache(const HighlightCache* cache);
+
+  /** @returns The highlighting of every block of \e document. */
+  static HighlightCache capture(const QTextDocument* document);
+
+protected:
+  void highlightBlock(const QString &text);
+  void applyRules(const QString &text);
+  void applyCache(int block);
+  void underline(int start, int length);
+
+protected slots:
+  /** Reports the highlighting done since the last event loop iteration to
+   * the metrics registry. */
+  void onFrameFinished(void);
+
+private:
+  LineHighlighter               mRules;
+  QVector<QTextLayout::FormatRange> mRanges;    ///< Reused for every block
+  qint64                        mFrameNsecs;
+  int                           mFrameBlocks;
+  bool                          mFrameScheduled;
+  QSharedPointer<NameIndex>     mNames;
+  const HighlightCache*         mpCache;
+};
+
 #endif // _HIGHLIGHTER_H_
\ No newline at end of file
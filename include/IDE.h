@@ -1,58 +1,139 @@
-#ifndef _IDE_H_
-#define _IDE_H_
-#include <QtGui/QWidget>
-
-// FORWARD DECLARATIONS
-class QTabWidget;
-class QStatusBar;
-class TextEditor;
-
-class IDE : public QWidget
-{
-  Q_OBJECT
-
-public:
-  IDE(QWidget* parent = NULL, bool statusBar = true);
-  ~IDE(void);
-
-public slots:
-  void newFile(void);
-  void save(void);
-  void saveAs(void);
-  void open(void);
-  void setCurrentFormat(const QString& format);
-
-protected:
-  void addEditor(const QString& filename, const QString& path);
-  void dragEnterEvent(QDragEnterEvent*);
-  void dropEvent(QDropEvent*);
-  void setKeyword(const QString& keyword, const QString& format);
-
-protected slots:
-  void onFileDropped(const QString&);
-  void onTabChanged(int);
-  void onTabCloseRequested(int);
-  void onKeywordChanged(const QString&, const QString&);
-  void onEditorKeyEvent(QKeyEvent*);
-
-protected:
-  struct FileEditor : public QObjectUserData
-  {
-    FileEditor();
-    ~FileEditor();
-
-    QString filename;
-    QString path;
-    TextEditor* editor;
-  };
-
-  QFont                 mFont;
-  QTabWidget*           mpTabs;
-  QStatusBar*           mpStatusBar;
-  QVector<FileEditor*>  mEditors;
-  QVector<QString>      mKeywordSyntaxes;
-  QVector<QString>::iterator mKeywordSyntaxesItr;
-  FileEditor*           mpCurrentEditor;
-};
-
+#ifndef _IDE_H_
+#define _IDE_H_
+#include <QtGui/QWidget>
+#include <QtCore/QDateTime>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSet>
+#include "Atom.h"
+#include "Session.h"
+#include "ScriptDiff.h"
+
+// FORWARD DECLARATIONS
+class QTabWidget;
+class QStatusBar;
+class QFileSystemWatcher;
+class QTimer;
+class TextEditor;
+class LargeFileEditor;
+class Journal;
+class JournalWriter;
+class KeystrokeSession;
+class PerformanceHud;
+
+class IDE : public QWidget
+{
+  Q_OBJECT
+
+public:
+  IDE(QWidget* parent = NULL, bool statusBar = true);
+  ~IDE(void);
+
+public slots:
+  void newFile(void);
+  void save(void);
+  void saveAs(void);
+  void open(void);
+  void openFromBundle(void);
+  void setCurrentFormat(const QString& format);
+  void foldAll(void);
+  void unfoldAll(void);
+  void setRecording(bool record);
+  void setPerformanceHudVisible(bool visible);
+  void recoverJournals(void);
+  void saveSession(void);
+  void restoreSession(void);
+  void compareWithSaved(void);
+  void compareWithFile(void);
+
+signals:
+  /** Emitted whenever a different editor is shown, or the format of the
+   * current one is changed.
+   * @param editor The current TextEditor, or NULL if there isn't one or the
+   *        current file is open in a LargeFileEditor. */
+  void currentEditorChanged(TextEditor* editor);
+
+  /** Emitted when the current document has been compared with another
+   * version of it.
+   * @param title What was compared.
+   * @param changes The structural differences, in document order. */
+  void compared(const QString& title, const QVector<ScriptChange>& changes);
+
+protected:
+  struct FileEditor;
+
+  void addEditor(const QString& filename, const QString& path, bool large = false);
+  void createEditor(FileEditor* fe, bool large);
+  void openFile(const QString& path);
+  void watch(FileEditor* fe);
+  void reportImpact(const QString& path);
+  void showImpact(const QString& path);
+  void compareWith(const QString& path, const QString& title);
+  bool reloadFile(FileEditor* fe);
+  void restoreTab(FileEditor* fe);
+  void dragEnterEvent(QDragEnterEvent*);
+  void dropEvent(QDropEvent*);
+  void setKeyword(Atom keyword, const QString& format);
+  void updatePerformanceHud(void);
+
+protected slots:
+  void onFileDropped(const QString&);
+  void onTabChanged(int);
+  void onTabCloseRequested(int);
+  void onKeywordChanged(Atom, const QString&);
+  void onEditorKeyEvent(QKeyEvent*);
+  void onReflowed(void);
+  void onFileChanged(const QString&);
+  void reloadChangedFiles(void);
+  void onRulesChanged(const QStringList&);
+  void onDependenciesChanged(const QStringList&);
+
+protected:
+  /** An open file.  Files that TextEditor can't lay out are edited with a
+   * LargeFileEditor instead, so exactly one of the two editors is set; the
+   * methods here work with whichever it is. */
+  struct FileEditor : public QObjectUserData
+  {
+    FileEditor();
+    ~FileEditor();
+
+    QWidget* widget(void) const;
+    bool load(const QString& path);
+    bool save(const QString& path);
+    bool hasUnsavedChanges(void) const;
+    void setFileFormat(const QString& format);
+    QString fileFormat(void) const;
+    void reloadRules(void);
+
+    QString filename;
+    QString path;
+    QDateTime modified;   ///< Time stamp of the file when last loaded or saved here
+    qint64 size;          ///< Size of the file when last loaded or saved here
+    TextEditor* editor;
+    LargeFileEditor* largeEditor;
+    Journal* journal;     ///< Autosave journal of the TextEditor, owned by it
+    SessionTab* pending;  ///< Saved state of a tab not shown since it was restored, or NULL
+    HighlightCache highlight; ///< Last highlighting saved with the session
+  };
+
+  QFont                 mFont;
+  QTabWidget*           mpTabs;
+  QStatusBar*           mpStatusBar;
+  QVector<FileEditor*>  mEditors;
+  QVector<QString>      mKeywordSyntaxes;
+  QVector<QString>::iterator mKeywordSyntaxesItr;
+  FileEditor*           mpCurrentEditor;
+  KeystrokeSession*     mpRecording;
+  PerformanceHud*       mpHud;
+  QFileSystemWatcher*   mpWatcher;
+  QTimer*               mpReloadTimer;
+  QSet<QString>         mChangedFiles;  ///< Changed on disk and waiting for mpReloadTimer
+  QElapsedTimer         mFirstChange;   ///< Since the first of mChangedFiles changed
+  QSet<QString>         mSavedScripts;  ///< Saved and waiting for the graph to take them in
+  JournalWriter*        mpJournalWriter;
+  QString               mSessionPath;
+  QTimer*               mpSessionTimer;
+  uint                  mSessionHash;   ///< Of the session as last saved
+  bool                  mRestoring;
+};
+
 #endif // #endif
\ No newline at end of file
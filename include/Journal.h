@@ -0,0 +1,205 @@
+#ifndef _JOURNAL_H_
+#define _JOURNAL_H_
+#include <QtCore/QObject>
+#include <QtCore/QThread>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QStringList>
+
+// FORWARD DECLARATIONS
+class QFile;
+class TextEditor;
+
+/** A document read back from the journal of an editor that didn't close. */
+struct RecoveredDocument
+{
+  QString journal;    ///< The journal file it was read from
+  QString temp;       ///< A compacted journal left beside it by a crash, or empty
+  QString path;       ///< The file it was opened from, or empty if it had none
+  QString filename;
+  QString format;
+  QString text;
+};
+
+/** Writes the autosave journals of every modified document, on a thread of
+ * its own so that typing never waits on the disk.
+ *
+ * A journal is a file of records, each framed by its size and a checksum so
+ * that a record cut short by a crash is recognized and the ones before it
+ * are still used.  It starts with a snapshot of the document, and each
+ * change after that is appended as the position, the number of characters
+ * removed and the text inserted.  Changes are queued by the GUI thread,
+ * where a run of typing or deleting is merged into a single change, and are
+ * written a batch at a time.  Once a journal's changes outgrow its snapshot,
+ * it is compacted into a new snapshot, which the thread can do on its own
+ * since it keeps a copy of each document up to date from the changes. */
+class JournalWriter : public QThread
+{
+public:
+  /** What the writer has done since it started. */
+  struct Stats
+  {
+    qint64  editBytes;      ///< Characters inserted and removed by the changes
+    qint64  writtenBytes;   ///< Bytes written to the journals, snapshots included
+    qint64  records;        ///< Changes written, after merging
+    qint64  batches;
+    qint64  compactions;
+    double  meanLatencyMs;  ///< Mean time from a change being queued to it being written
+    double  maxLatencyMs;
+  };
+
+  /** Starts the writer thread.
+   * @param directory The directory the journals are written to.  It is
+   *        created if needed. */
+  JournalWriter(const QString& directory);
+
+  /** Writes anything still queued and stops the thread.  The journals that
+   * haven't been ended are kept, for the next start to recover. */
+  ~JournalWriter(void);
+
+  /// @returns The directory the journals are written to.
+  const QString& directory(void) const;
+
+  /** Starts a journal.
+   * @param path The file the document was opened from, if any.
+   * @param filename The name shown for the document.
+   * @param format The format of the document.
+   * @param text The whole document.
+   * @returns The journal's id, for the other calls. */
+  int begin(const QString& path, const QString& filename, const QString& format, const QString& text);
+
+  /** Queues a change to a document: \e removed characters at \e position are
+   * replaced by \e added. */
+  void change(int journal, int position, int removed, const QString& added);
+
+  /** Replaces a journal's document with a new snapshot. */
+  void snapshot(int journal, const QString& text);
+
+  /** Records that a document was saved to a new file. */
+  void rename(int journal, const QString& path, const QString& filename);
+
+  /** Ends a journal, removing its file. */
+  void end(int journal);
+
+  /** Blocks until everything queued has been written. */
+  void flush(void);
+
+  /// @returns What the writer has done since it started.
+  Stats stats(void) const;
+
+  /** Reads back the journals left in a directory by editors that didn't
+   * close, such as after a crash.  The journals of editors that are still
+   * running, this one included, are skipped: each writer holds a lock file
+   * for as long as it runs, which the system lets go of however it ends.
+   * @param directory The journal directory.
+   * @returns The documents, as they were when their last change was
+   *          written. */
+  static QList<RecoveredDocument> recover(const QString& directory);
+
+  /** Removes the journal a document was recovered from, and the compacted
+   * journal beside it, once the document has been restored or the user
+   * chose to discard it.
+   * @returns FALSE if the editor that wrote the journal is running again,
+   *          in which case the journal is left alone. */
+  static bool discard(const RecoveredDocument& doc);
+
+protected:
+  void run(void);
+
+private:
+  enum RecordType {BEGIN, CHANGE, SNAPSHOT, RENAME, END};
+
+  /** A request queued for the writer thread. */
+  struct Record
+  {
+    RecordType  type;
+    int         journal;
+    int         position;
+    int         removed;
+    QString     text;       ///< Inserted text, or the whole document
+    QString     path;
+    QString     filename;
+    QString     format;
+    qint64      queued;     ///< When it was queued, by mClock
+  };
+
+  /** An open journal.  These are only touched by the writer thread. */
+  struct Log
+  {
+    QFile*      file;
+    QString     text;       ///< The document, as the journal has it
+    QString     path;
+    QString     filename;
+    QString     format;
+    qint64      changeBytes;  ///< Bytes of changes since the snapshot
+  };
+
+  void push(const Record& record);
+  void write(const QList<Record>& batch);
+  void compact(Log* log);
+
+private:
+  QString                 mDirectory;
+  QString                 mLockPath;
+  quintptr                mLock;        ///< Held while the writer runs, or 0
+  QElapsedTimer           mClock;
+  mutable QMutex          mMutex;
+  QWaitCondition          mWake;        ///< Something was queued, or the thread should stop
+  QWaitCondition          mIdle;        ///< A batch was written
+  QList<Record>           mQueue;
+  qint64                  mQueuedBytes;
+  int                     mNextJournal;
+  bool                    mWriting;
+  bool                    mFlush;
+  bool                    mStop;
+  Stats                   mStats;
+  double                  mTotalLatencyMs;
+  QHash<int, Log*>        mLogs;
+};
+
+/** Journals the changes made to a TextEditor's document.  The journal is
+ * started when the document is first changed after being loaded or saved,
+ * with a snapshot that is taken once control returns to the event loop, so
+ * loading and reloading don't take one.  Changes the highlighter reports,
+ * which don't touch the text, are ignored. */
+class Journal : public QObject
+{
+  Q_OBJECT
+
+public:
+  /** Journals \e editor, which owns the journal. */
+  Journal(TextEditor* editor, JournalWriter* writer);
+
+  /** Ends the journal. */
+  ~Journal(void);
+
+  /** Sets the file the document belongs to, for recovery. */
+  void setFile(const QString& path, const QString& filename);
+
+  /** Ends the journal, since the document matches its file.  Call after
+   * loading or saving. */
+  void clear(void);
+
+private slots:
+  void onContentsChange(int position, int removed, int added);
+  void takeSnapshot(void);
+
+private:
+  /** Takes a snapshot on the next pass of the event loop. */
+  void scheduleSnapshot(void);
+
+private:
+  TextEditor*     mpEditor;
+  JournalWriter*  mpWriter;
+  QString         mPath;
+  QString         mFilename;
+  int             mId;          ///< The journal, or -1 if there isn't one
+  int             mLength;      ///< Length of the document as journaled
+  int             mRevision;    ///< Revision of the document as journaled
+  bool            mSnapshotPending;
+};
+
+#endif // _JOURNAL_H_
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef _KEYSTROKESESSION_H_
+#define _KEYSTROKESESSION_H_
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+// FORWARD DECLARATIONS
+class QKeyEvent;
+
+/** A single recorded key press. */
+struct Keystroke
+{
+  int     key;
+  int     modifiers;
+  QString text;
+};
+
+/** A recorded sequence of key presses in a TextEditor, along with the file
+ * and cursor position the recording started from, so that it can be replayed
+ * later to measure how the editor responds.
+ *
+ * Sessions are saved as plain text with one key press per line, so they can
+ * be written by hand or edited after recording:
+ * @code
+ * file    D:/materials/example.material
+ * cursor  1024
+ * key     01000004 00000000 %0D
+ * @endcode
+ * Keys and modifiers are Qt::Key and Qt::KeyboardModifiers in hex, and the
+ * text is percent-encoded. */
+class KeystrokeSession
+{
+public:
+  KeystrokeSession(void);
+
+  /** Removes all keystrokes and resets the file and cursor position. */
+  void clear(void);
+
+  /** Appends a key press to the session. */
+  void append(const QKeyEvent& event);
+
+  /** Appends a key press to the session. */
+  void append(int key, int modifiers = 0, const QString& text = QString());
+
+  /** @param path The file to load the session from.
+   * @returns TRUE if the session was loaded, FALSE otherwise. */
+  bool load(const QString& path);
+
+  /** @param path The file to save the session to.
+   * @returns TRUE if the session was saved, FALSE otherwise. */
+  bool save(const QString& path) const;
+
+  /** Sorts a key press into the kind of work it causes in the editor, for
+   * example "enter" for auto-indentation or "brace" for brace matching.
+   * @returns The category of \e keystroke. */
+  static QString category(const Keystroke& keystroke);
+
+  /// The file that was open when recording started
+  QString             file;
+
+  /// The cursor position when recording started
+  int                 cursorPosition;
+
+  /// The recorded key presses, in order
+  QVector<Keystroke>  keystrokes;
+};
+
+#endif // _KEYSTROKESESSION_H_
\ No newline at end of file
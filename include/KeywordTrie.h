@@ -0,0 +1,80 @@
+#ifndef _KEYWORDTRIE_H_
+#define _KEYWORDTRIE_H_
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+namespace config
+{
+  /** A prefix trie over the words of a format, used to look up completions
+   * as the user types.  The trie is stored in two flat arrays (nodes and
+   * edges), with each node's edges contiguous and sorted, so that walking it
+   * touches as little memory as possible.
+   *
+   * Words are walked by their lower case keys, so they match
+   * case-insensitively, but are returned as they are spelled, as indices
+   * into words(). */
+  class KeywordTrie
+  {
+  public:
+    KeywordTrie(void);
+
+    /** Replaces the contents of the trie.
+     * @param words The words to store.  Duplicates are ignored. */
+    void build(const QStringList& words);
+
+    /** Finds every word that starts with \e prefix, in alphabetical order.
+     * @param prefix The prefix to look for.
+     * @param out Receives the indices of the matching words.
+     * @param limit The most words to return. */
+    void findPrefix(const QString& prefix, QVector<int>& out, int limit) const;
+
+    /** Finds every word that contains the characters of \e query in order,
+     * though not necessarily next to each other ("dwr" finds "depth_write").
+     * @param query The characters to look for.
+     * @param out Receives the indices of the matching words.
+     * @param limit The most words to return. */
+    void findFuzzy(const QString& query, QVector<int>& out, int limit) const;
+
+    /** @returns The words in the trie as they are spelled, in alphabetical
+     * order of their lower case keys. */
+    const QStringList& words(void) const;
+
+    /// @returns The number of nodes in the trie.
+    int nodeCount(void) const;
+
+    /** Scores how well \e word matches what the user typed.  A word that
+     * starts with \e query always beats one that only contains it, matches at
+     * the start of '_' separated parts and runs of consecutive matches score
+     * higher, and shorter words win ties.
+     * @returns The score, or -1 if \e word doesn't contain \e query. */
+    static int score(const QString& query, const QString& word);
+
+  private:
+    struct Node
+    {
+      int firstEdge;
+      int numEdges;
+      int word;       ///< Index of the first word ending here, or -1
+      int numWords;   ///< Words ending here, more than one if only their case differs
+    };
+
+    struct Edge
+    {
+      ushort  ch;
+      int     child;
+    };
+
+    int buildNode(int lo, int hi, int depth);
+    void collect(int node, QVector<int>& out, int limit) const;
+    void collectFuzzy(int node, const QString& query, int matched, QVector<int>& out, int limit) const;
+
+  private:
+    QStringList     mWords;   ///< As they are spelled
+    QStringList     mKeys;    ///< Lower case key of each word
+    QVector<Node>   mNodes;
+    QVector<Edge>   mEdges;
+  };
+}
+
+#endif // _KEYWORDTRIE_H_
\ No newline at end of file
@@ -0,0 +1,276 @@
+#ifndef _LARGEFILEEDITOR_H_
+#define _LARGEFILEEDITOR_H_
+#include <QtGui/QAbstractScrollArea>
+#include <QtCore/QHash>
+#include "PieceTable.h"
+#include "Highlighter.h"
+#include "Atom.h"
+
+/** An editor for files too big for TextEditor, such as generated material
+ * dumps of hundreds of megabytes.  The file is edited in place through a
+ * PieceTable, and the view is virtual: nothing is laid out but the lines on
+ * screen, and of those only the visible columns, so opening a file costs no
+ * more than mapping it and scrolling costs the same anywhere in the file.
+ *
+ * Files within TextEditor::MAX_FILE_SIZE that have lines too long for a
+ * TextEditor to lay out, such as materials exported on a single line, are
+ * opened here too.
+ *
+ * It offers the editing TextEditor does at the keyboard (auto-indentation,
+ * brace matching and spaces for tabs), along with selection, the clipboard
+ * and undo, and highlights with the same rules, but has no completion.  The
+ * vertical scroll bar moves through the file by byte, since the number of
+ * lines isn't known.
+ *
+ * The ends of the lines in view are kept, and moved along with edits, so
+ * neither painting nor typing has to search a long line for its ends.  A
+ * long line is highlighted a chunk at a time around the visible columns,
+ * and when one comes into view the editor offers to reflow the script onto
+ * separate lines. */
+class LargeFileEditor : public QAbstractScrollArea
+{
+  Q_OBJECT
+
+public:
+  /** Default CTOR */
+  LargeFileEditor(QWidget* parent = NULL);
+
+  /** Default DTOR */
+  ~LargeFileEditor(void);
+
+  /** Sets the number of spaces that get inserted whenever TAB is pressed.
+   * @param spaces The number of spaces to insert. */
+  void setTabSpaces(int spaces);
+
+  /** @returns TRUE if the document has unsaved changes, FALSE otherwise. */
+  bool hasUnsavedChanges() const;
+
+  /** @returns The memory used by this editor's edits and highlighter, in
+   * bytes.  The mapped file isn't counted. */
+  qint64 estimatedMemory(void) const;
+
+  /** @returns The document. */
+  const PieceTable& buffer(void) const;
+
+  /** @returns The format of the document, such as "materials". */
+  const QString& fileFormat(void) const;
+
+  /** Sets the current file format to format.
+   * @param format The desired file format. */
+  void setFileFormat(const QString& format);
+
+  /** Takes up the rules of the current format again once ConfigFile
+   * reloaded them.  Lines are highlighted as they are painted, so only the
+   * view has to be painted again. */
+  void reloadRules(void);
+
+  /** Maps a file for editing.
+   * @param path The path of the file to load.
+   * @returns TRUE if the file is successfuly loaded, FALSE otherwise. */
+  bool load(const QString& path);
+
+  /** Saves the document, and then maps the saved file in its place so the
+   * edits no longer take up memory.
+   * @param path The path of the file to save to.
+   * @returns TRUE if the file is successfuly saved, FALSE otherwise. */
+  bool save(const QString& path);
+
+  /// @returns The position of the cursor, in bytes from the start of the file.
+  qint64 cursorPosition(void) const;
+
+  /** Moves the cursor, clearing the selection, and scrolls it into view. */
+  void setCursorPosition(qint64 pos);
+
+  /// @returns TRUE if some text is selected, FALSE otherwise.
+  bool hasSelection(void) const;
+
+  /// @returns The selected text.
+  QByteArray selectedText(void) const;
+
+  /** Shows or hides the bar offering to reflow the document. */
+  void setReflowOffered(bool offered);
+
+public slots:
+  /** Breaks the document into one statement per line, with each brace on a
+   * line of its own, indented by the depth of its braces.  Strings and
+   * comments are kept as they are. */
+  void reflow(void);
+
+  /** Takes back the last edit.  A run of typed characters, and the edits
+   * made by one key press, are taken back together. */
+  void undo(void);
+
+  /** Makes the last edit that was taken back again. */
+  void redo(void);
+
+  /** Copies the selection to the clipboard and removes it. */
+  void cut(void);
+
+  /** Copies the selection to the clipboard. */
+  void copy(void);
+
+  /** Replaces the selection with the text on the clipboard. */
+  void paste(void);
+
+  /** Selects the whole document. */
+  void selectAll(void);
+
+signals:
+  /** Emitted whenever a file is dropped onto the editor.
+   * @param path The full path of the file dropped onto the editor. */
+  void fileDropped(const QString& path);
+
+  /** Emitted whenever the first word of the cursor's line changes.
+   * @param keyword The new keyword in focus, or the null atom.
+   * @param format The format that this keyword applies to. */
+  void keywordChanged(Atom keyword, const QString& format);
+
+  /** Emitted whenever a key is pressed in the editor.
+   * @param event The QKeyEvent received in keyPressEvent(). */
+  void keyPressed(QKeyEvent* event);
+
+  /** Emitted after the document has been reflowed. */
+  void reflowed(void);
+
+protected:
+  /** An edit kept for undo and redo. */
+  struct Edit
+  {
+    qint64      pos;
+    QByteArray  removed;
+    QByteArray  inserted;
+    qint64      cursor;   ///< Where the cursor was before the edit
+    bool        chained;  ///< Taken back along with the edit before it
+    bool        typed;    ///< A run of typed characters, which typing extends
+  };
+
+  void keyPressEvent(QKeyEvent*);
+  void paintEvent(QPaintEvent*);
+  void mousePressEvent(QMouseEvent*);
+  void mouseMoveEvent(QMouseEvent*);
+  void resizeEvent(QResizeEvent*);
+  void dragEnterEvent(QDragEnterEvent*);
+  void dropEvent(QDropEvent*);
+  void scrollContentsBy(int dx, int dy);
+  bool focusNextPrevChild(bool next);
+
+  /** Inserts text at the cursor and moves the cursor past it. */
+  void insertText(const QByteArray& text);
+
+  /** Removes text, keeping the cursor and view where they were. */
+  void removeText(qint64 pos, qint64 length);
+
+  /** Removes the selected text, leaving the cursor where it started. */
+  void removeSelection(void);
+
+  /** Keeps an edit that is about to be made, so it can be undone.  The
+   * edits made until the next key press are chained to it.  Should the
+   * history grow past its limit, the oldest edits are forgotten.
+   * @param pos Where the edit is.
+   * @param removed The number of bytes to be removed at \e pos.
+   * @param inserted The text to be inserted at \e pos in their place. */
+  void recordEdit(qint64 pos, qint64 removed, const QByteArray& inserted);
+
+  /** Replaces text in the document, moving the cursor, the selection, the
+   * view and the rows in view along with it. */
+  void applyEdit(qint64 pos, qint64 removed, const QByteArray& inserted);
+
+  /** Forgets every edit kept for undo and redo. */
+  void clearHistory(void);
+
+  /// @returns The position in the document nearest to a point in the viewport.
+  qint64 positionAt(const QPoint& point);
+
+  /** @returns The end of the text of the line starting at \e line: the
+   * position of its line break, or of the '\r' of a "\r\n" break. */
+  qint64 textEnd(qint64 line) const;
+
+  /** Gets the number of spaces that the current line should be indented to
+   * match the indentation of its scope.  Braces are counted backwards from
+   * the cursor, a line at a time, and if no open brace turns up within a
+   * megabyte the current line's indentation is kept.
+   * @param toPrevBraceOnly If TRUE, this will only return how many spaces the
+   *        opening brace for this scope is indented.
+   * @returns The number of spaces that the current line should be indented. */
+  int getNumIndent(bool toPrevBraceOnly = false) const;
+
+  /** Will insert a closing brace } that lines up with the most recent open
+   * brace {, like TextEditor::matchBraces(). */
+  void matchBraces(void);
+
+  /** Moves the cursor up or down by lines, keeping its column. */
+  void moveLines(int count);
+
+  /** Scrolls so that the cursor's line is visible. */
+  void ensureCursorVisible(void);
+
+  /** Updates the scroll bars from the view and the document. */
+  void updateScrollBars(void);
+
+  /** Checks for a new focused keyword. */
+  void updateKeyword(void);
+
+  /** Gets the lexical state (code, string or comment) at the start of a
+   * chunk of a long line, so the chunk can be highlighted on its own.  The
+   * states of a line's chunks are kept until it is edited.
+   * @param line The start of the line.
+   * @param end The end of the line's text.
+   * @param chunk The index of the chunk.
+   * @returns The state of the lexer at the start of the chunk. */
+  char chunkState(qint64 line, qint64 end, int chunk);
+
+  /** Forgets the chunk states that an edit at \e pos changes. */
+  void invalidateChunks(qint64 pos);
+
+  /** Brings the line ends of the rows in view up to date with mTopLine,
+   * looking up only those of lines that weren't in view before. */
+  void updateRows(void);
+
+  /** Moves the line ends of the rows in view along with an edit.
+   * @param pos Where the edit is.
+   * @param removed The number of bytes removed at \e pos.
+   * @param inserted The text inserted at \e pos in their place. */
+  void editRows(qint64 pos, qint64 removed, const QByteArray& inserted);
+
+  /** @returns The start of the line holding \e pos, from the rows in view
+   * if it is one of them, or from the document otherwise. */
+  qint64 findLineStart(qint64 pos) const;
+
+  /** @returns The end of the line starting at \e line, from the rows in
+   * view if it is one of them, or from the document otherwise. */
+  qint64 findLineEnd(qint64 line) const;
+
+  /** Places the reflow bar above the viewport. */
+  void layoutReflowBar(void);
+
+  int lineHeight(void) const;
+  int charWidth(void) const;
+  int visibleLines(void) const;
+  int visibleColumns(void) const;
+
+protected:
+  PieceTable      mBuffer;
+  LineHighlighter mHighlighter;
+  QVector<QTextLayout::FormatRange> mRanges;
+  bool            mUnsavedChanges;
+  QString         mFormat;
+  QByteArray      mTabSpaces;
+  QByteArray      mNewline;       ///< "\n", or "\r\n" if the file uses it
+  Atom            mFocusedKeyword;
+  qint64          mTopLine;       ///< Start of the first visible line
+  qint64          mCursor;
+  qint64          mAnchor;        ///< Other end of the selection, or mCursor
+  int             mGoalColumn;    ///< Column kept when moving up and down
+  int             mLeftColumn;    ///< First visible column
+  qint64          mScrollScale;   ///< Bytes per step of the vertical scroll bar
+  QHash<qint64, QByteArray> mChunkStates; ///< Chunk states of long lines, by line start
+  QVector<qint64> mRowEnds;       ///< Ends of the lines from mRowsTop on, or empty if unknown
+  qint64          mRowsTop;       ///< Start of the first line in mRowEnds
+  QVector<Edit>   mUndo;
+  QVector<Edit>   mRedo;
+  qint64          mHistoryMemory; ///< Bytes held by mUndo and mRedo
+  bool            mChainEdits;    ///< Chain the next edit to the last one
+  QWidget*        mpReflowBar;
+};
+
+#endif // _LARGEFILEEDITOR_H_
\ No newline at end of file
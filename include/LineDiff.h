@@ -0,0 +1,41 @@
+#ifndef _LINEDIFF_H_
+#define _LINEDIFF_H_
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+/** A change found by LineDiff: lines [oldStart, oldStart + oldCount) of the
+ * old text are replaced by lines [newStart, newStart + newCount) of the new.
+ * Either count may be 0, for a pure insert or removal. */
+struct DiffHunk
+{
+  int oldStart;
+  int oldCount;
+  int newStart;
+  int newCount;
+};
+
+/** Finds the lines that differ between two versions of a text, so that only
+ * those have to be touched when a file is reloaded.  Lines are compared by a
+ * 64 bit hash, which is computed once per line, and the shortest edit script
+ * between the hashes is found with Myers' algorithm after the common start
+ * and end are trimmed off.  A reload usually changes a few lines of a large
+ * file, which this finds in time proportional to the file plus the square of
+ * the number of changed lines. */
+class LineDiff
+{
+public:
+  /** @returns The hash of a line used for comparisons. */
+  static quint64 hashLine(const QString& line);
+
+  /** Compares two texts.
+   * @param oldLines The hash of each line of the old text.
+   * @param newLines The hash of each line of the new text.
+   * @param maxEdits The most lines changed before giving up on a minimal
+   *        diff; everything between the common start and end is then
+   *        returned as a single hunk.
+   * @returns The hunks, in order.  None if the texts are the same. */
+  static QVector<DiffHunk> compare(const QVector<quint64>& oldLines, const QVector<quint64>& newLines,
+                                   int maxEdits = 2000);
+};
+
+#endif // _LINEDIFF_H_
\ No newline at end of file
@@ -1,28 +1,37 @@
-#ifndef _MAINWINDOW_H_
-#define _MAINWINDOW_H_
-#include <QtGui/QMainWindow>
-#include "Highlighter.h"
-
-class IDE;
-
-class MainWindow : public QMainWindow
-{
-  Q_OBJECT
-
-public:
-  MainWindow(QWidget *parent = 0);
-
-public slots:
-  void about();
-  void temp(QAction*);
-  
-private:
-  void setupEditor();
-  void setupFileMenu();
-  void setupOptionsMenu();
-  void setupHelpMenu();
-
-  IDE* mpIde;
-};
-
+#ifndef _MAINWINDOW_H_
+#define _MAINWINDOW_H_
+#include <QtGui/QMainWindow>
+#include "Highlighter.h"
+
+class IDE;
+class QDockWidget;
+
+class MainWindow : public QMainWindow
+{
+  Q_OBJECT
+
+public:
+  MainWindow(QWidget *parent = 0);
+
+public slots:
+  void about();
+  void temp(QAction*);
+  void setTracing(bool);
+  void saveTrace();
+  
+private:
+  void setupEditor();
+  void setupFileMenu();
+  void setupViewMenu();
+  void setupOptionsMenu();
+  void setupHelpMenu();
+
+  IDE* mpIde;
+  QDockWidget* mpOutlineDock;
+  QDockWidget* mpProblemsDock;
+  QDockWidget* mpEffectiveDock;
+  QDockWidget* mpDiffDock;
+  QDockWidget* mpDocsDock;
+};
+
 #endif // _MAINWINDOW_H_
\ No newline at end of file
@@ -0,0 +1,195 @@
+#ifndef _MANUALINDEX_H_
+#define _MANUALINDEX_H_
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QVector>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QFileSystemWatcher>
+#include <QtCore/QTimer>
+#include <QtCore/QElapsedTimer>
+
+/** A page of the manual that matched a search. */
+struct ManualHit
+{
+  QString   path;     ///< Relative to the manual directory, with '/' separators
+  QString   title;
+  QString   snippet;  ///< The text around the first match
+  QString   term;     ///< The word of the page that matched first
+  double    score;
+};
+
+/** A page of the manual, as the index reads it. */
+struct ManualPage
+{
+  QString               path;     ///< Relative to the manual directory, with '/' separators
+  QString               title;
+  QString               text;     ///< As toPlainText() makes it
+  qint64                modified; ///< In ms since the epoch
+  qint64                size;
+  QHash<QString, int>   counts;   ///< How often each word is in the page, words in the title weighing more
+  int                   length;   ///< Of the page in words, as weighed
+
+  ManualPage(void) : modified(0), size(0), length(0) {}
+
+  /** Reads the page at \e path under \e directory.
+   * @returns FALSE if it can't be read. */
+  static bool read(const QString& directory, const QString& path, ManualPage& out);
+};
+
+/** An inverted index of the words in the HTML pages of a directory, such as
+ * the Ogre manual.
+ *
+ * Each word is mapped to the pages it is in and how often, so a search
+ * only looks at the pages with its words in them.  Words are kept in order,
+ * so the last word of a query, which may still be being typed, is matched
+ * as a prefix by reading a range of them.  Pages are ranked by BM25, with
+ * words in titles counting more.  The text of each page is kept too, for
+ * the snippets and for IDE::setKeyword's syntax lookups.
+ *
+ * Like DependencyGraph, refresh() reads only the pages that changed since
+ * the index was saved, by their time stamps and sizes, and the index is made
+ * of implicitly shared containers, so copies are cheap. */
+class ManualIndex
+{
+public:
+  ManualIndex(void);
+
+  /** Sets the directory whose pages are in the index.  The index is emptied
+   * if it isn't the one it has. */
+  void setDirectory(const QString& directory);
+
+  /// @returns The directory whose pages are in the index.
+  const QString& directory(void) const;
+
+  /** Brings the index up to date with the pages in its directory, reading
+   * the ones that are new or changed in parallel and dropping the ones that
+   * are gone.
+   * @returns The number of pages read or dropped. */
+  int refresh(void);
+
+  /** Loads an index saved by save().
+   * @returns FALSE if there isn't one, or it can't be read. */
+  bool load(const QString& path);
+
+  /** Saves the index.  Saves that fail leave the last good index alone. */
+  bool save(const QString& path);
+
+  /// @returns TRUE if the index changed since it was loaded or saved.
+  bool isModified(void) const;
+
+  /** Finds the pages with every word of \e query in them, best first.
+   * Unless \e query ends in a space, its last word matches any word that
+   * starts with it.
+   * @param maxHits The most pages to return. */
+  void search(const QString& query, int maxHits, QVector<ManualHit>& out) const;
+
+  /** @returns The text of the page at \e path, relative to the directory,
+   * or an empty string if it isn't in the index. */
+  QString pageText(const QString& path) const;
+
+  /** @returns The pages in the index, relative to the directory. */
+  QStringList pages(void) const;
+
+  /// @returns The number of pages in the index.
+  int pageCount(void) const;
+
+  /// @returns The number of distinct words in the index.
+  int termCount(void) const;
+
+  /** @returns TRUE if the index reads the file at \e path. */
+  static bool isPage(const QString& path);
+
+  /** @returns The text of an HTML page, without its tags and with its
+   * entities decoded.  Line breaks, paragraphs and the other block elements
+   * start new lines; the rest of the layout is collapsed to single spaces. */
+  static QString toPlainText(const QString& html);
+
+  /** Splits text into the words the index keeps, in lower case.
+   * @param parts Also adds the parts of words joined by '_', so "blend"
+   *        finds scene_blend. */
+  static QStringList splitTerms(const QString& text, bool parts);
+
+private:
+  struct Posting
+  {
+    int   page;
+    int   count;
+  };
+
+  typedef QMap<QString, QVector<Posting> > PostingMap;
+
+  void addPage(const ManualPage& page);
+  void removePage(const QString& path);
+  void scoreTerm(const QVector<Posting>& postings, QHash<int, double>& scores) const;
+
+private:
+  QString               mDirectory;
+  QVector<ManualPage>   mPages;
+  QVector<int>          mFree;      ///< Free slots of mPages, whose paths are empty
+  QHash<QString, int>   mPageIds;   ///< By relative path
+  PostingMap            mPostings;  ///< By word
+  qint64                mTotalLength;
+  bool                  mModified;
+};
+
+/** Keeps the index of the manual directory in config.xml up to date in the
+ * background.  The index saved by the last session is loaded and brought
+ * up to date off the GUI thread, and again whenever the pages change or
+ * config.xml names another directory. */
+class ManualIndexer : public QObject
+{
+  Q_OBJECT
+
+public:
+  /// @returns The indexer, which starts building the first time it's needed.
+  static ManualIndexer* instance(void);
+
+  /** @returns The index as it is now.  It is empty until the first build
+   * finishes, and while there is no manual directory. */
+  const ManualIndex& index(void) const;
+
+  /// @returns TRUE while the index is being built.
+  bool isBuilding(void) const;
+
+signals:
+  /** Emitted whenever the index changes. */
+  void changed(void);
+
+protected slots:
+  void onBuildFinished(void);
+  void onPathChanged(const QString& path);
+
+  /** Builds the index of the manual again if config.xml now names another
+   * directory for it. */
+  void onConfigChanged(void);
+
+  /** Starts bringing the index up to date, or once the current build ends. */
+  void rebuild(void);
+
+private:
+  ManualIndexer(void);
+
+  /** Brings \e index up to date with \e directory and saves it at
+   * \e savePath if it changed.  An empty index is first loaded from
+   * \e savePath.  This is what runs on the thread pool. */
+  static ManualIndex buildIndex(ManualIndex index, const QString& directory, const QString& savePath);
+
+  /** Watches the manual directory, its subdirectories and its pages. */
+  void syncWatches(void);
+
+private:
+  static ManualIndexer*         mpMe;
+  ManualIndex                   mIndex;
+  QString                       mSavePath;
+  QString                       mDirectory; ///< The manual directory of the latest build
+  QFutureWatcher<ManualIndex>   mBuild;
+  QFileSystemWatcher            mWatcher;
+  QTimer                        mTimer;
+  QElapsedTimer                 mSinceBuild;
+  bool                          mPending;   ///< Pages changed during the build
+};
+
+#endif // _MANUALINDEX_H_
\ No newline at end of file
@@ -0,0 +1,144 @@
+#ifndef _MATERIALFLATTENER_H_
+#define _MATERIALFLATTENER_H_
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+#include "ResourceResolver.h"
+
+// FORWARD DECLARATIONS
+namespace script
+{
+  struct Node;
+}
+
+/** A statement of a material script, and the statements in its block.
+ * Unlike script::Node, a statement owns its text, so it outlives the file
+ * it was read from. */
+struct MaterialStatement
+{
+  QString                     keyword;
+  QStringList                 args;
+  bool                        block;    ///< Has a { } block, even an empty one
+  QVector<MaterialStatement>  children;
+
+  MaterialStatement(void) : block(false) {}
+
+  /** @returns The statement as script text, each level of its block
+   * indented by one more tab than \e indent. */
+  QString toString(int indent = 0) const;
+
+  /** Copies a statement out of a parsed script, block and all. */
+  static MaterialStatement fromNode(const script::Node* node);
+
+  /** @returns TRUE if attributes with \e keyword may be repeated in a block,
+   * told apart by their first argument, like param_named. */
+  static bool isRepeatable(const QString& keyword);
+
+  bool operator==(const MaterialStatement& rhs) const;
+  bool operator!=(const MaterialStatement& rhs) const { return !(*this == rhs); }
+};
+
+/** A material as a script defines it, before inheritance. */
+struct MaterialDefinition
+{
+  QString             name;
+  QString             parent;   ///< After the ':', or empty
+  int                 line;
+  MaterialStatement   body;     ///< The material statement, without its parent
+
+  /** Finds the materials a parsed script defines, in order. */
+  static void fromScript(const script::Node* root, QVector<MaterialDefinition>& out);
+};
+
+/** Resolves "material Child : Parent" chains into the effective material:
+ * the parent's effective material with the child's statements laid over it,
+ * the way Ogre's script compiler does.  Objects in the child's blocks are
+ * merged into the parent's object with the same keyword and name, or if
+ * they have no name, the one in the same position; anything else is
+ * added.  Attributes replace the parent's attribute of the same keyword
+ * (and first argument, for the ones that may be repeated, like
+ * param_named), or are added.
+ *
+ * Every effective material is kept once worked out, so flattening a whole
+ * library works out each material once, however deep the chains are.
+ * Each material also knows the materials that inherit from it, so when a
+ * definition changes exactly it and its descendants are worked out again.
+ *
+ * Scripts are either added directly, such as a document being edited, or
+ * read from the resource directories the first time one of their materials
+ * is needed.  Scripts added directly take precedence. */
+class MaterialFlattener
+{
+public:
+  MaterialFlattener(void);
+
+  /** Sets where materials that no script added defines are looked for.
+   * Scripts already read from the old index stay until refresh(). */
+  void setResources(const ResourceIndex& resources);
+
+  /** Adds a script's materials, replacing whatever it defined before.  Only
+   * the materials whose definitions changed are forgotten, along with the
+   * materials that inherit from them. */
+  void addScript(const QString& path, const QVector<MaterialDefinition>& definitions);
+
+  /** Drops a script's materials. */
+  void removeScript(const QString& path);
+
+  /** Reads the scripts read from the resource directories again if they
+   * changed on disk, and drops them if they're gone.
+   * @returns The number of scripts read again or dropped. */
+  int refresh(void);
+
+  /** Works out the effective material of \e name.
+   * @param out Receives the material statement, without a parent.
+   * @param error Receives why it couldn't be worked out: a material that
+   *        isn't defined anywhere, or a chain that inherits from itself.
+   * @returns FALSE if it couldn't be worked out. */
+  bool flatten(const QString& name, MaterialStatement& out, QString* error = NULL);
+
+  /** @returns \e name and the materials it inherits from, nearest first, as
+   * far as they are defined. */
+  QStringList ancestry(const QString& name);
+
+  /** @returns The script defining \e name, or an empty string. */
+  QString definingScript(const QString& name);
+
+  /// @returns The number of effective materials kept.
+  int flattenedCount(void) const;
+
+private:
+  struct Definition
+  {
+    MaterialDefinition  material;
+    QString             path;
+  };
+
+  struct Script
+  {
+    QStringList   names;      ///< Of the materials it defines, in lower case
+    bool          loaded;     ///< Read from the resource directories
+    qint64        modified;   ///< In ms since the epoch, if loaded
+    qint64        size;
+
+    Script(void) : loaded(false), modified(0), size(0) {}
+  };
+
+  const Definition* findDefinition(const QString& key);
+  bool loadScript(const QString& path);
+  void setDefinitions(const QString& path, const QVector<MaterialDefinition>& definitions, bool loaded);
+  void dropScript(const QString& path);
+  void linkParent(const QString& key, const QString& parent, bool add);
+  void forget(const QString& key);
+  bool flattenKey(const QString& name, QStringList& visiting, MaterialStatement& out, QString* error);
+
+private:
+  ResourceIndex                         mResources;
+  QHash<QString, Script>                mScripts;
+  QHash<QString, Definition>            mDefinitions; ///< By lower case name
+  QHash<QString, QSet<QString> >        mInheritors;  ///< Lower case names of the children of each material
+  QHash<QString, MaterialStatement>     mFlattened;   ///< By lower case name
+};
+
+#endif // _MATERIALFLATTENER_H_
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifndef _METRICS_H_
+#define _METRICS_H_
+#include <QtCore/QString>
+#include <QtCore/QMap>
+
+namespace metrics
+{
+  /** A named measurement fed by one of the editor's subsystems.  A metric
+   * keeps a rolling window of its most recent samples, so it can be used as
+   * a gauge (last()), a rolling average (mean(), peak(), percentile()) or a
+   * counter (total()).  Recording a sample is a couple of stores, cheap
+   * enough to leave on all the time.
+   *
+   * Metrics are only fed and read on the GUI thread. */
+  class Metric
+  {
+  public:
+    /// Number of recent samples kept
+    static const int WINDOW = 128;
+
+    Metric(void);
+
+    /** Records a sample. */
+    void sample(double value);
+
+    /// @returns The most recent sample, or 0 if there are none.
+    double last(void) const;
+
+    /// @returns The mean of the samples in the window.
+    double mean(void) const;
+
+    /// @returns The largest sample in the window.
+    double peak(void) const;
+
+    /// @returns The p-th percentile (0-100) of the samples in the window.
+    double percentile(double p) const;
+
+    /// @returns The sum of every sample ever recorded.
+    double total(void) const;
+
+    /// @returns The number of samples ever recorded.
+    qint64 count(void) const;
+
+  private:
+    double  mWindow[WINDOW];
+    int     mNext;
+    qint64  mCount;
+    double  mTotal;
+  };
+
+  /** The central registry of metrics.  Subsystems look their metrics up once
+   * (the pointer stays valid for the life of the program) and feed them, and
+   * anything that wants to show numbers, such as the performance HUD, reads
+   * them back by name. */
+  class Registry
+  {
+  public:
+    /// @returns A static pointer to the Registry singleton.
+    static Registry* instance();
+
+    /** @param name The name of the metric, such as "highlight.frame_ms".
+     * @returns The metric with the given name.  It is created if it doesn't
+     *          exist yet. */
+    Metric* metric(const QString& name);
+
+    /// @returns All metrics, by name.
+    const QMap<QString, Metric*>& all(void) const;
+
+  private:
+    /// Private ctor
+    Registry(void);
+
+    /// Private dtor
+    ~Registry(void);
+
+  private:
+    static Registry*        mpMe;
+    QMap<QString, Metric*>  mMetrics;
+  };
+}
+
+#endif // _METRICS_H_
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef _OUTLINE_H_
+#define _OUTLINE_H_
+#include <QtGui/QTreeWidget>
+#include <QtGui/QTextCursor>
+#include <QtCore/QTimer>
+#include <QtCore/QPointer>
+#include <QtCore/QList>
+
+// FORWARD DECLARATIONS
+class TextEditor;
+class QTextBlock;
+
+/** A tree of the scopes in the current document, meant to be docked beside
+ * the IDE's tabs: the materials, techniques, passes and texture units of a
+ * material script, or the overlays, containers and elements of an overlay
+ * script.  A scope gets an entry if it is at the top level or its keyword
+ * is one of the format's strong keywords.  Clicking an entry moves the
+ * cursor to it.
+ *
+ * The tree is kept up to date a top-level scope at a time.  Edits are
+ * gathered into one range of the document, and shortly after the last one,
+ * the top-level scopes that range touches are read again from the brace
+ * depths the highlighter keeps with each block and their entries replaced.
+ * The rest of the tree is left alone, however large the document. */
+class Outline : public QTreeWidget
+{
+  Q_OBJECT
+
+public:
+  Outline(QWidget* parent = NULL);
+
+  /** Brings the tree up to date with the edits made since it last was.
+   * This happens on its own shortly after each edit. */
+  void refresh(void);
+
+public slots:
+  /** Sets the editor whose document is outlined, and builds the tree.
+   * @param editor The current editor, or NULL if there isn't one. */
+  void setEditor(TextEditor* editor);
+
+protected slots:
+  /** Adds an edit to the range waiting to be read again. */
+  void onContentsChange(int position, int removed, int added);
+
+  /** Moves the editor's cursor to the entry. */
+  void onItemClicked(QTreeWidgetItem* item, int column);
+
+protected:
+  /** Reads the entries of the top-level scopes from \e first to \e last.
+   * @param tops Receives the entries of the top-level scopes.
+   * @param cursors Receives a cursor at the start of the block each of
+   *        them opens its brace on. */
+  void scan(const QTextBlock& first, const QTextBlock& last, QList<QTreeWidgetItem*>& tops, QList<QTextCursor>& cursors) const;
+
+  /** @returns The index of the first top-level entry whose brace is at or
+   * after \e position. */
+  int findTop(int position) const;
+
+protected:
+  QPointer<TextEditor>  mpEditor;
+  QTimer                mTimer;
+  QList<QTextCursor>    mTops;      ///< Brace of each top-level entry, kept in place by the document
+  int                   mDirtyFrom; ///< Start of the edited range, or -1 if there isn't one
+  int                   mDirtyTo;   ///< End of the edited range
+};
+
+#endif // _OUTLINE_H_
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef _PERFORMANCEHUD_H_
+#define _PERFORMANCEHUD_H_
+#include <QtGui/QLabel>
+#include <QtCore/QTimer>
+#include <QtCore/QPointer>
+#include <QtCore/QVector>
+
+// FORWARD DECLARATIONS
+class TextEditor;
+
+/** A compact live readout of the editor's performance, meant to sit in the
+ * IDE's status bar.  It shows the rolling highlight time per frame, blocks
+ * rehighlighted per edit, keystroke latency, and the size and estimated
+ * memory of the current tab.  The numbers come from the metrics registry and
+ * are only read while the HUD is visible, a few times a second. */
+class PerformanceHud : public QLabel
+{
+  Q_OBJECT
+
+public:
+  PerformanceHud(QWidget* parent = NULL);
+
+  /** Sets the editor whose document is described by the HUD.
+   * @param editor The current editor, or NULL if there isn't one. */
+  void setEditor(TextEditor* editor);
+
+  /** Sets the editors whose memory is added up for the total.
+   * @param editors Every open editor. */
+  void setEditors(const QVector<TextEditor*>& editors);
+
+protected:
+  void showEvent(QShowEvent*);
+  void hideEvent(QHideEvent*);
+
+protected slots:
+  /** Reads the metrics and updates the text. */
+  void refresh(void);
+
+protected:
+  QTimer                          mTimer;
+  QPointer<TextEditor>            mpEditor;
+  QVector<QPointer<TextEditor> >  mEditors;
+};
+
+#endif // _PERFORMANCEHUD_H_
\ No newline at end of file
@@ -0,0 +1,99 @@
+#ifndef _PIECETABLE_H_
+#define _PIECETABLE_H_
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QVector>
+
+// FORWARD DECLARATIONS
+class QIODevice;
+
+/** A text buffer for files too big to load into a QTextDocument.  The
+ * original file is memory mapped and never copied; inserted text is appended
+ * to a separate add buffer, and the document is the sequence of pieces of
+ * the two buffers that the edits have left.  Opening a file costs nothing
+ * more than mapping it, and memory grows only with what is typed.
+ *
+ * Scripts are ASCII, so the buffer is indexed by byte like the rest of the
+ * editor's file handling.  There is no line index: lines are found by
+ * scanning for '\n' from a known position, which is only ever done for the
+ * handful of lines around the view. */
+class PieceTable
+{
+public:
+  PieceTable(void);
+  ~PieceTable(void);
+
+  /** Maps a file as the original buffer, discarding any edits.
+   * @param path The file to open.
+   * @returns TRUE if the file was opened, FALSE otherwise. */
+  bool open(const QString& path);
+
+  /** Uses a copy of \e data as the original buffer, discarding any edits. */
+  void setData(const QByteArray& data);
+
+  /** Unmaps the file and empties the buffer. */
+  void close(void);
+
+  /** Writes the document to \e device.
+   * @returns TRUE if everything was written. */
+  bool write(QIODevice* device) const;
+
+  /// @returns The length of the document in bytes.
+  qint64 size(void) const;
+
+  /// @returns The byte at \e pos, which must be less than size().
+  char at(qint64 pos) const;
+
+  /** @returns Up to \e length bytes of the document from \e pos. */
+  QByteArray read(qint64 pos, qint64 length) const;
+
+  /** Inserts \e text before the byte at \e pos.  Typing at the end of the
+   * previous insert extends its piece instead of adding another. */
+  void insert(qint64 pos, const QByteArray& text);
+
+  /** Removes \e length bytes from \e pos. */
+  void remove(qint64 pos, qint64 length);
+
+  /// @returns The position of the start of the line containing \e pos.
+  qint64 lineStart(qint64 pos) const;
+
+  /// @returns The position of the '\n' ending the line containing \e pos, or size().
+  qint64 lineEnd(qint64 pos) const;
+
+  /// @returns The start of the line after the one containing \e pos, or size().
+  qint64 nextLine(qint64 pos) const;
+
+  /// @returns The start of the line before the one containing \e pos, or 0.
+  qint64 previousLine(qint64 pos) const;
+
+  /** @returns The memory held by the edits, in bytes.  The mapped file
+   * isn't counted; its pages belong to the file cache. */
+  qint64 editMemory(void) const;
+
+  /// @returns The number of pieces the document is made of.
+  int pieceCount(void) const;
+
+private:
+  struct Piece
+  {
+    bool    added;    ///< In the add buffer rather than the original
+    qint64  start;    ///< Offset in its buffer
+    qint64  length;
+  };
+
+  const char* data(const Piece& piece) const;
+  int findPiece(qint64 pos, qint64* offset) const;
+  void updateOffsets(int first);
+
+private:
+  QFile           mFile;
+  const char*     mpOriginal;
+  qint64          mOriginalSize;
+  QByteArray      mCopy;      ///< Holds the original when it isn't mapped
+  QByteArray      mAdded;
+  QVector<Piece>  mPieces;
+  QVector<qint64> mOffsets;   ///< Document position of each piece
+  qint64          mSize;
+};
+
+#endif // _PIECETABLE_H_
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef _PROBLEMLIST_H_
+#define _PROBLEMLIST_H_
+#include <QtGui/QTreeWidget>
+#include <QtCore/QPointer>
+
+// FORWARD DECLARATIONS
+class TextEditor;
+
+/** The diagnostics of the current document as a list, meant to be docked
+ * beside the IDE's tabs.  Clicking a problem moves the cursor to it.  The
+ * list is only filled in while it is showing. */
+class ProblemList : public QTreeWidget
+{
+  Q_OBJECT
+
+public:
+  ProblemList(QWidget* parent = NULL);
+
+public slots:
+  /** Sets the editor whose diagnostics are listed.
+   * @param editor The current editor, or NULL if there isn't one. */
+  void setEditor(TextEditor* editor);
+
+protected:
+  void showEvent(QShowEvent*);
+
+protected slots:
+  /** Lists the diagnostics of the document again. */
+  void refresh(void);
+
+  /** Moves the editor's cursor to the problem. */
+  void onItemClicked(QTreeWidgetItem* item, int column);
+
+protected:
+  QPointer<TextEditor>  mpEditor;
+  bool                  mStale;   ///< The diagnostics changed while the list was hidden
+};
+
+#endif // _PROBLEMLIST_H_
\ No newline at end of file
@@ -0,0 +1,277 @@
+#ifndef _RESOURCERESOLVER_H_
+#define _RESOURCERESOLVER_H_
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+#include <QtCore/QTimer>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFileSystemWatcher>
+#include <QtCore/QFutureWatcher>
+#include "DependencyGraph.h"
+
+// FORWARD DECLARATIONS
+namespace script
+{
+  struct Node;
+}
+
+/** What a name in a script refers to. */
+enum ResourceKind
+{
+  RESOURCE_TEXTURE,           ///< A file in one of the resource directories
+  RESOURCE_VERTEX_PROGRAM,    ///< A vertex_program defined in a script
+  RESOURCE_FRAGMENT_PROGRAM,  ///< A fragment_program defined in a script
+  RESOURCE_MATERIAL           ///< A material defined in a script
+};
+
+/** A name a script refers to: a texture, a program or a parent material. */
+struct ResourceReference
+{
+  ResourceKind  kind;
+  QString       name;
+  int           line;
+};
+
+/** A program or material defined by a script. */
+struct ResourceDefinition
+{
+  ResourceKind  kind;
+  QString       name;
+  QString       path;   ///< The script that defines it
+  int           line;
+};
+
+/** The files in the resource directories, and the programs and materials
+ * their scripts define, for resolving the names scripts refer to.
+ *
+ * Each directory is listed once, and every file in it is kept in a hash by
+ * name, so resolving a name is a hash lookup that never touches the disk.
+ * A directory that changes is listed again on its own, and a script that
+ * changes is read again on its own.  Names are matched case-insensitively,
+ * the way they are on Windows.
+ *
+ * The index is a value made of implicitly shared containers, so a copy of
+ * it costs a few reference counts and can be read on another thread while
+ * the original changes. */
+class ResourceIndex
+{
+public:
+  ResourceIndex(void);
+
+  /** Sets the directories to look in, and empties the index.  Nothing is
+   * listed until scan() is called. */
+  void setDirectories(const QStringList& directories);
+
+  /// @returns The directories looked in.
+  const QStringList& directories(void) const;
+
+  /** Lists every directory under the resource directories and reads the
+   * definitions of the scripts in them.  Scripts are read in parallel. */
+  void scan(void);
+
+  /** Lists a directory again and brings the index up to date with the files
+   * and directories added to or removed from it.  Its scripts' modification
+   * times and sizes are compared with those of the last listing, so scripts
+   * written in place are noticed too.  Directories that aren't in the index
+   * are ignored.  The scripts aren't read here, since the caller may want to
+   * read them on another thread.
+   * @returns The scripts that were added or changed, to be read and given
+   *     to setDefinitions().  Until then they keep the definitions they had. */
+  QStringList updateDirectory(const QString& directory);
+
+  /** Drops the definitions of a script if it's gone.
+   * @returns TRUE if the script is in the index, to be read again. */
+  bool updateScript(const QString& path);
+
+  /** Sets the definitions read from a script, in place of those it had.  A
+   * script that left the index while it was read is ignored. */
+  void setDefinitions(const QString& path, const QVector<ResourceDefinition>& definitions);
+
+  /// @returns TRUE if no directory has been listed, so nothing can resolve.
+  bool isEmpty(void) const;
+
+  /// @returns Every directory listed, resource directories included.
+  QStringList listedDirectories(void) const;
+
+  /// @returns Every script whose definitions are indexed.
+  QStringList scripts(void) const;
+
+  /// @returns The number of files in the index.
+  int fileCount(void) const;
+
+  /** @param name The name of a file, optionally with a path relative to one
+   *        of the resource directories.
+   * @returns The path of the file, or an empty string if it isn't in any of
+   *     the resource directories. */
+  QString findFile(const QString& name) const;
+
+  /** @returns The definition of a program or material, or NULL if no script
+   *     in the resource directories defines it. */
+  const ResourceDefinition* findDefinition(ResourceKind kind, const QString& name) const;
+
+  /** @returns TRUE if \e reference names a file or definition in the index. */
+  bool resolve(const ResourceReference& reference) const;
+
+  /** @param keyword The keyword of a statement.
+   * @param kind Receives what the statement refers to.
+   * @returns TRUE if the statement refers to a resource: a texture, a
+   *     program, or a material.  A material statement at the top level
+   *     refers to its parent after the ':', and anywhere else, as in an
+   *     overlay element, to the material it names. */
+  static bool referenceKind(const QString& keyword, ResourceKind& kind);
+
+  /** Finds the names a parsed script refers to.
+   * @param root The root of the script's AST. */
+  static void findReferences(const script::Node* root, QVector<ResourceReference>& out);
+
+  /** Finds the programs and materials a parsed script defines.
+   * @param root The root of the script's AST.
+   * @param path The path recorded with each definition. */
+  static void findDefinitions(const script::Node* root, const QString& path, QVector<ResourceDefinition>& out);
+
+  /// @returns A short description of a reference that doesn't resolve.
+  static QString describeUnresolved(const ResourceReference& reference);
+
+private:
+  struct Listing
+  {
+    QStringList             files;
+    QStringList             directories;
+    QHash<QString, qint64>  stamps;       ///< Modification time and size of each script
+  };
+
+  void listTree(const QString& directory, QStringList& scripts);
+  void removeTree(const QString& directory);
+  void addFile(const QString& path);
+  void removeFile(const QString& path);
+  bool isListed(const QString& path) const;
+  void addDefinitions(const QString& path, const QVector<ResourceDefinition>& definitions);
+  void removeDefinitions(const QString& path);
+  void readScripts(const QStringList& paths);
+
+private:
+  QStringList                                   mDirectories;
+  QHash<QString, Listing>                       mListings;    ///< Of each directory listed
+  QHash<QString, QStringList>                   mFiles;       ///< Paths of the files by lower case name
+  QHash<QString, ResourceDefinition>            mDefinitions; ///< By lower case name, more than one per name
+  QHash<QString, QVector<ResourceDefinition> >  mScripts;     ///< Definitions of each script read
+};
+
+/** Keeps a ResourceIndex of the directories in config.xml's ResourcePaths
+ * up to date for the editor.  The directories are scanned on another thread
+ * the first time the index is needed, and after that the directories are
+ * watched, and they and the scripts in them are brought up to date shortly
+ * after they change.  They are scanned again when config.xml names other ones.
+ *
+ * The resolver keeps the DependencyGraph of the same directories with it.
+ * The graph is saved next to config.xml, so the scan only reads the scripts
+ * that changed since the editor last ran. */
+class ResourceResolver : public QObject
+{
+  Q_OBJECT
+
+public:
+  /// @returns The resolver, which starts scanning the first time it's needed.
+  static ResourceResolver* instance(void);
+
+  /** @returns The index as it is now.  It is empty until the first scan
+   * finishes, and while no resource directories are configured. */
+  const ResourceIndex& index(void) const;
+
+  /** @returns The dependency graph as it is now.  Like the index, it is
+   * empty until the first scan finishes. */
+  const DependencyGraph& dependencies(void) const;
+
+  /** Brings the index and graph up to date with a script the editor just
+   * saved, without waiting for the watcher.  The script is read off the GUI
+   * thread, so the graph only has it once dependenciesChanged() names it.
+   * @returns FALSE if the script isn't in the resource directories, and so
+   * won't be named. */
+  bool fileSaved(const QString& path);
+
+  /** Saves the dependency graph if it changed since it was last saved. */
+  void saveDependencies(void);
+
+signals:
+  /** Emitted whenever the index changes. */
+  void changed(void);
+
+  /** Emitted once the graph has taken in the scripts that changed, or
+   * dropped the ones that are gone. */
+  void dependenciesChanged(const QStringList& scripts);
+
+protected slots:
+  void onScanFinished(void);
+  void onDirectoryChanged(const QString& path);
+  void onReadFinished(void);
+
+  /** Scans the resource directories again if config.xml now names other
+   * ones. */
+  void onConfigChanged(void);
+
+  /** Brings the index up to date with the directories and scripts that
+   * changed.  The directories are listed here, and the scripts that changed
+   * read on the thread pool, with onReadFinished() taking them in. */
+  void update(void);
+
+private:
+  struct Scan
+  {
+    ResourceIndex     index;
+    DependencyGraph   graph;
+  };
+
+  /** A script read for update(): what it defines, and what it adds to the
+   * graph if the graph reads it. */
+  struct Read
+  {
+    QVector<ResourceDefinition>   definitions;
+    DependencyGraph::FileEntry    entry;
+    bool                          hasEntry;
+  };
+
+  ResourceResolver(void);
+
+  /** Starts scanning the resource directories, or empties the index if
+   * there are none. */
+  void scan(void);
+
+  /** Builds an index of \e directories, and brings the graph saved at
+   * \e graphPath up to date with them.  This is what the first scan runs. */
+  static Scan scanDirectories(const QStringList& directories, const QString& graphPath);
+
+  /** Parses a script once for both the index and the graph.  This is what
+   * update() runs on the thread pool. */
+  static Read readScript(const QString& path);
+
+  /** Brings the graph up to date with the scripts that were read, and drops
+   * the ones that went since \e before.
+   * @returns The scripts that changed in the graph. */
+  QStringList updateDependencies(const QSet<QString>& before, const QStringList& scripts, const QList<Read>& reads);
+
+  /** Watches exactly the directories in the index.  Scripts aren't watched
+   * on their own: a change to one shows up in its directory's listing. */
+  void syncWatches(void);
+
+private:
+  static ResourceResolver*        mpMe;
+  ResourceIndex                   mIndex;
+  DependencyGraph                 mGraph;
+  QString                         mGraphPath;
+  QStringList                     mDirectories; ///< The resource directories of the latest scan
+  QFutureWatcher<Scan>            mScan;
+  QFileSystemWatcher              mWatcher;
+  QTimer                          mTimer;
+  QElapsedTimer                   mSinceScan;
+  QSet<QString>                   mChangedDirectories;
+  QSet<QString>                   mChangedScripts;
+  QFutureWatcher<Read>            mRead;
+  QStringList                     mReadScripts; ///< The scripts being read
+  QSet<QString>                   mReadBefore;  ///< The scripts indexed before the update
+  bool                            mPending;     ///< The directories changed during the scan
+};
+
+#endif // _RESOURCERESOLVER_H_
\ No newline at end of file
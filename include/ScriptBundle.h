@@ -0,0 +1,95 @@
+#ifndef _SCRIPTBUNDLE_H_
+#define _SCRIPTBUNDLE_H_
+#include <QtCore/QString>
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QVector>
+
+// FORWARD DECLARATIONS
+namespace script
+{
+  struct Node;
+}
+
+/** A script to be packed into a bundle. */
+struct BundleEntry
+{
+  QString     name;   ///< Relative path, with '/' separators
+  QByteArray  data;
+};
+
+/** Many scripts packed into one file, so loading them costs one open rather
+ * than one per script.
+ *
+ * A bundle starts with a header and an index of its entries, sorted by
+ * name, each with the offset, length and Adler-32 checksum of its data.
+ * The names follow the index, and the data follows the names.  Opening a
+ * bundle maps it into memory and checks that the index is sound, without
+ * reading any data; finding an entry is a binary search of the index, and
+ * its data is read straight out of the mapping, which script::ScriptFile
+ * can parse in place.  Numbers are stored little endian. */
+class ScriptBundle
+{
+public:
+  ScriptBundle(void);
+  ~ScriptBundle(void);
+
+  /** Maps a bundle into memory.  Any bundle already open is closed first.
+   * @returns FALSE if the file can't be read or isn't a sound bundle. */
+  bool open(const QString& path);
+
+  /** Unmaps the bundle.  Pointers to its data are no longer valid. */
+  void close(void);
+
+  /// @returns TRUE if a bundle is open.
+  bool isOpen(void) const;
+
+  /// @returns The number of entries.
+  int count(void) const;
+
+  /// @returns The name of entry \e index.
+  QString name(int index) const;
+
+  /** @returns The index of the entry called \e name, or -1 if there isn't
+   * one.  Names are matched exactly. */
+  int find(const QString& name) const;
+
+  /** @returns The data of entry \e index, in the mapping.  It is valid
+   * until the bundle is closed. */
+  const char* data(int index) const;
+
+  /// @returns The size of the data of entry \e index, in bytes.
+  int size(int index) const;
+
+  /** @returns TRUE if the data of entry \e index matches its checksum. */
+  bool verify(int index) const;
+
+  /** Packs entries into a bundle.
+   * @param entries The entries, in any order.  Names must be unique.
+   * @returns FALSE if the bundle couldn't be written. */
+  static bool write(const QString& path, const QVector<BundleEntry>& entries);
+
+  /** Writes a parsed script back out with nothing but what its statements
+   * need: no comments, no indentation and one space between words.  A
+   * script minified twice comes out the same, so this is also its
+   * canonical form. */
+  static QByteArray minify(const script::Node* root);
+
+  /// @returns The Adler-32 checksum of \e size bytes at \e data.
+  static quint32 checksum(const char* data, int size);
+
+private:
+  ScriptBundle(const ScriptBundle&);
+  ScriptBundle& operator=(const ScriptBundle&);
+
+  const uchar* entry(int index) const;
+
+private:
+  QFile         mFile;
+  const uchar*  mpMapping;
+  qint64        mSize;
+  int           mCount;
+  const uchar*  mpNames;    ///< Start of the names, after the index
+};
+
+#endif // _SCRIPTBUNDLE_H_
\ No newline at end of file
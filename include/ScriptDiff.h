@@ -0,0 +1,62 @@
+#ifndef _SCRIPTDIFF_H_
+#define _SCRIPTDIFF_H_
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+// FORWARD DECLARATIONS
+namespace script
+{
+  struct Node;
+}
+
+/** What happened to a statement between two versions of a script. */
+enum ScriptChangeKind
+{
+  SCRIPT_ADDED,
+  SCRIPT_REMOVED,
+  SCRIPT_CHANGED,   ///< An attribute's arguments, or an object's parent
+  SCRIPT_RENAMED    ///< An object whose name changed but whose block didn't
+};
+
+/** A difference between two versions of a script. */
+struct ScriptChange
+{
+  ScriptChangeKind  kind;
+  QString           location; ///< The objects the statement is in, as "material A > technique #1"
+  QString           before;   ///< The statement in the old version, or empty if it was added
+  QString           after;    ///< The statement in the new version, or empty if it was removed
+  int               oldLine;  ///< 0 if it was added
+  int               newLine;  ///< 0 if it was removed
+
+  /// @returns The change on one line, as the command line prints it.
+  QString toString(void) const;
+};
+
+/** A diff of two parsed versions of a script by their structure rather than
+ * their text, so reindenting, moving comments, and reordering materials
+ * or attributes aren't differences.
+ *
+ * Statements are matched up within each block by what they are: objects
+ * by keyword and name, or if they have no name, by keyword and position
+ * among the objects with that keyword, and attributes by keyword (and
+ * first argument, for ones that may be repeated, like param_named).
+ * Every subtree is hashed first, Merkle-style, from its statement and the
+ * hashes of what it matches up with, so two statements with the same
+ * hash are the same all the way down and are passed over without being
+ * looked into.  Only the subtrees that differ are walked, so the cost is
+ * one pass over both scripts to hash them and the size of the differences
+ * after that.  Objects that are left over on both sides with the same
+ * block are reported as renamed. */
+class ScriptDiff
+{
+public:
+  /** Compares two versions of a script.
+   * @param before The root of the old version's AST.
+   * @param after The root of the new version's AST.
+   * @param out Receives the differences, in the order of the new version,
+   *        with what was removed from each block after what is still in
+   *        it. */
+  static void diff(const script::Node* before, const script::Node* after, QVector<ScriptChange>& out);
+};
+
+#endif // _SCRIPTDIFF_H_
\ No newline at end of file
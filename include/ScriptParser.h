@@ -0,0 +1,270 @@
+#ifndef _SCRIPTPARSER_H_
+#define _SCRIPTPARSER_H_
+#include <QtCore/QString>
+#include <QtCore/QFile>
+#include <QtCore/QVector>
+#include "ConfigFile.h"
+
+namespace script
+{
+  /** A non-owning view of a range of bytes inside a script buffer.  Tokens,
+   * identifiers and arguments produced by the parser are all StringRefs that
+   * point directly into the (usually memory-mapped) file, so no string data is
+   * ever copied while parsing.  A StringRef is only valid for as long as the
+   * buffer it points into. */
+  struct StringRef
+  {
+    const char* data;
+    int         length;
+
+    StringRef() : data(NULL), length(0) {}
+    StringRef(const char* d, int l) : data(d), length(l) {}
+
+    bool isEmpty(void) const { return length == 0; }
+    bool operator==(const StringRef& other) const;
+    bool operator!=(const StringRef& other) const { return !(*this == other); }
+    bool operator==(const char* str) const;
+    bool operator!=(const char* str) const { return !(*this == str); }
+
+    /// @returns A deep copy of the referenced bytes, decoded as UTF-8.
+    QString toString(void) const;
+  };
+
+  /// @returns A hash of the bytes referenced by \e ref, for use with QHash.
+  uint qHash(const StringRef& ref);
+
+  /** A bump allocator that hands out memory from large blocks.  Every AST node
+   * for a file comes from that file's Arena, and all of them are released at
+   * once when the Arena is cleared or destroyed.  Objects created in the Arena
+   * never have their destructors run, so only POD types should live here. */
+  class Arena
+  {
+  public:
+    /** @param blockSize The size of each block requested from the heap.
+     *        Allocations bigger than this get a block of their own. */
+    Arena(int blockSize = 64 * 1024);
+    ~Arena(void);
+
+    /** @param size The number of bytes needed.
+     * @returns A pointer to \e size bytes, aligned to 8 bytes, or NULL if
+     *          the heap couldn't provide them. */
+    void* allocate(int size);
+
+    /** @returns A pointer to an uninitialized array of \e count T's. */
+    template <typename T>
+    T* allocateArray(int count) { return static_cast<T*>(allocate(sizeof(T) * count)); }
+
+    /** Frees every block in one shot.  All pointers previously handed out by
+     * this Arena become invalid. */
+    void clear(void);
+
+    /// @returns The number of bytes handed out since the last clear().
+    int bytesUsed(void) const;
+
+    /// @returns The number of blocks requested from the heap since the last clear().
+    int blockCount(void) const;
+
+  private:
+    struct Block
+    {
+      Block* next;
+      int    size;
+      int    used;
+    };
+
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+
+  private:
+    Block*  mpBlocks;
+    int     mBlockSize;
+    int     mBytesUsed;
+    int     mBlockCount;
+  };
+
+  /** Maps keywords to their FormatWord using an open addressing hash table, so
+   * that a StringRef can be classified without building a QString from it.
+   * Lookups never allocate. */
+  class KeywordTable
+  {
+  public:
+    KeywordTable(void);
+
+    /// Builds the table from the words of a format.  See build().
+    explicit KeywordTable(const config::FormatWordMap& words);
+
+    /** Replaces the contents of this table with \e words.
+     * @param words The vocabulary of a format, as returned by
+     *        ConfigFile::getWordsByFormat(). */
+    void build(const config::FormatWordMap& words);
+
+    /** @param word The word to look up.
+     * @returns The FormatWord for \e word, or NULL if it isn't a keyword. */
+    const config::FormatWord* find(const StringRef& word) const;
+
+    /// @returns The number of keywords in this table.
+    int count(void) const;
+
+  private:
+    struct Slot
+    {
+      uint                hash;
+      StringRef           key;
+      config::FormatWord  word;
+    };
+
+    QByteArray      mKeys;
+    QVector<Slot>   mSlots;
+    uint            mMask;
+    int             mCount;
+  };
+
+  /// Types of tokens produced by the Lexer
+  enum TokenType
+  {
+    TOKEN_WORD,
+    TOKEN_STRING,
+    TOKEN_OPEN_BRACE,
+    TOKEN_CLOSE_BRACE,
+    TOKEN_COLON,
+    TOKEN_NEWLINE,
+    TOKEN_END
+  };
+
+  /** A single token.  The text of a TOKEN_STRING excludes its quotes. */
+  struct Token
+  {
+    TokenType type;
+    StringRef text;
+    int       line;
+  };
+
+  /** Splits a UTF-8 script buffer into tokens.  Comments (both // and block
+   * comments) are skipped, but only start where a token could, so a path
+   * such as "textures//stone.png" remains a single word.  A ':' is only a
+   * TOKEN_COLON when it stands on its own, so that names such as
+   * "Core/NodeMaterial" or "a:b" remain a single word too. */
+  class Lexer
+  {
+  public:
+    /** @param data The start of the buffer.  It is not copied.
+     * @param length The length of the buffer in bytes. */
+    Lexer(const char* data, int length);
+
+    /// @returns The next token in the buffer, or TOKEN_END once it is exhausted.
+    Token next(void);
+
+  private:
+    const char* mpCur;
+    const char* mpEnd;
+    int         mLine;
+  };
+
+  /// Types of nodes in the AST
+  enum NodeType
+  {
+    NODE_ROOT,
+    NODE_OBJECT,    ///< A keyword followed by a { } block, such as "pass"
+    NODE_PROPERTY   ///< A single line attribute, such as "lighting off"
+  };
+
+  /** A node in the AST of a script.  Nodes are allocated from the Arena of the
+   * ScriptFile that owns them and are only valid as long as that ScriptFile
+   * is open.  For "material Child : Parent" the keyword is "material", the
+   * only argument is "Child" and inherits is "Parent". */
+  struct Node
+  {
+    NodeType                  type;
+    StringRef                 keyword;
+    const config::FormatWord* word;       ///< The recognized keyword, or NULL
+    StringRef*                args;
+    int                       numArgs;
+    StringRef                 inherits;
+    int                       line;
+    Node*                     parent;
+    Node*                     firstChild;
+    Node*                     lastChild;
+    Node*                     next;
+
+    /// @returns The first argument (the object name), or an empty StringRef.
+    StringRef name(void) const { return numArgs > 0 ? args[0] : StringRef(); }
+  };
+
+  /** An error found while parsing a script. */
+  struct ParseError
+  {
+    int         line;
+    const char* message;
+  };
+
+  /** A parsed script file.  The file is memory-mapped and parsed in place:
+   * every StringRef in the AST points into the mapping, and every Node comes
+   * from a per-file Arena that is freed in one shot by close().  This is meant
+   * for batch tools that need to look at a lot of files quickly, and does not
+   * go through QString or QTextDocument at all. */
+  class ScriptFile
+  {
+  public:
+    /** @param keywords The keywords used to fill in Node::word.  May be NULL,
+     *        in which case no keywords are recognized.  The table must outlive
+     *        this ScriptFile. */
+    ScriptFile(const KeywordTable* keywords = NULL);
+    ~ScriptFile(void);
+
+    /** Maps a file into memory and parses it.  Any previously opened file is
+     * closed first.
+     * @param path The path of the file to parse.
+     * @returns TRUE if the file could be opened, FALSE otherwise.  Files
+     *          bigger than 2 GB are refused with an error.  A file that
+     *          opens but has syntax errors still returns TRUE; see errors(). */
+    bool open(const QString& path);
+
+    /** Parses a buffer that is already in memory.  The buffer is not copied,
+     * so it must stay alive for as long as this ScriptFile is open.
+     * @param data The UTF-8 text to parse.
+     * @param length The length of \e data in bytes. */
+    void parse(const char* data, int length);
+
+    /** Releases the AST and unmaps the file. */
+    void close(void);
+
+    /// @returns The root of the AST.  Its children are the top-level objects.
+    const Node* root(void) const;
+
+    /// @returns Any errors found while parsing.
+    const QVector<ParseError>& errors(void) const;
+
+    /// @returns The number of nodes in the AST, not counting the root.
+    int nodeCount(void) const;
+
+    /// @returns The buffer being parsed.
+    const char* data(void) const;
+
+    /// @returns The size of the buffer being parsed, in bytes.
+    int size(void) const;
+
+    /// @returns The Arena holding the AST.
+    const Arena& arena(void) const;
+
+  private:
+    ScriptFile(const ScriptFile&);
+    ScriptFile& operator=(const ScriptFile&);
+
+    /// Records an error that isn't tied to a line of the script.
+    void error(const char* message);
+
+  private:
+    const KeywordTable*   mpKeywords;
+    QFile                 mFile;
+    uchar*                mpMapping;
+    const char*           mpData;
+    int                   mSize;
+    Arena                 mArena;
+    Node*                 mpRoot;
+    Node                  mEmptyRoot;   ///< The root left when the Arena runs out of memory
+    int                   mNodeCount;
+    QVector<ParseError>   mErrors;
+  };
+}
+
+#endif // _SCRIPTPARSER_H_
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef _SESSION_H_
+#define _SESSION_H_
+#include <QtCore/QString>
+#include <QtCore/QVector>
+#include "Highlighter.h"
+
+/** A tab of a saved Session. */
+struct SessionTab
+{
+  SessionTab(void);
+
+  QString         path;
+  QString         format;
+  bool            large;            ///< Open in a LargeFileEditor
+  qint64          cursorPosition;
+  int             horizontalScroll;
+  int             verticalScroll;
+  HighlightCache  highlight;        ///< Empty unless the file was unmodified
+};
+
+/** The files open in the IDE, saved on exit and from time to time so that
+ * the next start can put the tabs back as they were.  Tabs are restored
+ * without loading their files; each is loaded when it is first shown, and
+ * if its text still matches the saved highlighting, it is shown highlighted
+ * without running the rules.
+ *
+ * Sessions are written with QDataStream, as a magic number and version
+ * followed by the current tab and each tab in order.  A session that can't
+ * be read is ignored rather than half restored. */
+class Session
+{
+public:
+  Session(void);
+
+  /** Removes all tabs. */
+  void clear(void);
+
+  /** @returns The session in its saved form. */
+  QByteArray toByteArray(void) const;
+
+  /** Reads a session in its saved form.
+   * @returns TRUE if it was read, FALSE otherwise.  The session is left
+   *          empty if it wasn't. */
+  bool fromByteArray(const QByteArray& data);
+
+  /** @param path The file to load the session from.
+   * @returns TRUE if the session was loaded, FALSE otherwise. */
+  bool load(const QString& path);
+
+  /** Saves the session, replacing the file only once it has been written
+   * in full.
+   * @param path The file to save the session to.
+   * @returns TRUE if the session was saved, FALSE otherwise. */
+  bool save(const QString& path) const;
+
+  /// The index of the tab that was showing, or -1
+  int                 currentTab;
+
+  /// The tabs, in order
+  QVector<SessionTab> tabs;
+};
+
+#endif // _SESSION_H_
\ No newline at end of file
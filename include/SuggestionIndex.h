@@ -0,0 +1,73 @@
+#ifndef _SUGGESTIONINDEX_H_
+#define _SUGGESTIONINDEX_H_
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+namespace config
+{
+  /** A BK-tree over the words of a format, used to suggest the keyword a
+   * misspelt word was meant to be ("dpeth_write" finds "depth_write").
+   *
+   * Each node holds a word, and its children are grouped by their edit
+   * distance to it.  Edit distance obeys the triangle inequality, so a
+   * search for words within distance r of the query only has to follow the
+   * edges whose distance is within r of the node's own, which leaves most
+   * of the vocabulary unvisited.  Like KeywordTrie, the tree is stored in two
+   * flat arrays, with each node's edges contiguous and sorted by distance.
+   *
+   * Words are stored in lower case and matched case-insensitively, and are
+   * returned as indices into words(). */
+  class SuggestionIndex
+  {
+  public:
+    SuggestionIndex(void);
+
+    /** Replaces the contents of the index.
+     * @param words The words to store.  Duplicates are ignored. */
+    void build(const QStringList& words);
+
+    /** Finds the words nearest to \e word, nearest first, with words at the
+     * same distance in alphabetical order.
+     * @param word The word to find suggestions for.
+     * @param out Receives the indices of the words.
+     * @param limit The most words to return.
+     * @param maxDistance The furthest a word may be, or -1 for a distance
+     *        that suits the length of \e word. */
+    void suggest(const QString& word, QVector<int>& out, int limit, int maxDistance = -1) const;
+
+    /// @returns The words in the index, in alphabetical order.
+    const QStringList& words(void) const;
+
+    /// @returns The number of nodes in the index.
+    int nodeCount(void) const;
+
+    /** @returns The edit distance between \e a and \e b: the fewest
+     * characters that have to be inserted, removed or replaced to turn one
+     * into the other.  Characters are compared as they are. */
+    static int distance(const QString& a, const QString& b);
+
+  private:
+    struct Node
+    {
+      int word;
+      int firstEdge;
+      int numEdges;
+    };
+
+    struct Edge
+    {
+      int distance;
+      int child;
+    };
+
+    int buildNode(const QVector<int>& members);
+
+  private:
+    QStringList     mWords;
+    QVector<Node>   mNodes;
+    QVector<Edge>   mEdges;
+  };
+}
+
+#endif // _SUGGESTIONINDEX_H_
\ No newline at end of file
@@ -1,148 +1,273 @@
-#ifndef _TEXTEDITOR_H_
-#define _TEXTEDITOR_H_
-#include <QtGui/QTextEdit>
-
-// FORWARD DECLARATIONS
-class Highlighter;
-
-class TextEditor : public QTextEdit
-{
-  Q_OBJECT
-
-public:
-  /** Default CTOR */
-  TextEditor(QWidget* parent = NULL);
-
-  /** Default DTOR */
-  ~TextEditor(void);
-
-  /** Sets the number of spaces that get inserted whenever TAB is pressed.
-   * @param spaces The number of spaces to insert. */
-  void setTabSpaces(int spaces);
-
-  /** @returns TRUE if the document has unsaved changes, FALSE otherwise. */
-  bool hasUnsavedChanges() const;
-
-  /** Load the contents of a file into the TextEditor.
-   * @param path The path of the file to load.
-   * @returns TRUE if the file is successfuly loaded, FALSE otherwise. */
-  bool load(const QString& path);
-
-  /** Saves the contents of the TextEditor to file.
-   * @param path The path of the file to save to.
-   * @param TRUE if the file is successfuly saved, FALSE otherwise. */
-  bool save(const QString& path);
-
-  /** @param lineNumber The number of the line to return.
-   * @returns The text on the specified line number, or a null QString if the
-   *          line does not exist in the TextEditor. */
-  QString getLine(int lineNumber) const;
-
-  /** @returns The current line number.  This can be used with getLine() to get
-   * the current line. */
-  int currentLineNumber(void) const;
-
-  /** Replace a line of text with a new string.
-   * @param lineNumber The number of the line to replace.  All text on this 
-   *        line will be replaced by the new string.
-   * @param str The string to replace the line with.
-   * @returns TRUE if the line is replaced, FALSE otherwise.  For example, 
-   *        passing an invalid line number will cause this to return FALSE. */
-  bool replaceLine(int lineNumber, const QString& str);
-
-  /** @param pos The desired cursor position.
-   * @returns The line number that cursor position \e pos lies on. */
-  int lineNumberAtPos(int pos);
-
-  /** Sets the current file format to format.  This can be used to manually 
-   * specify the format for a file you're working on if it either wasn't 
-   * recognized when loaded, or you started editing a new file.
-   * @param format The desired file format. */
-  void setFileFormat(const QString& format);
-
-public slots:
-  /** Increases the indentation of all selected lines.  The size of the 
-   * indentation is determined by the current number of tab spaces. */
-  void increaseIndent(void);
-
-  /** Decreases the indentation of all selected lines.  The size of the
-   * indentation is determined by the current number of tab spaces. */
-  void decreaseIndent(void);
-
-signals:
-  /** Emitted whenever a file is dropped onto the TextEditor.  The TextEditor
-   * class does not handle file drops directly, but rather expects some other
-   * widget to handle it by either telling the TextEditor to load the file,
-   * or creating a new TextEditor to load the file instead.
-   * @param path The full path of the file dropped onto the TextEditor. */
-  void fileDropped(const QString& path);
-
-  /** Emitted whenever the focused keyword changes.  A keyword stays in focus
-   * as long as you are on the same line as it, so the basically is emitted
-   * whenever you move the cursor to a line with a different keyword, or the 
-   * keyword on this line changes.
-   * The word emitted in this signal may be an empty string if the current line
-   * has no keyword.
-   * @param keyword The new keyword in focus.  This could be an empty string if
-   *        the current line has no keyword.
-   * @param format The format that this keyword applies to. */
-  void keywordChanged(const QString& keyword, const QString& format);
-
-  /** Emitted whenever a key is pressed in the editor.  This allows the any 
-   * other widgets to know about key press events received by the editor so
-   * that they may respond to them as well.  For example, IDE listens for
-   * CTRL+Up and CTRL+Down key events to change the displayed syntax for a 
-   * keyword.
-   * @param event The QKeyEvent received in keyPressEvent(). */
-  void keyPressed(QKeyEvent* event);
-
-protected:
-  /** Handle special case key events to produce things such as auto-indentation
-   * and brace matching.  All other key events are passed through to the base
-   * class. */
-  void keyPressEvent(QKeyEvent*);
-
-  /** Gets the number of spaces that the current line should be indented to 
-   * match the indentation of its scope.
-   * @param toPrevBraceOnly If TRUE, this will only return how many spaces the
-   *        opening brace for this scope is indented.  Otherwise, this returns
-   *        the number of spaces that a new line in this scope should be 
-   *        indented.
-   * @returns The number of spaces that the current line should be indented. */
-  int getNumIndent(bool toPrevBraceOnly = false);
-
-  /** Will insert a closing brace } that lines up with the most recent open
-   * brace {.  If there are no open braces, this will insert a closing brace at
-   * the begining of the line.  If there is text between the beginning of the
-   * line and the cursor, the closing brace will be inserted at the current
-   * cursor position. */
-  void matchBraces(void);
-
-  /** Used to determine if the MIME data contains urls to handle file drops.
-   * @param source The MIME data that is being drug onto the widget.
-   * @returns TRUE if the source contains urls or any other supported MIME
-   *          type, FALSE otherwise. */
-  bool canInsertFromMimeData(const QMimeData* source) const;
-
-  /** Used to receive drop event from file drops.  All other MIME sources
-   * are handled by the base class.  When a file is dropped onto the 
-   * TextEditor, this method will emit the fileDropped() signal.
-   * @param source The MIME data that is being dropped onto the widget. */
-  void insertFromMimeData(const QMimeData* source);
-
-protected slots:
-  /** Marks the contents of the TextEditor as having unsaved changes. */
-  void onTextChanged(void);
-  
-  /** Checks the for a new focused keyword */
-  void onCursorPositionChanged(void);
-
-protected:
-  bool          mUnsavedChanges;
-  QString       mFormat;
-  QString       mTabSpaces;
-  QString       mFocusedKeyword;
-  Highlighter*  mpHighlighter;
-};
-
+#ifndef _TEXTEDITOR_H_
+#define _TEXTEDITOR_H_
+#include <QtGui/QTextEdit>
+#include <QtGui/QTextBlock>
+#include "Atom.h"
+
+// FORWARD DECLARATIONS
+class Highlighter;
+class Autocompleter;
+class Diagnostics;
+struct HighlightCache;
+class QTimer;
+
+class TextEditor : public QTextEdit
+{
+  Q_OBJECT
+
+public:
+  /// Largest file laid out by a TextEditor, in bytes
+  static const int MAX_FILE_SIZE = 16 * 1024 * 1024;
+
+  /// Longest line laid out by a TextEditor, in characters
+  static const int MAX_LINE_LENGTH = 10000;
+
+  /** Default CTOR */
+  TextEditor(QWidget* parent = NULL);
+
+  /** Checks that a file can be edited in a TextEditor without layout and
+   * highlighting grinding to a halt.  QTextDocument lays out every line in
+   * full, so a file that is too big, or has a single line that is too long,
+   * needs a LargeFileEditor instead.  This is meant to be called before the
+   * file is loaded.  Only files within MAX_FILE_SIZE are scanned, and only
+   * for line breaks up to the first line that is too long.
+   * @param path The file to check.
+   * @param longLines Receives TRUE if the file has a line longer than
+   *        MAX_LINE_LENGTH, FALSE otherwise.
+   * @returns TRUE if the file can be loaded into a TextEditor. */
+  static bool canLayOut(const QString& path, bool* longLines = NULL);
+
+  /** Checks text in the same way as canLayOut(const QString&, bool*). */
+  static bool canLayOut(const QByteArray& text, bool* longLines = NULL);
+
+  /** Default DTOR */
+  ~TextEditor(void);
+
+  /** Sets the number of spaces that get inserted whenever TAB is pressed.
+   * @param spaces The number of spaces to insert. */
+  void setTabSpaces(int spaces);
+
+  /** @returns TRUE if the document has unsaved changes, FALSE otherwise. */
+  bool hasUnsavedChanges() const;
+
+  /** @returns An estimate of the memory used by this editor's document and
+   * highlighter, in bytes. */
+  qint64 estimatedMemory(void) const;
+
+  /** @returns The syntax highlighter for this editor's document. */
+  Highlighter* highlighter(void) const;
+
+  /** @returns The live diagnostics of the document. */
+  Diagnostics* diagnostics(void) const;
+
+  /** @returns The format of the document, such as "materials". */
+  const QString& fileFormat(void) const;
+
+  /** Load the contents of a file into the TextEditor.
+   * @param path The path of the file to load.
+   * @param cache Highlighting saved with a session.  If it matches the file,
+   *        the document is highlighted from it instead of by the rules.
+   * @returns TRUE if the file is successfuly loaded, FALSE otherwise. */
+  bool load(const QString& path, const HighlightCache* cache = NULL);
+
+  /** @returns HighlightCache::hash() of the file's text as it was last
+   * loaded, reloaded or saved. */
+  quint64 fileHash(void) const;
+
+  /** @returns The highlighting of the document, to be saved with a session.
+   * It is only of use while the document matches its file. */
+  HighlightCache highlightCache(void) const;
+
+  /** Brings the document up to date with a file that was changed by another
+   * program.  Only the lines that differ are replaced, as a single edit that
+   * can be undone, so the cursor, the scroll position, the undo history and
+   * the highlighting of the rest of the document are kept.
+   * @param path The path of the file to reload.
+   * @returns The number of lines replaced, inserted or removed, or -1 if the
+   *          file couldn't be read. */
+  int reload(const QString& path);
+
+  /** Saves the contents of the TextEditor to file.
+   * @param path The path of the file to save to.
+   * @param TRUE if the file is successfuly saved, FALSE otherwise. */
+  bool save(const QString& path);
+
+  /** @param lineNumber The number of the line to return.
+   * @returns The text on the specified line number, or a null QString if the
+   *          line does not exist in the TextEditor. */
+  QString getLine(int lineNumber) const;
+
+  /** @returns The current line number.  This can be used with getLine() to get
+   * the current line. */
+  int currentLineNumber(void) const;
+
+  /** Replace a line of text with a new string.
+   * @param lineNumber The number of the line to replace.  All text on this 
+   *        line will be replaced by the new string.
+   * @param str The string to replace the line with.
+   * @returns TRUE if the line is replaced, FALSE otherwise.  For example, 
+   *        passing an invalid line number will cause this to return FALSE. */
+  bool replaceLine(int lineNumber, const QString& str);
+
+  /** @param pos The desired cursor position.
+   * @returns The line number that cursor position \e pos lies on. */
+  int lineNumberAtPos(int pos);
+
+  /** Sets the current file format to format.  This can be used to manually 
+   * specify the format for a file you're working on if it either wasn't 
+   * recognized when loaded, or you started editing a new file.
+   * @param format The desired file format. */
+  void setFileFormat(const QString& format);
+
+  /** Takes up the rules of the current format again once ConfigFile
+   * reloaded them.  The blocks in view are restyled as soon as they are
+   * painted, and the rest in short slices from there on, while the editor
+   * is shown, so a large document doesn't hold up the event loop. */
+  void reloadRules(void);
+
+  /** @returns TRUE if \e block starts a scope that can be folded.  That is a
+   * line followed by a line starting with the brace it opens, as scripts are
+   * usually written, or a line that opens a brace itself.  Scopes are found
+   * from the brace depth the highlighter keeps for each block, so this only
+   * looks at \e block and its neighbours. */
+  bool isFoldHeader(const QTextBlock& block) const;
+
+  /** @returns The last block of the scope started by \e header, which is the
+   * line closing it, or the last block of the document if it isn't closed.
+   * The block is invalid if \e header isn't a fold header. */
+  QTextBlock foldEnd(const QTextBlock& header) const;
+
+  /** @returns TRUE if the scope started by \e header is folded. */
+  bool isFolded(const QTextBlock& header) const;
+
+  /** Folds or unfolds the scope started by \e header.  The blocks of a
+   * folded scope are hidden, so layout skips them, and highlighting only
+   * keeps track of their scopes until they are shown again.  Scopes folded
+   * inside it stay folded when it is unfolded. */
+  void setFolded(const QTextBlock& header, bool folded);
+
+public slots:
+  /** Folds every scope in the document. */
+  void foldAll(void);
+
+  /** Unfolds every scope in the document. */
+  void unfoldAll(void);
+
+  /** Increases the indentation of all selected lines.  The size of the 
+   * indentation is determined by the current number of tab spaces. */
+  void increaseIndent(void);
+
+  /** Decreases the indentation of all selected lines.  The size of the
+   * indentation is determined by the current number of tab spaces. */
+  void decreaseIndent(void);
+
+signals:
+  /** Emitted whenever a file is dropped onto the TextEditor.  The TextEditor
+   * class does not handle file drops directly, but rather expects some other
+   * widget to handle it by either telling the TextEditor to load the file,
+   * or creating a new TextEditor to load the file instead.
+   * @param path The full path of the file dropped onto the TextEditor. */
+  void fileDropped(const QString& path);
+
+  /** Emitted whenever the focused keyword changes.  A keyword stays in focus
+   * as long as you are on the same line as it, so the basically is emitted
+   * whenever you move the cursor to a line with a different keyword, or the 
+   * keyword on this line changes.
+   * The word emitted in this signal may be the null atom if the current line
+   * has no keyword.
+   * @param keyword The new keyword in focus.  This could be the null atom if
+   *        the current line has no keyword.
+   * @param format The format that this keyword applies to. */
+  void keywordChanged(Atom keyword, const QString& format);
+
+  /** Emitted whenever a key is pressed in the editor.  This allows the any 
+   * other widgets to know about key press events received by the editor so
+   * that they may respond to them as well.  For example, IDE listens for
+   * CTRL+Up and CTRL+Down key events to change the displayed syntax for a 
+   * keyword.
+   * @param event The QKeyEvent received in keyPressEvent(). */
+  void keyPressed(QKeyEvent* event);
+
+protected:
+  /** Handle special case key events to produce things such as auto-indentation,
+   * brace matching and autocompletion (CTRL+Space shows the completions even
+   * before anything is typed).  All other key events are passed through to
+   * the base class. */
+  void keyPressEvent(QKeyEvent*);
+
+  /** Paints the visible part of the document.  This is only overridden so
+   * that the time spent on layout and painting shows up in traces. */
+  void paintEvent(QPaintEvent*);
+
+  /** Keeps the fold gutter alongside the text. */
+  void resizeEvent(QResizeEvent*);
+
+  /** Carries on restyling the document, if the rules were reloaded while
+   * the editor was hidden. */
+  void showEvent(QShowEvent*);
+
+  /** Shows the blocks from \e first to \e last as the folds say they should
+   * be, and lays them out again. */
+  void applyFolds(const QTextBlock& first, const QTextBlock& last);
+
+  /** Unfolds the scopes that hide \e block, and \e block itself if it is
+   * folded, so that the text at the cursor or an edit is always shown. */
+  void revealBlock(const QTextBlock& block);
+
+  /** Gets the number of spaces that the current line should be indented to 
+   * match the indentation of its scope.
+   * @param toPrevBraceOnly If TRUE, this will only return how many spaces the
+   *        opening brace for this scope is indented.  Otherwise, this returns
+   *        the number of spaces that a new line in this scope should be 
+   *        indented.
+   * @returns The number of spaces that the current line should be indented. */
+  int getNumIndent(bool toPrevBraceOnly = false);
+
+  /** Will insert a closing brace } that lines up with the most recent open
+   * brace {.  If there are no open braces, this will insert a closing brace at
+   * the begining of the line.  If there is text between the beginning of the
+   * line and the cursor, the closing brace will be inserted at the current
+   * cursor position. */
+  void matchBraces(void);
+
+  /** Used to determine if the MIME data contains urls to handle file drops.
+   * @param source The MIME data that is being drug onto the widget.
+   * @returns TRUE if the source contains urls or any other supported MIME
+   *          type, FALSE otherwise. */
+  bool canInsertFromMimeData(const QMimeData* source) const;
+
+  /** Used to receive drop event from file drops.  All other MIME sources
+   * are handled by the base class.  When a file is dropped onto the 
+   * TextEditor, this method will emit the fileDropped() signal.
+   * @param source The MIME data that is being dropped onto the widget. */
+  void insertFromMimeData(const QMimeData* source);
+
+protected slots:
+  /** Marks the contents of the TextEditor as having unsaved changes. */
+  void onTextChanged(void);
+  
+  /** Checks the for a new focused keyword */
+  void onCursorPositionChanged(void);
+
+  /** Unfolds any folds an edit touches. */
+  void onContentsChange(int position, int removed, int added);
+
+  /** Highlights the next slice of the blocks left stale by reloadRules(). */
+  void restyle(void);
+
+protected:
+  bool          mUnsavedChanges;
+  quint64       mFileHash;
+  QString       mFormat;
+  QString       mTabSpaces;
+  Atom          mFocusedKeyword;
+  Highlighter*  mpHighlighter;
+  Autocompleter* mpAutocompleter;
+  Diagnostics*  mpDiagnostics;
+  QWidget*      mpFoldGutter;
+  QTimer*       mpRestyleTimer;
+  int           mRestyleBlock;    ///< Number of the block to restyle next
+  int           mRestyleLeft;     ///< Blocks still to go through
+};
+
 #endif // _TEXTEDITOR_H_
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+#include <QtCore/QString>
+#include <QtCore/QAtomicInt>
+
+/** Scoped trace probes.  Put a TRACE_SCOPE("Name") at the top of a block and
+ * the time spent in that block is recorded while tracing is enabled.  When
+ * tracing is disabled (the default) a probe costs a single test of an int.
+ *
+ * Each thread records into its own fixed size ring buffer without taking any
+ * locks, so the oldest events are overwritten once a buffer is full.  The
+ * buffers can be written out at any time with trace::dump() as Chrome
+ * trace-event JSON, which chrome://tracing and Perfetto can open.
+ *
+ * Names must be string literals (or otherwise outlive the trace); only the
+ * pointer is recorded. */
+namespace trace
+{
+  /** Number of events each thread keeps before the oldest are overwritten.
+   * Must be a power of two, so slots can be found with a mask. */
+  const int BUFFER_SIZE = 65536;
+
+  /** Non-zero while tracing is enabled.  It is set from the GUI thread and
+   * read by probes on every thread.  Use isEnabled() rather than this
+   * directly. */
+  extern QAtomicInt gEnabled;
+
+  /// @returns TRUE if trace probes are currently recording.
+  inline bool isEnabled(void) { return gEnabled != 0; }
+
+  /** Turns recording on or off.  Events already recorded are kept until
+   * clear() is called. */
+  void setEnabled(bool enabled);
+
+  /// @returns The time in nanoseconds since tracing was first enabled.
+  qint64 now(void);
+
+  /** Records a completed scope into the calling thread's buffer.
+   * @param name The name of the scope.
+   * @param start When the scope started, from now().
+   * @param end When the scope ended, from now(). */
+  void record(const char* name, qint64 start, qint64 end);
+
+  /** Discards all recorded events. */
+  void clear(void);
+
+  /** Writes every recorded event to \e path as Chrome trace-event JSON.
+   * This can be called while other threads are still recording.
+   * @returns TRUE if the file was written, FALSE otherwise. */
+  bool dump(const QString& path);
+
+  /** Records the time between its construction and destruction.  Use the
+   * TRACE_SCOPE macro rather than creating these directly. */
+  class Scope
+  {
+  public:
+    Scope(const char* name) : mpName(isEnabled() ? name : NULL), mStart(0)
+    {
+      if (mpName)
+        mStart = now();
+    }
+
+    ~Scope(void)
+    {
+      if (mpName)
+        record(mpName, mStart, now());
+    }
+
+  private:
+    const char* mpName;
+    qint64      mStart;
+  };
+}
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+/// Traces the enclosing scope under the name \e name.
+#define TRACE_SCOPE(name) trace::Scope TRACE_CONCAT(traceScope_, __LINE__)(name)
+
+#endif // _TRACE_H_
\ No newline at end of file
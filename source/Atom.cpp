@@ -0,0 +1,171 @@
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QVector>
+#include <cstring>
+#include "Atom.h" // class definition
+#include "BuiltinFormats.h"
+
+// Strings are kept in fixed chunks that never move, so an atom's string can
+// be read without taking the lock
+static const int CHUNK_SIZE = 1024;
+static const int MAX_CHUNKS = 4096;
+
+// ====================================================
+//  ATOM TABLE (local)
+// ====================================================
+struct AtomTable
+{
+  AtomTable(void) : count(0)
+  {
+    memset(chunks, 0, sizeof(chunks));
+  }
+
+  ~AtomTable(void)
+  {
+    for (int i = 0; i < MAX_CHUNKS; ++i)
+      delete [] chunks[i];
+  }
+
+  QReadWriteLock  lock;
+  QString*        chunks[MAX_CHUNKS];
+  int             count;    ///< Number of atoms; ids run from 1 to count
+  QVector<int>    slots;    ///< Open addressing table of ids, 0 when empty
+  QVector<uint>   hashes;   ///< Hash of each atom's string, by id
+};
+
+static AtomTable gAtoms;
+static const QString gNullString;
+
+// ====================================================
+//  HASH (local)
+// ====================================================
+static uint hashChars(const QChar* data, int length)
+{
+  return config::builtin::hash(0, reinterpret_cast<const ushort*>(data), length);
+} // hashChars
+
+// ====================================================
+//  STRING AT (local)
+// ====================================================
+static const QString& stringAt(int id)
+{
+  return gAtoms.chunks[id / CHUNK_SIZE][id % CHUNK_SIZE];
+} // stringAt
+
+// ====================================================
+//  PROBE (local)
+// ====================================================
+static int probe(const QChar* data, int length, uint hash)
+{
+  // The caller holds the lock
+  if (gAtoms.slots.isEmpty())
+    return 0;
+
+  int mask = gAtoms.slots.size() - 1;
+  for (int slot = hash & mask; gAtoms.slots[slot] != 0; slot = (slot + 1) & mask)
+  {
+    int id = gAtoms.slots[slot];
+    if (gAtoms.hashes[id] != hash)
+      continue;
+
+    const QString& str = stringAt(id);
+    if (str.size() == length && memcmp(str.constData(), data, length * sizeof(QChar)) == 0)
+      return id;
+  }
+  return 0;
+} // probe
+
+// ====================================================
+//  INSERT (local)
+// ====================================================
+static void insertSlot(int id)
+{
+  int mask = gAtoms.slots.size() - 1;
+  int slot = gAtoms.hashes[id] & mask;
+  while (gAtoms.slots[slot] != 0)
+    slot = (slot + 1) & mask;
+  gAtoms.slots[slot] = id;
+} // insertSlot
+
+// ====================================================
+//  INTERN (static)
+// ====================================================
+Atom Atom::intern(const QString& str)
+{
+  if (str.isEmpty())
+    return Atom();
+
+  uint hash = hashChars(str.constData(), str.size());
+  {
+    QReadLocker locker(&gAtoms.lock);
+    int id = probe(str.constData(), str.size(), hash);
+    if (id != 0)
+      return Atom(id);
+  }
+
+  QWriteLocker locker(&gAtoms.lock);
+
+  // Another thread may have added it in the meantime
+  int id = probe(str.constData(), str.size(), hash);
+  if (id != 0)
+    return Atom(id);
+
+  id = gAtoms.count + 1;
+  Q_ASSERT(id < CHUNK_SIZE * MAX_CHUNKS);
+  if (gAtoms.chunks[id / CHUNK_SIZE] == NULL)
+    gAtoms.chunks[id / CHUNK_SIZE] = new QString[CHUNK_SIZE];
+  gAtoms.chunks[id / CHUNK_SIZE][id % CHUNK_SIZE] = str;
+  gAtoms.hashes.resize(id + 1);
+  gAtoms.hashes[id] = hash;
+  gAtoms.count = id;
+
+  // Keep the table at most half full
+  if (gAtoms.count * 2 > gAtoms.slots.size())
+  {
+    gAtoms.slots.fill(0, qMax(256, gAtoms.slots.size() * 2));
+    for (int i = 1; i <= gAtoms.count; ++i)
+      insertSlot(i);
+  }
+  else
+  {
+    insertSlot(id);
+  }
+
+  return Atom(id);
+} // intern
+
+// ====================================================
+//  INTERN (static)
+// ====================================================
+Atom Atom::intern(const char* str)
+{
+  return intern(QString::fromLatin1(str));
+} // intern
+
+// ====================================================
+//  FIND (static)
+// ====================================================
+Atom Atom::find(const QChar* data, int length)
+{
+  if (length == 0)
+    return Atom();
+
+  uint hash = hashChars(data, length);
+  QReadLocker locker(&gAtoms.lock);
+  return Atom(probe(data, length, hash));
+} // find
+
+// ====================================================
+//  FIND (static)
+// ====================================================
+Atom Atom::find(const QString& str)
+{
+  return find(str.constData(), str.size());
+} // find
+
+// ====================================================
+//  TO STRING
+// ====================================================
+const QString& Atom::toString(void) const
+{
+  return (mId == 0 ? gNullString : stringAt(mId));
+} // toString
\ No newline at end of file
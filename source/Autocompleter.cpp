@@ -0,0 +1,251 @@
+#include <QtGui/QtGui>
+#include <algorithm>
+#include "Autocompleter.h" // class definition
+#include "TextEditor.h"
+#include "Highlighter.h"
+#include "ConfigFile.h"
+#include "Trace.h"
+#include "Metrics.h"
+
+// Initialize Static Members
+QList<Autocompleter*> Autocompleter::mAll;
+
+// Most words looked at when ranking, so a one letter prefix stays cheap
+static const int CANDIDATE_LIMIT = 500;
+
+// ====================================================
+//  IS WORD CHAR (local)
+// ====================================================
+static bool isWordChar(QChar ch)
+{
+  // Material names are usually paths, such as "Examples/Rockwall"
+  return ch.isLetterOrNumber() || ch == '_' || ch == '/' || ch == '.';
+} // isWordChar
+
+// ====================================================
+//  SUGGESTION (local)
+// ====================================================
+struct Suggestion
+{
+  int     score;
+  QString text;
+
+  bool operator<(const Suggestion& rhs) const
+  {
+    if (score != rhs.score)
+      return score > rhs.score;
+    return text < rhs.text;
+  }
+};
+
+// ====================================================
+//  CTOR
+// ====================================================
+Autocompleter::Autocompleter(TextEditor* editor)
+  : QObject(editor), mpEditor(editor)
+{
+  mpModel = new QStringListModel(this);
+
+  mpCompleter = new QCompleter(this);
+  mpCompleter->setWidget(mpEditor);
+  mpCompleter->setModel(mpModel);
+
+  // The suggestions are already filtered and ranked, so the completer
+  // should show them as they are
+  mpCompleter->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+  mpCompleter->setCaseSensitivity(Qt::CaseInsensitive);
+  mpCompleter->setMaxVisibleItems(10);
+
+  connect(mpCompleter, SIGNAL(activated(const QString&)), this, SLOT(insertCompletion(const QString&)));
+
+  mAll.push_back(this);
+} // ctor
+
+// ====================================================
+//  DTOR
+// ====================================================
+Autocompleter::~Autocompleter(void)
+{
+  mAll.removeAll(this);
+} // dtor
+
+// ====================================================
+//  IS POPUP VISIBLE
+// ====================================================
+bool Autocompleter::isPopupVisible(void) const
+{
+  return mpCompleter->popup()->isVisible();
+} // isPopupVisible
+
+// ====================================================
+//  HIDE POPUP
+// ====================================================
+void Autocompleter::hidePopup(void)
+{
+  mpCompleter->popup()->hide();
+} // hidePopup
+
+// ====================================================
+//  WORD START
+// ====================================================
+int Autocompleter::wordStart(void) const
+{
+  QTextCursor cursor = mpEditor->textCursor();
+  QString text = cursor.block().text();
+
+  int start = cursor.positionInBlock();
+  while (start > 0 && isWordChar(text[start - 1]))
+    --start;
+  return start;
+} // wordStart
+
+// ====================================================
+//  UPDATE
+// ====================================================
+void Autocompleter::update(bool force)
+{
+  TRACE_SCOPE("Autocompleter::update");
+
+  QElapsedTimer timer;
+  timer.start();
+
+  QTextCursor cursor = mpEditor->textCursor();
+  QTextBlock block = cursor.block();
+  QString text = block.text();
+  int column = cursor.positionInBlock();
+  int start = wordStart();
+  QString prefix = text.mid(start, column - start);
+
+  // Nothing to complete before enough has been typed
+  if (!force && prefix.size() < MIN_PREFIX)
+  {
+    hidePopup();
+    return;
+  }
+
+  // The highlighter keeps the parser state at the end of every block, so
+  // only this line has to be scanned to find the scope.  Nothing is offered
+  // in a comment.
+  bool attribute = false;
+  bool comment = false;
+  ScopeState state = Highlighter::scopeAt(block, start, &attribute, &comment);
+  if (comment)
+  {
+    hidePopup();
+    return;
+  }
+
+  QStringList names;
+  if (!attribute)
+    names = openMaterialNames();
+
+  QStringList suggestions = suggest(mpEditor->fileFormat(), prefix, state.current(), attribute, names);
+
+  // Don't offer a word that's already been typed out in full
+  if (suggestions.isEmpty() || (suggestions.size() == 1 && suggestions.first() == prefix))
+  {
+    hidePopup();
+  }
+  else
+  {
+    mpModel->setStringList(suggestions);
+
+    QAbstractItemView* popup = mpCompleter->popup();
+    popup->setCurrentIndex(mpModel->index(0, 0));
+
+    QTextCursor startCursor(block);
+    startCursor.setPosition(block.position() + start);
+    QRect rect = mpEditor->cursorRect(startCursor);
+    rect.setWidth(popup->sizeHintForColumn(0) + popup->verticalScrollBar()->sizeHint().width());
+    mpCompleter->complete(rect);
+  }
+
+  static metrics::Metric* latency = metrics::Registry::instance()->metric("completion.update_ms");
+  latency->sample(timer.nsecsElapsed() / 1000000.0);
+} // update
+
+// ====================================================
+//  SUGGEST (static)
+// ====================================================
+QStringList Autocompleter::suggest(const QString& format, const QString& prefix, Atom scope,
+                                   bool attribute, const QStringList& names)
+{
+  const config::KeywordTrie& trie = config::ConfigFile::instance()->getTrieByFormat(format);
+  const config::FormatWordMap& words = config::ConfigFile::instance()->getWordsByFormat(format);
+
+  // Prefix matches first, so the limit can't crowd them out, then anything
+  // containing the typed characters in order
+  QVector<int> candidates;
+  trie.findPrefix(prefix, candidates, CANDIDATE_LIMIT);
+  if (!prefix.isEmpty())
+    trie.findFuzzy(prefix, candidates, CANDIDATE_LIMIT);
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+  QVector<Suggestion> ranked;
+  QVector<Suggestion> unscoped;
+  foreach (int index, candidates)
+  {
+    const QString& word = trie.words()[index];
+    config::FormatWordMap::const_iterator citr = words.find(word);
+    if (citr == words.end())
+      continue;
+
+    Suggestion suggestion = { config::KeywordTrie::score(prefix, word), word };
+    if (suggestion.score < 0)
+      continue;
+
+    // Attributes of the enclosing block start statements, and values
+    // (words without a scope) follow them
+    if (attribute ? citr->scopes.contains(scope) : citr->scopes.isEmpty())
+      ranked.push_back(suggestion);
+    else
+      unscoped.push_back(suggestion);
+  }
+
+  foreach (const QString& name, names)
+  {
+    Suggestion suggestion = { config::KeywordTrie::score(prefix, name), name };
+    if (suggestion.score >= 0)
+      ranked.push_back(suggestion);
+  }
+
+  // A block the words file knows nothing about gets every word rather than none
+  if (ranked.isEmpty())
+    ranked = unscoped;
+
+  int count = qMin(ranked.size(), static_cast<int>(MAX_SUGGESTIONS));
+  std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end());
+
+  QStringList suggestions;
+  for (int i = 0; i < count; ++i)
+    suggestions << ranked[i].text;
+  return suggestions;
+} // suggest
+
+// ====================================================
+//  OPEN MATERIAL NAMES (static)
+// ====================================================
+QStringList Autocompleter::openMaterialNames(void)
+{
+  // Each highlighter keeps the names its document defines up to date as it
+  // parses, so this is just a union of small sets
+  QSet<QString> names;
+  foreach (Autocompleter* completer, mAll)
+  {
+    foreach (const QString& name, completer->mpEditor->highlighter()->definedNames())
+      names.insert(name);
+  }
+  return names.toList();
+} // openMaterialNames
+
+// ====================================================
+//  INSERT COMPLETION (slot)
+// ====================================================
+void Autocompleter::insertCompletion(const QString& completion)
+{
+  QTextCursor cursor = mpEditor->textCursor();
+  cursor.setPosition(cursor.block().position() + wordStart(), QTextCursor::KeepAnchor);
+  cursor.insertText(completion);
+  mpEditor->setTextCursor(cursor);
+} // insertCompletion
\ No newline at end of file
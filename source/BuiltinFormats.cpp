@@ -0,0 +1,26 @@
+#include "BuiltinFormats.h"
+
+namespace config
+{
+  namespace builtin
+  {
+    // The tables: FORMATS and the arrays it points to
+    #include "BuiltinFormats.inc"
+
+    // ====================================================
+    //  FORMATS
+    // ====================================================
+    const Format* formats(void)
+    {
+      return FORMATS;
+    } // formats
+
+    // ====================================================
+    //  FORMAT COUNT
+    // ====================================================
+    int formatCount(void)
+    {
+      return static_cast<int>(sizeof(FORMATS) / sizeof(FORMATS[0]));
+    } // formatCount
+  }
+}
\ No newline at end of file
@@ -1,228 +1,760 @@
-#include "ConfigFile.h"
-#include <QtXml/QtXml>
-
-namespace config
-{
-  // Initialize Static Members
-  ConfigFile* ConfigFile::mpMe = NULL;
-
-  // ====================================================
-  //  CTOR
-  // ====================================================
-  ConfigFile::ConfigFile(void)
-  {
-    load();
-  } // ctor
-
-  // ====================================================
-  //  DTOR
-  // ====================================================
-  ConfigFile::~ConfigFile(void)
-  {
-  } // dtor
-
-  // ====================================================
-  //  INSTANCE (static)
-  // ====================================================
-  ConfigFile* ConfigFile::instance()
-  {
-    if (mpMe == NULL)
-      mpMe = new ConfigFile;
-    return mpMe;
-  } // instance
-
-  // ====================================================
-  //  GET MANUAL PATH
-  // ====================================================
-  const QString& ConfigFile::getManualPath(void) const
-  {
-    return mManualPath;
-  } // getManualPath
-
-  // ====================================================
-  //  GET FORMAT BY EXTENSION
-  // ====================================================
-  const QString& ConfigFile::getFormatByExtension(const QString& extension) const
-  {
-    static QString FORMAT_NOT_FOUND;
-
-    QMap<QString, QString>::const_iterator citr = mFormatsByExt.find(extension);
-    return (citr != mFormatsByExt.end() ? (*citr) : FORMAT_NOT_FOUND);
-  } // getFormatByExtension
-
-  // ====================================================
-  //  GET HIGHLIGHTS BY FORMAT
-  // ====================================================
-  const FormatHighlightingMap& ConfigFile::getHighlightsByFormat(const QString& format) const
-  {
-    static const FormatHighlightingMap FORMAT_NOT_FOUND;
-
-    if (format.isNull())
-      return FORMAT_NOT_FOUND;
-
-    QMap<QString, FormatHighlightingMap>::const_iterator citr = mHighlightsByFormat.find(format);
-    return (citr != mHighlightsByFormat.end() ? (*citr) : FORMAT_NOT_FOUND);
-  } // getHighlightsByFormat
-
-  // ====================================================
-  //  GET WORDS BY FORMAT
-  // ====================================================
-  const FormatWordMap& ConfigFile::getWordsByFormat(const QString& format) const
-  {
-    static const FormatWordMap FORMAT_NOT_FOUND;
-
-    if (format.isNull())
-      return FORMAT_NOT_FOUND;
-
-    QMap<QString, FormatWordMap>::const_iterator citr = mWordsByFormat.find(format);
-    return (citr != mWordsByFormat.end() ? (*citr) : FORMAT_NOT_FOUND);
-  } // getWordsByFormat
-
-  // ====================================================
-  //  GET ALL FORMAT NAMES
-  // ====================================================
-  QStringList ConfigFile::getAllFormatNames(void) const
-  {
-    QStringList formats;
-
-    QMap<QString, QString>::const_iterator citr = mFormatsByExt.begin();
-    for (; citr != mFormatsByExt.end(); ++citr)
-      formats << (*citr);
-
-    return formats;
-  } // getAllFormatNames
-
-  // ====================================================
-  //  LOAD
-  // ====================================================
-  void ConfigFile::load(void)
-  {
-    QFile file("config.xml");
-    if (file.open(QFile::ReadOnly | QFile::Text))
-    {
-      QDomDocument doc;
-      if (doc.setContent(&file))
-      {
-        QDomElement root = doc.documentElement();
-
-        // Manual Path
-        QDomElement manPath = root.firstChildElement("OgreManualPath");
-        if (manPath.isNull() == false)
-        {
-          mManualPath = manPath.text() + "\\";  // Make sure it ends with a /
-        }
-
-        // Formats (required)
-        QDomElement formatsNode = root.firstChildElement("Formats");
-        QDomNodeList formats = root.elementsByTagName("Format");
-
-        for (int i = 0; i < formats.count(); ++i)
-        {
-          QDomElement child = formats.item(i).toElement();
-          QString formatName = child.text();
-          QString highFile   = child.attribute("highlights_file");
-          QString wordFile   = child.attribute("words_file");
-          QString fileExt    = child.attribute("file_extensions");
-
-          // Load this format
-          loadFormat(formatName, highFile, wordFile);
-
-          // Associate this format with its file extension
-          mFormatsByExt[fileExt] = formatName;
-        }
-      }
-    }
-  } // load
-
-  // ====================================================
-  //  LOAD FORMAT
-  // ====================================================
-  void ConfigFile::loadFormat(const QString& formatName, const QString& highlightsFile, const QString& wordsFile)
-  {    
-    FormatHighlightingMap highlightsMap;
-    FormatWordMap wordsMap;
-    
-    // Highlight rules
-    {
-      QFile file(highlightsFile);
-      if (file.open(QFile::ReadOnly | QFile::Text))
-      {
-        QDomDocument doc;
-        if (doc.setContent(&file))
-        {
-          QDomElement root = doc.documentElement();
-          QDomNodeList highlights = root.elementsByTagName("Highlight");
-        
-          for (int i = 0; i < highlights.count(); ++i)
-          {
-            FormatHighlighting rule;
-            QDomElement child = highlights.item(i).toElement();
-            rule.name = child.attribute("name");
-            rule.format.setForeground(QColor(child.attribute("color", "#000000")));
-            bool bold = (child.attribute("bold", "false").toLower() == "true");
-            bool italics = (child.attribute("italics", "false").toLower() == "true");
-          
-            if (bold)    rule.format.setFontWeight(QFont::Bold);
-            if (italics) rule.format.setFontItalic(true);
-
-            if (rule.name == "comment")
-            {
-              rule.patterns.clear();
-              rule.patterns.append(QRegExp("//[^\n]*"));
-            }
-            else if (rule.name == "string")
-            {
-              rule.patterns.clear();
-              rule.patterns.append(QRegExp("\".*\""));
-            }
-            
-            // Add this highlighting rule to the map
-            highlightsMap[rule.name] = rule;
-          }
-        }
-      }
-    }
-
-    // Words
-    {
-      QFile file(wordsFile);
-      if (file.open(QFile::ReadOnly | QFile::Text))
-      {
-        QDomDocument doc;
-        if (doc.setContent(&file))
-        {
-          QDomElement root = doc.documentElement();
-          QDomNodeList words = root.elementsByTagName("Word");
-        
-          for (int i = 0; i < words.count(); ++i)
-          {
-            QDomElement child = words.item(i).toElement();
-            FormatWord formatWord;
-            formatWord.highlightType = child.attribute("highlight");
-            formatWord.doc           = child.attribute("documentation");
-            formatWord.word          = child.text();
-
-            // Add this word to the highlighting rules map under its highlight category (ie, keywords)
-            QMap<QString, FormatHighlighting>::Iterator highItr = highlightsMap.find(formatWord.highlightType);
-            if (highItr != highlightsMap.end())
-            {
-              // Add this word to the patterns for its highlight type
-              highItr->patterns.append(QRegExp(QString("\\b%1\\b").arg(formatWord.word)));
-
-              // Add this word to the format words for this format
-              wordsMap[formatWord.word] = formatWord;               
-            }
-          }
-        }
-      }
-    }
-
-    // Add this FormatHighlightMap to the map of formats
-    if (highlightsMap.empty() == false)
-      mHighlightsByFormat[formatName] = highlightsMap;
-
-    // Add this FormatWordMap to the map of formats
-    if (wordsMap.empty() == false)
-      mWordsByFormat[formatName] = wordsMap;
-  } // loadFormat
+#include "ConfigFile.h"
+#include "Trace.h"
+#include <QtXml/QtXml>
+#include <cstring>
+
+/// Starting value of the rules stamp, the FNV-1a offset basis
+static const quint64 RULES_STAMP_BASIS = Q_UINT64_C(14695981039346656037);
+
+namespace config
+{
+  // Initialize Static Members
+  ConfigFile* ConfigFile::mpMe = NULL;
+
+  // ====================================================
+  //  CTOR
+  // ====================================================
+  ConfigFile::ConfigFile(void)
+  {
+    load();
+  } // ctor
+
+  // ====================================================
+  //  DTOR
+  // ====================================================
+  ConfigFile::~ConfigFile(void)
+  {
+  } // dtor
+
+  // ====================================================
+  //  INSTANCE (static)
+  // ====================================================
+  ConfigFile* ConfigFile::instance()
+  {
+    if (mpMe == NULL)
+      mpMe = new ConfigFile;
+    return mpMe;
+  } // instance
+
+  // ====================================================
+  //  GET MANUAL PATH
+  // ====================================================
+  const QString& ConfigFile::getManualPath(void) const
+  {
+    return mManualPath;
+  } // getManualPath
+
+  // ====================================================
+  //  GET RESOURCE PATHS
+  // ====================================================
+  const QStringList& ConfigFile::getResourcePaths(void) const
+  {
+    return mResourcePaths;
+  } // getResourcePaths
+
+  // ====================================================
+  //  GET FORMAT BY EXTENSION
+  // ====================================================
+  const QString& ConfigFile::getFormatByExtension(const QString& extension) const
+  {
+    static QString FORMAT_NOT_FOUND;
+
+    QMap<QString, QString>::const_iterator citr = mFormatsByExt.find(extension);
+    return (citr != mFormatsByExt.end() ? (*citr) : FORMAT_NOT_FOUND);
+  } // getFormatByExtension
+
+  // ====================================================
+  //  GET HIGHLIGHTS BY FORMAT
+  // ====================================================
+  const FormatHighlightingMap& ConfigFile::getHighlightsByFormat(const QString& format) const
+  {
+    static const FormatHighlightingMap FORMAT_NOT_FOUND;
+
+    if (format.isNull())
+      return FORMAT_NOT_FOUND;
+
+    QMap<QString, FormatHighlightingMap>::const_iterator citr = mHighlightsByFormat.find(format);
+    return (citr != mHighlightsByFormat.end() ? (*citr) : FORMAT_NOT_FOUND);
+  } // getHighlightsByFormat
+
+  // ====================================================
+  //  GET WORDS BY FORMAT
+  // ====================================================
+  const FormatWordMap& ConfigFile::getWordsByFormat(const QString& format) const
+  {
+    static const FormatWordMap FORMAT_NOT_FOUND;
+
+    if (format.isNull())
+      return FORMAT_NOT_FOUND;
+
+    QMap<QString, FormatWordMap>::const_iterator citr = mWordsByFormat.find(format);
+    return (citr != mWordsByFormat.end() ? (*citr) : FORMAT_NOT_FOUND);
+  } // getWordsByFormat
+
+  // ====================================================
+  //  FIND WORD
+  // ====================================================
+  const FormatWord* ConfigFile::findWord(const QString& format, Atom word) const
+  {
+    QMap<QString, QHash<Atom, FormatWord> >::const_iterator formatItr = mAtomWordsByFormat.find(format);
+    if (formatItr == mAtomWordsByFormat.end())
+      return NULL;
+
+    QHash<Atom, FormatWord>::const_iterator citr = formatItr->find(word);
+    return (citr != formatItr->end() ? &(*citr) : NULL);
+  } // findWord
+
+  // ====================================================
+  //  GET TRIE BY FORMAT
+  // ====================================================
+  const KeywordTrie& ConfigFile::getTrieByFormat(const QString& format) const
+  {
+    static const KeywordTrie FORMAT_NOT_FOUND;
+
+    if (format.isNull())
+      return FORMAT_NOT_FOUND;
+
+    QMap<QString, KeywordTrie>::const_iterator citr = mTriesByFormat.find(format);
+    return (citr != mTriesByFormat.end() ? (*citr) : FORMAT_NOT_FOUND);
+  } // getTrieByFormat
+
+  // ====================================================
+  //  GET SUGGESTIONS BY FORMAT
+  // ====================================================
+  const SuggestionIndex& ConfigFile::getSuggestionsByFormat(const QString& format) const
+  {
+    static const SuggestionIndex FORMAT_NOT_FOUND;
+
+    if (format.isNull())
+      return FORMAT_NOT_FOUND;
+
+    QMap<QString, SuggestionIndex>::const_iterator citr = mSuggestionsByFormat.find(format);
+    return (citr != mSuggestionsByFormat.end() ? (*citr) : FORMAT_NOT_FOUND);
+  } // getSuggestionsByFormat
+
+  // ====================================================
+  //  GET WORD TABLE BY FORMAT
+  // ====================================================
+  const WordTable& ConfigFile::getWordTableByFormat(const QString& format) const
+  {
+    static const WordTable FORMAT_NOT_FOUND;
+
+    if (format.isNull())
+      return FORMAT_NOT_FOUND;
+
+    QMap<QString, WordTable>::const_iterator citr = mTablesByFormat.find(format);
+    return (citr != mTablesByFormat.end() ? (*citr) : FORMAT_NOT_FOUND);
+  } // getWordTableByFormat
+
+  // ====================================================
+  //  GET ALL FORMAT NAMES
+  // ====================================================
+  QStringList ConfigFile::getAllFormatNames(void) const
+  {
+    QStringList formats;
+
+    QMap<QString, QString>::const_iterator citr = mFormatsByExt.begin();
+    for (; citr != mFormatsByExt.end(); ++citr)
+      formats << (*citr);
+
+    return formats;
+  } // getAllFormatNames
+
+  // ====================================================
+  //  GET RULES STAMP
+  // ====================================================
+  quint64 ConfigFile::getRulesStamp(void) const
+  {
+    return mRulesStamp;
+  } // getRulesStamp
+
+  // ====================================================
+  //  RELOAD
+  // ====================================================
+  void ConfigFile::reload(void)
+  {
+    mManualPath.clear();
+    mResourcePaths.clear();
+    mHighlightsByFormat.clear();
+    mWordsByFormat.clear();
+    mAtomWordsByFormat.clear();
+    mTriesByFormat.clear();
+    mSuggestionsByFormat.clear();
+    mTablesByFormat.clear();
+    mFormatsByExt.clear();
+    mFilesByFormat.clear();
+    mFileStamps.clear();
+
+    load();
+  } // reload
+
+  // ====================================================
+  //  FILE STAMP (local)
+  // ====================================================
+  static quint64 fileStamp(const QString& path)
+  {
+    QFileInfo fi(path);
+    if (!fi.exists())
+      return 0;
+    return (static_cast<quint64>(fi.lastModified().toMSecsSinceEpoch()) * 31 + fi.size()) * 31 + qHash(fi.absoluteFilePath());
+  } // fileStamp
+
+  // ====================================================
+  //  STAMP BYTES (local)
+  // ====================================================
+  /** Adds \e size bytes to a stamp, with 64 bit FNV-1a. */
+  static quint64 stampBytes(quint64 stamp, const char* data, int size)
+  {
+    for (int i = 0; i < size; ++i)
+    {
+      stamp ^= static_cast<uchar>(data[i]);
+      stamp *= Q_UINT64_C(1099511628211);
+    }
+    return stamp;
+  } // stampBytes
+
+  // ====================================================
+  //  STAMP STRING (local)
+  // ====================================================
+  /** Adds a string, and its terminator so that neighbours stay apart. */
+  static quint64 stampString(quint64 stamp, const char* text)
+  {
+    return stampBytes(stamp, text, static_cast<int>(strlen(text)) + 1);
+  } // stampString
+
+  // ====================================================
+  //  GET SOURCE FILES
+  // ====================================================
+  QStringList ConfigFile::getSourceFiles(void) const
+  {
+    return mFileStamps.keys();
+  } // getSourceFiles
+
+  // ====================================================
+  //  GET CHANGED FILES
+  // ====================================================
+  QStringList ConfigFile::getChangedFiles(void) const
+  {
+    QStringList files;
+
+    QMap<QString, quint64>::const_iterator citr = mFileStamps.begin();
+    for (; citr != mFileStamps.end(); ++citr)
+    {
+      if (fileStamp(citr.key()) != *citr)
+        files << citr.key();
+    }
+    return files;
+  } // getChangedFiles
+
+  // ====================================================
+  //  CLONE
+  // ====================================================
+  ConfigFile* ConfigFile::clone(void) const
+  {
+    return new ConfigFile(*this);
+  } // clone
+
+  // ====================================================
+  //  RELOAD FILES
+  // ====================================================
+  QStringList ConfigFile::reloadFiles(const QStringList& files)
+  {
+    TRACE_SCOPE("ConfigFile::reloadFiles");
+
+    // The config file says which files make up each format, and which
+    // formats there are, so any of them may have changed
+    if (files.contains(mConfigPath))
+    {
+      QSet<QString> formats = mTablesByFormat.keys().toSet();
+      reload();
+      formats += mTablesByFormat.keys().toSet();
+
+      QStringList names = formats.toList();
+      names.sort();
+      return names;
+    }
+
+    QStringList formats;
+    QMap<QString, QStringList>::const_iterator citr = mFilesByFormat.begin();
+    for (; citr != mFilesByFormat.end(); ++citr)
+    {
+      foreach (const QString& file, *citr)
+      {
+        if (files.contains(file))
+        {
+          formats << citr.key();
+          break;
+        }
+      }
+    }
+
+    foreach (const QString& format, formats)
+      reloadFormat(format);
+    updateRulesStamp();
+    return formats;
+  } // reloadFiles
+
+  // ====================================================
+  //  REPLACE WITH
+  // ====================================================
+  void ConfigFile::replaceWith(ConfigFile* other)
+  {
+    *this = *other;
+    delete other;
+  } // replaceWith
+
+  // ====================================================
+  //  STAMP FILE
+  // ====================================================
+  void ConfigFile::stampFile(const QString& path)
+  {
+    if (!path.isEmpty())
+      mFileStamps[path] = fileStamp(path);
+  } // stampFile
+
+  // ====================================================
+  //  UPDATE RULES STAMP
+  // ====================================================
+  void ConfigFile::updateRulesStamp(void)
+  {
+    TRACE_SCOPE("ConfigFile::updateRulesStamp");
+
+    // Of what the rules are made of, rather than when or where, so the
+    // stamp only changes when they do, and is the same for every build of
+    // the same built-in formats
+    quint64 stamp = RULES_STAMP_BASIS;
+    const builtin::Format* formats = builtin::formats();
+    for (int f = 0; f < builtin::formatCount(); ++f)
+    {
+      const builtin::Format& format = formats[f];
+      stamp = stampString(stamp, format.name);
+      stamp = stampString(stamp, format.extension);
+      for (int i = 0; i < format.numHighlights; ++i)
+      {
+        const builtin::Highlight& highlight = format.highlights[i];
+        stamp = stampString(stamp, highlight.name);
+        stamp = stampString(stamp, highlight.color);
+        stamp = stampBytes(stamp, highlight.bold ? "b" : "-", 1);
+        stamp = stampBytes(stamp, highlight.italics ? "i" : "-", 1);
+      }
+      for (int i = 0; i < format.numWords; ++i)
+      {
+        const builtin::Word& word = format.words[i];
+        stamp = stampString(stamp, word.word);
+        stamp = stampString(stamp, format.highlights[word.highlight].name);
+        stamp = stampString(stamp, word.doc);
+        stamp = stampString(stamp, word.scope);
+      }
+    }
+
+    // The files on top of them, in the order of their paths
+    QMap<QString, quint64>::const_iterator citr = mFileStamps.begin();
+    for (; citr != mFileStamps.end(); ++citr)
+    {
+      QByteArray path = citr.key().toUtf8();
+      stamp = stampBytes(stamp, path.constData(), path.size() + 1);
+
+      QFile file(citr.key());
+      if (file.open(QFile::ReadOnly))
+      {
+        QByteArray data = file.readAll();
+        stamp = stampBytes(stamp, data.constData(), data.size());
+      }
+      stamp = stampBytes(stamp, "", 1);
+    }
+    mRulesStamp = stamp;
+  } // updateRulesStamp
+
+  // ====================================================
+  //  LOAD
+  // ====================================================
+  void ConfigFile::load(void)
+  {
+    TRACE_SCOPE("ConfigFile::load");
+
+    // The built-in formats are there even without a config file, which
+    // only adds to and overrides them
+    loadBuiltinFormats();
+
+    // The config file is watched even before it exists
+    mConfigPath = QDir::current().absoluteFilePath("config.xml");
+    stampFile(mConfigPath);
+
+    QFile file(mConfigPath);
+    if (file.open(QFile::ReadOnly | QFile::Text))
+    {
+      QDomDocument doc;
+      if (doc.setContent(&file))
+      {
+        QDomElement root = doc.documentElement();
+
+        // Manual Path
+        QDomElement manPath = root.firstChildElement("OgreManualPath");
+        if (manPath.isNull() == false)
+        {
+          mManualPath = manPath.text() + "/";  // Make sure it ends with a /
+        }
+
+        // Resource directories (optional), relative to the config file
+        QDomElement resources = root.firstChildElement("ResourcePaths");
+        for (QDomElement path = resources.firstChildElement("Path"); !path.isNull(); path = path.nextSiblingElement("Path"))
+        {
+          if (!path.text().trimmed().isEmpty())
+            mResourcePaths << QDir::cleanPath(QDir::current().absoluteFilePath(path.text().trimmed()));
+        }
+
+        // Formats (required)
+        QDomElement formatsNode = root.firstChildElement("Formats");
+        QDomNodeList formats = root.elementsByTagName("Format");
+
+        for (int i = 0; i < formats.count(); ++i)
+        {
+          QDomElement child = formats.item(i).toElement();
+          QString formatName = child.text();
+          QString highFile   = child.attribute("highlights_file");
+          QString wordFile   = child.attribute("words_file");
+          QString fileExt    = child.attribute("file_extensions");
+
+          // Keep the files as absolute paths, so they can be watched
+          if (!highFile.isEmpty())
+            highFile = QDir::current().absoluteFilePath(highFile);
+          if (!wordFile.isEmpty())
+            wordFile = QDir::current().absoluteFilePath(wordFile);
+          mFilesByFormat[formatName] = QStringList() << highFile << wordFile;
+
+          // Load this format
+          loadFormat(formatName, highFile, wordFile);
+
+          // Associate this format with its file extension
+          mFormatsByExt[fileExt] = formatName;
+        }
+      }
+    }
+
+    // Build the completion tries, suggestion indexes and atom lookups once
+    // here, so lookups while typing are cheap
+    foreach (const QString& formatName, mWordsByFormat.keys())
+      finishFormat(formatName);
+
+    updateRulesStamp();
+  } // load
+
+  // ====================================================
+  //  FINISH FORMAT
+  // ====================================================
+  void ConfigFile::finishFormat(const QString& formatName)
+  {
+    QMap<QString, FormatWordMap>::const_iterator citr = mWordsByFormat.find(formatName);
+    if (citr == mWordsByFormat.end())
+      return;
+
+    mTriesByFormat[formatName].build(citr->keys());
+    mSuggestionsByFormat[formatName].build(citr->keys());
+
+    QHash<Atom, FormatWord>& atomWords = mAtomWordsByFormat[formatName];
+    foreach (const FormatWord& formatWord, *citr)
+      atomWords.insert(formatWord.atom, formatWord);
+  } // finishFormat
+
+  // ====================================================
+  //  RELOAD FORMAT
+  // ====================================================
+  void ConfigFile::reloadFormat(const QString& formatName)
+  {
+    TRACE_SCOPE("ConfigFile::reloadFormat");
+
+    mHighlightsByFormat.remove(formatName);
+    mWordsByFormat.remove(formatName);
+    mAtomWordsByFormat.remove(formatName);
+    mTriesByFormat.remove(formatName);
+    mSuggestionsByFormat.remove(formatName);
+    mTablesByFormat.remove(formatName);
+
+    const builtin::Format* formats = builtin::formats();
+    for (int f = 0; f < builtin::formatCount(); ++f)
+    {
+      if (formatName == QLatin1String(formats[f].name))
+        loadBuiltinFormat(formats[f]);
+    }
+
+    QMap<QString, QStringList>::const_iterator citr = mFilesByFormat.find(formatName);
+    if (citr != mFilesByFormat.end())
+      loadFormat(formatName, citr->value(0), citr->value(1));
+
+    finishFormat(formatName);
+  } // reloadFormat
+
+  // ====================================================
+  //  SET DEFAULT PATTERNS (local)
+  // ====================================================
+  static void setDefaultPatterns(FormatHighlighting& rule)
+  {
+    // Keywords are classified through the format's WordTable; only comments
+    // and strings are matched with patterns
+    if (rule.name == "comment")
+    {
+      rule.patterns.clear();
+      rule.patterns.append(QRegExp("//[^\n]*"));
+    }
+    else if (rule.name == "string")
+    {
+      rule.patterns.clear();
+      rule.patterns.append(QRegExp("\".*\""));
+    }
+  } // setDefaultPatterns
+
+  // ====================================================
+  //  INTERN SCOPES (local)
+  // ====================================================
+  static QVector<Atom> internScopes(const QString& scopes)
+  {
+    QVector<Atom> atoms;
+    foreach (const QString& scope, scopes.split(',', QString::SkipEmptyParts))
+      atoms.push_back(Atom::intern(scope.trimmed()));
+    return atoms;
+  } // internScopes
+
+  // ====================================================
+  //  LOAD BUILTIN FORMATS
+  // ====================================================
+  void ConfigFile::loadBuiltinFormats(void)
+  {
+    TRACE_SCOPE("ConfigFile::loadBuiltinFormats");
+
+    const builtin::Format* formats = builtin::formats();
+    for (int f = 0; f < builtin::formatCount(); ++f)
+    {
+      loadBuiltinFormat(formats[f]);
+      mFormatsByExt[QString::fromLatin1(formats[f].extension)] = QString::fromLatin1(formats[f].name);
+    }
+  } // loadBuiltinFormats
+
+  // ====================================================
+  //  LOAD BUILTIN FORMAT
+  // ====================================================
+  void ConfigFile::loadBuiltinFormat(const builtin::Format& format)
+  {
+    QString formatName = QString::fromLatin1(format.name);
+
+    FormatHighlightingMap highlightsMap;
+    for (int i = 0; i < format.numHighlights; ++i)
+    {
+      FormatHighlighting rule;
+      rule.atom = Atom::intern(format.highlights[i].name);
+      rule.name = rule.atom.toString();
+      rule.format.setForeground(QColor(format.highlights[i].color));
+      if (format.highlights[i].bold)    rule.format.setFontWeight(QFont::Bold);
+      if (format.highlights[i].italics) rule.format.setFontItalic(true);
+      setDefaultPatterns(rule);
+      highlightsMap[rule.name] = rule;
+    }
+
+    FormatWordMap wordsMap;
+    for (int i = 0; i < format.numWords; ++i)
+    {
+      const builtin::Word& word = format.words[i];
+      FormatWord formatWord;
+      formatWord.atom          = Atom::intern(word.word);
+      formatWord.word          = formatWord.atom.toString();
+      formatWord.highlightType = Atom::intern(format.highlights[word.highlight].name).toString();
+      formatWord.doc           = QString::fromLatin1(word.doc);
+      formatWord.scopes        = internScopes(QString::fromLatin1(word.scope));
+      wordsMap[formatWord.word] = formatWord;
+    }
+
+    mHighlightsByFormat[formatName] = highlightsMap;
+    mWordsByFormat[formatName] = wordsMap;
+    mTablesByFormat[formatName].setBuiltin(&format);
+  } // loadBuiltinFormat
+
+  // ====================================================
+  //  LOAD FORMAT
+  // ====================================================
+  void ConfigFile::loadFormat(const QString& formatName, const QString& highlightsFile, const QString& wordsFile)
+  {    
+    TRACE_SCOPE("ConfigFile::loadFormat");
+
+    // Start from the built-in format, if there is one
+    FormatHighlightingMap highlightsMap = mHighlightsByFormat.value(formatName);
+    FormatWordMap wordsMap = mWordsByFormat.value(formatName);
+    WordTable& table = mTablesByFormat[formatName];
+    
+    // Highlight rules
+    {
+      stampFile(highlightsFile);
+
+      QFile file(highlightsFile);
+      if (file.open(QFile::ReadOnly | QFile::Text))
+      {
+        QDomDocument doc;
+        if (doc.setContent(&file))
+        {
+          QDomElement root = doc.documentElement();
+          QDomNodeList highlights = root.elementsByTagName("Highlight");
+        
+          for (int i = 0; i < highlights.count(); ++i)
+          {
+            FormatHighlighting rule;
+            QDomElement child = highlights.item(i).toElement();
+            rule.atom = Atom::intern(child.attribute("name"));
+            rule.name = rule.atom.toString();
+            rule.format.setForeground(QColor(child.attribute("color", "#000000")));
+            bool bold = (child.attribute("bold", "false").toLower() == "true");
+            bool italics = (child.attribute("italics", "false").toLower() == "true");
+          
+            if (bold)    rule.format.setFontWeight(QFont::Bold);
+            if (italics) rule.format.setFontItalic(true);
+
+            setDefaultPatterns(rule);
+            
+            // Add this highlighting rule to the map, replacing a built-in one
+            highlightsMap[rule.name] = rule;
+          }
+        }
+      }
+    }
+
+    // Words
+    {
+      stampFile(wordsFile);
+
+      QFile file(wordsFile);
+      if (file.open(QFile::ReadOnly | QFile::Text))
+      {
+        QDomDocument doc;
+        if (doc.setContent(&file))
+        {
+          QDomElement root = doc.documentElement();
+          QDomNodeList words = root.elementsByTagName("Word");
+        
+          for (int i = 0; i < words.count(); ++i)
+          {
+            QDomElement child = words.item(i).toElement();
+            FormatWord formatWord;
+            formatWord.atom          = Atom::intern(child.text());
+            formatWord.word          = formatWord.atom.toString();
+            formatWord.highlightType = Atom::intern(child.attribute("highlight")).toString();
+            formatWord.doc           = child.attribute("documentation");
+
+            formatWord.scopes = internScopes(child.attribute("scope"));
+
+            // Only keep words whose highlight type exists
+            if (highlightsMap.contains(formatWord.highlightType))
+            {
+              // Add this word to the format words for this format
+              wordsMap[formatWord.word] = formatWord;               
+
+              // The word table only has to learn about words that aren't
+              // already built in with the same highlight type
+              Atom highlightType = Atom::find(formatWord.highlightType);
+              if (table.classify(formatWord.word.constData(), formatWord.word.size()) != highlightType)
+                table.addOverride(formatWord.word, highlightType);
+            }
+          }
+        }
+      }
+    }
+
+    // Add this FormatHighlightMap to the map of formats
+    if (highlightsMap.empty() == false)
+      mHighlightsByFormat[formatName] = highlightsMap;
+
+    // Add this FormatWordMap to the map of formats
+    if (wordsMap.empty() == false)
+      mWordsByFormat[formatName] = wordsMap;
+  } // loadFormat
+
+  // ---------------------------------------------------------------------
+  //                              WORD TABLE
+  // ---------------------------------------------------------------------
+
+  // ====================================================
+  //  CTOR
+  // ====================================================
+  WordTable::WordTable(void)
+    : mpBuiltin(NULL), mNumOverrides(0)
+  {
+  } // ctor
+
+  // ====================================================
+  //  SET BUILTIN
+  // ====================================================
+  void WordTable::setBuiltin(const builtin::Format* format)
+  {
+    mpBuiltin = format;
+    mBuiltinTypes.clear();
+    for (int i = 0; i < format->numHighlights; ++i)
+      mBuiltinTypes.push_back(Atom::intern(format->highlights[i].name));
+  } // setBuiltin
+
+  // ====================================================
+  //  ADD OVERRIDE
+  // ====================================================
+  void WordTable::addOverride(const QString& word, Atom highlightType)
+  {
+    // Keep the table at most half full
+    if ((mNumOverrides + 1) * 2 > mOverrides.size())
+    {
+      QVector<Override> old = mOverrides;
+      mOverrides.clear();
+      mOverrides.resize(qMax(16, old.size() * 2));
+      mNumOverrides = 0;
+      foreach (const Override& entry, old)
+      {
+        if (!entry.word.isEmpty())
+          addOverride(entry.word, entry.highlightType);
+      }
+    }
+
+    const ushort* data = word.utf16();
+    int mask = mOverrides.size() - 1;
+    int slot = builtin::hash(0, data, word.size()) & mask;
+    while (!mOverrides[slot].word.isEmpty() && mOverrides[slot].word != word)
+      slot = (slot + 1) & mask;
+
+    if (mOverrides[slot].word.isEmpty())
+      ++mNumOverrides;
+    mOverrides[slot].word = word;
+    mOverrides[slot].highlightType = highlightType;
+  } // addOverride
+
+  // ====================================================
+  //  FIND OVERRIDE
+  // ====================================================
+  const WordTable::Override* WordTable::findOverride(const QChar* data, int length) const
+  {
+    const ushort* chars = reinterpret_cast<const ushort*>(data);
+    int mask = mOverrides.size() - 1;
+    int slot = builtin::hash(0, chars, length) & mask;
+    while (!mOverrides[slot].word.isEmpty())
+    {
+      const Override& entry = mOverrides[slot];
+      if (entry.word.size() == length && memcmp(entry.word.constData(), data, length * sizeof(QChar)) == 0)
+        return &entry;
+      slot = (slot + 1) & mask;
+    }
+    return NULL;
+  } // findOverride
+
+  // ====================================================
+  //  CLASSIFY
+  // ====================================================
+  Atom WordTable::classify(const QChar* data, int length) const
+  {
+    if (mNumOverrides > 0)
+    {
+      const Override* entry = findOverride(data, length);
+      if (entry)
+        return entry->highlightType;
+    }
+
+    if (mpBuiltin)
+    {
+      const builtin::Word* word = builtin::find(*mpBuiltin, reinterpret_cast<const ushort*>(data), length);
+      if (word)
+        return mBuiltinTypes[word->highlight];
+    }
+
+    return Atom();
+  } // classify
 } // namespace config
\ No newline at end of file
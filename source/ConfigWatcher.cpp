@@ -0,0 +1,146 @@
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSet>
+#include <QtCore/QtConcurrentRun>
+#include "ConfigWatcher.h" // class definition
+#include "ConfigFile.h"
+#include "Trace.h"
+#include "Metrics.h"
+
+/// How long the watcher waits after a change on disk before it loads the
+/// rules again, in milliseconds, so an editor saving a file in several
+/// steps causes one reload
+static const int CONFIG_DELAY = 200;
+
+namespace config
+{
+  // Initialize Static Members
+  ConfigWatcher* ConfigWatcher::mpMe = NULL;
+
+  // ====================================================
+  //  INSTANCE (static)
+  // ====================================================
+  ConfigWatcher* ConfigWatcher::instance(void)
+  {
+    if (mpMe == NULL)
+      mpMe = new ConfigWatcher();
+    return mpMe;
+  } // instance
+
+  // ====================================================
+  //  CTOR
+  // ====================================================
+  ConfigWatcher::ConfigWatcher(void)
+    : mPending(false)
+  {
+    connect(&mReload, SIGNAL(finished()), this, SLOT(onReloadFinished()));
+    connect(&mWatcher, SIGNAL(directoryChanged(const QString&)), this, SLOT(onPathChanged(const QString&)));
+    connect(&mWatcher, SIGNAL(fileChanged(const QString&)), this, SLOT(onPathChanged(const QString&)));
+
+    mTimer.setSingleShot(true);
+    mTimer.setInterval(CONFIG_DELAY);
+    connect(&mTimer, SIGNAL(timeout()), this, SLOT(reload()));
+
+    syncWatches();
+  } // ctor
+
+  // ====================================================
+  //  IS RELOADING
+  // ====================================================
+  bool ConfigWatcher::isReloading(void) const
+  {
+    return mReload.isRunning();
+  } // isReloading
+
+  // ====================================================
+  //  RELOAD (slot)
+  // ====================================================
+  void ConfigWatcher::reload(void)
+  {
+    // One reload at a time; changes during it are picked up by another
+    if (mReload.isRunning())
+    {
+      mPending = true;
+      return;
+    }
+
+    // Most changes in the directories are to other files
+    ConfigFile* config = ConfigFile::instance();
+    QStringList files = config->getChangedFiles();
+    if (files.isEmpty())
+    {
+      syncWatches();
+      return;
+    }
+
+    mSinceReload.start();
+    mReload.setFuture(QtConcurrent::run(&ConfigWatcher::reloadFiles, config->clone(), files));
+  } // reload
+
+  // ====================================================
+  //  RELOAD FILES (static)
+  // ====================================================
+  ConfigWatcher::Reload ConfigWatcher::reloadFiles(ConfigFile* config, const QStringList& files)
+  {
+    TRACE_SCOPE("ConfigWatcher::reloadFiles");
+
+    Reload result;
+    result.config = config;
+    result.formats = config->reloadFiles(files);
+    return result;
+  } // reloadFiles
+
+  // ====================================================
+  //  ON RELOAD FINISHED (slot)
+  // ====================================================
+  void ConfigWatcher::onReloadFinished(void)
+  {
+    Reload result = mReload.result();
+    ConfigFile::instance()->replaceWith(result.config);
+    syncWatches();
+
+    metrics::Registry::instance()->metric("config.reload_ms")->sample(mSinceReload.nsecsElapsed() / 1000000.0);
+    emit changed(result.formats);
+
+    if (mPending)
+    {
+      mPending = false;
+      reload();
+    }
+  } // onReloadFinished
+
+  // ====================================================
+  //  ON PATH CHANGED (slot)
+  // ====================================================
+  void ConfigWatcher::onPathChanged(const QString& path)
+  {
+    Q_UNUSED(path);
+    mTimer.start();
+  } // onPathChanged
+
+  // ====================================================
+  //  SYNC WATCHES
+  // ====================================================
+  void ConfigWatcher::syncWatches(void)
+  {
+    // A file that is saved by replacing it drops out of the watcher, and
+    // one that doesn't exist yet can't be watched, so their directories are
+    QSet<QString> wanted;
+    foreach (const QString& file, ConfigFile::instance()->getSourceFiles())
+    {
+      QFileInfo fi(file);
+      if (fi.exists())
+        wanted.insert(file);
+      if (fi.absoluteDir().exists())
+        wanted.insert(fi.absolutePath());
+    }
+    QSet<QString> watched = mWatcher.directories().toSet() + mWatcher.files().toSet();
+
+    QStringList added = (wanted - watched).toList();
+    QStringList removed = (watched - wanted).toList();
+    if (!removed.isEmpty())
+      mWatcher.removePaths(removed);
+    if (!added.isEmpty())
+      mWatcher.addPaths(added);
+  } // syncWatches
+}
\ No newline at end of file
@@ -0,0 +1,539 @@
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSet>
+#include <QtCore/QtConcurrentMap>
+#include "DependencyGraph.h" // class definition
+#include "ResourceResolver.h"
+#include "ScriptParser.h"
+#include "Trace.h"
+
+/// Identifies a saved dependency graph
+static const quint32 GRAPH_MAGIC = 0x4d444550;  // "MDEP"
+
+/// Changed whenever the layout of a saved graph does
+static const quint32 GRAPH_VERSION = 1;
+
+/// Names of the kinds of node, as the command line takes them
+static const char* const KIND_NAMES[] =
+{
+  "file", "material", "vertex_program", "fragment_program", "texture", "overlay"
+};
+static const int NUM_KINDS = sizeof(KIND_NAMES) / sizeof(KIND_NAMES[0]);
+
+// ====================================================
+//  MAKE NODE (local)
+// ====================================================
+static DependencyNode makeNode(DependencyKind kind, const QString& name)
+{
+  // Textures are files, which are found regardless of case
+  DependencyNode node;
+  node.kind = kind;
+  node.name = (kind == DEPENDENCY_TEXTURE ? name.toLower() : name);
+  return node;
+} // makeNode
+
+// ====================================================
+//  ADD EDGE (local)
+// ====================================================
+static void addEdge(QVector<DependencyEdge>& out, const DependencyNode& from, const DependencyNode& to)
+{
+  DependencyEdge edge;
+  edge.from = from;
+  edge.to = to;
+  out.push_back(edge);
+} // addEdge
+
+// ====================================================
+//  ADD REFERENCES (local)
+// ====================================================
+/** Adds an edge from \e owner to everything the statements under \e parent
+ * refer to. */
+static void addReferences(const script::Node* parent, const DependencyNode& owner, QVector<DependencyEdge>& out)
+{
+  for (const script::Node* node = parent->firstChild; node; node = node->next)
+  {
+    ResourceKind kind;
+    if (!node->name().isEmpty() && ResourceIndex::referenceKind(node->keyword.toString(), kind))
+    {
+      DependencyKind to = DEPENDENCY_MATERIAL;
+      if (kind == RESOURCE_TEXTURE)
+        to = DEPENDENCY_TEXTURE;
+      else if (kind == RESOURCE_VERTEX_PROGRAM)
+        to = DEPENDENCY_VERTEX_PROGRAM;
+      else if (kind == RESOURCE_FRAGMENT_PROGRAM)
+        to = DEPENDENCY_FRAGMENT_PROGRAM;
+      addEdge(out, owner, makeNode(to, node->name().toString()));
+    }
+    addReferences(node, owner, out);
+  }
+} // addReferences
+
+// ====================================================
+//  READ EDGES (local)
+// ====================================================
+/** Reads the edges of a script on one of QtConcurrent's threads. */
+struct ReadEdges
+{
+  typedef QVector<DependencyEdge> result_type;
+
+  QVector<DependencyEdge> operator()(const QString& path) const
+  {
+    QVector<DependencyEdge> edges;
+    script::ScriptFile file;
+    if (file.open(path))
+      DependencyGraph::findEdges(file.root(), path, edges);
+    return edges;
+  }
+};
+
+// ====================================================
+//  TO STRING
+// ====================================================
+QString DependencyNode::toString(void) const
+{
+  return QString("%1:%2").arg(KIND_NAMES[kind], name);
+} // toString
+
+// ====================================================
+//  FROM STRING (static)
+// ====================================================
+bool DependencyNode::fromString(const QString& text, DependencyNode& node)
+{
+  int colon = text.indexOf(':');
+  for (int i = 0; colon > 0 && i < NUM_KINDS; ++i)
+  {
+    if (text.left(colon) == KIND_NAMES[i])
+    {
+      node = makeNode(static_cast<DependencyKind>(i), text.mid(colon + 1));
+      return true;
+    }
+  }
+  return false;
+} // fromString
+
+// ====================================================
+//  CTOR
+// ====================================================
+DependencyGraph::DependencyGraph(void)
+  : mEdgeCount(0), mModified(false)
+{
+} // ctor
+
+// ====================================================
+//  SET DIRECTORIES
+// ====================================================
+void DependencyGraph::setDirectories(const QStringList& directories)
+{
+  QStringList cleaned;
+  foreach (const QString& directory, directories)
+    cleaned << QDir::cleanPath(QDir::current().absoluteFilePath(directory));
+  if (cleaned == mDirectories)
+    return;
+
+  mDirectories = cleaned;
+  mFiles.clear();
+  mIds.clear();
+  mNodes.clear();
+  mDependencies.clear();
+  mDependents.clear();
+  mEdgeCount = 0;
+  mModified = true;
+} // setDirectories
+
+// ====================================================
+//  DIRECTORIES
+// ====================================================
+const QStringList& DependencyGraph::directories(void) const
+{
+  return mDirectories;
+} // directories
+
+// ====================================================
+//  REFRESH
+// ====================================================
+int DependencyGraph::refresh(void)
+{
+  TRACE_SCOPE("DependencyGraph::refresh");
+
+  // Time stamps and sizes come with the listing, so nothing is read unless
+  // it changed
+  QSet<QString> present;
+  QStringList changed;
+  QVector<FileEntry> stamps;
+  foreach (const QString& directory, mDirectories)
+  {
+    QDirIterator it(directory, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+      QString path = it.next();
+      if (!isScript(path) || present.contains(path))
+        continue;
+      present.insert(path);
+
+      FileEntry stamp;
+      stamp.modified = it.fileInfo().lastModified().toMSecsSinceEpoch();
+      stamp.size = it.fileInfo().size();
+      QHash<QString, FileEntry>::const_iterator citr = mFiles.find(path);
+      if (citr == mFiles.end() || citr->modified != stamp.modified || citr->size != stamp.size)
+      {
+        changed << path;
+        stamps.push_back(stamp);
+      }
+    }
+  }
+
+  QStringList removed;
+  QHash<QString, FileEntry>::const_iterator citr = mFiles.begin();
+  for (; citr != mFiles.end(); ++citr)
+  {
+    if (!present.contains(citr.key()))
+      removed << citr.key();
+  }
+  foreach (const QString& path, removed)
+    removeFile(path);
+
+  QList<QVector<DependencyEdge> > edges = QtConcurrent::blockingMapped<QList<QVector<DependencyEdge> > >(changed, ReadEdges());
+  for (int i = 0; i < changed.size(); ++i)
+  {
+    stamps[i].edges = edges[i];
+    removeFile(changed[i]);
+    addFile(changed[i], stamps[i]);
+  }
+  return changed.size() + removed.size();
+} // refresh
+
+// ====================================================
+//  SET FILE
+// ====================================================
+void DependencyGraph::setFile(const QString& path, const FileEntry& entry)
+{
+  removeFile(path);
+  addFile(path, entry);
+} // setFile
+
+// ====================================================
+//  HAS FILE
+// ====================================================
+bool DependencyGraph::hasFile(const QString& path) const
+{
+  return mFiles.contains(path);
+} // hasFile
+
+// ====================================================
+//  LOAD
+// ====================================================
+bool DependencyGraph::load(const QString& path)
+{
+  TRACE_SCOPE("DependencyGraph::load");
+
+  QFile file(path);
+  if (!file.open(QFile::ReadOnly))
+    return false;
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_4_6);
+
+  quint32 magic, version;
+  QStringList directories;
+  qint32 count;
+  stream >> magic >> version >> directories >> count;
+  if (stream.status() != QDataStream::Ok || magic != GRAPH_MAGIC || version != GRAPH_VERSION || count < 0)
+    return false;
+
+  DependencyGraph graph;
+  graph.mDirectories = directories;
+  for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+  {
+    QString path;
+    FileEntry entry;
+    qint32 numEdges;
+    stream >> path >> entry.modified >> entry.size >> numEdges;
+    for (int e = 0; e < numEdges && stream.status() == QDataStream::Ok; ++e)
+    {
+      qint32 fromKind, toKind;
+      DependencyEdge edge;
+      stream >> fromKind >> edge.from.name >> toKind >> edge.to.name;
+      if (fromKind < 0 || fromKind >= NUM_KINDS || toKind < 0 || toKind >= NUM_KINDS)
+        return false;
+      edge.from.kind = static_cast<DependencyKind>(fromKind);
+      edge.to.kind = static_cast<DependencyKind>(toKind);
+      entry.edges.push_back(edge);
+    }
+    graph.addFile(path, entry);
+  }
+
+  if (stream.status() != QDataStream::Ok)
+    return false;
+
+  *this = graph;
+  mModified = false;
+  return true;
+} // load
+
+// ====================================================
+//  SAVE
+// ====================================================
+bool DependencyGraph::save(const QString& path)
+{
+  TRACE_SCOPE("DependencyGraph::save");
+
+  // Written next to the last good graph and then swapped in, as sessions are
+  QString temp = path + ".saving";
+  QFile file(temp);
+  if (!file.open(QFile::WriteOnly | QFile::Truncate))
+    return false;
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_4_6);
+  stream << GRAPH_MAGIC << GRAPH_VERSION << mDirectories << static_cast<qint32>(mFiles.size());
+
+  QHash<QString, FileEntry>::const_iterator citr = mFiles.begin();
+  for (; citr != mFiles.end(); ++citr)
+  {
+    stream << citr.key() << citr->modified << citr->size << static_cast<qint32>(citr->edges.size());
+    foreach (const DependencyEdge& edge, citr->edges)
+      stream << static_cast<qint32>(edge.from.kind) << edge.from.name << static_cast<qint32>(edge.to.kind) << edge.to.name;
+  }
+
+  bool written = (stream.status() == QDataStream::Ok && file.error() == QFile::NoError);
+  file.close();
+  if (written)
+  {
+    QFile::remove(path);
+    written = QFile::rename(temp, path);
+  }
+  if (!written)
+    QFile::remove(temp);
+  else
+    mModified = false;
+  return written;
+} // save
+
+// ====================================================
+//  IS MODIFIED
+// ====================================================
+bool DependencyGraph::isModified(void) const
+{
+  return mModified;
+} // isModified
+
+// ====================================================
+//  AFFECTED BY
+// ====================================================
+void DependencyGraph::affectedBy(const DependencyNode& node, QVector<DependencyNode>& out) const
+{
+  walk(mDependents, node, out);
+} // affectedBy
+
+// ====================================================
+//  DEPENDENCIES OF
+// ====================================================
+void DependencyGraph::dependenciesOf(const DependencyNode& node, QVector<DependencyNode>& out) const
+{
+  walk(mDependencies, node, out);
+} // dependenciesOf
+
+// ====================================================
+//  DEFINING FILES
+// ====================================================
+QStringList DependencyGraph::definingFiles(const QVector<DependencyNode>& nodes) const
+{
+  QStringList files;
+  QSet<int> seen;
+  foreach (const DependencyNode& node, nodes)
+  {
+    int id = findId(node);
+    if (id < 0)
+      continue;
+
+    // What a node is defined in is among what it depends on directly
+    QHash<int, int>::const_iterator citr = mDependencies[id].begin();
+    for (; citr != mDependencies[id].end(); ++citr)
+    {
+      if (mNodes[citr.key()].kind == DEPENDENCY_FILE && !seen.contains(citr.key()))
+      {
+        seen.insert(citr.key());
+        files << mNodes[citr.key()].name;
+      }
+    }
+  }
+  return files;
+} // definingFiles
+
+// ====================================================
+//  FILE COUNT
+// ====================================================
+int DependencyGraph::fileCount(void) const
+{
+  return mFiles.size();
+} // fileCount
+
+// ====================================================
+//  EDGE COUNT
+// ====================================================
+int DependencyGraph::edgeCount(void) const
+{
+  return mEdgeCount;
+} // edgeCount
+
+// ====================================================
+//  IS SCRIPT (static)
+// ====================================================
+bool DependencyGraph::isScript(const QString& path)
+{
+  return path.endsWith(".material", Qt::CaseInsensitive) || path.endsWith(".program", Qt::CaseInsensitive) ||
+         path.endsWith(".overlay", Qt::CaseInsensitive);
+} // isScript
+
+// ====================================================
+//  READ FILE (static)
+// ====================================================
+bool DependencyGraph::readFile(const QString& path, const script::Node* root, FileEntry& out)
+{
+  QFileInfo info(path);
+  if (!info.exists() || !isScript(path))
+    return false;
+
+  out.modified = info.lastModified().toMSecsSinceEpoch();
+  out.size = info.size();
+  out.edges.clear();
+  if (root)
+    findEdges(root, path, out.edges);
+  return true;
+} // readFile
+
+// ====================================================
+//  FIND EDGES (static)
+// ====================================================
+void DependencyGraph::findEdges(const script::Node* root, const QString& path, QVector<DependencyEdge>& out)
+{
+  if (root == NULL)
+    return;
+
+  DependencyNode file = makeNode(DEPENDENCY_FILE, path);
+  for (const script::Node* node = root->firstChild; node; node = node->next)
+  {
+    // What the script defines depends on the script, and owns what is
+    // referred to inside it.  Anything else at the top level is owned by
+    // the script itself.
+    DependencyNode owner = file;
+    if (node->keyword == "material")
+      owner = makeNode(DEPENDENCY_MATERIAL, node->name().toString());
+    else if (node->keyword == "vertex_program")
+      owner = makeNode(DEPENDENCY_VERTEX_PROGRAM, node->name().toString());
+    else if (node->keyword == "fragment_program")
+      owner = makeNode(DEPENDENCY_FRAGMENT_PROGRAM, node->name().toString());
+    else if (node->keyword == "overlay")
+      owner = makeNode(DEPENDENCY_OVERLAY, node->name().toString());
+
+    if (owner.name.isEmpty())
+      owner = file;
+    if (owner.kind != DEPENDENCY_FILE)
+      addEdge(out, owner, file);
+    if (owner.kind == DEPENDENCY_MATERIAL && !node->inherits.isEmpty())
+      addEdge(out, owner, makeNode(DEPENDENCY_MATERIAL, node->inherits.toString()));
+    addReferences(node, owner, out);
+  }
+} // findEdges
+
+// ====================================================
+//  FIND ID
+// ====================================================
+int DependencyGraph::findId(const DependencyNode& node) const
+{
+  return mIds.value(QString::number(node.kind) + ':' + node.name, -1);
+} // findId
+
+// ====================================================
+//  ADD NODE
+// ====================================================
+int DependencyGraph::addNode(const DependencyNode& node)
+{
+  QString key = QString::number(node.kind) + ':' + node.name;
+  QHash<QString, int>::const_iterator citr = mIds.find(key);
+  if (citr != mIds.end())
+    return *citr;
+
+  // Nodes are never taken out; saving and loading again drops unused ones
+  int id = mNodes.size();
+  mIds.insert(key, id);
+  mNodes.push_back(node);
+  mDependencies.push_back(QHash<int, int>());
+  mDependents.push_back(QHash<int, int>());
+  return id;
+} // addNode
+
+// ====================================================
+//  ADD FILE
+// ====================================================
+void DependencyGraph::addFile(const QString& path, const FileEntry& entry)
+{
+  mFiles.insert(path, entry);
+  foreach (const DependencyEdge& edge, entry.edges)
+  {
+    int from = addNode(edge.from);
+    int to = addNode(edge.to);
+    if (mDependencies[from][to]++ == 0)
+      ++mEdgeCount;
+    ++mDependents[to][from];
+  }
+  mModified = true;
+} // addFile
+
+// ====================================================
+//  REMOVE FILE
+// ====================================================
+void DependencyGraph::removeFile(const QString& path)
+{
+  QHash<QString, FileEntry>::iterator itr = mFiles.find(path);
+  if (itr == mFiles.end())
+    return;
+
+  foreach (const DependencyEdge& edge, itr->edges)
+  {
+    int from = findId(edge.from);
+    int to = findId(edge.to);
+    if (--mDependencies[from][to] == 0)
+    {
+      mDependencies[from].remove(to);
+      --mEdgeCount;
+    }
+    if (--mDependents[to][from] == 0)
+      mDependents[to].remove(from);
+  }
+  mFiles.erase(itr);
+  mModified = true;
+} // removeFile
+
+// ====================================================
+//  WALK
+// ====================================================
+void DependencyGraph::walk(const QVector<QHash<int, int> >& edges, const DependencyNode& node, QVector<DependencyNode>& out) const
+{
+  int start = findId(node);
+  if (start < 0)
+    return;
+
+  // Breadth first, touching only the nodes that are in the answer and the
+  // edges between them
+  QSet<int> seen;
+  seen.insert(start);
+  QVector<int> queue(1, start);
+  for (int i = 0; i < queue.size(); ++i)
+  {
+    QHash<int, int>::const_iterator citr = edges[queue[i]].begin();
+    for (; citr != edges[queue[i]].end(); ++citr)
+    {
+      if (!seen.contains(citr.key()))
+      {
+        seen.insert(citr.key());
+        queue.push_back(citr.key());
+        out.push_back(mNodes[citr.key()]);
+      }
+    }
+  }
+} // walk
\ No newline at end of file
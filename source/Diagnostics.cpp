@@ -0,0 +1,531 @@
+#include <QtGui/QtGui>
+#include <QtCore/QtConcurrentRun>
+#include "Diagnostics.h" // class definition
+#include "TextEditor.h"
+#include "Trace.h"
+#include "Metrics.h"
+
+/// How long after an edit the lines it touched are copied out to be
+/// checked, in milliseconds.  Checking itself takes a few milliseconds.
+static const int DIAGNOSTICS_DELAY = 50;
+
+// ====================================================
+//  CONTEXT OF (local)
+// ====================================================
+/** @returns The highlighter's state of the block before \e block, which
+ * changes whenever the scopes \e block is in do. */
+static int contextOf(const QTextBlock& block)
+{
+  QTextBlock previous = block.previous();
+  return (previous.isValid() ? previous.userState() : 0);
+} // contextOf
+
+// ====================================================
+//  IS IDENTIFIER (local)
+// ====================================================
+/** @returns TRUE if the word could be a keyword.  Numbers, paths and the
+ * like that start a line are left alone. */
+static bool isIdentifier(const QChar* data, int length)
+{
+  if (length == 0 || !(data[0].isLetter() || data[0] == '_'))
+    return false;
+  for (int i = 1; i < length; ++i)
+  {
+    if (!(data[i].isLetterOrNumber() || data[i] == '_'))
+      return false;
+  }
+  return true;
+} // isIdentifier
+
+// ====================================================
+//  JOIN SCOPES (local)
+// ====================================================
+static QString joinScopes(const QVector<Atom>& scopes)
+{
+  QStringList names;
+  foreach (Atom scope, scopes)
+    names << scope.toString();
+  return names.join(" or ");
+} // joinScopes
+
+// ====================================================
+//  SUGGESTIONS FOR (local)
+// ====================================================
+/** @returns The keywords nearest to \e word, as the end of a message, or an
+ * empty string if none are near enough to be what was meant. */
+static QString suggestionsFor(const QString& word, const config::SuggestionIndex& index)
+{
+  QVector<int> nearest;
+  index.suggest(word, nearest, 3);
+  if (nearest.isEmpty())
+    return QString();
+
+  // Only the ones as near as the nearest; the rest are rarely what was meant
+  const QStringList& words = index.words();
+  int best = config::SuggestionIndex::distance(word.toLower(), words[nearest[0]]);
+  QStringList names;
+  foreach (int i, nearest)
+  {
+    if (config::SuggestionIndex::distance(word.toLower(), words[i]) == best)
+      names << QString("'%1'").arg(words[i]);
+  }
+  return QString(" - did you mean %1?").arg(names.join(" or "));
+} // suggestionsFor
+
+// ====================================================
+//  NEXT ARGUMENT (local)
+// ====================================================
+/** Finds the next argument of a statement.  Quotes aren't part of a
+ * quoted argument.
+ * @returns FALSE if the statement has no more arguments. */
+static bool nextArgument(const QChar* data, ScriptTokenizer& tokens, int& start, int& end)
+{
+  ScriptTokenizer::Token token = tokens.next();
+  if (token != ScriptTokenizer::TOKEN_WORD && token != ScriptTokenizer::TOKEN_STRING)
+    return false;
+
+  start = tokens.start();
+  end = tokens.end();
+  if (token == ScriptTokenizer::TOKEN_STRING)
+  {
+    ++start;
+    if (end > start && data[end - 1] == '"')
+      --end;
+  }
+  return true;
+} // nextArgument
+
+// ====================================================
+//  CHECK REFERENCE (local)
+// ====================================================
+/** Checks that what a statement refers to can be found.
+ * @param keyword The keyword starting the statement.
+ * @param tokens The line, read as far as the keyword. */
+static void checkReference(const QString& keyword, const QChar* data, ScriptTokenizer tokens, bool topLevel,
+                           const DiagnosticJob& job, QVector<Diagnostic>& diagnostics)
+{
+  ResourceKind kind;
+  if (!ResourceIndex::referenceKind(keyword, kind))
+    return;
+
+  int start, end;
+  if (!nextArgument(data, tokens, start, end))
+    return;
+
+  // A material at the top level refers to the parent after its ':'
+  if (kind == RESOURCE_MATERIAL && topLevel)
+  {
+    if (!nextArgument(data, tokens, start, end) || QString(data + start, end - start) != ":" ||
+        !nextArgument(data, tokens, start, end))
+      return;
+  }
+
+  ResourceReference reference;
+  reference.kind = kind;
+  reference.name = QString(data + start, end - start);
+  if (reference.name.isEmpty() || job.resources.resolve(reference) ||
+      (kind == RESOURCE_MATERIAL && job.materials.contains(reference.name)))
+    return;
+
+  Diagnostic diagnostic;
+  diagnostic.kind = Diagnostic::UNRESOLVED_NAME;
+  diagnostic.start = start;
+  diagnostic.length = end - start;
+  diagnostic.word = reference.name;
+  diagnostic.message = ResourceIndex::describeUnresolved(reference);
+  diagnostics.push_back(diagnostic);
+} // checkReference
+
+// ====================================================
+//  CHECK LINE (local)
+// ====================================================
+/** Checks a line and advances the scope state over it.  The line is read
+ * with the same ScriptTokenizer as ScopeState::scan() reads it, so the
+ * scopes agree with the highlighter's.  \e scopes holds every scope some
+ * word of the format belongs in. */
+static void checkLine(const QString& text, ScopeState& state, const DiagnosticJob& job, const QSet<Atom>& scopes,
+                      QVector<Diagnostic>& diagnostics)
+{
+  const QChar* data = text.constData();
+  ScriptTokenizer tokens(data, text.size(), state.inComment);
+  bool atStart = true;
+
+  for (ScriptTokenizer::Token token = tokens.next(); token != ScriptTokenizer::TOKEN_END; token = tokens.next())
+  {
+    if (token == ScriptTokenizer::TOKEN_STRING)
+    {
+      atStart = false;
+    }
+    else if (token == ScriptTokenizer::TOKEN_OPEN)
+    {
+      state.stack.push_back(state.pending);
+      state.pending = Atom();
+      atStart = true;
+    }
+    else if (token == ScriptTokenizer::TOKEN_CLOSE)
+    {
+      if (state.stack.isEmpty())
+      {
+        Diagnostic diagnostic;
+        diagnostic.kind = Diagnostic::UNMATCHED_BRACE;
+        diagnostic.start = tokens.start();
+        diagnostic.length = 1;
+        diagnostic.word = "}";
+        diagnostic.message = "'}' has no matching '{'";
+        diagnostics.push_back(diagnostic);
+      }
+      else
+      {
+        state.stack.pop_back();
+      }
+      state.pending = Atom();
+      atStart = true;
+    }
+    else if (atStart)
+    {
+      int start = tokens.start();
+      int length = tokens.end() - start;
+      atStart = false;
+      state.pending = Atom::find(data + start, length);
+
+      // Nothing can be said about the insides of blocks the format has no
+      // words for, such as an overlay template or a named overlay, or about
+      // formats without words
+      Atom scope = (state.stack.isEmpty() ? job.script : state.stack.last());
+      if (!scopes.contains(scope) || !isIdentifier(data + start, length))
+        continue;
+
+      QString word(data + start, length);
+      config::FormatWordMap::const_iterator citr = job.words.find(word);
+      Diagnostic diagnostic;
+      diagnostic.start = start;
+      diagnostic.length = length;
+      diagnostic.word = word;
+
+      if (citr == job.words.end())
+      {
+        // A word on its own at the top level names a block, as in overlay
+        // scripts, rather than being a keyword
+        ScriptTokenizer after = tokens;
+        ScriptTokenizer::Token next = after.next();
+        bool alone = (next == ScriptTokenizer::TOKEN_END || next == ScriptTokenizer::TOKEN_OPEN);
+        if (state.stack.isEmpty() && alone)
+          continue;
+
+        diagnostic.kind = Diagnostic::UNKNOWN_KEYWORD;
+        diagnostic.message = QString("Unknown keyword '%1'").arg(word) + suggestionsFor(word, job.suggestions);
+        diagnostics.push_back(diagnostic);
+      }
+      else if (!citr->scopes.isEmpty() && !citr->scopes.contains(scope))
+      {
+        diagnostic.kind = Diagnostic::WRONG_SCOPE;
+        diagnostic.message = QString("'%1' belongs in %2, not %3").arg(word, joinScopes(citr->scopes), scope.toString());
+        diagnostics.push_back(diagnostic);
+      }
+      else if (!job.resources.isEmpty())
+      {
+        checkReference(word, data, tokens, state.stack.isEmpty(), job, diagnostics);
+      }
+    }
+  }
+  state.inComment = tokens.inBlockComment();
+} // checkLine
+
+// ====================================================
+//  CTOR
+// ====================================================
+Diagnostics::Diagnostics(TextEditor* editor)
+  : QObject(editor), mpEditor(editor), mEditedSince(-1), mDirtyFrom(-1), mDirtyTo(-1)
+{
+  // The highlighter is connected first, so block states are up to date by
+  // the time edits get here
+  connect(mpEditor->document(), SIGNAL(contentsChange(int, int, int)), this, SLOT(onContentsChange(int, int, int)));
+  connect(&mWatcher, SIGNAL(finished()), this, SLOT(onFinished()));
+  connect(ResourceResolver::instance(), SIGNAL(changed()), this, SLOT(revalidate()));
+
+  mTimer.setSingleShot(true);
+  mTimer.setInterval(DIAGNOSTICS_DELAY);
+  connect(&mTimer, SIGNAL(timeout()), this, SLOT(post()));
+} // ctor
+
+// ====================================================
+//  DTOR
+// ====================================================
+Diagnostics::~Diagnostics(void)
+{
+  // A check that's still running works on its own copy of the lines, so it
+  // is left to finish and its results dropped
+  disconnect(&mWatcher, NULL, this, NULL);
+} // dtor
+
+// ====================================================
+//  CHECK (static)
+// ====================================================
+DiagnosticResult Diagnostics::check(const DiagnosticJob& job)
+{
+  TRACE_SCOPE("Diagnostics::check");
+
+  DiagnosticResult result;
+  result.firstBlock = job.firstBlock;
+  result.lines.resize(job.lines.size());
+
+  // The scopes the format has words for
+  QSet<Atom> scopes;
+  config::FormatWordMap::const_iterator citr = job.words.begin();
+  for (; citr != job.words.end(); ++citr)
+  {
+    foreach (Atom scope, citr->scopes)
+      scopes.insert(scope);
+  }
+
+  ScopeState state = job.state;
+  for (int i = 0; i < job.lines.size(); ++i)
+    checkLine(job.lines[i], state, job, scopes, result.lines[i]);
+  result.state = state;
+  return result;
+} // check
+
+// ====================================================
+//  REVALIDATE (slot)
+// ====================================================
+void Diagnostics::revalidate(void)
+{
+  markDirty(0, mpEditor->document()->characterCount());
+} // revalidate
+
+// ====================================================
+//  IS PENDING
+// ====================================================
+bool Diagnostics::isPending(void) const
+{
+  return mDirtyFrom >= 0 || mWatcher.isRunning();
+} // isPending
+
+// ====================================================
+//  COUNT
+// ====================================================
+int Diagnostics::count(void) const
+{
+  int total = 0;
+  for (QTextBlock block = mpEditor->document()->begin(); block.isValid(); block = block.next())
+  {
+    BlockData* data = Highlighter::blockData(block);
+    if (data)
+      total += data->diagnostics.size();
+  }
+  return total;
+} // count
+
+// ====================================================
+//  MARK DIRTY
+// ====================================================
+void Diagnostics::markDirty(int from, int to)
+{
+  if (mDirtyFrom < 0)
+  {
+    mDirtyFrom = from;
+    mDirtyTo = to;
+    if (!mWatcher.isRunning())
+      mSinceEdit.start();
+  }
+  else
+  {
+    mDirtyFrom = qMin(mDirtyFrom, from);
+    mDirtyTo = qMax(mDirtyTo, to);
+  }
+  mTimer.start();
+} // markDirty
+
+// ====================================================
+//  ON CONTENTS CHANGE (slot)
+// ====================================================
+void Diagnostics::onContentsChange(int position, int removed, int added)
+{
+  // Results for anything from here on can't be trusted any more
+  if (mWatcher.isRunning())
+    mEditedSince = (mEditedSince < 0 ? position : qMin(mEditedSince, position));
+
+  // Keep the end of the waiting range where it was in the text, unless the
+  // edit removed it or reaches past it
+  if (mDirtyFrom >= 0)
+  {
+    if (mDirtyTo >= position + removed)
+      mDirtyTo += added - removed;
+    else
+      mDirtyTo = position + added;
+  }
+  markDirty(position, position + added);
+} // onContentsChange
+
+// ====================================================
+//  POST (slot)
+// ====================================================
+void Diagnostics::post(void)
+{
+  if (mDirtyFrom < 0 || mWatcher.isRunning())
+    return;
+
+  TRACE_SCOPE("Diagnostics::post");
+
+  DiagnosticJob job;
+  job.script = Atom::intern("script");
+  job.words = config::ConfigFile::instance()->getWordsByFormat(mpEditor->fileFormat());
+  job.suggestions = config::ConfigFile::instance()->getSuggestionsByFormat(mpEditor->fileFormat());
+  job.resources = ResourceResolver::instance()->index();
+  if (!job.resources.isEmpty())
+    job.materials = mpEditor->highlighter()->nameIndex();
+
+  QTextDocument* doc = mpEditor->document();
+  QTextBlock first = doc->findBlock(mDirtyFrom);
+  QTextBlock last = doc->findBlock(mDirtyTo);
+  if (!first.isValid())
+    first = doc->lastBlock();
+  if (!last.isValid())
+    last = doc->lastBlock();
+  mDirtyFrom = -1;
+
+  // Carry on past the edits for as long as the scopes lines are in have
+  // changed since they were checked
+  while (last.next().isValid())
+  {
+    BlockData* data = Highlighter::blockData(last.next());
+    if (data && data->checkedContext == contextOf(last.next()))
+      break;
+    last = last.next();
+  }
+
+  BlockData* previous = Highlighter::blockData(first.previous());
+  if (previous)
+    job.state = previous->state;
+  job.firstBlock = first.blockNumber();
+  for (QTextBlock block = first; block.isValid(); block = block.next())
+  {
+    job.lines.push_back(block.text());
+    job.contexts.push_back(contextOf(block));
+    if (block == last)
+      break;
+  }
+
+  mContexts = job.contexts;
+  mJobEnd = QTextCursor(last);
+  mJobEnd.movePosition(QTextCursor::EndOfBlock);
+  mEditedSince = -1;
+  mWatcher.setFuture(QtConcurrent::run(&Diagnostics::check, job));
+} // post
+
+// ====================================================
+//  ON FINISHED (slot)
+// ====================================================
+void Diagnostics::onFinished(void)
+{
+  TRACE_SCOPE("Diagnostics::onFinished");
+
+  DiagnosticResult result = mWatcher.result();
+  QTextDocument* doc = mpEditor->document();
+  Highlighter* highlighter = mpEditor->highlighter();
+  bool changed = false;
+
+  QTextBlock block = doc->findBlockByNumber(result.firstBlock);
+  for (int i = 0; i < result.lines.size() && block.isValid(); ++i, block = block.next())
+  {
+    // Blocks from the first edit made while checking may have moved or
+    // changed, so they go back to be checked again
+    if (mEditedSince >= 0 && block.position() + block.length() > mEditedSince)
+    {
+      markDirty(block.position(), mJobEnd.position());
+      break;
+    }
+
+    BlockData* data = Highlighter::blockData(block);
+    if (data == NULL)
+      continue;
+
+    data->checkedContext = mContexts[i];
+    data->checkedText = qHash(block.text());
+    if (!(data->diagnostics == result.lines[i]))
+    {
+      data->diagnostics = result.lines[i];
+      highlighter->rehighlightBlock(block);
+      changed = true;
+    }
+  }
+  mEditedSince = -1;
+
+  if (mDirtyFrom < 0)
+  {
+    static metrics::Metric* latency = metrics::Registry::instance()->metric("diagnostics.latency_ms");
+    latency->sample(mSinceEdit.nsecsElapsed() / 1000000.0);
+  }
+
+  updateUnclosedBrace();
+  if (changed)
+    emit changed();
+
+  // Anything edited while checking was held back until now
+  if (mDirtyFrom >= 0)
+    post();
+} // onFinished
+
+// ====================================================
+//  UPDATE UNCLOSED BRACE
+// ====================================================
+void Diagnostics::updateUnclosedBrace(void)
+{
+  QTextDocument* doc = mpEditor->document();
+  BlockData* last = Highlighter::blockData(doc->lastBlock());
+  int depth = (last ? last->state.stack.size() : 0);
+
+  // The innermost brace still open is on the last block that had less open
+  // before it
+  QTextBlock brace;
+  if (depth > 0)
+  {
+    brace = doc->lastBlock();
+    while (brace.previous().isValid())
+    {
+      BlockData* previous = Highlighter::blockData(brace.previous());
+      if (previous == NULL || previous->state.stack.size() < depth)
+        break;
+      brace = brace.previous();
+    }
+  }
+
+  // Take the report off the block that had it.  Checking that block again
+  // replaces its diagnostics, so the report may be gone already.
+  QTextBlock old = (mUnclosed.isNull() ? QTextBlock() : mUnclosed.block());
+  BlockData* data = (old.isValid() ? Highlighter::blockData(old) : NULL);
+  bool reported = false;
+  if (data)
+  {
+    for (int i = data->diagnostics.size() - 1; i >= 0; --i)
+    {
+      if (data->diagnostics[i].kind == Diagnostic::UNCLOSED_BRACE)
+      {
+        if (old == brace)
+          return;
+        data->diagnostics.remove(i);
+        reported = true;
+      }
+    }
+    if (reported)
+      mpEditor->highlighter()->rehighlightBlock(old);
+  }
+  mUnclosed = QTextCursor();
+
+  data = (brace.isValid() ? Highlighter::blockData(brace) : NULL);
+  if (data)
+  {
+    Diagnostic diagnostic;
+    diagnostic.kind = Diagnostic::UNCLOSED_BRACE;
+    diagnostic.start = qMax(0, brace.text().lastIndexOf('{'));
+    diagnostic.length = 1;
+    diagnostic.word = "{";
+    diagnostic.message = "'{' is never closed";
+    data->diagnostics.push_back(diagnostic);
+    mpEditor->highlighter()->rehighlightBlock(brace);
+    mUnclosed = QTextCursor(brace);
+  }
+
+  if (reported || brace.isValid())
+    emit changed();
+} // updateUnclosedBrace
\ No newline at end of file
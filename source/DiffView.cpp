@@ -0,0 +1,71 @@
+#include <QtGui/QtGui>
+#include "DiffView.h" // class definition
+#include "TextEditor.h"
+#include "Trace.h"
+
+// ====================================================
+//  CTOR
+// ====================================================
+DiffView::DiffView(QWidget* parent)
+  : QTreeWidget(parent)
+{
+  setRootIsDecorated(false);
+  setUniformRowHeights(true);
+  setHeaderLabels(QStringList() << "Line" << "Difference");
+  connect(this, SIGNAL(itemClicked(QTreeWidgetItem*, int)), this, SLOT(onItemClicked(QTreeWidgetItem*, int)));
+} // ctor
+
+// ====================================================
+//  SET EDITOR (slot)
+// ====================================================
+void DiffView::setEditor(TextEditor* editor)
+{
+  // The differences are of the document that was current
+  if (editor != mpEditor)
+    clear();
+  mpEditor = editor;
+} // setEditor
+
+// ====================================================
+//  SET CHANGES (slot)
+// ====================================================
+void DiffView::setChanges(const QString& title, const QVector<ScriptChange>& changes)
+{
+  TRACE_SCOPE("DiffView::setChanges");
+
+  clear();
+  setHeaderLabels(QStringList() << "Line" << title);
+
+  QList<QTreeWidgetItem*> items;
+  foreach (const ScriptChange& change, changes)
+  {
+    // What was removed has no line in the document
+    QString line = (change.newLine > 0 ? QString::number(change.newLine) : QString());
+    QTreeWidgetItem* item = new QTreeWidgetItem(QStringList() << line << change.toString());
+    item->setData(0, Qt::UserRole, change.newLine);
+    items.append(item);
+  }
+  if (items.isEmpty())
+    items.append(new QTreeWidgetItem(QStringList() << QString() << "No structural differences"));
+  addTopLevelItems(items);
+} // setChanges
+
+// ====================================================
+//  ON ITEM CLICKED (slot)
+// ====================================================
+void DiffView::onItemClicked(QTreeWidgetItem* item, int column)
+{
+  Q_UNUSED(column);
+
+  int line = item->data(0, Qt::UserRole).toInt();
+  if (mpEditor == NULL || line <= 0)
+    return;
+
+  QTextBlock block = mpEditor->document()->findBlockByNumber(line - 1);
+  if (!block.isValid())
+    return;
+
+  mpEditor->setTextCursor(QTextCursor(block));
+  mpEditor->ensureCursorVisible();
+  mpEditor->setFocus();
+} // onItemClicked
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include <QtGui/QtGui>
+#include "DocsSearch.h" // class definition
+#include "ManualIndex.h"
+#include "Trace.h"
+
+/// Most pages listed for a query
+static const int MAX_HITS = 50;
+
+// ====================================================
+//  CTOR
+// ====================================================
+DocsSearch::DocsSearch(QWidget* parent)
+  : QWidget(parent)
+{
+  mpQuery = new QLineEdit(this);
+  connect(mpQuery, SIGNAL(textChanged(const QString&)), this, SLOT(search()));
+
+  mpResults = new QTreeWidget(this);
+  mpResults->setRootIsDecorated(false);
+  mpResults->setUniformRowHeights(true);
+  mpResults->setHeaderLabels(QStringList() << "Page" << "Match");
+  connect(mpResults, SIGNAL(itemClicked(QTreeWidgetItem*, int)), this, SLOT(onItemClicked(QTreeWidgetItem*, int)));
+
+  mpPage = new QTextBrowser(this);
+
+  QSplitter* splitter = new QSplitter(Qt::Vertical, this);
+  splitter->addWidget(mpResults);
+  splitter->addWidget(mpPage);
+
+  QVBoxLayout* vbox = new QVBoxLayout;
+  vbox->setMargin(0);
+  vbox->setSpacing(2);
+  vbox->addWidget(mpQuery);
+  vbox->addWidget(splitter);
+  setLayout(vbox);
+
+  connect(ManualIndexer::instance(), SIGNAL(changed()), this, SLOT(search()));
+  search();
+} // ctor
+
+// ====================================================
+//  SET QUERY (slot)
+// ====================================================
+void DocsSearch::setQuery(const QString& query)
+{
+  mpQuery->setText(query);
+} // setQuery
+
+// ====================================================
+//  SEARCH (slot)
+// ====================================================
+void DocsSearch::search(void)
+{
+  TRACE_SCOPE("DocsSearch::search");
+
+  ManualIndexer* indexer = ManualIndexer::instance();
+  mpResults->clear();
+
+  QVector<ManualHit> hits;
+  indexer->index().search(mpQuery->text(), MAX_HITS, hits);
+
+  QList<QTreeWidgetItem*> items;
+  foreach (const ManualHit& hit, hits)
+  {
+    QTreeWidgetItem* item = new QTreeWidgetItem(QStringList() << hit.title << hit.snippet);
+    item->setToolTip(0, hit.path);
+    item->setToolTip(1, hit.snippet);
+    item->setData(0, Qt::UserRole, hit.path);
+    item->setData(1, Qt::UserRole, hit.term);
+    items.append(item);
+  }
+
+  // Say why there's nothing, rather than just showing nothing
+  QString empty;
+  if (indexer->index().directory().isEmpty() && !indexer->isBuilding())
+    empty = "No OgreManualPath in config.xml";
+  else if (indexer->index().pageCount() == 0)
+    empty = (indexer->isBuilding() ? "Indexing the manual..." : "No pages in the manual directory");
+  else if (items.isEmpty() && !mpQuery->text().trimmed().isEmpty())
+    empty = "No pages match";
+  if (!empty.isEmpty())
+    items.append(new QTreeWidgetItem(QStringList() << empty));
+  mpResults->addTopLevelItems(items);
+} // search
+
+// ====================================================
+//  ON ITEM CLICKED (slot)
+// ====================================================
+void DocsSearch::onItemClicked(QTreeWidgetItem* item, int column)
+{
+  Q_UNUSED(column);
+
+  QString path = item->data(0, Qt::UserRole).toString();
+  if (path.isEmpty())
+    return;
+
+  QString directory = ManualIndexer::instance()->index().directory();
+  mpPage->setSource(QUrl::fromLocalFile(directory + '/' + path));
+
+  // From the top, to the first match
+  QString term = item->data(1, Qt::UserRole).toString();
+  mpPage->moveCursor(QTextCursor::Start);
+  if (!term.isEmpty())
+    mpPage->find(term);
+} // onItemClicked
\ No newline at end of file
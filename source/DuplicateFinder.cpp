@@ -0,0 +1,272 @@
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QtAlgorithms>
+#include <algorithm>
+#include "DuplicateFinder.h" // class definition
+#include "ScriptParser.h"
+#include "Trace.h"
+
+/// Number of hashes in a MinHash signature
+static const int SIGNATURE_SIZE = 64;
+
+/// Rows of the signature in each band.  With 16 bands of 4, materials that
+/// share 80% of their features land in a bucket together 99.9% of the time,
+/// and ones that share 30% under 13% of the time.
+static const int BAND_ROWS = 4;
+
+/// Buckets larger than this compare their members with the first only,
+/// rather than with each other, so a template copied thousands of times
+/// doesn't cost millions of comparisons
+static const int MAX_BUCKET = 64;
+
+// ====================================================
+//  MIX (local)
+// ====================================================
+static uint mix(uint h)
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6bU;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35U;
+  h ^= h >> 16;
+  return h;
+} // mix
+
+// ====================================================
+//  ADD FEATURES (local)
+// ====================================================
+/** Adds a feature for each statement in the block of \e node.
+ * @param prefix The objects \e node is in, as they start its features. */
+static void addFeatures(const script::Node* node, const QString& prefix, QStringList& out)
+{
+  QHash<QString, int> ordinals;
+  for (const script::Node* child = node->firstChild; child; child = child->next)
+  {
+    QString keyword = child->keyword.toString();
+    if (child->type == script::NODE_OBJECT)
+    {
+      QString label = (child->name().isEmpty() ? QString("%1 #%2").arg(keyword).arg(++ordinals[keyword])
+                                                 : keyword + ' ' + child->name().toString());
+      QString path = (prefix.isEmpty() ? label : prefix + '/' + label);
+      out << path + " {";
+      addFeatures(child, path, out);
+    }
+    else
+    {
+      QString text = keyword;
+      for (int i = 0; i < child->numArgs; ++i)
+        text += ' ' + child->args[i].toString();
+      out << (prefix.isEmpty() ? text : prefix + '/' + text);
+    }
+  }
+} // addFeatures
+
+// ====================================================
+//  FIND ROOT (local)
+// ====================================================
+/** @returns The representative of \e k's set, halving the path to it. */
+static int findRoot(QVector<int>& parents, int k)
+{
+  while (parents[k] != k)
+  {
+    parents[k] = parents[parents[k]];
+    k = parents[k];
+  }
+  return k;
+} // findRoot
+
+// ====================================================
+//  COMES FIRST (local)
+// ====================================================
+/** Orders groups identical first, then largest first. */
+static bool comesFirst(const DuplicateGroup& a, const DuplicateGroup& b)
+{
+  if (a.exact != b.exact)
+    return a.exact;
+  return a.members.size() > b.members.size();
+} // comesFirst
+
+// ====================================================
+//  FROM SCRIPT (static)
+// ====================================================
+void MaterialFingerprint::fromScript(const script::Node* root, const QString& path, QVector<MaterialFingerprint>& out)
+{
+  if (root == NULL)
+    return;
+
+  uint seeds[SIGNATURE_SIZE];
+  for (int i = 0; i < SIGNATURE_SIZE; ++i)
+    seeds[i] = mix(0x9e3779b9U * (i + 1));
+
+  for (const script::Node* node = root->firstChild; node; node = node->next)
+  {
+    if (node->keyword != "material" || node->name().isEmpty())
+      continue;
+
+    MaterialFingerprint fingerprint;
+    addFeatures(node, QString(), fingerprint.features);
+    if (fingerprint.features.isEmpty())
+      continue;
+
+    // Copies of a material with different parents aren't the same
+    if (!node->inherits.isEmpty())
+      fingerprint.features << ": " + node->inherits.toString();
+    fingerprint.features.sort();
+    fingerprint.features.removeDuplicates();
+
+    fingerprint.name = node->name().toString();
+    fingerprint.path = path;
+    fingerprint.line = node->line;
+    fingerprint.exact = QCryptographicHash::hash(fingerprint.features.join("\n").toUtf8(), QCryptographicHash::Md5);
+
+    foreach (const QString& feature, fingerprint.features)
+      fingerprint.hashes.push_back(qHash(feature));
+    std::sort(fingerprint.hashes.begin(), fingerprint.hashes.end());
+    fingerprint.hashes.erase(std::unique(fingerprint.hashes.begin(), fingerprint.hashes.end()), fingerprint.hashes.end());
+
+    fingerprint.signature.fill(0xffffffffU, SIGNATURE_SIZE);
+    foreach (uint hash, fingerprint.hashes)
+    {
+      for (int i = 0; i < SIGNATURE_SIZE; ++i)
+        fingerprint.signature[i] = qMin(fingerprint.signature[i], mix(hash ^ seeds[i]));
+    }
+    out.push_back(fingerprint);
+  }
+} // fromScript
+
+// ====================================================
+//  FIND (static)
+// ====================================================
+void DuplicateFinder::find(const QVector<MaterialFingerprint>& fingerprints, double threshold, QVector<DuplicateGroup>& out)
+{
+  TRACE_SCOPE("DuplicateFinder::find");
+
+  // Identical materials, by digest, in the order they were first seen
+  QHash<QByteArray, int> classOf;
+  QVector<QVector<int> > classes;
+  for (int i = 0; i < fingerprints.size(); ++i)
+  {
+    QHash<QByteArray, int>::const_iterator citr = classOf.find(fingerprints[i].exact);
+    if (citr == classOf.end())
+    {
+      classOf.insert(fingerprints[i].exact, classes.size());
+      classes.push_back(QVector<int>(1, i));
+    }
+    else
+      classes[*citr].push_back(i);
+  }
+
+  QVector<DuplicateGroup> groups;
+  foreach (const QVector<int>& members, classes)
+  {
+    if (members.size() < 2)
+      continue;
+    DuplicateGroup group;
+    group.exact = true;
+    group.members = members;
+    group.similarity = 1.0;
+    group.common = fingerprints[members.first()].features;
+    groups.push_back(group);
+  }
+
+  // Similar materials, comparing one of each identical class with the
+  // others in its buckets
+  QVector<int> parents(classes.size());
+  for (int k = 0; k < parents.size(); ++k)
+    parents[k] = k;
+
+  for (int band = 0; band + BAND_ROWS <= SIGNATURE_SIZE; band += BAND_ROWS)
+  {
+    QHash<uint, QVector<int> > buckets;
+    for (int k = 0; k < classes.size(); ++k)
+    {
+      const QVector<uint>& signature = fingerprints[classes[k].first()].signature;
+      uint key = band;
+      for (int row = 0; row < BAND_ROWS; ++row)
+        key = mix(key + signature[band + row]);
+      buckets[key].push_back(k);
+    }
+
+    QHash<uint, QVector<int> >::const_iterator citr = buckets.begin();
+    for (; citr != buckets.end(); ++citr)
+    {
+      const QVector<int>& bucket = *citr;
+      for (int j = 1; j < bucket.size(); ++j)
+      {
+        for (int i = (bucket.size() > MAX_BUCKET ? j - 1 : 0); i < j; ++i)
+        {
+          int a = (bucket.size() > MAX_BUCKET ? bucket.first() : bucket[i]);
+          int rootA = findRoot(parents, a);
+          int rootB = findRoot(parents, bucket[j]);
+          if (rootA != rootB && similarity(fingerprints[classes[a].first()], fingerprints[classes[bucket[j]].first()]) >= threshold)
+            parents[rootB] = rootA;
+        }
+      }
+    }
+  }
+
+  // Each set of classes joined up is a group, with every copy in it
+  QHash<int, QVector<int> > sets;
+  QVector<int> roots;
+  for (int k = 0; k < classes.size(); ++k)
+  {
+    int root = findRoot(parents, k);
+    if (!sets.contains(root))
+      roots.push_back(root);
+    sets[root].push_back(k);
+  }
+
+  foreach (int root, roots)
+  {
+    const QVector<int>& set = sets[root];
+    if (set.size() < 2)
+      continue;
+
+    DuplicateGroup group;
+    group.exact = false;
+    QSet<QString> common = fingerprints[classes[set.first()].first()].features.toSet();
+    QSet<QString> any;
+    foreach (int k, set)
+    {
+      const MaterialFingerprint& fingerprint = fingerprints[classes[k].first()];
+      QSet<QString> features = fingerprint.features.toSet();
+      common.intersect(features);
+      any.unite(features);
+      group.members += classes[k];
+    }
+    qSort(group.members);
+    group.common = common.toList();
+    group.common.sort();
+    group.similarity = (any.isEmpty() ? 1.0 : double(common.size()) / any.size());
+    groups.push_back(group);
+  }
+
+  qStableSort(groups.begin(), groups.end(), comesFirst);
+  out += groups;
+} // find
+
+// ====================================================
+//  SIMILARITY (static)
+// ====================================================
+double DuplicateFinder::similarity(const MaterialFingerprint& a, const MaterialFingerprint& b)
+{
+  // Both are sorted, so the overlap is one merge
+  int i = 0, j = 0, shared = 0;
+  while (i < a.hashes.size() && j < b.hashes.size())
+  {
+    if (a.hashes[i] < b.hashes[j])
+      ++i;
+    else if (b.hashes[j] < a.hashes[i])
+      ++j;
+    else
+    {
+      ++shared;
+      ++i;
+      ++j;
+    }
+  }
+
+  int total = a.hashes.size() + b.hashes.size() - shared;
+  return (total > 0 ? double(shared) / total : 1.0);
+} // similarity
\ No newline at end of file
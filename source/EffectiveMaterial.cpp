@@ -0,0 +1,137 @@
+#include <QtGui/QtGui>
+#include "EffectiveMaterial.h" // class definition
+#include "TextEditor.h"
+#include "ResourceResolver.h"
+#include "ScriptParser.h"
+#include "Trace.h"
+
+/// How long the view waits after the cursor moves before it catches up, in
+/// milliseconds
+static const int EFFECTIVE_DELAY = 250;
+
+// ====================================================
+//  CTOR
+// ====================================================
+EffectiveMaterial::EffectiveMaterial(QWidget* parent)
+  : QPlainTextEdit(parent), mStale(true)
+{
+  setReadOnly(true);
+  setLineWrapMode(QPlainTextEdit::NoWrap);
+
+  mTimer.setSingleShot(true);
+  mTimer.setInterval(EFFECTIVE_DELAY);
+  connect(&mTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+
+  ResourceResolver* resolver = ResourceResolver::instance();
+  mFlattener.setResources(resolver->index());
+  connect(resolver, SIGNAL(changed()), this, SLOT(onResourcesChanged()));
+} // ctor
+
+// ====================================================
+//  SET EDITOR (slot)
+// ====================================================
+void EffectiveMaterial::setEditor(TextEditor* editor)
+{
+  if (mpEditor)
+    disconnect(mpEditor, NULL, this, NULL);
+
+  // Unsaved materials of the last document mustn't hide the ones on disk
+  if (!mDocumentKey.isEmpty())
+    mFlattener.removeScript(mDocumentKey);
+  mDocumentKey.clear();
+
+  mpEditor = editor;
+  if (mpEditor)
+  {
+    mDocumentKey = QString("document:%1").arg(reinterpret_cast<quintptr>(editor));
+    setFont(mpEditor->font());
+    connect(mpEditor, SIGNAL(cursorPositionChanged()), this, SLOT(schedule()));
+    connect(mpEditor, SIGNAL(textChanged()), this, SLOT(schedule()));
+  }
+  mStale = true;
+  schedule();
+} // setEditor
+
+// ====================================================
+//  SHOW EVENT (inherited)
+// ====================================================
+void EffectiveMaterial::showEvent(QShowEvent* event)
+{
+  QPlainTextEdit::showEvent(event);
+  if (mStale)
+    refresh();
+} // showEvent
+
+// ====================================================
+//  SCHEDULE (slot)
+// ====================================================
+void EffectiveMaterial::schedule(void)
+{
+  // There's no need to work anything out while nobody looks
+  mStale = true;
+  if (isVisible())
+    mTimer.start();
+} // schedule
+
+// ====================================================
+//  ON RESOURCES CHANGED (slot)
+// ====================================================
+void EffectiveMaterial::onResourcesChanged(void)
+{
+  mFlattener.setResources(ResourceResolver::instance()->index());
+  mFlattener.refresh();
+  schedule();
+} // onResourcesChanged
+
+// ====================================================
+//  REFRESH (slot)
+// ====================================================
+void EffectiveMaterial::refresh(void)
+{
+  mStale = !isVisible();
+  if (mStale)
+    return;
+
+  TRACE_SCOPE("EffectiveMaterial::refresh");
+
+  if (mpEditor == NULL)
+  {
+    setPlainText(QString());
+    return;
+  }
+
+  // Materials the document defines replace the ones it had last time; the
+  // ones that didn't change keep what was worked out for them
+  QByteArray text = mpEditor->toPlainText().toUtf8();
+  script::ScriptFile file;
+  file.parse(text.constData(), text.size());
+  QVector<MaterialDefinition> definitions;
+  MaterialDefinition::fromScript(file.root(), definitions);
+  mFlattener.addScript(mDocumentKey, definitions);
+
+  // The material under the cursor is the last one to start above it
+  int line = mpEditor->textCursor().blockNumber() + 1;
+  const MaterialDefinition* current = NULL;
+  for (int i = 0; i < definitions.size() && definitions[i].line <= line; ++i)
+    current = &definitions[i];
+
+  QString view;
+  MaterialStatement effective;
+  QString error;
+  if (current == NULL)
+    view = "// The cursor isn't in a material\n";
+  else if (!mFlattener.flatten(current->name, effective, &error))
+    view = "// " + error + "\n";
+  else
+  {
+    QStringList ancestry = mFlattener.ancestry(current->name);
+    view = QString("// Effective material of %1\n").arg(current->name);
+    if (ancestry.size() > 1)
+      view += "// Inherits " + ancestry.mid(1).join(" : ") + "\n";
+    view += effective.toString();
+  }
+
+  // Leave the view where it is if the material didn't change
+  if (view != toPlainText())
+    setPlainText(view);
+} // refresh
\ No newline at end of file
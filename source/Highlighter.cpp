@@ -1,50 +1,678 @@
-#include <QtGui/QtGui>
-#include <QtXml/QtXml>
-#include "Highlighter.h"  // class definition
-#include "ConfigFile.h"
-
-// ====================================================
-//  CTOR
-// ====================================================
-Highlighter::Highlighter(QTextDocument *parent)
-  : QSyntaxHighlighter(parent)
-{
-  
-} // ctor
-
-// ====================================================
-//  SET FILE FORMAT
-// ====================================================
-void Highlighter::setFileFormat(const QString& format)
-{
-  mHighlightingRules = config::ConfigFile::instance()->getHighlightsByFormat(format);
-  rehighlight();
-} // setFormat
-
-// ====================================================
-//  HIGHLIGHT BLOCK (inherited)
-// ====================================================
-void Highlighter::highlightBlock(const QString &text)
-{
-  // Highlighting
-  foreach (const config::FormatHighlighting &rule, mHighlightingRules) 
-  {
-    bool ruleApplied = false;
-    foreach (const QRegExp& expression, rule.patterns)
-    {
-      int index = expression.indexIn(text);
-      while (index >= 0) 
-      {
-        ruleApplied = true;
-        int length = expression.matchedLength();
-        setFormat(index, length, rule.format);
-        index = expression.indexIn(text, index + length);
-      }
-    }
-
-    if ((rule.name == "comment" || rule.name == "string") && ruleApplied)
-      return;
-  }
-
-  setCurrentBlockState(0);
-} // highlightBlock
\ No newline at end of file
+#include <QtGui/QtGui>
+#include <QtXml/QtXml>
+#include "Highlighter.h"  // class definition
+#include "ConfigFile.h"
+#include "Trace.h"
+#include "Metrics.h"
+
+// ---------------------------------------------------------------------
+//                            SCRIPT TOKENIZER
+// ---------------------------------------------------------------------
+
+// ====================================================
+//  CTOR
+// ====================================================
+ScriptTokenizer::ScriptTokenizer(const QChar* data, int length, bool inComment)
+  : mpData(data), mLength(length), mStart(0), mEnd(0), mBlockComment(inComment), mLineComment(false)
+{
+} // ctor
+
+// ====================================================
+//  NEXT
+// ====================================================
+ScriptTokenizer::Token ScriptTokenizer::next(void)
+{
+  int i = mEnd;
+  for (;;)
+  {
+    // Block comments end wherever "*/" is, even inside a word
+    if (mBlockComment)
+    {
+      while (i < mLength && !(mpData[i] == '*' && i + 1 < mLength && mpData[i + 1] == '/'))
+        ++i;
+      if (i == mLength)
+        break;
+      i += 2;
+      mBlockComment = false;
+    }
+
+    while (i < mLength && mpData[i].isSpace())
+      ++i;
+    if (i == mLength || mLineComment)
+      break;
+
+    // Comments start where a token could
+    if (mpData[i] == '/' && i + 1 < mLength && (mpData[i + 1] == '/' || mpData[i + 1] == '*'))
+    {
+      if (mpData[i + 1] == '/')
+      {
+        mLineComment = true;
+        break;
+      }
+      mBlockComment = true;
+      i += 2;
+      continue;
+    }
+
+    mStart = i;
+    QChar ch = mpData[i++];
+    if (ch == '{')
+    {
+      mEnd = i;
+      return TOKEN_OPEN;
+    }
+    if (ch == '}')
+    {
+      mEnd = i;
+      return TOKEN_CLOSE;
+    }
+    if (ch == '"')
+    {
+      while (i < mLength && mpData[i] != '"')
+        ++i;
+      mEnd = (i < mLength ? i + 1 : i);
+      return TOKEN_STRING;
+    }
+
+    while (i < mLength && !mpData[i].isSpace() && mpData[i] != '{' && mpData[i] != '}' && mpData[i] != '"')
+      ++i;
+    mEnd = i;
+    return TOKEN_WORD;
+  }
+
+  mStart = mEnd = i;
+  return TOKEN_END;
+} // next
+
+// ====================================================
+//  START
+// ====================================================
+int ScriptTokenizer::start(void) const
+{
+  return mStart;
+} // start
+
+// ====================================================
+//  END
+// ====================================================
+int ScriptTokenizer::end(void) const
+{
+  return mEnd;
+} // end
+
+// ====================================================
+//  IN BLOCK COMMENT
+// ====================================================
+bool ScriptTokenizer::inBlockComment(void) const
+{
+  return mBlockComment;
+} // inBlockComment
+
+// ====================================================
+//  IN COMMENT
+// ====================================================
+bool ScriptTokenizer::inComment(void) const
+{
+  return mBlockComment || mLineComment;
+} // inComment
+
+// ---------------------------------------------------------------------
+//                              SCOPE STATE
+// ---------------------------------------------------------------------
+
+// ====================================================
+//  CURRENT
+// ====================================================
+Atom ScopeState::current(void) const
+{
+  static const Atom SCRIPT = Atom::intern("script");
+  return (stack.isEmpty() ? SCRIPT : stack.last());
+} // current
+
+// ====================================================
+//  SCAN
+// ====================================================
+bool ScopeState::scan(const QString& text, int length, QString* definedName, bool* endsInComment)
+{
+  static const Atom MATERIAL = Atom::intern("material");
+
+  const QChar* data = text.constData();
+  ScriptTokenizer tokens(data, qMin(length, text.size()), inComment);
+
+  bool atStart = true;    // Every block is a line, and every line a statement
+  int wordIndex = 0;
+  bool defining = false;
+
+  for (ScriptTokenizer::Token token = tokens.next(); token != ScriptTokenizer::TOKEN_END; token = tokens.next())
+  {
+    if (token == ScriptTokenizer::TOKEN_STRING)
+    {
+      atStart = false;
+    }
+    else if (token == ScriptTokenizer::TOKEN_OPEN)
+    {
+      stack.push_back(pending);
+      pending = Atom();
+      atStart = true;
+    }
+    else if (token == ScriptTokenizer::TOKEN_CLOSE)
+    {
+      if (!stack.isEmpty())
+        stack.pop_back();
+      pending = Atom();
+      atStart = true;
+    }
+    else if (atStart)
+    {
+      // Words that were never interned can't be keywords
+      pending = Atom::find(data + tokens.start(), tokens.end() - tokens.start());
+      defining = (stack.isEmpty() && pending == MATERIAL);
+      wordIndex = 1;
+      atStart = false;
+    }
+    else if (wordIndex++ == 1 && defining && definedName)
+    {
+      *definedName = QString(data + tokens.start(), tokens.end() - tokens.start());
+    }
+  }
+
+  inComment = tokens.inBlockComment();
+  if (endsInComment)
+    *endsInComment = tokens.inComment();
+  return atStart;
+} // scan
+
+// ---------------------------------------------------------------------
+//                              BLOCK DATA
+// ---------------------------------------------------------------------
+
+// ====================================================
+//  CTOR
+// ====================================================
+BlockData::BlockData(const QSharedPointer<NameIndex>& names)
+  : folded(false), stale(false), checkedText(0), checkedContext(-2), mNames(names)
+{
+} // ctor
+
+// ====================================================
+//  DTOR
+// ====================================================
+BlockData::~BlockData(void)
+{
+  // Blocks are destroyed by the document when lines are removed
+  setDefinedName(QString());
+} // dtor
+
+// ====================================================
+//  SET DEFINED NAME
+// ====================================================
+void BlockData::setDefinedName(const QString& name)
+{
+  if (name == mDefinedName)
+    return;
+
+  if (!mDefinedName.isEmpty())
+  {
+    NameIndex::iterator itr = mNames->find(mDefinedName);
+    if (itr != mNames->end() && --(*itr) <= 0)
+      mNames->erase(itr);
+  }
+
+  mDefinedName = name;
+  if (!mDefinedName.isEmpty())
+    ++(*mNames)[mDefinedName];
+} // setDefinedName
+
+// ---------------------------------------------------------------------
+//                            LINE HIGHLIGHTER
+// ---------------------------------------------------------------------
+
+// ====================================================
+//  CTOR
+// ====================================================
+LineHighlighter::LineHighlighter(void)
+{
+  mRuleMemory = 0;
+} // ctor
+
+// ====================================================
+//  SET FILE FORMAT
+// ====================================================
+void LineHighlighter::setFileFormat(const QString& format)
+{
+  mHighlightingRules = config::ConfigFile::instance()->getHighlightsByFormat(format);
+  mWordTable = config::ConfigFile::instance()->getWordTableByFormat(format);
+
+  mWordFormats.clear();
+  foreach (const config::FormatHighlighting& rule, mHighlightingRules)
+    mWordFormats.insert(rule.atom, rule.format);
+
+  // Estimate the memory held by the rules.  QRegExp doesn't expose the size
+  // of its compiled form, so a fixed cost per expression is assumed.
+  mRuleMemory = 0;
+  foreach (const config::FormatHighlighting& rule, mHighlightingRules)
+  {
+    mRuleMemory += sizeof(config::FormatHighlighting) + rule.name.size() * sizeof(QChar);
+    foreach (const QRegExp& expression, rule.patterns)
+      mRuleMemory += sizeof(QRegExp) + 256 + expression.pattern().size() * sizeof(QChar);
+  }
+  metrics::Registry::instance()->metric("highlighter.rule_bytes")->sample(mRuleMemory);
+} // setFileFormat
+
+// ====================================================
+//  RULE MEMORY
+// ====================================================
+qint64 LineHighlighter::ruleMemory(void) const
+{
+  return mRuleMemory;
+} // ruleMemory
+
+// ====================================================
+//  HIGHLIGHT
+// ====================================================
+void LineHighlighter::highlight(const QString& text, QVector<QTextLayout::FormatRange>& ranges) const
+{
+  ranges.resize(0);
+
+  // Words: one probe of the format's word table for each identifier
+  const QChar* data = text.constData();
+  int length = text.size();
+  int i = 0;
+  while (i < length)
+  {
+    if (!data[i].isLetterOrNumber() && data[i] != '_')
+    {
+      ++i;
+      continue;
+    }
+
+    int start = i;
+    while (i < length && (data[i].isLetterOrNumber() || data[i] == '_'))
+      ++i;
+
+    Atom highlightType = mWordTable.classify(data + start, i - start);
+    if (!highlightType.isNull())
+    {
+      QHash<Atom, QTextCharFormat>::const_iterator citr = mWordFormats.find(highlightType);
+      if (citr != mWordFormats.end())
+      {
+        QTextLayout::FormatRange range;
+        range.start = start;
+        range.length = i - start;
+        range.format = *citr;
+        ranges.push_back(range);
+      }
+    }
+  }
+
+  // Patterns (strings), then comments, so they win over words inside them
+  config::FormatHighlightingMap::const_iterator comment = mHighlightingRules.end();
+  config::FormatHighlightingMap::const_iterator citr = mHighlightingRules.begin();
+  for (; citr != mHighlightingRules.end(); ++citr)
+  {
+    if (citr->name == "comment")
+      comment = citr;
+    else
+      applyPatterns(*citr, text, ranges);
+  }
+
+  if (comment != mHighlightingRules.end())
+    applyPatterns(*comment, text, ranges);
+} // highlight
+
+// ====================================================
+//  APPLY PATTERNS
+// ====================================================
+void LineHighlighter::applyPatterns(const config::FormatHighlighting& rule, const QString& text,
+                                    QVector<QTextLayout::FormatRange>& ranges) const
+{
+  foreach (const QRegExp& expression, rule.patterns)
+  {
+    int index = expression.indexIn(text);
+    while (index >= 0) 
+    {
+      QTextLayout::FormatRange range;
+      range.start = index;
+      range.length = expression.matchedLength();
+      range.format = rule.format;
+      ranges.push_back(range);
+      index = expression.indexIn(text, index + range.length);
+    }
+  }
+} // applyPatterns
+
+// ---------------------------------------------------------------------
+//                            HIGHLIGHT CACHE
+// ---------------------------------------------------------------------
+
+// ====================================================
+//  CTOR
+// ====================================================
+HighlightCache::HighlightCache(void)
+{
+  fileHash = 0;
+  rulesStamp = 0;
+} // ctor
+
+// ====================================================
+//  IS EMPTY
+// ====================================================
+bool HighlightCache::isEmpty(void) const
+{
+  return blocks.isEmpty();
+} // isEmpty
+
+// ====================================================
+//  HASH (static)
+// ====================================================
+quint64 HighlightCache::hash(const QString& text)
+{
+  // 64 bit FNV-1a
+  quint64 hash = Q_UINT64_C(14695981039346656037);
+  const ushort* data = text.utf16();
+  for (int i = 0; i < text.size(); ++i)
+  {
+    hash ^= data[i];
+    hash *= Q_UINT64_C(1099511628211);
+  }
+  return hash;
+} // hash
+
+// ====================================================
+//  OPERATOR <<
+// ====================================================
+QDataStream& operator<<(QDataStream& stream, const HighlightCache& cache)
+{
+  return stream << cache.fileHash << cache.format << cache.rulesStamp << cache.formats << cache.blocks;
+} // operator <<
+
+// ====================================================
+//  OPERATOR >>
+// ====================================================
+QDataStream& operator>>(QDataStream& stream, HighlightCache& cache)
+{
+  // The vectors are read an element at a time, rather than with QVector's
+  // operator>>, which allocates whatever count it reads, however corrupt
+  quint32 count;
+  stream >> cache.fileHash >> cache.format >> cache.rulesStamp >> count;
+  cache.formats.clear();
+  for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+  {
+    QTextCharFormat format;
+    stream >> format;
+    cache.formats.push_back(format);
+  }
+
+  stream >> count;
+  cache.blocks.clear();
+  for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+  {
+    quint32 size;
+    stream >> size;
+    QVector<int> ranges;
+    for (quint32 j = 0; j < size && stream.status() == QDataStream::Ok; ++j)
+    {
+      qint32 value;
+      stream >> value;
+      ranges.push_back(value);
+    }
+    cache.blocks.push_back(ranges);
+  }
+  return stream;
+} // operator >>
+
+// ---------------------------------------------------------------------
+//                              HIGHLIGHTER
+// ---------------------------------------------------------------------
+
+// ====================================================
+//  CTOR
+// ====================================================
+Highlighter::Highlighter(QTextDocument *parent)
+  : QSyntaxHighlighter(parent), mNames(new NameIndex)
+{
+  mFrameNsecs = 0;
+  mFrameBlocks = 0;
+  mFrameScheduled = false;
+  mpCache = NULL;
+} // ctor
+
+// ====================================================
+//  SET FILE FORMAT
+// ====================================================
+void Highlighter::setFileFormat(const QString& format)
+{
+  TRACE_SCOPE("Highlighter::setFileFormat");
+
+  mRules.setFileFormat(format);
+  rehighlight();
+} // setFormat
+
+// ====================================================
+//  RELOAD RULES
+// ====================================================
+void Highlighter::reloadRules(const QString& format)
+{
+  TRACE_SCOPE("Highlighter::reloadRules");
+
+  // Saved highlighting was for the old rules
+  mRules.setFileFormat(format);
+  mpCache = NULL;
+
+  for (QTextBlock block = document()->begin(); block.isValid(); block = block.next())
+  {
+    BlockData* data = blockData(block);
+    if (data)
+      data->stale = true;
+  }
+} // reloadRules
+
+// ====================================================
+//  RULE MEMORY
+// ====================================================
+qint64 Highlighter::ruleMemory(void) const
+{
+  return mRules.ruleMemory();
+} // ruleMemory
+
+// ====================================================
+//  DEFINED NAMES
+// ====================================================
+QStringList Highlighter::definedNames(void) const
+{
+  return mNames->keys();
+} // definedNames
+
+// ====================================================
+//  NAME INDEX
+// ====================================================
+NameIndex Highlighter::nameIndex(void) const
+{
+  return *mNames;
+} // nameIndex
+
+// ====================================================
+//  BLOCK DATA (static)
+// ====================================================
+BlockData* Highlighter::blockData(const QTextBlock& block)
+{
+  return static_cast<BlockData*>(block.userData());
+} // blockData
+
+// ====================================================
+//  SCOPE AT (static)
+// ====================================================
+ScopeState Highlighter::scopeAt(const QTextBlock& block, int column, bool* atStatementStart, bool* inComment)
+{
+  ScopeState state;
+  BlockData* previous = blockData(block.previous());
+  if (previous)
+    state = previous->state;
+
+  bool atStart = state.scan(block.text(), column, NULL, inComment);
+  if (atStatementStart)
+    *atStatementStart = atStart;
+  return state;
+} // scopeAt
+
+// ====================================================
+//  HIGHLIGHT BLOCK (inherited)
+// ====================================================
+void Highlighter::highlightBlock(const QString &text)
+{
+  TRACE_SCOPE("Highlighter::highlightBlock");
+
+  QElapsedTimer timer;
+  timer.start();
+
+  // Carry the parser state on from the previous block.  The block state is a
+  // hash of it, so QSyntaxHighlighter keeps going to the following blocks
+  // for as long as an edit changes their scopes, and stops as soon as it doesn't.
+  BlockData* data = blockData(currentBlock());
+  if (data == NULL)
+  {
+    data = new BlockData(mNames);
+    setCurrentBlockUserData(data);
+  }
+
+  BlockData* previous = blockData(currentBlock().previous());
+  data->state = (previous ? previous->state : ScopeState());
+
+  QString definedName;
+  data->state.scan(text, text.size(), &definedName);
+  data->setDefinedName(definedName);
+
+  uint hash = qHash(data->state.pending) * 2 + (data->state.inComment ? 1 : 0);
+  foreach (Atom scope, data->state.stack)
+    hash = hash * 31 + qHash(scope);
+  setCurrentBlockState(static_cast<int>(hash & 0x7fffffff));
+
+  // Blocks hidden by a fold only need their scopes, which the blocks after
+  // them depend on.  TextEditor highlights them again once they're shown.
+  data->stale = !currentBlock().isVisible();
+  if (!data->stale)
+  {
+    if (mpCache && currentBlock().blockNumber() < mpCache->blocks.size())
+      applyCache(currentBlock().blockNumber());
+    else
+      applyRules(text);
+
+    // Underline what the diagnostics found, as long as they were found in
+    // this text; an edit clears them until the line has been checked again
+    if (!data->diagnostics.isEmpty() && data->checkedText == qHash(text))
+    {
+      foreach (const Diagnostic& diagnostic, data->diagnostics)
+        underline(diagnostic.start, diagnostic.length);
+    }
+  }
+
+  // Accumulate the work done for this frame.  Everything highlighted before
+  // control returns to the event loop counts as one frame.
+  mFrameNsecs += timer.nsecsElapsed();
+  ++mFrameBlocks;
+  if (!mFrameScheduled)
+  {
+    mFrameScheduled = true;
+    QTimer::singleShot(0, this, SLOT(onFrameFinished()));
+  }
+} // highlightBlock
+
+// ====================================================
+//  APPLY RULES
+// ====================================================
+void Highlighter::applyRules(const QString &text)
+{
+  mRules.highlight(text, mRanges);
+  foreach (const QTextLayout::FormatRange& range, mRanges)
+    setFormat(range.start, range.length, range.format);
+} // applyRules
+
+// ====================================================
+//  UNDERLINE
+// ====================================================
+void Highlighter::underline(int start, int length)
+{
+  // One character at a time, so each keeps the rest of its format
+  for (int i = start; i < start + length && i < currentBlock().length(); ++i)
+  {
+    QTextCharFormat charFormat = format(i);
+    charFormat.setUnderlineStyle(QTextCharFormat::SpellCheckUnderline);
+    charFormat.setUnderlineColor(Qt::red);
+    setFormat(i, 1, charFormat);
+  }
+} // underline
+
+// ====================================================
+//  APPLY CACHE
+// ====================================================
+void Highlighter::applyCache(int block)
+{
+  // The cache comes from a session file, so anything that doesn't fit the
+  // block is cut to it or dropped rather than trusted
+  const QVector<int>& ranges = mpCache->blocks[block];
+  int length = currentBlock().length();
+  for (int i = 0; i + 2 < ranges.size(); i += 3)
+  {
+    int index = ranges[i + 2];
+    if (index < 0 || index >= mpCache->formats.size())
+      continue;
+
+    int start = qMax(ranges[i], 0);
+    int end = qMin(qint64(ranges[i]) + ranges[i + 1], qint64(length));
+    if (start < end)
+      setFormat(start, int(end - start), mpCache->formats[index]);
+  }
+} // applyCache
+
+// ====================================================
+//  SET CACHE
+// ====================================================
+void Highlighter::setCache(const HighlightCache* cache)
+{
+  mpCache = cache;
+} // setCache
+
+// ====================================================
+//  CAPTURE (static)
+// ====================================================
+HighlightCache Highlighter::capture(const QTextDocument* document)
+{
+  TRACE_SCOPE("Highlighter::capture");
+
+  // QSyntaxHighlighter keeps its formats in the layout of each block
+  HighlightCache cache;
+  cache.blocks.reserve(document->blockCount());
+  for (QTextBlock block = document->begin(); block.isValid(); block = block.next())
+  {
+    QVector<int> ranges;
+    foreach (const QTextLayout::FormatRange& range, block.layout()->additionalFormats())
+    {
+      // There are only ever a handful of formats
+      int format = cache.formats.indexOf(range.format);
+      if (format < 0)
+      {
+        format = cache.formats.size();
+        cache.formats.push_back(range.format);
+      }
+      ranges << range.start << range.length << format;
+    }
+    cache.blocks.push_back(ranges);
+  }
+  return cache;
+} // capture
+
+// ====================================================
+//  ON FRAME FINISHED (slot)
+// ====================================================
+void Highlighter::onFrameFinished(void)
+{
+  static metrics::Metric* frameMs = metrics::Registry::instance()->metric("highlight.frame_ms");
+  static metrics::Metric* blocks = metrics::Registry::instance()->metric("highlight.blocks_per_edit");
+
+  frameMs->sample(mFrameNsecs / 1000000.0);
+  blocks->sample(mFrameBlocks);
+
+  mFrameNsecs = 0;
+  mFrameBlocks = 0;
+  mFrameScheduled = false;
+} // onFrameFinished
\ No newline at end of file
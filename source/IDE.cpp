@@ -1,400 +1,1129 @@
-//#ifdef Q_WS_WIN
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
-#include <WinBase.h>
-//#endif // Q_WS_WIN
-
-#include <QtGui/QtGui>
-#include "IDE.h"  // class declarations
-#include "TextEditor.h"
-#include "ConfigFile.h"
-
-IDE::FileEditor::FileEditor() {editor = NULL;}
-IDE::FileEditor::~FileEditor() {if (editor) {editor->setUserData(0, NULL); delete editor; editor = NULL;}}
-
-// ====================================================
-//  CTOR
-// ====================================================
-IDE::IDE(QWidget* parent, bool statusBar)
-  : QWidget(parent)
-{
-  setAcceptDrops(true);
-  mKeywordSyntaxesItr = mKeywordSyntaxes.end();
-
-  // Load the ConfigFile
-  config::ConfigFile::instance();
-
-  // Create a VBox Layout for the editors and status bar
-  QVBoxLayout* vbox = new QVBoxLayout;
-  vbox->setMargin(0);
-  vbox->setSpacing(0);
-
-  // Define the default font for each editor
-  mFont;
-  mFont.setFamily("Courier New");
-  mFont.setFixedPitch(true);
-  mFont.setPointSize(10);
-
-  // Create the tab widget that will hold each editor.
-  mpTabs = new QTabWidget(this);
-  mpTabs->setTabsClosable(true);
-  mpTabs->setMovable(true);
-  mpTabs->setTabShape(QTabWidget::Triangular);
-  connect(mpTabs, SIGNAL(currentChanged(int)), this, SLOT(onTabChanged(int)));
-  connect(mpTabs, SIGNAL(tabCloseRequested(int)), this, SLOT(onTabCloseRequested(int)));
-  
-  // Create the status bar.  Only show it if statusBar is true
-  mpStatusBar = new QStatusBar(this);
-  mpStatusBar->setVisible(statusBar);
-    
-  // Add the tab widget and status bar to the vbox
-  vbox->addWidget(mpTabs);
-  vbox->addWidget(mpStatusBar);
-
-  setLayout(vbox);
-} // ctor
-
-// ====================================================
-//  DTOR
-// ====================================================
-IDE::~IDE(void)
-{
-  foreach (FileEditor* fe, mEditors)
-    delete fe;
-} // dtor
-
-// ====================================================
-//  ADD EDITOR
-// ====================================================
-void IDE::addEditor(const QString& filename, const QString& path)
-{
-  // Create a new FileEditor struct to hold the filename, path, and
-  // TextEditor for the new editor
-  FileEditor* fe = new FileEditor;
-  fe->filename = filename;
-  fe->path = path;
-  fe->editor = new TextEditor(mpTabs);
-  fe->editor->setFont(mFont);
-  fe->editor->setUserData(0, fe);
-  connect(fe->editor, SIGNAL(fileDropped(const QString&)), this, SLOT(onFileDropped(const QString&)));
-  connect(fe->editor, SIGNAL(keywordChanged(const QString&, const QString&)), this, SLOT(onKeywordChanged(const QString&, const QString&)));
-  connect(fe->editor, SIGNAL(keyPressed(QKeyEvent*)), this, SLOT(onEditorKeyEvent(QKeyEvent*)));
-  mEditors.push_back(fe);
-
-  // Add this new editor to the tab widget and make it the current tab
-  int tab = mpTabs->addTab(fe->editor, fe->filename);
-  mpTabs->setTabToolTip(tab, fe->path);
-  mpTabs->setCurrentWidget(fe->editor); // causes mpTabs to emit signal currentChanged()
-} // addEditor
-
-// ====================================================
-//  DRAG ENTER EVENT (inherited)
-// ====================================================
-void IDE::dragEnterEvent(QDragEnterEvent* e)
-{
-  if (e->mimeData()->hasUrls())
-    e->acceptProposedAction();
-  else
-    QWidget::dragEnterEvent(e);
-} // dragEnterEvent
-
-// ====================================================
-//  DROP EVENT (inherited)
-// ====================================================
-void IDE::dropEvent(QDropEvent* e)
-{
-  if (e->mimeData()->hasUrls())
-  {
-    QList<QUrl> urls = e->mimeData()->urls();
-    foreach (QUrl url, urls)
-      onFileDropped(url.toLocalFile());
-  }
-  else
-    QWidget::dropEvent(e);
-} // dropEvent
-
-// ====================================================
-//  SET KEYWORD
-// ====================================================
-void IDE::setKeyword(const QString& keyword, const QString& format)
-{
-  const config::FormatWordMap& words = 
-    config::ConfigFile::instance()->getWordsByFormat(format);
-
-  // Clear the current status
-  mpStatusBar->clearMessage();
-
-  // Clear any existing syntaxes
-  mKeywordSyntaxes.clear();
-  
-  config::FormatWordMap::const_iterator citr = words.find(keyword);
-  if (citr != words.end())
-  {
-    QString docFile = citr->doc;
-    const QString& manualPath = config::ConfigFile::instance()->getManualPath();
-      
-    QFile file(manualPath + docFile);
-    if (file.open(QFile::ReadOnly | QFile::Text))
-    {
-      QTextStream stream(&file);
-      QString text = stream.readAll();
-      file.close();
-
-      
-      // Probably never going to be 4 different formats, but just to be sure...
-      for (int i = 0; i < 4; ++i)
-      {
-        // Look for the string "Format: <keyword>"
-        QString pattern = QString("Format%1: %2 ")
-                          .arg((i==0) ? "" : QString::number(i))
-                          .arg(keyword);
-        QStringMatcher matcher(pattern);
-        int index = matcher.indexIn(text);
-        if (index >= 0)
-        {
-          // Look for the first <BR> after the format.
-          matcher.setPattern("<BR>");
-          int endIndex = matcher.indexIn(text, index);
-          if (endIndex >= 0)
-          {
-            // The syntax is between the two indices.
-            QString syntax = text.mid(index, endIndex-index);
-
-            // Format the synatx properly
-            syntax.replace("&lt;", "<");
-            syntax.replace("&gt;", ">");
-
-            // Add to the keyword syntax vector
-            mKeywordSyntaxes.push_back(syntax);
-          }
-        }
-      }
-    }
-  }
-
-  // Point to the first syntax
-  mKeywordSyntaxesItr = mKeywordSyntaxes.begin();
-
-  // If there is at least one valid syntax, show the first one
-  if (mKeywordSyntaxesItr != mKeywordSyntaxes.end())
-    mpStatusBar->showMessage(*mKeywordSyntaxesItr);
-} // setKeyword
-
-// ---------------------------------------------------------------------
-//                               SLOTS
-// ---------------------------------------------------------------------
-
-// ====================================================
-//  ON FILE DROPPED (slot)
-// ====================================================
-void IDE::onFileDropped(const QString& path)
-{
-  QFileInfo fi(path);
-  if (fi.exists())
-  {
-    // See if a text editor for this file already exists
-    foreach (FileEditor* fe, mEditors)
-    {
-      if (fe->path == fi.absoluteFilePath())
-      {
-        mpTabs->setCurrentWidget(fe->editor);
-        return;
-      }
-    }
-
-    QString filename = fi.fileName();
-    QString path = fi.absoluteFilePath();
-
-    addEditor(filename, path);
-    mpCurrentEditor->editor->load(path);
-  }
-} // onFileDropped
-
-// ====================================================
-//  NEW FILE (slot)
-// ====================================================
-void IDE::newFile(void)
-{
-  addEditor("untitled", "");
-} // neFile
-
-// ====================================================
-//  SAVE (slot)
-// ====================================================
-void IDE::save(void)
-{
-  if (mpCurrentEditor)
-  {
-    // If the path for this file exists, save to it
-    if (QFile::exists(mpCurrentEditor->path))
-      mpCurrentEditor->editor->save(mpCurrentEditor->path);
-
-    // Otherwise, call saveAs()
-    else
-      saveAs();
-  }
-} // save
-
-// ====================================================
-//  SAVE AS (slot)
-// ====================================================
-void IDE::saveAs(void)
-{
-  if (mpCurrentEditor)
-  {
-    QString path = QFileDialog::getSaveFileName(this, "Save As");
-    if (!path.isNull())
-    {
-      QFileInfo fi(path);
-      mpCurrentEditor->editor->save(path);
-      mpCurrentEditor->path = fi.absoluteFilePath();
-      mpCurrentEditor->filename = fi.fileName();
-      mpTabs->setTabText(mpTabs->indexOf(mpCurrentEditor->editor), mpCurrentEditor->filename);
-    }
-  }
-} // saveAs
-
-// ====================================================
-//  OPEN (slot)
-// ====================================================
-void IDE::open(void)
-{
-  QStringList files = QFileDialog::getOpenFileNames(this, "Open Files");
-  foreach (QString path, files)
-  {
-    QFileInfo fi(path);
-    addEditor(fi.fileName(), fi.absoluteFilePath());
-    mpCurrentEditor->editor->load(path);
-  }
-} // open
-
-// ====================================================
-//  ON TAB CHANGED (slot)
-// ====================================================
-void IDE::onTabChanged(int tab)
-{
-  if (mpTabs->currentWidget())
-  {
-    mpCurrentEditor = static_cast<FileEditor*>(mpTabs->currentWidget()->userData(0));
-    mpCurrentEditor->editor->setFocus();
-  }
-  else
-  {
-    mpCurrentEditor = NULL;
-  }
-} // onTabChanged
-
-// ====================================================
-//  ON TAB CLOSE REQUESTED (slot)
-// ====================================================
-void IDE::onTabCloseRequested(int tab)
-{
-  bool discard = false;
-
-  FileEditor* editor = static_cast<FileEditor*>(mpTabs->widget(tab)->userData(0));
-  if (editor->editor->hasUnsavedChanges())
-  {
-    int r = QMessageBox::warning(this, "Unsaved Changes", QString("Do you want to save changes to %1 before closing?").arg(editor->filename),
-                                 QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
-    
-    if (r == QMessageBox::Save) 
-    {
-      FileEditor* current = mpCurrentEditor;
-      mpCurrentEditor = editor;
-      save();
-      mpCurrentEditor = current;
-    }
-    else if (r == QMessageBox::Discard) discard = true;
-  }
-
-  // If the editor now has no unsaved changes, close it.  This isn't an else 
-  // because the above if statement may have been true and the contents of the
-  // editor saved.  We ONLY want to close the tab if the contents were saved, or
-  // the operator wants to discard changes.
-  if (!editor->editor->hasUnsavedChanges() || discard)
-  {
-    // Save the current editor before we remove it, because once it's removed then
-    // mpCurrentEditor points to something else.
-    FileEditor* old = editor;
-
-    // Remove the current tab
-    mpTabs->removeTab(tab);
-
-    // Remove the current editor from the vector
-    QVector<FileEditor*>::iterator itr = mEditors.begin();
-    while (itr != mEditors.end() && (*itr) != old) ++itr;
-    if (itr != mEditors.end())
-      mEditors.erase(itr);
-
-    // Delete the removed editor
-    delete old;
-  }
-} // onTabCloseRequested
-
-// ====================================================
-//  ON KEYWORD CHANGED (slot)
-// ====================================================
-void IDE::onKeywordChanged(const QString& keyword, const QString& format)
-{
-  // See if this is a valid keyword for this format
-  const config::FormatWordMap& words = 
-    config::ConfigFile::instance()->getWordsByFormat(format);
-  
-  setKeyword(keyword, format);
-} // onKeywordChanged
-
-// ====================================================
-//  ON EDITOR KEY EVENT (slot)
-// ====================================================
-void IDE::onEditorKeyEvent(QKeyEvent* e)
-{
-  // CTRL+Up or CTRL+Down : Change which keyword syntax is displayed
-  if (e->modifiers() & Qt::ControlModifier &&
-      mKeywordSyntaxesItr != mKeywordSyntaxes.end())
-  {
-    if (e->key() == Qt::Key_Up)
-    {
-      // Advance the iterator
-      ++mKeywordSyntaxesItr;
-      if (mKeywordSyntaxesItr == mKeywordSyntaxes.end())
-        mKeywordSyntaxesItr = mKeywordSyntaxes.begin();
-    }
-    else if (e->key() == Qt::Key_Down)
-    {
-      // Decrease the iterator
-      if (mKeywordSyntaxesItr != mKeywordSyntaxes.begin())
-        --mKeywordSyntaxesItr;
-      else
-        mKeywordSyntaxesItr = (mKeywordSyntaxes.end() - 1);
-    }
-
-    mpStatusBar->showMessage(*mKeywordSyntaxesItr);
-  }
-
-  // CTRL+Tab : Select next tab
-  else if (e->modifiers() & Qt::ControlModifier && e->key() == Qt::Key_Tab)
-  {
-    int index = mpTabs->currentIndex() + 1;
-    if (index == mpTabs->count())
-      index = 0;
-    mpTabs->setCurrentIndex(index);
-  }
-
-  // CTRL+BackTab (SHIFT+Tab) : Select prev tab
-  else if (e->modifiers() & Qt::ControlModifier && e->key() == Qt::Key_Backtab)
-  {
-    int index = mpTabs->currentIndex() - 1;
-    if (index < 0)
-      index = mpTabs->count() - 1;
-    mpTabs->setCurrentIndex(index);
-  }
-} // onEditorKeyEvent
-
-// ====================================================
-//  SET CURRENT FORMAT (slot)
-// ====================================================
-void IDE::setCurrentFormat(const QString& format)
-{
-  if (mpCurrentEditor)
-    mpCurrentEditor->editor->setFileFormat(format);
-} // setCurrentFormat
\ No newline at end of file
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <WinBase.h>
+#endif // _WIN32
+
+#include <QtGui/QtGui>
+#include "IDE.h"  // class declarations
+#include "TextEditor.h"
+#include "LargeFileEditor.h"
+#include "ConfigFile.h"
+#include "ConfigWatcher.h"
+#include "KeystrokeSession.h"
+#include "PerformanceHud.h"
+#include "Journal.h"
+#include "ResourceResolver.h"
+#include "ManualIndex.h"
+#include "ScriptBundle.h"
+#include "ScriptParser.h"
+#include "Trace.h"
+#include "Metrics.h"
+
+/// Quiet time after a file changes on disk before it is reloaded, in ms
+static const int RELOAD_DELAY = 300;
+
+/// Longest that a steady stream of changes can hold off reloading, in ms
+static const int MAX_RELOAD_DELAY = 2000;
+
+/// Time between saves of the session, in ms
+static const int SESSION_INTERVAL = 60 * 1000;
+
+IDE::FileEditor::FileEditor() {size = -1; editor = NULL; largeEditor = NULL; journal = NULL; pending = NULL;}
+IDE::FileEditor::~FileEditor() {delete pending; QWidget* w = widget(); if (w) {w->setUserData(0, NULL); delete w; editor = NULL; largeEditor = NULL; journal = NULL;}}
+QWidget* IDE::FileEditor::widget() const {return (largeEditor ? static_cast<QWidget*>(largeEditor) : editor);}
+bool IDE::FileEditor::load(const QString& path) {bool loaded = (largeEditor ? largeEditor->load(path) : editor->load(path)); if (loaded && journal) journal->clear(); return loaded;}
+bool IDE::FileEditor::save(const QString& path) {if (pending && path == this->path) return true; bool saved = (largeEditor ? largeEditor->save(path) : editor->save(path)); if (saved && journal) journal->clear(); return saved;}
+bool IDE::FileEditor::hasUnsavedChanges() const {return (largeEditor ? largeEditor->hasUnsavedChanges() : editor->hasUnsavedChanges());}
+void IDE::FileEditor::setFileFormat(const QString& format) {if (pending) pending->format = format; else if (largeEditor) largeEditor->setFileFormat(format); else editor->setFileFormat(format);}
+QString IDE::FileEditor::fileFormat() const {return (pending ? pending->format : largeEditor ? largeEditor->fileFormat() : editor->fileFormat());}
+void IDE::FileEditor::reloadRules() {if (pending) return; if (largeEditor) largeEditor->reloadRules(); else editor->reloadRules();}
+
+// ====================================================
+//  CTOR
+// ====================================================
+IDE::IDE(QWidget* parent, bool statusBar)
+  : QWidget(parent)
+{
+  setAcceptDrops(true);
+  mKeywordSyntaxesItr = mKeywordSyntaxes.end();
+  mpCurrentEditor = NULL;
+  mpRecording = NULL;
+
+  // Load the ConfigFile, and take up changes to its files as they're saved
+  config::ConfigFile::instance();
+  connect(config::ConfigWatcher::instance(), SIGNAL(changed(const QStringList&)), this, SLOT(onRulesChanged(const QStringList&)));
+  connect(ResourceResolver::instance(), SIGNAL(dependenciesChanged(const QStringList&)),
+          this, SLOT(onDependenciesChanged(const QStringList&)));
+
+  // Create a VBox Layout for the editors and status bar
+  QVBoxLayout* vbox = new QVBoxLayout;
+  vbox->setMargin(0);
+  vbox->setSpacing(0);
+
+  // Define the default font for each editor
+  mFont;
+  mFont.setFamily("Courier New");
+  mFont.setFixedPitch(true);
+  mFont.setPointSize(10);
+
+  // Create the tab widget that will hold each editor.
+  mpTabs = new QTabWidget(this);
+  mpTabs->setTabsClosable(true);
+  mpTabs->setMovable(true);
+  mpTabs->setTabShape(QTabWidget::Triangular);
+  connect(mpTabs, SIGNAL(currentChanged(int)), this, SLOT(onTabChanged(int)));
+  connect(mpTabs, SIGNAL(tabCloseRequested(int)), this, SLOT(onTabCloseRequested(int)));
+  
+  // Create the status bar.  Only show it if statusBar is true
+  mpStatusBar = new QStatusBar(this);
+  mpStatusBar->setVisible(statusBar);
+
+  // Create the performance HUD.  It lives on the right of the status bar and
+  // is hidden until it's turned on.
+  mpHud = new PerformanceHud(mpStatusBar);
+  mpStatusBar->addPermanentWidget(mpHud);
+  mpHud->hide();
+
+  // Watch open files for changes made by other programs.  Tools that
+  // regenerate many files at once send a burst of changes, so they're
+  // collected until things go quiet and then reloaded together.
+  mpWatcher = new QFileSystemWatcher(this);
+  connect(mpWatcher, SIGNAL(fileChanged(const QString&)), this, SLOT(onFileChanged(const QString&)));
+  mpReloadTimer = new QTimer(this);
+  mpReloadTimer->setSingleShot(true);
+  connect(mpReloadTimer, SIGNAL(timeout()), this, SLOT(reloadChangedFiles()));
+
+  // Journal unsaved changes, next to config.xml, so they survive a crash
+  mpJournalWriter = new JournalWriter(QDir::current().absoluteFilePath("journal"));
+
+  // Save the open tabs from time to time, and on exit, for the next start
+  mSessionPath = QDir::current().absoluteFilePath("session.dat");
+  mSessionHash = 0;
+  mRestoring = false;
+  mpSessionTimer = new QTimer(this);
+  connect(mpSessionTimer, SIGNAL(timeout()), this, SLOT(saveSession()));
+  mpSessionTimer->start(SESSION_INTERVAL);
+    
+  // Add the tab widget and status bar to the vbox
+  vbox->addWidget(mpTabs);
+  vbox->addWidget(mpStatusBar);
+
+  setLayout(vbox);
+} // ctor
+
+// ====================================================
+//  DTOR
+// ====================================================
+IDE::~IDE(void)
+{
+  saveSession();
+
+  foreach (FileEditor* fe, mEditors)
+    delete fe;
+  delete mpRecording;
+
+  // After the editors, which end their journals through it
+  delete mpJournalWriter;
+} // dtor
+
+// ====================================================
+//  ADD EDITOR
+// ====================================================
+void IDE::addEditor(const QString& filename, const QString& path, bool large)
+{
+  // Create a new FileEditor struct to hold the filename, path, and
+  // editor for the new editor
+  FileEditor* fe = new FileEditor;
+  fe->filename = filename;
+  fe->path = path;
+  createEditor(fe, large);
+  mEditors.push_back(fe);
+  updatePerformanceHud();
+
+  // Add this new editor to the tab widget and make it the current tab
+  int tab = mpTabs->addTab(fe->widget(), fe->filename);
+  mpTabs->setTabToolTip(tab, fe->path);
+  mpTabs->setCurrentWidget(fe->widget()); // causes mpTabs to emit signal currentChanged()
+} // addEditor
+
+// ====================================================
+//  CREATE EDITOR
+// ====================================================
+void IDE::createEditor(FileEditor* fe, bool large)
+{
+  if (large)
+  {
+    fe->largeEditor = new LargeFileEditor(mpTabs);
+    fe->journal = NULL;
+    connect(fe->largeEditor, SIGNAL(reflowed()), this, SLOT(onReflowed()));
+  }
+  else
+  {
+    fe->editor = new TextEditor(mpTabs);
+    fe->journal = new Journal(fe->editor, mpJournalWriter);
+    fe->journal->setFile(fe->path, fe->filename);
+  }
+
+  // Both editors have the same signals
+  QWidget* w = fe->widget();
+  w->setFont(mFont);
+  w->setUserData(0, fe);
+  connect(w, SIGNAL(fileDropped(const QString&)), this, SLOT(onFileDropped(const QString&)));
+  connect(w, SIGNAL(keywordChanged(Atom, const QString&)), this, SLOT(onKeywordChanged(Atom, const QString&)));
+  connect(w, SIGNAL(keyPressed(QKeyEvent*)), this, SLOT(onEditorKeyEvent(QKeyEvent*)));
+} // createEditor
+
+// ====================================================
+//  OPEN FILE
+// ====================================================
+void IDE::openFile(const QString& path)
+{
+  TRACE_SCOPE("IDE::openFile");
+
+  // Files that TextEditor can't lay out, because they're too big or have
+  // enormous lines, go to a LargeFileEditor.  It has selection, the
+  // clipboard and undo too, and those with long lines are offered a reflow,
+  // which may bring them back to a TextEditor.
+  bool longLines = false;
+  bool large = !TextEditor::canLayOut(path, &longLines);
+
+  QFileInfo fi(path);
+  addEditor(fi.fileName(), fi.absoluteFilePath(), large);
+  mpCurrentEditor->load(path);
+  watch(mpCurrentEditor);
+  if (longLines)
+    mpCurrentEditor->largeEditor->setReflowOffered(true);
+} // openFile
+
+// ====================================================
+//  WATCH
+// ====================================================
+void IDE::watch(FileEditor* fe)
+{
+  // Remember the file as it is now, so that the change notification for
+  // our own load or save can be told apart from another program's
+  QFileInfo fi(fe->path);
+  fe->modified = fi.lastModified();
+  fe->size = fi.size();
+
+  if (fi.exists() && !mpWatcher->files().contains(fe->path))
+    mpWatcher->addPath(fe->path);
+} // watch
+
+// ====================================================
+//  REPORT IMPACT
+// ====================================================
+void IDE::reportImpact(const QString& path)
+{
+  // The script is read off the GUI thread, so the graph only knows what
+  // the save changed once onDependenciesChanged() names it
+  if (ResourceResolver::instance()->fileSaved(path))
+    mSavedScripts.insert(path);
+} // reportImpact
+
+// ====================================================
+//  SHOW IMPACT
+// ====================================================
+void IDE::showImpact(const QString& path)
+{
+  ResourceResolver* resolver = ResourceResolver::instance();
+  if (!resolver->dependencies().hasFile(path))
+    return;
+
+  // Tell how far the save reaches, so a change to a base material or a
+  // shared program doesn't go unnoticed
+  DependencyNode file;
+  file.kind = DEPENDENCY_FILE;
+  file.name = path;
+  QVector<DependencyNode> affected;
+  resolver->dependencies().affectedBy(file, affected);
+
+  int materials = 0, overlays = 0;
+  foreach (const DependencyNode& node, affected)
+  {
+    if (node.kind == DEPENDENCY_MATERIAL)
+      ++materials;
+    else if (node.kind == DEPENDENCY_OVERLAY)
+      ++overlays;
+  }
+  mpStatusBar->showMessage(QString("Saved %1: affects %2 material(s) and %3 overlay(s)")
+                           .arg(QFileInfo(path).fileName()).arg(materials).arg(overlays), 5000);
+} // showImpact
+
+// ====================================================
+//  RELOAD FILE
+// ====================================================
+bool IDE::reloadFile(FileEditor* fe)
+{
+  bool reloaded;
+  if (fe->editor)
+  {
+    reloaded = (fe->editor->reload(fe->path) >= 0);
+    if (reloaded)
+      fe->journal->clear();
+  }
+  else
+  {
+    // The large editor's view is of the mapped file, which has to be mapped
+    // again, so only its position can be kept
+    qint64 cursor = fe->largeEditor->cursorPosition();
+    reloaded = fe->largeEditor->load(fe->path);
+    fe->largeEditor->setCursorPosition(cursor);
+  }
+
+  watch(fe);
+  return reloaded;
+} // reloadFile
+
+// ====================================================
+//  RESTORE TAB
+// ====================================================
+void IDE::restoreTab(FileEditor* fe)
+{
+  TRACE_SCOPE("IDE::restoreTab");
+
+  SessionTab* tab = fe->pending;
+  fe->pending = NULL;
+
+  if (fe->editor)
+  {
+    // The saved highlighting is used if the file hasn't changed since
+    fe->editor->load(fe->path, &tab->highlight);
+    fe->journal->clear();
+    if (fe->editor->fileHash() == tab->highlight.fileHash)
+      fe->highlight = tab->highlight;
+    if (!tab->format.isEmpty() && tab->format != fe->editor->fileFormat())
+      fe->editor->setFileFormat(tab->format);
+
+    QTextCursor cursor = fe->editor->textCursor();
+    cursor.setPosition(static_cast<int>(qBound(Q_INT64_C(0), tab->cursorPosition, static_cast<qint64>(fe->editor->document()->characterCount() - 1))));
+    fe->editor->setTextCursor(cursor);
+    fe->editor->horizontalScrollBar()->setValue(tab->horizontalScroll);
+    fe->editor->verticalScrollBar()->setValue(tab->verticalScroll);
+  }
+  else
+  {
+    fe->largeEditor->load(fe->path);
+    if (!tab->format.isEmpty())
+      fe->largeEditor->setFileFormat(tab->format);
+    fe->largeEditor->setCursorPosition(tab->cursorPosition);
+  }
+
+  watch(fe);
+  updatePerformanceHud();
+  delete tab;
+} // restoreTab
+
+// ====================================================
+//  DRAG ENTER EVENT (inherited)
+// ====================================================
+void IDE::dragEnterEvent(QDragEnterEvent* e)
+{
+  if (e->mimeData()->hasUrls())
+    e->acceptProposedAction();
+  else
+    QWidget::dragEnterEvent(e);
+} // dragEnterEvent
+
+// ====================================================
+//  DROP EVENT (inherited)
+// ====================================================
+void IDE::dropEvent(QDropEvent* e)
+{
+  if (e->mimeData()->hasUrls())
+  {
+    QList<QUrl> urls = e->mimeData()->urls();
+    foreach (QUrl url, urls)
+      onFileDropped(url.toLocalFile());
+  }
+  else
+    QWidget::dropEvent(e);
+} // dropEvent
+
+// ====================================================
+//  SET KEYWORD
+// ====================================================
+void IDE::setKeyword(Atom keyword, const QString& format)
+{
+  TRACE_SCOPE("IDE::setKeyword");
+
+  const config::FormatWord* word = 
+    config::ConfigFile::instance()->findWord(format, keyword);
+
+  // Clear the current status
+  mpStatusBar->clearMessage();
+
+  // Clear any existing syntaxes
+  mKeywordSyntaxes.clear();
+  
+  if (word)
+  {
+    // The manual's index has the text of every page, so nothing is read
+    // unless the index isn't built yet
+    QString text = ManualIndexer::instance()->index().pageText(word->doc);
+    if (text.isEmpty())
+    {
+      QFile file(config::ConfigFile::instance()->getManualPath() + word->doc);
+      if (file.open(QFile::ReadOnly | QFile::Text))
+      {
+        TRACE_SCOPE("IDE::setKeyword (read manual)");
+        text = ManualIndex::toPlainText(QTextStream(&file).readAll());
+      }
+    }
+
+    // Probably never going to be 4 different formats, but just to be sure...
+    for (int i = 0; i < 4; ++i)
+    {
+      // Look for the string "Format: <keyword>"
+      QString pattern = QString("Format%1: %2 ")
+                        .arg((i==0) ? "" : QString::number(i))
+                        .arg(word->word);
+      QStringMatcher matcher(pattern);
+      int index = matcher.indexIn(text);
+      if (index >= 0)
+      {
+        // The syntax runs to the end of its line, where the page had a <BR>
+        int endIndex = text.indexOf('\n', index);
+        if (endIndex >= 0)
+          mKeywordSyntaxes.push_back(text.mid(index, endIndex - index).trimmed());
+      }
+    }
+  }
+
+  // Point to the first syntax
+  mKeywordSyntaxesItr = mKeywordSyntaxes.begin();
+
+  // If there is at least one valid syntax, show the first one
+  if (mKeywordSyntaxesItr != mKeywordSyntaxes.end())
+    mpStatusBar->showMessage(*mKeywordSyntaxesItr);
+} // setKeyword
+
+// ====================================================
+//  UPDATE PERFORMANCE HUD
+// ====================================================
+void IDE::updatePerformanceHud(void)
+{
+  QVector<TextEditor*> editors;
+  foreach (FileEditor* fe, mEditors)
+  {
+    if (fe->editor)
+      editors.push_back(fe->editor);
+  }
+
+  mpHud->setEditors(editors);
+  mpHud->setEditor(mpCurrentEditor ? mpCurrentEditor->editor : NULL);
+} // updatePerformanceHud
+
+// ---------------------------------------------------------------------
+//                               SLOTS
+// ---------------------------------------------------------------------
+
+// ====================================================
+//  ON FILE DROPPED (slot)
+// ====================================================
+void IDE::onFileDropped(const QString& path)
+{
+  QFileInfo fi(path);
+  if (fi.exists())
+  {
+    // See if a text editor for this file already exists
+    foreach (FileEditor* fe, mEditors)
+    {
+      if (fe->path == fi.absoluteFilePath())
+      {
+        mpTabs->setCurrentWidget(fe->widget());
+        return;
+      }
+    }
+
+    openFile(fi.absoluteFilePath());
+  }
+} // onFileDropped
+
+// ====================================================
+//  NEW FILE (slot)
+// ====================================================
+void IDE::newFile(void)
+{
+  addEditor("untitled", "");
+} // neFile
+
+// ====================================================
+//  SAVE (slot)
+// ====================================================
+void IDE::save(void)
+{
+  if (mpCurrentEditor)
+  {
+    // If the path for this file exists, save to it
+    if (QFile::exists(mpCurrentEditor->path))
+    {
+      mpCurrentEditor->save(mpCurrentEditor->path);
+      watch(mpCurrentEditor);
+      reportImpact(mpCurrentEditor->path);
+    }
+
+    // Otherwise, call saveAs()
+    else
+      saveAs();
+  }
+} // save
+
+// ====================================================
+//  SAVE AS (slot)
+// ====================================================
+void IDE::saveAs(void)
+{
+  if (mpCurrentEditor)
+  {
+    QString path = QFileDialog::getSaveFileName(this, "Save As");
+    if (!path.isNull())
+    {
+      QFileInfo fi(path);
+      mpCurrentEditor->save(path);
+      if (!mpCurrentEditor->path.isEmpty())
+        mpWatcher->removePath(mpCurrentEditor->path);
+      mpCurrentEditor->path = fi.absoluteFilePath();
+      mpCurrentEditor->filename = fi.fileName();
+      if (mpCurrentEditor->journal)
+        mpCurrentEditor->journal->setFile(mpCurrentEditor->path, mpCurrentEditor->filename);
+      watch(mpCurrentEditor);
+      reportImpact(mpCurrentEditor->path);
+      mpTabs->setTabText(mpTabs->indexOf(mpCurrentEditor->widget()), mpCurrentEditor->filename);
+    }
+  }
+} // saveAs
+
+// ====================================================
+//  OPEN (slot)
+// ====================================================
+void IDE::open(void)
+{
+  QStringList files = QFileDialog::getOpenFileNames(this, "Open Files");
+  foreach (QString path, files)
+    openFile(path);
+} // open
+
+// ====================================================
+//  OPEN FROM BUNDLE (slot)
+// ====================================================
+void IDE::openFromBundle(void)
+{
+  QString path = QFileDialog::getOpenFileName(this, "Open From Bundle");
+  if (path.isNull())
+    return;
+
+  // Only the index is read to list the scripts
+  ScriptBundle bundle;
+  if (!bundle.open(path))
+  {
+    QMessageBox::warning(this, "Open From Bundle", QString("%1 is not a script bundle.").arg(QFileInfo(path).fileName()));
+    return;
+  }
+
+  QStringList names;
+  for (int i = 0; i < bundle.count(); ++i)
+    names << bundle.name(i);
+  bool chosen = false;
+  QString name = QInputDialog::getItem(this, "Open From Bundle", "Script:", names, 0, true, &chosen);
+  if (!chosen)
+    return;
+
+  int index = bundle.find(name);
+  QString problem;
+  if (index < 0)
+    problem = QString("There is no %1 in %2.");
+  else if (bundle.size(index) > TextEditor::MAX_FILE_SIZE)
+    problem = QString("%1 in %2 is too large to edit.");
+  else if (!bundle.verify(index))
+    problem = QString("%1 in %2 is corrupt.");
+  if (!problem.isEmpty())
+  {
+    QMessageBox::warning(this, "Open From Bundle", problem.arg(name, QFileInfo(path).fileName()));
+    return;
+  }
+
+  // The script has no file of its own, so it's saved like a new one
+  QFileInfo fi(name);
+  addEditor(fi.fileName(), QString());
+  mpCurrentEditor->setFileFormat(config::ConfigFile::instance()->getFormatByExtension(fi.suffix()));
+  mpCurrentEditor->editor->setPlainText(QString::fromUtf8(bundle.data(index), bundle.size(index)));
+  mpTabs->setTabToolTip(mpTabs->currentIndex(), QString("%1 in %2").arg(name, QDir::toNativeSeparators(path)));
+} // openFromBundle
+
+// ====================================================
+//  ON TAB CHANGED (slot)
+// ====================================================
+void IDE::onTabChanged(int tab)
+{
+  if (mpTabs->currentWidget())
+  {
+    mpCurrentEditor = static_cast<FileEditor*>(mpTabs->currentWidget()->userData(0));
+    if (mpCurrentEditor->pending && !mRestoring)
+      restoreTab(mpCurrentEditor);
+    mpCurrentEditor->widget()->setFocus();
+  }
+  else
+  {
+    mpCurrentEditor = NULL;
+  }
+
+  updatePerformanceHud();
+  emit currentEditorChanged(mpCurrentEditor ? mpCurrentEditor->editor : NULL);
+} // onTabChanged
+
+// ====================================================
+//  ON TAB CLOSE REQUESTED (slot)
+// ====================================================
+void IDE::onTabCloseRequested(int tab)
+{
+  bool discard = false;
+
+  FileEditor* editor = static_cast<FileEditor*>(mpTabs->widget(tab)->userData(0));
+  if (editor->hasUnsavedChanges())
+  {
+    int r = QMessageBox::warning(this, "Unsaved Changes", QString("Do you want to save changes to %1 before closing?").arg(editor->filename),
+                                 QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
+    
+    if (r == QMessageBox::Save) 
+    {
+      FileEditor* current = mpCurrentEditor;
+      mpCurrentEditor = editor;
+      save();
+      mpCurrentEditor = current;
+    }
+    else if (r == QMessageBox::Discard) discard = true;
+  }
+
+  // If the editor now has no unsaved changes, close it.  This isn't an else 
+  // because the above if statement may have been true and the contents of the
+  // editor saved.  We ONLY want to close the tab if the contents were saved, or
+  // the operator wants to discard changes.
+  if (!editor->hasUnsavedChanges() || discard)
+  {
+    // Save the current editor before we remove it, because once it's removed then
+    // mpCurrentEditor points to something else.
+    FileEditor* old = editor;
+
+    // Remove the current tab
+    mpTabs->removeTab(tab);
+    if (!old->path.isEmpty())
+      mpWatcher->removePath(old->path);
+
+    // Remove the current editor from the vector
+    QVector<FileEditor*>::iterator itr = mEditors.begin();
+    while (itr != mEditors.end() && (*itr) != old) ++itr;
+    if (itr != mEditors.end())
+      mEditors.erase(itr);
+
+    // Delete the removed editor
+    delete old;
+    updatePerformanceHud();
+  }
+} // onTabCloseRequested
+
+// ====================================================
+//  ON KEYWORD CHANGED (slot)
+// ====================================================
+void IDE::onKeywordChanged(Atom keyword, const QString& format)
+{
+  setKeyword(keyword, format);
+} // onKeywordChanged
+
+// ====================================================
+//  ON EDITOR KEY EVENT (slot)
+// ====================================================
+void IDE::onEditorKeyEvent(QKeyEvent* e)
+{
+  // Record the key press if a keystroke session is being recorded
+  if (mpRecording)
+    mpRecording->append(*e);
+
+  // CTRL+Up or CTRL+Down : Change which keyword syntax is displayed
+  if (e->modifiers() & Qt::ControlModifier &&
+      mKeywordSyntaxesItr != mKeywordSyntaxes.end())
+  {
+    if (e->key() == Qt::Key_Up)
+    {
+      // Advance the iterator
+      ++mKeywordSyntaxesItr;
+      if (mKeywordSyntaxesItr == mKeywordSyntaxes.end())
+        mKeywordSyntaxesItr = mKeywordSyntaxes.begin();
+    }
+    else if (e->key() == Qt::Key_Down)
+    {
+      // Decrease the iterator
+      if (mKeywordSyntaxesItr != mKeywordSyntaxes.begin())
+        --mKeywordSyntaxesItr;
+      else
+        mKeywordSyntaxesItr = (mKeywordSyntaxes.end() - 1);
+    }
+
+    mpStatusBar->showMessage(*mKeywordSyntaxesItr);
+  }
+
+  // CTRL+Tab : Select next tab
+  else if (e->modifiers() & Qt::ControlModifier && e->key() == Qt::Key_Tab)
+  {
+    int index = mpTabs->currentIndex() + 1;
+    if (index == mpTabs->count())
+      index = 0;
+    mpTabs->setCurrentIndex(index);
+  }
+
+  // CTRL+BackTab (SHIFT+Tab) : Select prev tab
+  else if (e->modifiers() & Qt::ControlModifier && e->key() == Qt::Key_Backtab)
+  {
+    int index = mpTabs->currentIndex() - 1;
+    if (index < 0)
+      index = mpTabs->count() - 1;
+    mpTabs->setCurrentIndex(index);
+  }
+} // onEditorKeyEvent
+
+// ====================================================
+//  ON REFLOWED (slot)
+// ====================================================
+void IDE::onReflowed(void)
+{
+  LargeFileEditor* large = qobject_cast<LargeFileEditor*>(sender());
+  FileEditor* fe = static_cast<FileEditor*>(large->userData(0));
+
+  // If the reflowed document can be laid out now, move it to a TextEditor,
+  // which has completion and diagnostics
+  const PieceTable& buffer = large->buffer();
+  if (buffer.size() > TextEditor::MAX_FILE_SIZE)
+    return;
+  QByteArray text = buffer.read(0, buffer.size());
+  if (!TextEditor::canLayOut(text))
+    return;
+
+  int tab = mpTabs->indexOf(large);
+  large->setUserData(0, NULL);
+  fe->largeEditor = NULL;
+  createEditor(fe, false);
+  fe->editor->setFileFormat(large->fileFormat());
+  fe->editor->setPlainText(text);   // Leaves it with unsaved changes
+
+  mpTabs->insertTab(tab, fe->editor, fe->filename);
+  mpTabs->setTabToolTip(tab, fe->path);
+  mpTabs->setCurrentWidget(fe->editor);
+  mpTabs->removeTab(mpTabs->indexOf(large));
+
+  // This is called from the old editor's signal, so it can't be deleted yet
+  large->deleteLater();
+  updatePerformanceHud();
+} // onReflowed
+
+// ====================================================
+//  ON FILE CHANGED (slot)
+// ====================================================
+void IDE::onFileChanged(const QString& path)
+{
+  // Wait for the changes to stop, but not forever
+  if (mChangedFiles.isEmpty())
+    mFirstChange.start();
+  mChangedFiles.insert(path);
+
+  if (mFirstChange.elapsed() < MAX_RELOAD_DELAY)
+    mpReloadTimer->start(RELOAD_DELAY);
+} // onFileChanged
+
+// ====================================================
+//  RELOAD CHANGED FILES (slot)
+// ====================================================
+void IDE::reloadChangedFiles(void)
+{
+  TRACE_SCOPE("IDE::reloadChangedFiles");
+  QElapsedTimer timer;
+  timer.start();
+
+  QSet<QString> paths = mChangedFiles;
+  mChangedFiles.clear();
+
+  int reloaded = 0;
+  int answer = QMessageBox::NoButton;   // Becomes YesToAll or NoToAll
+  foreach (FileEditor* fe, mEditors)
+  {
+    if (!paths.contains(fe->path))
+      continue;
+
+    // Programs that save by replacing the file, as LargeFileEditor does,
+    // leave the watcher watching nothing, so watch the new file.  A file
+    // that's gone is left alone; the document still holds its text.
+    QFileInfo fi(fe->path);
+    if (!fi.exists())
+      continue;
+    if (!mpWatcher->files().contains(fe->path))
+      mpWatcher->addPath(fe->path);
+
+    // A tab that hasn't been shown yet will load the file as it is then
+    if (fe->pending)
+    {
+      watch(fe);
+      continue;
+    }
+
+    // Our own saves and loads are already in the document
+    if (fi.lastModified() == fe->modified && fi.size() == fe->size)
+      continue;
+
+    if (fe->hasUnsavedChanges())
+    {
+      int r = answer;
+      if (r == QMessageBox::NoButton)
+      {
+        r = QMessageBox::question(this, "File Changed",
+                                  QString("%1 has been changed by another program.  Do you want to reload it and lose your changes?").arg(fe->filename),
+                                  QMessageBox::Yes | QMessageBox::No | QMessageBox::YesToAll | QMessageBox::NoToAll, QMessageBox::No);
+        if (r == QMessageBox::YesToAll || r == QMessageBox::NoToAll)
+          answer = r;
+      }
+
+      // The tab may have been closed while the question was up
+      if (!mEditors.contains(fe))
+        continue;
+      if (r == QMessageBox::No || r == QMessageBox::NoToAll)
+      {
+        // Don't ask again until it changes again
+        fe->modified = fi.lastModified();
+        fe->size = fi.size();
+        continue;
+      }
+    }
+
+    if (reloadFile(fe))
+      ++reloaded;
+  }
+
+  if (reloaded > 0)
+  {
+    mpStatusBar->showMessage(QString("Reloaded %1 file(s) changed on disk").arg(reloaded), 5000);
+    updatePerformanceHud();
+  }
+
+  static metrics::Metric* reloadMs = metrics::Registry::instance()->metric("ide.reload_ms");
+  reloadMs->sample(timer.nsecsElapsed() / 1000000.0);
+} // reloadChangedFiles
+
+// ====================================================
+//  ON RULES CHANGED (slot)
+// ====================================================
+void IDE::onRulesChanged(const QStringList& formats)
+{
+  TRACE_SCOPE("IDE::onRulesChanged");
+
+  // Only the editors of the formats that changed are restyled, the one in
+  // view first.  Tabs that were restored but not shown yet pick up the new
+  // rules when they're loaded.
+  int restyled = 0;
+  if (mpCurrentEditor && !mpCurrentEditor->pending && formats.contains(mpCurrentEditor->fileFormat()))
+  {
+    mpCurrentEditor->reloadRules();
+    ++restyled;
+  }
+  foreach (FileEditor* fe, mEditors)
+  {
+    if (fe != mpCurrentEditor && !fe->pending && formats.contains(fe->fileFormat()))
+    {
+      fe->reloadRules();
+      ++restyled;
+    }
+  }
+
+  mpStatusBar->showMessage(QString("Reloaded the rules of %1 (%2 file(s) restyled)").arg(formats.join(", ")).arg(restyled), 5000);
+} // onRulesChanged
+
+// ====================================================
+//  ON DEPENDENCIES CHANGED (slot)
+// ====================================================
+void IDE::onDependenciesChanged(const QStringList& scripts)
+{
+  foreach (const QString& script, scripts)
+  {
+    if (mSavedScripts.remove(script))
+      showImpact(script);
+  }
+} // onDependenciesChanged
+
+// ====================================================
+//  SET CURRENT FORMAT (slot)
+// ====================================================
+void IDE::setCurrentFormat(const QString& format)
+{
+  if (mpCurrentEditor)
+  {
+    mpCurrentEditor->setFileFormat(format);
+    emit currentEditorChanged(mpCurrentEditor->editor);
+  }
+} // setCurrentFormat
+
+// ====================================================
+//  FOLD ALL (slot)
+// ====================================================
+void IDE::foldAll(void)
+{
+  if (mpCurrentEditor && mpCurrentEditor->editor)
+    mpCurrentEditor->editor->foldAll();
+} // foldAll
+
+// ====================================================
+//  UNFOLD ALL (slot)
+// ====================================================
+void IDE::unfoldAll(void)
+{
+  if (mpCurrentEditor && mpCurrentEditor->editor)
+    mpCurrentEditor->editor->unfoldAll();
+} // unfoldAll
+
+// ====================================================
+//  SET RECORDING (slot)
+// ====================================================
+void IDE::setRecording(bool record)
+{
+  if (record && mpRecording == NULL)
+  {
+    // Remember where the session starts so that it can be replayed against
+    // the same file
+    mpRecording = new KeystrokeSession;
+    if (mpCurrentEditor)
+    {
+      mpRecording->file = mpCurrentEditor->path;
+      if (mpCurrentEditor->editor)
+        mpRecording->cursorPosition = mpCurrentEditor->editor->textCursor().position();
+    }
+  }
+  else if (!record && mpRecording)
+  {
+    QString path = QFileDialog::getSaveFileName(this, "Save Keystroke Session", QString(), "Keystroke Sessions (*.keys)");
+    if (!path.isNull() && !mpRecording->save(path))
+      QMessageBox::warning(this, "Keystroke Session", QString("Could not save %1").arg(path));
+
+    delete mpRecording;
+    mpRecording = NULL;
+  }
+} // setRecording
+
+// ====================================================
+//  SET PERFORMANCE HUD VISIBLE (slot)
+// ====================================================
+void IDE::setPerformanceHudVisible(bool visible)
+{
+  mpHud->setVisible(visible);
+} // setPerformanceHudVisible
+
+// ====================================================
+//  RECOVER JOURNALS (slot)
+// ====================================================
+void IDE::recoverJournals(void)
+{
+  TRACE_SCOPE("IDE::recoverJournals");
+
+  QList<RecoveredDocument> docs = JournalWriter::recover(mpJournalWriter->directory());
+  if (docs.isEmpty())
+    return;
+
+  QStringList names;
+  foreach (const RecoveredDocument& doc, docs)
+    names << (doc.path.isEmpty() ? doc.filename : doc.path);
+
+  // Cancel keeps the journals for the next start
+  int r = QMessageBox::question(this, "Recover Unsaved Changes",
+                                QString("The editor closed without saving changes to:\n\n%1\n\nDo you want to recover them?").arg(names.join("\n")),
+                                QMessageBox::Yes | QMessageBox::Discard | QMessageBox::Cancel, QMessageBox::Yes);
+  if (r != QMessageBox::Yes && r != QMessageBox::Discard)
+    return;
+
+  foreach (const RecoveredDocument& doc, docs)
+  {
+    // The recovered documents get journals of their own as they're opened
+    if (r == QMessageBox::Yes)
+    {
+      // The file may be open already, from the last session
+      FileEditor* fe = NULL;
+      foreach (FileEditor* other, mEditors)
+      {
+        if (!doc.path.isEmpty() && other->path == doc.path && other->editor)
+          fe = other;
+      }
+
+      if (fe)
+      {
+        mpTabs->setCurrentWidget(fe->widget());
+        if (fe->pending)
+          restoreTab(fe);
+      }
+      else
+      {
+        addEditor(doc.filename, doc.path);
+        fe = mpCurrentEditor;
+        if (!doc.path.isEmpty())
+          watch(fe);
+      }
+
+      // A file that has grown too big for a TextEditor keeps its journal
+      // until it can be recovered into one
+      if (fe->editor == NULL)
+        continue;
+
+      if (!doc.format.isEmpty())
+        fe->editor->setFileFormat(doc.format);
+      fe->editor->setPlainText(doc.text);   // Leaves it with unsaved changes
+    }
+
+    // Restored or discarded, unless its editor has started again since
+    JournalWriter::discard(doc);
+  }
+} // recoverJournals
+
+// ====================================================
+//  SAVE SESSION (slot)
+// ====================================================
+void IDE::saveSession(void)
+{
+  TRACE_SCOPE("IDE::saveSession");
+
+  Session session;
+  for (int i = 0; i < mpTabs->count(); ++i)
+  {
+    FileEditor* fe = static_cast<FileEditor*>(mpTabs->widget(i)->userData(0));
+    if (fe->path.isEmpty())
+      continue;
+    if (fe == mpCurrentEditor)
+      session.currentTab = session.tabs.size();
+
+    // Tabs that haven't been shown are saved as they were restored
+    if (fe->pending)
+    {
+      session.tabs.push_back(*fe->pending);
+      continue;
+    }
+
+    SessionTab tab;
+    tab.path = fe->path;
+    if (fe->editor)
+    {
+      tab.format = fe->editor->fileFormat();
+      tab.cursorPosition = fe->editor->textCursor().position();
+      tab.horizontalScroll = fe->editor->horizontalScrollBar()->value();
+      tab.verticalScroll = fe->editor->verticalScrollBar()->value();
+
+      // The highlighting is only of use while the document matches its
+      // file, and only needs capturing again once the file changes
+      if (!fe->editor->hasUnsavedChanges())
+      {
+        if (fe->highlight.fileHash != fe->editor->fileHash() || fe->highlight.format != tab.format ||
+            fe->highlight.rulesStamp != config::ConfigFile::instance()->getRulesStamp())
+          fe->highlight = fe->editor->highlightCache();
+        tab.highlight = fe->highlight;
+      }
+    }
+    else
+    {
+      tab.format = fe->largeEditor->fileFormat();
+      tab.large = true;
+      tab.cursorPosition = fe->largeEditor->cursorPosition();
+    }
+    session.tabs.push_back(tab);
+  }
+
+  // Skip the write if nothing has changed since the last one
+  QByteArray data = session.toByteArray();
+  uint hash = qHash(data);
+  if (hash != mSessionHash && session.save(mSessionPath))
+    mSessionHash = hash;
+
+  ResourceResolver::instance()->saveDependencies();
+} // saveSession
+
+// ====================================================
+//  COMPARE WITH SAVED (slot)
+// ====================================================
+void IDE::compareWithSaved(void)
+{
+  if (mpCurrentEditor && QFile::exists(mpCurrentEditor->path))
+    compareWith(mpCurrentEditor->path, QString("%1 since it was saved").arg(mpCurrentEditor->filename));
+} // compareWithSaved
+
+// ====================================================
+//  COMPARE WITH FILE (slot)
+// ====================================================
+void IDE::compareWithFile(void)
+{
+  if (mpCurrentEditor == NULL)
+    return;
+
+  QString path = QFileDialog::getOpenFileName(this, "Compare With");
+  if (!path.isNull())
+    compareWith(path, QString("%1 against %2").arg(mpCurrentEditor->filename, QFileInfo(path).fileName()));
+} // compareWithFile
+
+// ====================================================
+//  COMPARE WITH
+// ====================================================
+void IDE::compareWith(const QString& path, const QString& title)
+{
+  TRACE_SCOPE("IDE::compareWith");
+
+  if (mpCurrentEditor->editor == NULL)
+  {
+    mpStatusBar->showMessage("Files open in large file mode can't be compared", 5000);
+    return;
+  }
+
+  script::ScriptFile before;
+  if (!before.open(path))
+  {
+    mpStatusBar->showMessage(QString("Could not read %1").arg(path), 5000);
+    return;
+  }
+
+  QByteArray text = mpCurrentEditor->editor->toPlainText().toUtf8();
+  script::ScriptFile after;
+  after.parse(text.constData(), text.size());
+
+  QVector<ScriptChange> changes;
+  ScriptDiff::diff(before.root(), after.root(), changes);
+  mpStatusBar->showMessage(QString("%1 structural difference(s)").arg(changes.size()), 5000);
+  emit compared(title, changes);
+} // compareWith
+
+// ====================================================
+//  RESTORE SESSION (slot)
+// ====================================================
+void IDE::restoreSession(void)
+{
+  TRACE_SCOPE("IDE::restoreSession");
+
+  Session session;
+  if (!session.load(mSessionPath))
+    return;
+
+  // Put the tabs back without loading anything, then show the current one,
+  // which is the only one loaded until another is shown
+  mRestoring = true;
+  FileEditor* current = NULL;
+  for (int i = 0; i < session.tabs.size(); ++i)
+  {
+    const SessionTab& tab = session.tabs[i];
+    QFileInfo fi(tab.path);
+    if (!fi.exists())
+      continue;
+
+    addEditor(fi.fileName(), fi.absoluteFilePath(), tab.large);
+    mpCurrentEditor->pending = new SessionTab(tab);
+    watch(mpCurrentEditor);
+    if (i == session.currentTab || current == NULL)
+      current = mpCurrentEditor;
+  }
+  mRestoring = false;
+
+  if (current)
+  {
+    if (mpTabs->currentWidget() == current->widget())
+      onTabChanged(mpTabs->currentIndex());
+    else
+      mpTabs->setCurrentWidget(current->widget());
+  }
+} // restoreSession
\ No newline at end of file
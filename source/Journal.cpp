@@ -0,0 +1,743 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // _WIN32
+
+#include <QtGui/QtGui>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <cstring>
+#include "Journal.h" // class definitions
+#include "TextEditor.h"
+#include "Trace.h"
+
+/// Identifies a journal file
+static const char JOURNAL_MAGIC[4] = {'M', 'E', 'J', '1'};
+
+/// Record types in a journal file
+static const quint8 RECORD_HEADER = 'H';
+static const quint8 RECORD_SNAPSHOT = 'S';
+static const quint8 RECORD_CHANGE = 'C';
+
+/// Longest a change waits to be written, in ms
+static const int BATCH_INTERVAL = 500;
+
+/// Queued bytes that start a batch before BATCH_INTERVAL is up
+static const qint64 BATCH_BYTES = 64 * 1024;
+
+/// Bytes of changes a journal may hold before it is compacted, at least
+static const qint64 COMPACT_BYTES = 256 * 1024;
+
+// ====================================================
+//  LOCK (local)
+// ====================================================
+/** Takes the lock file at \e path, creating it if needed.  The lock is held
+ * until unlock(), or until the process ends, even if it crashes.
+ * @returns A handle for unlock(), or 0 if the lock is held elsewhere, even
+ *          by this process. */
+static quintptr lock(const QString& path)
+{
+#ifdef _WIN32
+  // A file opened without sharing can't be opened again until it's closed
+  HANDLE handle = CreateFileW(reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(path).utf16()),
+                              GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  return (handle == INVALID_HANDLE_VALUE ? 0 : reinterpret_cast<quintptr>(handle));
+#else
+  // flock() locks belong to the open file, so a second open in the same
+  // process doesn't get the lock either
+  int fd = ::open(QFile::encodeName(path).constData(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    return 0;
+  if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+  {
+    ::close(fd);
+    return 0;
+  }
+  return static_cast<quintptr>(fd) + 1;
+#endif // _WIN32
+} // lock
+
+// ====================================================
+//  UNLOCK (local)
+// ====================================================
+/** Lets go of a lock taken by lock(), and removes the lock file if \e remove
+ * is set. */
+static void unlock(quintptr handle, const QString& path, bool remove)
+{
+  if (handle == 0)
+    return;
+#ifdef _WIN32
+  CloseHandle(reinterpret_cast<HANDLE>(handle));
+  if (remove)
+    QFile::remove(path);
+#else
+  // Removed while still held, so nobody takes a lock on a file that's gone
+  if (remove)
+    QFile::remove(path);
+  ::close(static_cast<int>(handle - 1));
+#endif // _WIN32
+} // unlock
+
+// ====================================================
+//  OWNER LOCK PATH (local)
+// ====================================================
+/** @returns The lock file of the writer that wrote \e journal.  Journals
+ * are named after the process that wrote them, as "pid-id.journal". */
+static QString ownerLockPath(const QString& journal)
+{
+  QFileInfo fi(journal);
+  return fi.absoluteDir().absoluteFilePath(fi.fileName().section('-', 0, 0) + ".lock");
+} // ownerLockPath
+
+// ====================================================
+//  CHECKSUM (local)
+// ====================================================
+static quint32 checksum(const char* data, int size)
+{
+  // 32 bit FNV-1a
+  quint32 hash = 2166136261u;
+  for (int i = 0; i < size; ++i)
+  {
+    hash ^= static_cast<uchar>(data[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+} // checksum
+
+// ====================================================
+//  APPEND RECORD (local)
+// ====================================================
+static void appendRecord(QByteArray& out, const QByteArray& payload)
+{
+  // Each record is framed by its size and checksum, so that one cut short
+  // by a crash can be told apart from a whole one
+  QByteArray frame;
+  QDataStream s(&frame, QIODevice::WriteOnly);
+  s << static_cast<quint32>(payload.size()) << checksum(payload.constData(), payload.size());
+  out.append(frame);
+  out.append(payload);
+} // appendRecord
+
+// ====================================================
+//  HEADER AND SNAPSHOT (local)
+// ====================================================
+static QByteArray headerAndSnapshot(const QString& path, const QString& filename, const QString& format,
+                                    const QString& text)
+{
+  QByteArray out(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+
+  QByteArray payload;
+  QDataStream s(&payload, QIODevice::WriteOnly);
+  s << RECORD_HEADER << path << filename << format;
+  appendRecord(out, payload);
+
+  payload.clear();
+  QDataStream t(&payload, QIODevice::WriteOnly);
+  t << RECORD_SNAPSHOT << text;
+  appendRecord(out, payload);
+  return out;
+} // headerAndSnapshot
+
+// ====================================================
+//  REPLAY (local)
+// ====================================================
+static bool replay(const QString& journal, RecoveredDocument* doc)
+{
+  QFile file(journal);
+  if (!file.open(QFile::ReadOnly))
+    return false;
+  QByteArray data = file.readAll();
+  if (data.size() < static_cast<int>(sizeof(JOURNAL_MAGIC)) || memcmp(data.constData(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0)
+    return false;
+
+  bool snapshot = false;
+  int pos = sizeof(JOURNAL_MAGIC);
+  while (pos + 8 <= data.size())
+  {
+    quint32 size, sum;
+    QDataStream frame(QByteArray::fromRawData(data.constData() + pos, 8));
+    frame >> size >> sum;
+
+    // Stop at a record that was cut short
+    if (size > static_cast<quint32>(data.size() - pos - 8) || checksum(data.constData() + pos + 8, size) != sum)
+      break;
+
+    QDataStream s(QByteArray::fromRawData(data.constData() + pos + 8, size));
+    quint8 type;
+    s >> type;
+    if (type == RECORD_HEADER)
+    {
+      s >> doc->path >> doc->filename >> doc->format;
+    }
+    else if (type == RECORD_SNAPSHOT)
+    {
+      s >> doc->text;
+      snapshot = true;
+    }
+    else if (type == RECORD_CHANGE && snapshot)
+    {
+      qint32 position, removed;
+      QString added;
+      s >> position >> removed >> added;
+      doc->text.replace(qBound(0, static_cast<int>(position), doc->text.size()), removed, added);
+    }
+    pos += 8 + size;
+  }
+
+  doc->journal = journal;
+  return snapshot;
+} // replay
+
+// ====================================================
+//  CTOR
+// ====================================================
+JournalWriter::JournalWriter(const QString& directory)
+{
+  mDirectory = directory;
+  QDir().mkpath(mDirectory);
+
+  // Tells other editors that the journals of this process aren't theirs
+  mLockPath = QDir(mDirectory).absoluteFilePath(QString("%1.lock").arg(QCoreApplication::applicationPid()));
+  mLock = lock(mLockPath);
+
+  mClock.start();
+  mQueuedBytes = 0;
+  mNextJournal = 0;
+  mWriting = false;
+  mFlush = false;
+  mStop = false;
+  memset(&mStats, 0, sizeof(mStats));
+  mTotalLatencyMs = 0.0;
+
+  start(QThread::LowPriority);
+} // ctor
+
+// ====================================================
+//  DTOR
+// ====================================================
+JournalWriter::~JournalWriter(void)
+{
+  mMutex.lock();
+  mStop = true;
+  mWake.wakeOne();
+  mMutex.unlock();
+  wait();
+
+  foreach (Log* log, mLogs)
+  {
+    delete log->file;
+    delete log;
+  }
+
+  // The journals kept are recovered by whoever starts next
+  unlock(mLock, mLockPath, true);
+} // dtor
+
+// ====================================================
+//  DIRECTORY
+// ====================================================
+const QString& JournalWriter::directory(void) const
+{
+  return mDirectory;
+} // directory
+
+// ====================================================
+//  BEGIN
+// ====================================================
+int JournalWriter::begin(const QString& path, const QString& filename, const QString& format, const QString& text)
+{
+  QMutexLocker lock(&mMutex);
+  Record record;
+  record.type = BEGIN;
+  record.journal = mNextJournal++;
+  record.text = text;
+  record.path = path;
+  record.filename = filename;
+  record.format = format;
+  push(record);
+  return record.journal;
+} // begin
+
+// ====================================================
+//  CHANGE
+// ====================================================
+void JournalWriter::change(int journal, int position, int removed, const QString& added)
+{
+  QMutexLocker lock(&mMutex);
+  mStats.editBytes += removed + added.size();
+
+  // Merge a run of typing, or of deleting backwards or forwards, into one
+  // change.  The earlier change is still queued, so it hasn't been written.
+  if (!mQueue.isEmpty() && mQueue.last().type == CHANGE && mQueue.last().journal == journal)
+  {
+    Record& last = mQueue.last();
+    if (removed == 0 && position == last.position + last.text.size())
+    {
+      last.text += added;
+      mQueuedBytes += added.size();
+      return;
+    }
+    if (added.isEmpty() && last.text.isEmpty() && (position + removed == last.position || position == last.position))
+    {
+      last.position = position;
+      last.removed += removed;
+      return;
+    }
+  }
+
+  Record record;
+  record.type = CHANGE;
+  record.journal = journal;
+  record.position = position;
+  record.removed = removed;
+  record.text = added;
+  push(record);
+} // change
+
+// ====================================================
+//  SNAPSHOT
+// ====================================================
+void JournalWriter::snapshot(int journal, const QString& text)
+{
+  QMutexLocker lock(&mMutex);
+  Record record;
+  record.type = SNAPSHOT;
+  record.journal = journal;
+  record.text = text;
+  push(record);
+} // snapshot
+
+// ====================================================
+//  RENAME
+// ====================================================
+void JournalWriter::rename(int journal, const QString& path, const QString& filename)
+{
+  QMutexLocker lock(&mMutex);
+  Record record;
+  record.type = RENAME;
+  record.journal = journal;
+  record.path = path;
+  record.filename = filename;
+  push(record);
+} // rename
+
+// ====================================================
+//  END
+// ====================================================
+void JournalWriter::end(int journal)
+{
+  QMutexLocker lock(&mMutex);
+  Record record;
+  record.type = END;
+  record.journal = journal;
+  push(record);
+} // end
+
+// ====================================================
+//  FLUSH
+// ====================================================
+void JournalWriter::flush(void)
+{
+  QMutexLocker lock(&mMutex);
+  mFlush = true;
+  mWake.wakeOne();
+  while (!mQueue.isEmpty() || mWriting)
+    mIdle.wait(&mMutex);
+  mFlush = false;
+} // flush
+
+// ====================================================
+//  STATS
+// ====================================================
+JournalWriter::Stats JournalWriter::stats(void) const
+{
+  QMutexLocker lock(&mMutex);
+  Stats stats = mStats;
+  stats.meanLatencyMs = (mStats.records > 0 ? mTotalLatencyMs / mStats.records : 0.0);
+  return stats;
+} // stats
+
+// ====================================================
+//  RECOVER (static)
+// ====================================================
+QList<RecoveredDocument> JournalWriter::recover(const QString& directory)
+{
+  TRACE_SCOPE("JournalWriter::recover");
+
+  QList<RecoveredDocument> docs;
+  QDir dir(directory);
+  QString own = QString("%1-").arg(QCoreApplication::applicationPid());
+  QStringList names = dir.entryList(QStringList() << "*.journal" << "*.journal.tmp", QDir::Files, QDir::Name);
+  QHash<QString, bool> running;   // By lock file
+  foreach (QString name, names)
+  {
+    if (name.startsWith(own))
+      continue;
+
+    // A writer that is still running holds its lock
+    QString lockPath = ownerLockPath(dir.absoluteFilePath(name));
+    if (!running.contains(lockPath))
+    {
+      quintptr handle = lock(lockPath);
+      running.insert(lockPath, handle == 0);
+      unlock(handle, lockPath, false);
+    }
+    if (running.value(lockPath))
+      continue;
+
+    // A compacted journal that didn't get renamed into place is only used
+    // if the journal it replaces is gone
+    if (name.endsWith(".tmp") && names.contains(name.left(name.size() - 4)))
+      continue;
+
+    RecoveredDocument doc;
+    if (replay(dir.absoluteFilePath(name), &doc))
+    {
+      if (names.contains(name + ".tmp"))
+        doc.temp = dir.absoluteFilePath(name + ".tmp");
+      docs.push_back(doc);
+    }
+  }
+  return docs;
+} // recover
+
+// ====================================================
+//  DISCARD (static)
+// ====================================================
+bool JournalWriter::discard(const RecoveredDocument& doc)
+{
+  QString lockPath = ownerLockPath(doc.journal);
+  quintptr handle = lock(lockPath);
+  if (handle == 0)
+    return false;
+
+  QFile::remove(doc.journal);
+  if (!doc.temp.isEmpty())
+    QFile::remove(doc.temp);
+
+  // The lock file goes with the last journal of its writer
+  QFileInfo fi(doc.journal);
+  QString prefix = fi.fileName().section('-', 0, 0) + "-";
+  QStringList left = fi.absoluteDir().entryList(QStringList() << prefix + "*.journal" << prefix + "*.journal.tmp", QDir::Files);
+  unlock(handle, lockPath, left.isEmpty());
+  return true;
+} // discard
+
+// ====================================================
+//  RUN (inherited)
+// ====================================================
+void JournalWriter::run(void)
+{
+  QMutexLocker lock(&mMutex);
+  while (true)
+  {
+    while (mQueue.isEmpty() && !mStop)
+      mWake.wait(&mMutex);
+
+    // Let the batch fill up, unless it's big already or wanted now
+    if (!mStop && !mFlush && mQueuedBytes < BATCH_BYTES)
+      mWake.wait(&mMutex, BATCH_INTERVAL);
+
+    if (mQueue.isEmpty() && mStop)
+      break;
+
+    QList<Record> batch = mQueue;
+    mQueue.clear();
+    mQueuedBytes = 0;
+    mWriting = true;
+
+    lock.unlock();
+    write(batch);
+    lock.relock();
+
+    mWriting = false;
+    if (mQueue.isEmpty())
+      mFlush = false;
+    mIdle.wakeAll();
+  }
+} // run
+
+// ====================================================
+//  PUSH
+// ====================================================
+void JournalWriter::push(const Record& record)
+{
+  mQueue.push_back(record);
+  mQueue.last().queued = mClock.nsecsElapsed();
+  mQueuedBytes += record.text.size() + 16;
+
+  // The first record starts the batch interval, and a big batch goes now
+  if (mQueue.size() == 1 || mQueuedBytes >= BATCH_BYTES)
+    mWake.wakeOne();
+} // push
+
+// ====================================================
+//  WRITE
+// ====================================================
+void JournalWriter::write(const QList<Record>& batch)
+{
+  TRACE_SCOPE("JournalWriter::write");
+
+  // Gather each journal's part of the batch, so it takes one write
+  QHash<int, QByteArray> out;
+  qint64 records = 0;
+  qint64 written = 0;
+  qint64 compactions = 0;
+  foreach (const Record& record, batch)
+  {
+    if (record.type == BEGIN)
+    {
+      Log* log = new Log;
+      log->file = new QFile(QDir(mDirectory).absoluteFilePath(
+        QString("%1-%2.journal").arg(QCoreApplication::applicationPid()).arg(record.journal)));
+      log->file->open(QFile::WriteOnly | QFile::Truncate);
+      log->text = record.text;
+      log->path = record.path;
+      log->filename = record.filename;
+      log->format = record.format;
+      log->changeBytes = 0;
+      mLogs.insert(record.journal, log);
+      out[record.journal] = headerAndSnapshot(log->path, log->filename, log->format, log->text);
+      continue;
+    }
+
+    Log* log = mLogs.value(record.journal);
+    if (log == NULL)
+      continue;
+
+    if (record.type == CHANGE)
+    {
+      log->text.replace(record.position, record.removed, record.text);
+
+      QByteArray payload;
+      QDataStream s(&payload, QIODevice::WriteOnly);
+      s << RECORD_CHANGE << static_cast<qint32>(record.position) << static_cast<qint32>(record.removed) << record.text;
+      appendRecord(out[record.journal], payload);
+      log->changeBytes += payload.size() + 8;
+      ++records;
+    }
+    else if (record.type == SNAPSHOT)
+    {
+      // Written by compacting, below
+      log->text = record.text;
+      log->changeBytes = COMPACT_BYTES + 2 * log->text.size() + 1;
+      out.remove(record.journal);
+    }
+    else if (record.type == RENAME)
+    {
+      log->path = record.path;
+      log->filename = record.filename;
+
+      QByteArray payload;
+      QDataStream s(&payload, QIODevice::WriteOnly);
+      s << RECORD_HEADER << log->path << log->filename << log->format;
+      appendRecord(out[record.journal], payload);
+    }
+    else if (record.type == END)
+    {
+      log->file->close();
+      log->file->remove();
+      delete log->file;
+      delete log;
+      mLogs.remove(record.journal);
+      out.remove(record.journal);
+    }
+  }
+
+  for (QHash<int, QByteArray>::const_iterator itr = out.begin(); itr != out.end(); ++itr)
+  {
+    QFile* file = mLogs[itr.key()]->file;
+    file->write(itr.value());
+    file->flush();
+    written += itr.value().size();
+  }
+
+  // Compact the journals whose changes have outgrown their snapshot
+  foreach (Log* log, mLogs)
+  {
+    if (log->changeBytes > qMax(COMPACT_BYTES, 2 * static_cast<qint64>(log->text.size())))
+    {
+      compact(log);
+      written += log->file->size();
+      ++compactions;
+    }
+  }
+
+  // Latency is measured to the end of the write
+  qint64 now = mClock.nsecsElapsed();
+  double totalLatency = 0.0;
+  double maxLatency = 0.0;
+  foreach (const Record& record, batch)
+  {
+    if (record.type != CHANGE)
+      continue;
+    double latency = (now - record.queued) / 1000000.0;
+    totalLatency += latency;
+    maxLatency = qMax(maxLatency, latency);
+  }
+
+  QMutexLocker lock(&mMutex);
+  mStats.writtenBytes += written;
+  mStats.records += records;
+  mStats.compactions += compactions;
+  mStats.batches += 1;
+  mStats.maxLatencyMs = qMax(mStats.maxLatencyMs, maxLatency);
+  mTotalLatencyMs += totalLatency;
+} // write
+
+// ====================================================
+//  COMPACT
+// ====================================================
+void JournalWriter::compact(Log* log)
+{
+  TRACE_SCOPE("JournalWriter::compact");
+
+  // Write the snapshot next to the journal and swap it in.  Recovery falls
+  // back to the new file if a crash leaves it without the old one.
+  QString path = log->file->fileName();
+  QString temp = path + ".tmp";
+  QFile file(temp);
+  if (!file.open(QFile::WriteOnly | QFile::Truncate))
+    return;
+  file.write(headerAndSnapshot(log->path, log->filename, log->format, log->text));
+  file.close();
+
+  log->file->close();
+  QFile::remove(path);
+  QFile::rename(temp, path);
+  log->file->open(QFile::WriteOnly | QFile::Append);
+  log->changeBytes = 0;
+} // compact
+
+// ----------------------------------------------------------------------------
+
+// ====================================================
+//  CTOR
+// ====================================================
+Journal::Journal(TextEditor* editor, JournalWriter* writer)
+  : QObject(editor)
+{
+  mpEditor = editor;
+  mpWriter = writer;
+  mId = -1;
+  mLength = 0;
+  mRevision = editor->document()->revision();
+  mSnapshotPending = false;
+
+  connect(editor->document(), SIGNAL(contentsChange(int, int, int)), this, SLOT(onContentsChange(int, int, int)));
+} // ctor
+
+// ====================================================
+//  DTOR
+// ====================================================
+Journal::~Journal(void)
+{
+  // The editor is being destroyed, so only the writer is left to tell
+  if (mId >= 0)
+    mpWriter->end(mId);
+} // dtor
+
+// ====================================================
+//  SET FILE
+// ====================================================
+void Journal::setFile(const QString& path, const QString& filename)
+{
+  mPath = path;
+  mFilename = filename;
+  if (mId >= 0)
+    mpWriter->rename(mId, mPath, mFilename);
+} // setFile
+
+// ====================================================
+//  CLEAR
+// ====================================================
+void Journal::clear(void)
+{
+  mSnapshotPending = false;
+  mRevision = mpEditor->document()->revision();
+  if (mId >= 0)
+  {
+    mpWriter->end(mId);
+    mId = -1;
+  }
+} // clear
+
+// ====================================================
+//  SCHEDULE SNAPSHOT
+// ====================================================
+void Journal::scheduleSnapshot(void)
+{
+  if (!mSnapshotPending)
+  {
+    mSnapshotPending = true;
+    QTimer::singleShot(0, this, SLOT(takeSnapshot()));
+  }
+} // scheduleSnapshot
+
+// ====================================================
+//  ON CONTENTS CHANGE (slot)
+// ====================================================
+void Journal::onContentsChange(int position, int removed, int added)
+{
+  // The highlighter's format changes come through here too, but don't
+  // change the revision
+  QTextDocument* doc = mpEditor->document();
+  if (doc->revision() == mRevision)
+    return;
+  mRevision = doc->revision();
+
+  // A pending snapshot will have this change in it
+  if (mId < 0 || mSnapshotPending)
+  {
+    scheduleSnapshot();
+    return;
+  }
+
+  // Qt counts the document's last paragraph separator in some changes, so
+  // keep the counts inside the document
+  int length = doc->characterCount() - 1;
+  removed = qBound(0, removed, mLength - position);
+  QTextCursor cursor(doc);
+  cursor.setPosition(qMin(position, length));
+  cursor.setPosition(qMin(position + added, length), QTextCursor::KeepAnchor);
+  QString text = cursor.selectedText();
+  text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+
+  // If the journal has lost track of the document, start it over
+  if (mLength - removed + text.size() != length)
+  {
+    scheduleSnapshot();
+    return;
+  }
+
+  mLength = length;
+  mpWriter->change(mId, position, removed, text);
+} // onContentsChange
+
+// ====================================================
+//  TAKE SNAPSHOT (slot)
+// ====================================================
+void Journal::takeSnapshot(void)
+{
+  TRACE_SCOPE("Journal::takeSnapshot");
+
+  // Cleared since it was scheduled, by a load or save
+  if (!mSnapshotPending)
+    return;
+  mSnapshotPending = false;
+  if (!mpEditor->hasUnsavedChanges())
+    return;
+
+  QString text = mpEditor->toPlainText();
+  mLength = text.size();
+  mRevision = mpEditor->document()->revision();
+  if (mId < 0)
+    mId = mpWriter->begin(mPath, mFilename, mpEditor->fileFormat(), text);
+  else
+    mpWriter->snapshot(mId, text);
+} // takeSnapshot
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include <QtGui/QKeyEvent>
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+#include <QtCore/QStringList>
+#include <QtCore/QUrl>
+#include "KeystrokeSession.h" // class definition
+
+// ====================================================
+//  CTOR
+// ====================================================
+KeystrokeSession::KeystrokeSession(void)
+  : cursorPosition(0)
+{
+} // ctor
+
+// ====================================================
+//  CLEAR
+// ====================================================
+void KeystrokeSession::clear(void)
+{
+  file.clear();
+  cursorPosition = 0;
+  keystrokes.clear();
+} // clear
+
+// ====================================================
+//  APPEND (QKeyEvent)
+// ====================================================
+void KeystrokeSession::append(const QKeyEvent& event)
+{
+  append(event.key(), static_cast<int>(event.modifiers()), event.text());
+} // append
+
+// ====================================================
+//  APPEND
+// ====================================================
+void KeystrokeSession::append(int key, int modifiers, const QString& text)
+{
+  Keystroke keystroke;
+  keystroke.key = key;
+  keystroke.modifiers = modifiers;
+  keystroke.text = text;
+  keystrokes.push_back(keystroke);
+} // append
+
+// ====================================================
+//  LOAD
+// ====================================================
+bool KeystrokeSession::load(const QString& path)
+{
+  QFile f(path);
+  if (!f.open(QFile::ReadOnly | QFile::Text))
+    return false;
+
+  clear();
+
+  QTextStream stream(&f);
+  while (!stream.atEnd())
+  {
+    QString line = stream.readLine();
+    if (line.startsWith("file "))
+      file = line.mid(5).trimmed();
+    else if (line.startsWith("cursor "))
+      cursorPosition = line.mid(7).trimmed().toInt();
+    else if (line.startsWith("key "))
+    {
+      QStringList fields = line.mid(4).split(' ', QString::SkipEmptyParts);
+      if (fields.size() < 2)
+        continue;
+
+      append(fields[0].toInt(NULL, 16), fields[1].toInt(NULL, 16),
+             fields.size() > 2 ? QUrl::fromPercentEncoding(fields[2].toAscii()) : QString());
+    }
+  }
+
+  return true;
+} // load
+
+// ====================================================
+//  SAVE
+// ====================================================
+bool KeystrokeSession::save(const QString& path) const
+{
+  QFile f(path);
+  if (!f.open(QFile::WriteOnly | QFile::Text))
+    return false;
+
+  QTextStream stream(&f);
+  stream << "file    " << file << "\n";
+  stream << "cursor  " << cursorPosition << "\n";
+
+  foreach (const Keystroke& k, keystrokes)
+  {
+    stream << "key     " << QString("%1 %2").arg(k.key, 8, 16, QChar('0')).arg(k.modifiers, 8, 16, QChar('0'));
+    if (!k.text.isEmpty())
+      stream << " " << QUrl::toPercentEncoding(k.text);
+    stream << "\n";
+  }
+
+  return true;
+} // save
+
+// ====================================================
+//  CATEGORY (static)
+// ====================================================
+QString KeystrokeSession::category(const Keystroke& keystroke)
+{
+  bool ctrl = (keystroke.modifiers & Qt::ControlModifier) != 0;
+
+  switch (keystroke.key)
+  {
+  case Qt::Key_Return:
+  case Qt::Key_Enter:
+    return "enter";
+
+  case Qt::Key_BraceRight:
+    return "brace";
+
+  case Qt::Key_Tab:
+    return ctrl ? "tab_switch" : "tab";
+
+  case Qt::Key_Backtab:
+    return ctrl ? "tab_switch" : "backtab";
+
+  case Qt::Key_Up:
+  case Qt::Key_Down:
+    return ctrl ? "syntax_cycle" : "navigate";
+
+  case Qt::Key_Left:
+  case Qt::Key_Right:
+  case Qt::Key_Home:
+  case Qt::Key_End:
+  case Qt::Key_PageUp:
+  case Qt::Key_PageDown:
+    return "navigate";
+
+  case Qt::Key_Backspace:
+  case Qt::Key_Delete:
+    return "delete";
+  }
+
+  if (!keystroke.text.isEmpty() && !ctrl)
+    return "type";
+
+  return "other";
+} // category
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include <QtCore/QPair>
+#include <QtCore/QtAlgorithms>
+#include "KeywordTrie.h" // class definition
+
+namespace config
+{
+  // ====================================================
+  //  CTOR
+  // ====================================================
+  KeywordTrie::KeywordTrie(void)
+  {
+  } // ctor
+
+  // ====================================================
+  //  BUILD
+  // ====================================================
+  void KeywordTrie::build(const QStringList& words)
+  {
+    // The trie is walked by lower case keys, but each word keeps its
+    // spelling, which is what the format's word map is keyed by
+    QVector<QPair<QString, QString> > sorted;
+    foreach (const QString& word, words)
+      sorted.push_back(qMakePair(word.toLower(), word));
+    qSort(sorted);
+
+    mWords.clear();
+    mKeys.clear();
+    for (int i = 0; i < sorted.size(); ++i)
+    {
+      if (i > 0 && sorted[i] == sorted[i - 1])
+        continue;
+      mKeys.push_back(sorted[i].first);
+      mWords.push_back(sorted[i].second);
+    }
+
+    mNodes.clear();
+    mEdges.clear();
+    buildNode(0, mWords.size(), 0);
+    mNodes.squeeze();
+    mEdges.squeeze();
+  } // build
+
+  // ====================================================
+  //  BUILD NODE
+  // ====================================================
+  int KeywordTrie::buildNode(int lo, int hi, int depth)
+  {
+    // [lo, hi) is a sorted range of words that share their first depth characters
+    int index = mNodes.size();
+    Node node = { 0, 0, -1, 0 };
+    if (lo < hi && mKeys[lo].size() == depth)
+      node.word = lo;
+    for (; lo < hi && mKeys[lo].size() == depth; ++lo)
+      ++node.numWords;
+    mNodes.push_back(node);
+
+    // Reserve this node's edges first so they stay contiguous, then fill
+    // them in as the children are built
+    int first = mEdges.size();
+    int count = 0;
+    for (int i = lo; i < hi; ++count)
+    {
+      ushort ch = mKeys[i][depth].unicode();
+      while (i < hi && mKeys[i][depth].unicode() == ch)
+        ++i;
+    }
+    mEdges.resize(first + count);
+    mNodes[index].firstEdge = first;
+    mNodes[index].numEdges = count;
+
+    int edge = first;
+    for (int i = lo; i < hi; ++edge)
+    {
+      ushort ch = mKeys[i][depth].unicode();
+      int end = i;
+      while (end < hi && mKeys[end][depth].unicode() == ch)
+        ++end;
+
+      int child = buildNode(i, end, depth + 1);
+      mEdges[edge].ch = ch;
+      mEdges[edge].child = child;
+      i = end;
+    }
+
+    return index;
+  } // buildNode
+
+  // ====================================================
+  //  FIND PREFIX
+  // ====================================================
+  void KeywordTrie::findPrefix(const QString& prefix, QVector<int>& out, int limit) const
+  {
+    if (mNodes.isEmpty())
+      return;
+
+    int node = 0;
+    for (int i = 0; i < prefix.size(); ++i)
+    {
+      ushort ch = prefix[i].toLower().unicode();
+      const Node& n = mNodes[node];
+
+      // Edges are sorted, so a binary search finds the child
+      int lo = n.firstEdge;
+      int hi = n.firstEdge + n.numEdges;
+      while (lo < hi)
+      {
+        int mid = (lo + hi) / 2;
+        if (mEdges[mid].ch < ch)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+
+      if (lo == n.firstEdge + n.numEdges || mEdges[lo].ch != ch)
+        return;
+      node = mEdges[lo].child;
+    }
+
+    collect(node, out, limit);
+  } // findPrefix
+
+  // ====================================================
+  //  COLLECT
+  // ====================================================
+  void KeywordTrie::collect(int node, QVector<int>& out, int limit) const
+  {
+    if (out.size() >= limit)
+      return;
+
+    const Node& n = mNodes[node];
+    for (int i = 0; i < n.numWords; ++i)
+      out.push_back(n.word + i);
+
+    for (int e = n.firstEdge; e < n.firstEdge + n.numEdges; ++e)
+      collect(mEdges[e].child, out, limit);
+  } // collect
+
+  // ====================================================
+  //  FIND FUZZY
+  // ====================================================
+  void KeywordTrie::findFuzzy(const QString& query, QVector<int>& out, int limit) const
+  {
+    if (mNodes.isEmpty())
+      return;
+    collectFuzzy(0, query.toLower(), 0, out, limit);
+  } // findFuzzy
+
+  // ====================================================
+  //  COLLECT FUZZY
+  // ====================================================
+  void KeywordTrie::collectFuzzy(int node, const QString& query, int matched, QVector<int>& out, int limit) const
+  {
+    if (out.size() >= limit)
+      return;
+
+    // Once every character of the query has been matched along the path,
+    // every word below matches too
+    if (matched == query.size())
+    {
+      collect(node, out, limit);
+      return;
+    }
+
+    // Matching greedily is enough to decide whether the query is a
+    // subsequence of a word, so each path is walked once
+    const Node& n = mNodes[node];
+    ushort next = query[matched].unicode();
+    for (int e = n.firstEdge; e < n.firstEdge + n.numEdges; ++e)
+      collectFuzzy(mEdges[e].child, query, matched + (mEdges[e].ch == next ? 1 : 0), out, limit);
+  } // collectFuzzy
+
+  // ====================================================
+  //  WORDS
+  // ====================================================
+  const QStringList& KeywordTrie::words(void) const
+  {
+    return mWords;
+  } // words
+
+  // ====================================================
+  //  NODE COUNT
+  // ====================================================
+  int KeywordTrie::nodeCount(void) const
+  {
+    return mNodes.size();
+  } // nodeCount
+
+  // ====================================================
+  //  SCORE (static)
+  // ====================================================
+  int KeywordTrie::score(const QString& query, const QString& word)
+  {
+    if (query.size() > word.size())
+      return -1;
+
+    if (word.startsWith(query, Qt::CaseInsensitive))
+      return 1000 - (word.size() - query.size());
+
+    int score = 0;
+    int matched = 0;
+    int last = -2;
+    for (int i = 0; i < word.size() && matched < query.size(); ++i)
+    {
+      if (word[i].toLower() != query[matched].toLower())
+        continue;
+
+      int bonus = 10;
+      if (i == 0 || word[i - 1] == '_' || word[i - 1] == '/')
+        bonus += 20;
+      if (i == last + 1)
+        bonus += 15;
+
+      score += bonus;
+      last = i;
+      ++matched;
+    }
+
+    if (matched < query.size())
+      return -1;
+    return qBound(0, score - (word.size() - query.size()), 999);
+  } // score
+} // namespace config
\ No newline at end of file
@@ -0,0 +1,1581 @@
+#include <QtGui/QtGui>
+#include <climits>
+#include "LargeFileEditor.h" // class definition
+#include "ConfigFile.h"
+#include "TextEditor.h"
+#include "Trace.h"
+#include "Metrics.h"
+
+// Bytes scanned back for an open brace before giving up
+static const qint64 MAX_INDENT_SCAN = 1024 * 1024;
+
+// Longest line highlighted as a whole.  A longer line is highlighted in
+// chunks of this size, only those covering the visible columns and a margin
+// either side, so a word crossing the edge of the view still gets its format.
+static const int MAX_HIGHLIGHT_LINE = 4096;
+static const int HIGHLIGHT_MARGIN = 64;
+
+// Lexical states at the start of a chunk of a long line
+static const char LEX_CODE = 0;
+static const char LEX_STRING = 1;
+static const char LEX_COMMENT = 2;
+
+// Most long lines whose chunk states are kept
+static const int MAX_CHUNK_LINES = 64;
+
+// Most memory held by the undo history, in bytes.  An edit bigger than this,
+// such as removing most of a huge file, can't be undone and clears it.
+static const qint64 MAX_HISTORY_MEMORY = 64 * 1024 * 1024;
+
+// Largest selection put on the clipboard, in bytes
+static const qint64 MAX_CLIPBOARD_SIZE = 64 * 1024 * 1024;
+
+// ====================================================
+//  EDIT MEMORY (local)
+// ====================================================
+static qint64 editMemory(qint64 removed, qint64 inserted)
+{
+  // The text of the edit, and roughly what it takes to keep it
+  return removed + inserted + 64;
+} // editMemory
+
+// ====================================================
+//  MOVE POSITION (local)
+// ====================================================
+/** @returns Where a position after an edit ends up once the edit is made.
+ * Positions before the edit, or at it, stay where they are. */
+static qint64 movePosition(qint64 p, qint64 pos, qint64 removed, qint64 inserted)
+{
+  return (p > pos ? qMax(pos, p - removed) + inserted : p);
+} // movePosition
+
+// ====================================================
+//  IS WORD CHAR (local)
+// ====================================================
+static bool isWordChar(char ch)
+{
+  return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_';
+} // isWordChar
+
+// ====================================================
+//  REFLOWER (local)
+// ====================================================
+/** Writes out a script one statement per line for LargeFileEditor::reflow(). */
+struct Reflower
+{
+  Reflower(const QString& format, const QByteArray& indent, const QByteArray& newline)
+    : format(format), indent(indent), newline(newline), words(0), lineEmpty(true) {}
+
+  /** Ends the output line, if anything has been written to it. */
+  void endLine(void)
+  {
+    if (!lineEmpty)
+      out += newline;
+    lineEmpty = true;
+    words = 0;
+  }
+
+  /** Writes a token, indenting it by brace depth if it starts a line. */
+  void put(const char* data, int length)
+  {
+    if (lineEmpty)
+    {
+      for (int i = 0; i < stack.size(); ++i)
+        out += indent;
+      lineEmpty = false;
+    }
+    else
+    {
+      out += ' ';
+    }
+    out.append(data, length);
+  }
+
+  /** @returns TRUE if a word is an attribute of the enclosing block, and so
+   * starts a statement of its own. */
+  bool startsStatement(const char* data, int length) const
+  {
+    static const Atom SCRIPT = Atom::intern("script");
+
+    Atom atom = Atom::find(QString::fromLatin1(data, length));
+    const config::FormatWord* word = config::ConfigFile::instance()->findWord(format, atom);
+    return (word && word->scopes.contains(stack.isEmpty() ? SCRIPT : stack.last()));
+  }
+
+  QString       format;
+  QByteArray    indent;
+  QByteArray    newline;
+  QByteArray    out;
+  QVector<Atom> stack;      ///< Keywords of the enclosing blocks
+  Atom          pending;    ///< First word of the current statement
+  int           words;      ///< Words written to the current line
+  bool          lineEmpty;
+};
+
+// ====================================================
+//  CTOR
+// ====================================================
+LargeFileEditor::LargeFileEditor(QWidget* parent)
+  : QAbstractScrollArea(parent)
+{
+  mUnsavedChanges = false;
+  mNewline = "\n";
+  mTopLine = 0;
+  mCursor = 0;
+  mAnchor = 0;
+  mGoalColumn = 0;
+  mLeftColumn = 0;
+  mScrollScale = 1;
+  mRowsTop = 0;
+  mHistoryMemory = 0;
+  mChainEdits = false;
+
+  // Set default format to whatever the first one is
+  QStringList formats = config::ConfigFile::instance()->getAllFormatNames();
+  if (formats.empty() == false)
+    mFormat = formats.first();
+  mHighlighter.setFileFormat(mFormat);
+
+  // Set default number of spaces per tab
+  mTabSpaces.fill(' ', 2);
+
+  // Enable drag and drop events
+  setAcceptDrops(true);
+  viewport()->setAcceptDrops(true);
+  viewport()->setCursor(Qt::IBeamCursor);
+  setFocusPolicy(Qt::StrongFocus);
+
+  // The bar offering to reflow long lines sits above the viewport
+  mpReflowBar = new QFrame(this);
+  QHBoxLayout* hbox = new QHBoxLayout(mpReflowBar);
+  hbox->setContentsMargins(4, 2, 4, 2);
+  hbox->addWidget(new QLabel("This file has lines too long to lay out, so only the visible part of each is shown.", mpReflowBar), 1);
+  QPushButton* reflowButton = new QPushButton("Reflow", mpReflowBar);
+  connect(reflowButton, SIGNAL(clicked()), this, SLOT(reflow()));
+  hbox->addWidget(reflowButton);
+  mpReflowBar->setAutoFillBackground(true);
+  mpReflowBar->setBackgroundRole(QPalette::ToolTipBase);
+  mpReflowBar->hide();
+
+  updateScrollBars();
+} // ctor
+
+// ====================================================
+//  DTOR
+// ====================================================
+LargeFileEditor::~LargeFileEditor(void)
+{
+} // dtor
+
+// ====================================================
+//  SET TAB SPACES
+// ====================================================
+void LargeFileEditor::setTabSpaces(int spaces)
+{
+  if (spaces > 0)
+    mTabSpaces.fill(' ', spaces);
+} // setTabSpaces
+
+// ====================================================
+//  HAS UNSAVED CHANGES
+// ====================================================
+bool LargeFileEditor::hasUnsavedChanges() const
+{
+  return mUnsavedChanges;
+} // hasUnsavedChanges
+
+// ====================================================
+//  ESTIMATED MEMORY
+// ====================================================
+qint64 LargeFileEditor::estimatedMemory(void) const
+{
+  return mBuffer.editMemory() + mHistoryMemory + mHighlighter.ruleMemory();
+} // estimatedMemory
+
+// ====================================================
+//  BUFFER
+// ====================================================
+const PieceTable& LargeFileEditor::buffer(void) const
+{
+  return mBuffer;
+} // buffer
+
+// ====================================================
+//  FILE FORMAT
+// ====================================================
+const QString& LargeFileEditor::fileFormat(void) const
+{
+  return mFormat;
+} // fileFormat
+
+// ====================================================
+//  SET FILE FORMAT
+// ====================================================
+void LargeFileEditor::setFileFormat(const QString& format)
+{
+  if (format != mFormat)
+  {
+    mFormat = format;
+    mHighlighter.setFileFormat(mFormat);
+    viewport()->update();
+  }
+} // setFileFormat
+
+// ====================================================
+//  RELOAD RULES
+// ====================================================
+void LargeFileEditor::reloadRules(void)
+{
+  mHighlighter.setFileFormat(mFormat);
+  viewport()->update();
+} // reloadRules
+
+// ====================================================
+//  LOAD
+// ====================================================
+bool LargeFileEditor::load(const QString& path)
+{
+  TRACE_SCOPE("LargeFileEditor::load");
+
+  QElapsedTimer timer;
+  timer.start();
+
+  if (!mBuffer.open(path))
+    return false;
+
+  // Load the proper format based on the file extension
+  QFileInfo fi(path);
+  mFormat = config::ConfigFile::instance()->getFormatByExtension(fi.suffix());
+  mHighlighter.setFileFormat(mFormat);
+
+  // Keep the file's line breaks.  Only the start of the file is looked at,
+  // so a file that is one enormous line doesn't get read to find out.
+  QByteArray head = mBuffer.read(0, 4096);
+  int newline = head.indexOf('\n');
+  mNewline = (newline > 0 && head[newline - 1] == '\r' ? "\r\n" : "\n");
+
+  mTopLine = 0;
+  mCursor = 0;
+  mAnchor = 0;
+  mGoalColumn = 0;
+  mLeftColumn = 0;
+  mUnsavedChanges = false;
+  mChunkStates.clear();
+  mRowEnds.clear();
+  clearHistory();
+
+  setReflowOffered(false);
+  updateScrollBars();
+  updateKeyword();
+  viewport()->update();
+
+  static metrics::Metric* openMs = metrics::Registry::instance()->metric("largefile.open_ms");
+  openMs->sample(timer.nsecsElapsed() / 1000000.0);
+  return true;
+} // load
+
+// ====================================================
+//  SAVE
+// ====================================================
+bool LargeFileEditor::save(const QString& path)
+{
+  TRACE_SCOPE("LargeFileEditor::save");
+
+  // Write to a temporary file first, since the file being replaced is
+  // probably the one the original text is mapped from
+  QString temp = path + ".saving";
+  QFile file(temp);
+  if (!file.open(QFile::WriteOnly))
+    return false;
+
+  bool written = mBuffer.write(&file);
+  file.close();
+  if (!written)
+  {
+    QFile::remove(temp);
+    return false;
+  }
+
+  // Let go of the mapping, put the new file in place, and map it.  The old
+  // file is moved aside rather than removed, and only removed once the new
+  // one is in place, so it is put back if anything fails.  Either way the
+  // document is mapped again, from the new file or the temporary one.
+  qint64 cursor = mCursor;
+  qint64 top = mTopLine;
+  mBuffer.close();
+
+  QString backup = path + ".backup";
+  QFile::remove(backup);
+  bool existed = QFile::exists(path);
+  bool saved = (!existed || QFile::rename(path, backup)) && QFile::rename(temp, path);
+  if (saved)
+    QFile::remove(backup);
+  else if (existed && !QFile::exists(path))
+    QFile::rename(backup, path);
+  mBuffer.open(saved ? path : temp);
+
+  // The history holds the text of each edit rather than pieces, so it can
+  // still be undone from the newly mapped file
+  mCursor = qMin(cursor, mBuffer.size());
+  mAnchor = qMin(mAnchor, mBuffer.size());
+  mTopLine = mBuffer.lineStart(top);
+  mChunkStates.clear();
+  mRowEnds.clear();
+  if (saved)
+    mUnsavedChanges = false;
+
+  updateScrollBars();
+  viewport()->update();
+  return saved;
+} // save
+
+// ====================================================
+//  CURSOR POSITION
+// ====================================================
+qint64 LargeFileEditor::cursorPosition(void) const
+{
+  return mCursor;
+} // cursorPosition
+
+// ====================================================
+//  SET CURSOR POSITION
+// ====================================================
+void LargeFileEditor::setCursorPosition(qint64 pos)
+{
+  mCursor = qBound(Q_INT64_C(0), pos, mBuffer.size());
+  mAnchor = mCursor;
+  mGoalColumn = static_cast<int>(mCursor - findLineStart(mCursor));
+  ensureCursorVisible();
+} // setCursorPosition
+
+// ====================================================
+//  HAS SELECTION
+// ====================================================
+bool LargeFileEditor::hasSelection(void) const
+{
+  return mAnchor != mCursor;
+} // hasSelection
+
+// ====================================================
+//  SELECTED TEXT
+// ====================================================
+QByteArray LargeFileEditor::selectedText(void) const
+{
+  return mBuffer.read(qMin(mAnchor, mCursor), qAbs(mCursor - mAnchor));
+} // selectedText
+
+// ====================================================
+//  SET REFLOW OFFERED
+// ====================================================
+void LargeFileEditor::setReflowOffered(bool offered)
+{
+  mpReflowBar->setVisible(offered);
+  setViewportMargins(0, (offered ? mpReflowBar->sizeHint().height() : 0), 0, 0);
+  layoutReflowBar();
+} // setReflowOffered
+
+// ====================================================
+//  REFLOW (slot)
+// ====================================================
+void LargeFileEditor::reflow(void)
+{
+  TRACE_SCOPE("LargeFileEditor::reflow");
+
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+
+  QByteArray text = mBuffer.read(0, mBuffer.size());
+  const char* data = text.constData();
+  int length = text.size();
+
+  Reflower r(mFormat, mTabSpaces, mNewline);
+  r.out.reserve(length + length / 4);
+
+  bool blankLine = true;
+  int i = 0;
+  while (i < length)
+  {
+    char ch = data[i];
+    if (ch == '\n')
+    {
+      // Blank lines are kept, and every line break ends a statement
+      r.endLine();
+      if (blankLine)
+        r.out += mNewline;
+      blankLine = true;
+      ++i;
+    }
+    else if (ch == ' ' || ch == '\t' || ch == '\r')
+    {
+      ++i;
+    }
+    else if (ch == '/' && i + 1 < length && data[i + 1] == '/')
+    {
+      // A comment runs to the end of the line
+      int start = i;
+      while (i < length && data[i] != '\n' && data[i] != '\r')
+        ++i;
+      r.put(data + start, i - start);
+      r.endLine();
+      blankLine = false;
+    }
+    else if (ch == '{')
+    {
+      Atom block = r.pending;
+      r.endLine();
+      r.put("{", 1);
+      r.endLine();
+      r.stack.push_back(block);
+      r.pending = Atom();
+      blankLine = false;
+      ++i;
+    }
+    else if (ch == '}')
+    {
+      r.endLine();
+      if (!r.stack.isEmpty())
+        r.stack.pop_back();
+      r.put("}", 1);
+      r.endLine();
+      r.pending = Atom();
+      blankLine = false;
+      ++i;
+    }
+    else
+    {
+      int start = i;
+      if (ch == '"')
+      {
+        for (++i; i < length && data[i] != '"' && data[i] != '\n'; ++i) {}
+        if (i < length && data[i] == '"')
+          ++i;
+      }
+      else
+      {
+        while (i < length && data[i] != ' ' && data[i] != '\t' && data[i] != '\r' && data[i] != '\n' &&
+               data[i] != '{' && data[i] != '}' && data[i] != '"')
+          ++i;
+      }
+
+      // An attribute of the enclosing block starts a new statement
+      if (r.words > 0 && ch != '"' && r.startsStatement(data + start, i - start))
+        r.endLine();
+      if (r.words == 0)
+        r.pending = Atom::find(QString::fromLatin1(data + start, i - start));
+
+      r.put(data + start, i - start);
+      ++r.words;
+      blankLine = false;
+    }
+  }
+  r.endLine();
+
+  // Replace the document as a single edit, which can be undone if it
+  // isn't too big to keep
+  mChunkStates.clear();
+  mRowEnds.clear();
+  mChainEdits = false;
+  recordEdit(0, mBuffer.size(), r.out);
+  applyEdit(0, mBuffer.size(), r.out);
+
+  mTopLine = 0;
+  mCursor = 0;
+  mAnchor = 0;
+  mGoalColumn = 0;
+  mLeftColumn = 0;
+
+  QApplication::restoreOverrideCursor();
+
+  setReflowOffered(false);
+  updateScrollBars();
+  updateKeyword();
+  viewport()->update();
+
+  emit reflowed();
+} // reflow
+
+// ====================================================
+//  UNDO (slot)
+// ====================================================
+void LargeFileEditor::undo(void)
+{
+  if (mUndo.isEmpty())
+    return;
+
+  // Take back the edits chained to the last one too, last first
+  qint64 cursor;
+  bool chained;
+  do
+  {
+    Edit edit = mUndo.last();
+    mUndo.pop_back();
+    applyEdit(edit.pos, edit.inserted.size(), edit.removed);
+    mRedo.push_back(edit);
+    cursor = edit.cursor;
+    chained = edit.chained;
+  } while (chained && !mUndo.isEmpty());
+
+  setCursorPosition(cursor);
+} // undo
+
+// ====================================================
+//  REDO (slot)
+// ====================================================
+void LargeFileEditor::redo(void)
+{
+  if (mRedo.isEmpty())
+    return;
+
+  // The edits that were taken back together are made again in order
+  qint64 cursor;
+  do
+  {
+    Edit edit = mRedo.last();
+    mRedo.pop_back();
+    applyEdit(edit.pos, edit.removed.size(), edit.inserted);
+    mUndo.push_back(edit);
+    cursor = edit.pos + edit.inserted.size();
+  } while (!mRedo.isEmpty() && mRedo.last().chained);
+
+  setCursorPosition(cursor);
+} // redo
+
+// ====================================================
+//  CUT (slot)
+// ====================================================
+void LargeFileEditor::cut(void)
+{
+  if (!hasSelection())
+    return;
+
+  // A selection too big for the clipboard is kept rather than lost
+  if (qAbs(mCursor - mAnchor) > MAX_CLIPBOARD_SIZE)
+  {
+    QApplication::beep();
+    return;
+  }
+
+  copy();
+  mChainEdits = false;
+  removeSelection();
+  setCursorPosition(mCursor);
+} // cut
+
+// ====================================================
+//  COPY (slot)
+// ====================================================
+void LargeFileEditor::copy(void)
+{
+  if (!hasSelection())
+    return;
+
+  if (qAbs(mCursor - mAnchor) > MAX_CLIPBOARD_SIZE)
+  {
+    QApplication::beep();
+    return;
+  }
+  QApplication::clipboard()->setText(QString::fromLatin1(selectedText()));
+} // copy
+
+// ====================================================
+//  PASTE (slot)
+// ====================================================
+void LargeFileEditor::paste(void)
+{
+  // Scripts are ASCII, and take on the line breaks of the file
+  QByteArray text = QApplication::clipboard()->text().toLatin1();
+  text.replace("\r\n", "\n");
+  if (mNewline != "\n")
+    text.replace("\n", mNewline);
+
+  mChainEdits = false;
+  removeSelection();
+  insertText(text);
+  setCursorPosition(mCursor);
+} // paste
+
+// ====================================================
+//  SELECT ALL (slot)
+// ====================================================
+void LargeFileEditor::selectAll(void)
+{
+  mAnchor = 0;
+  mCursor = mBuffer.size();
+  mGoalColumn = static_cast<int>(mCursor - findLineStart(mCursor));
+  ensureCursorVisible();
+} // selectAll
+
+// ====================================================
+//  KEY PRESS EVENT (inherited)
+// ====================================================
+void LargeFileEditor::keyPressEvent(QKeyEvent* event)
+{
+  TRACE_SCOPE("LargeFileEditor::keyPressEvent");
+
+  QElapsedTimer timer;
+  timer.start();
+
+  int k = event->key();
+  bool control = (event->modifiers() & Qt::ControlModifier);
+  bool shift = (event->modifiers() & Qt::ShiftModifier);
+  qint64 size = mBuffer.size();
+  qint64 line = findLineStart(mCursor);
+  bool keepColumn = false;
+
+  // Movement with SHIFT held extends the selection, and editing replaces
+  // it.  Everything else leaves it as it is.
+  bool keepSelection = false;
+  mChainEdits = false;
+
+  // Undo and the clipboard
+  if (event->matches(QKeySequence::Undo))
+    undo();
+  else if (event->matches(QKeySequence::Redo))
+    redo();
+  else if (event->matches(QKeySequence::Cut))
+    cut();
+  else if (event->matches(QKeySequence::Copy))
+  {
+    copy();
+    keepSelection = true;
+  }
+  else if (event->matches(QKeySequence::Paste))
+    paste();
+  else if (event->matches(QKeySequence::SelectAll))
+  {
+    selectAll();
+    keepSelection = true;
+  }
+
+  // Cursor movement.  CTRL+Up and CTRL+Down are left to the IDE.
+  else if (k == Qt::Key_Left)
+  {
+    if (mCursor > 0)
+      mCursor -= (mCursor > 1 && mBuffer.at(mCursor - 1) == '\n' && mBuffer.at(mCursor - 2) == '\r' ? 2 : 1);
+    keepSelection = shift;
+  }
+  else if (k == Qt::Key_Right)
+  {
+    if (mCursor < size)
+      mCursor += (mCursor + 1 < size && mBuffer.at(mCursor) == '\r' && mBuffer.at(mCursor + 1) == '\n' ? 2 : 1);
+    keepSelection = shift;
+  }
+  else if ((k == Qt::Key_Up || k == Qt::Key_Down) && !control)
+  {
+    moveLines(k == Qt::Key_Up ? -1 : 1);
+    keepColumn = true;
+    keepSelection = shift;
+  }
+  else if ((k == Qt::Key_Up || k == Qt::Key_Down) && control)
+  {
+    keepSelection = true;
+  }
+  else if (k == Qt::Key_PageUp || k == Qt::Key_PageDown)
+  {
+    moveLines(k == Qt::Key_PageUp ? -visibleLines() : visibleLines());
+    keepColumn = true;
+    keepSelection = shift;
+  }
+  else if (k == Qt::Key_Home)
+  {
+    mCursor = (control ? 0 : line);
+    keepSelection = shift;
+  }
+  else if (k == Qt::Key_End)
+  {
+    mCursor = (control ? size : textEnd(line));
+    keepSelection = shift;
+  }
+
+  // Deletion, taking a "\r\n" as one character
+  else if (k == Qt::Key_Backspace)
+  {
+    if (hasSelection())
+    {
+      removeSelection();
+    }
+    else if (mCursor > 0)
+    {
+      int count = (mCursor > 1 && mBuffer.at(mCursor - 1) == '\n' && mBuffer.at(mCursor - 2) == '\r' ? 2 : 1);
+      removeText(mCursor - count, count);
+    }
+  }
+  else if (k == Qt::Key_Delete)
+  {
+    if (hasSelection())
+      removeSelection();
+    else if (mCursor < size)
+      removeText(mCursor, (mCursor + 1 < size && mBuffer.at(mCursor) == '\r' && mBuffer.at(mCursor + 1) == '\n' ? 2 : 1));
+  }
+
+  // Enter (Auto Indent)
+  else if (k == Qt::Key_Enter || k == Qt::Key_Return)
+  {
+    removeSelection();
+    line = findLineStart(mCursor);
+
+    // If Ctrl+Enter is pressed, insert a newline at the beginning of this
+    // line and move the cursor up one line.
+    if (control)
+    {
+      mCursor = line;
+      insertText(mNewline);
+      mCursor = line;
+    }
+    else
+    {
+      insertText(mNewline);
+    }
+
+    // Insert appropriate number of spaces
+    insertText(QByteArray(getNumIndent(), ' '));
+  }
+
+  // Tab (but not CTRL+Tab), inserting spaces instead of tabs
+  else if (k == Qt::Key_Tab)
+  {
+    if (control)
+    {
+      keepSelection = true;
+    }
+    else
+    {
+      removeSelection();
+      insertText(mTabSpaces);
+    }
+  }
+
+  // Brace Match
+  else if (k == Qt::Key_BraceRight)
+  {
+    removeSelection();
+    matchBraces();
+  }
+
+  // Typing
+  else if (!control && !event->text().isEmpty() && event->text()[0].isPrint())
+  {
+    removeSelection();
+    insertText(event->text().toLatin1());
+  }
+  else
+  {
+    keepSelection = true;
+  }
+
+  if (!keepSelection)
+    mAnchor = mCursor;
+  if (!keepColumn)
+    mGoalColumn = static_cast<int>(mCursor - findLineStart(mCursor));
+  ensureCursorVisible();
+
+  // emit signal
+  emit keyPressed(event);
+
+  static metrics::Metric* latency = metrics::Registry::instance()->metric("editor.keystroke_ms");
+  latency->sample(timer.nsecsElapsed() / 1000000.0);
+} // keyPressEvent
+
+// ====================================================
+//  PAINT EVENT (inherited)
+// ====================================================
+void LargeFileEditor::paintEvent(QPaintEvent* event)
+{
+  TRACE_SCOPE("LargeFileEditor::paintEvent");
+
+  QPainter painter(viewport());
+  painter.fillRect(event->rect(), palette().base());
+
+  QFontMetrics metrics(font());
+  int height = lineHeight();
+  int width = charWidth();
+  int columns = visibleColumns() + 1;
+  QColor textColor = palette().color(QPalette::Text);
+  qint64 size = mBuffer.size();
+  qint64 selectionStart = qMin(mAnchor, mCursor);
+  qint64 selectionEnd = qMax(mAnchor, mCursor);
+
+  QVector<int> formats;
+  updateRows();
+  qint64 line = mTopLine;
+  for (int row = 0, y = 0; row < mRowEnds.size() && y < viewport()->height(); ++row, y += height)
+  {
+    qint64 lineEnd = mRowEnds[row];
+    qint64 end = (lineEnd > line && mBuffer.at(lineEnd - 1) == '\r' ? lineEnd - 1 : lineEnd);
+    qint64 length = end - line;
+
+    // Read the part of the line that will be highlighted.  A long line is
+    // highlighted a chunk at a time from the lexical state the line is in at
+    // the first chunk, so a string or comment that starts off screen still
+    // shows as one.  The highlighter is given the state as a prefix ('"' or
+    // "//") that isn't drawn.
+    qint64 from = 0;
+    qint64 count = length;
+    QString prefix;
+    if (length > MAX_HIGHLIGHT_LINE)
+    {
+      int firstChunk = qMax(0, mLeftColumn - HIGHLIGHT_MARGIN) / MAX_HIGHLIGHT_LINE;
+      int lastChunk = (mLeftColumn + columns + HIGHLIGHT_MARGIN) / MAX_HIGHLIGHT_LINE;
+      from = static_cast<qint64>(firstChunk) * MAX_HIGHLIGHT_LINE;
+      count = qMin(length - from, static_cast<qint64>(lastChunk - firstChunk + 1) * MAX_HIGHLIGHT_LINE);
+
+      char state = chunkState(line, end, firstChunk);
+      if (state == LEX_STRING)
+        prefix = "\"";
+      else if (state == LEX_COMMENT)
+        prefix = "//";
+    }
+
+    // Selection, with a column for the line break if it is selected too
+    if (selectionStart < selectionEnd && selectionStart <= end && selectionEnd > line)
+    {
+      qint64 first = qMax(selectionStart - line, static_cast<qint64>(mLeftColumn));
+      qint64 last = qMin(selectionEnd, end) - line + (selectionEnd > end ? 1 : 0);
+      last = qMin(last, static_cast<qint64>(mLeftColumn + columns));
+      if (last > first)
+        painter.fillRect(static_cast<int>(first - mLeftColumn) * width, y, static_cast<int>(last - first) * width, height, palette().highlight());
+    }
+
+    if (mLeftColumn < length)
+    {
+      QString text = prefix + QString::fromLatin1(mBuffer.read(line + from, count));
+      text.replace('\t', ' ');
+      int shift = prefix.size();
+
+      // Work out the format of every character.  Later ranges win.
+      mHighlighter.highlight(text, mRanges);
+      formats.fill(-1, text.size());
+      for (int r = 0; r < mRanges.size(); ++r)
+      {
+        int last = qMin(mRanges[r].start + mRanges[r].length, text.size());
+        for (int i = qMax(mRanges[r].start, 0); i < last; ++i)
+          formats[i] = r;
+      }
+
+      // Draw the visible columns, a run of characters with the same format at a time
+      int first = static_cast<int>(qMax(static_cast<qint64>(mLeftColumn) - from, Q_INT64_C(0))) + shift;
+      int last = static_cast<int>(qMin(static_cast<qint64>(mLeftColumn + columns) - from + shift, static_cast<qint64>(text.size())));
+      for (int i = first; i < last; )
+      {
+        int j = i + 1;
+        while (j < last && formats[j] == formats[i])
+          ++j;
+
+        QFont runFont = font();
+        QColor color = textColor;
+        if (formats[i] >= 0)
+        {
+          const QTextCharFormat& format = mRanges[formats[i]].format;
+          if (format.foreground().style() != Qt::NoBrush)
+            color = format.foreground().color();
+          runFont.setBold(format.fontWeight() > QFont::Normal);
+          runFont.setItalic(format.fontItalic());
+        }
+
+        painter.setFont(runFont);
+        painter.setPen(color);
+        painter.drawText(static_cast<int>(from + i - shift - mLeftColumn) * width, y + metrics.ascent(), text.mid(i, j - i));
+        i = j;
+      }
+    }
+
+    // Cursor
+    if (mCursor >= line && mCursor <= end)
+      painter.fillRect(static_cast<int>(mCursor - line - mLeftColumn) * width, y, 1, height, textColor);
+
+    if (lineEnd >= size)
+      break;
+    line = lineEnd + 1;
+  }
+} // paintEvent
+
+// ====================================================
+//  MOUSE PRESS EVENT (inherited)
+// ====================================================
+void LargeFileEditor::mousePressEvent(QMouseEvent* event)
+{
+  // SHIFT+click extends the selection
+  mCursor = positionAt(event->pos());
+  if (!(event->modifiers() & Qt::ShiftModifier))
+    mAnchor = mCursor;
+  mGoalColumn = static_cast<int>(mCursor - findLineStart(mCursor));
+  ensureCursorVisible();
+} // mousePressEvent
+
+// ====================================================
+//  MOUSE MOVE EVENT (inherited)
+// ====================================================
+void LargeFileEditor::mouseMoveEvent(QMouseEvent* event)
+{
+  // Dragging selects from where the button was pressed
+  if (!(event->buttons() & Qt::LeftButton))
+    return;
+
+  mCursor = positionAt(event->pos());
+  mGoalColumn = static_cast<int>(mCursor - findLineStart(mCursor));
+  ensureCursorVisible();
+} // mouseMoveEvent
+
+// ====================================================
+//  RESIZE EVENT (inherited)
+// ====================================================
+void LargeFileEditor::resizeEvent(QResizeEvent* event)
+{
+  QAbstractScrollArea::resizeEvent(event);
+  layoutReflowBar();
+  updateScrollBars();
+} // resizeEvent
+
+// ====================================================
+//  DRAG ENTER EVENT (inherited)
+// ====================================================
+void LargeFileEditor::dragEnterEvent(QDragEnterEvent* event)
+{
+  if (event->mimeData()->hasUrls())
+    event->acceptProposedAction();
+} // dragEnterEvent
+
+// ====================================================
+//  DROP EVENT (inherited)
+// ====================================================
+void LargeFileEditor::dropEvent(QDropEvent* event)
+{
+  if (event->mimeData()->hasUrls())
+  {
+    QList<QUrl> urls = event->mimeData()->urls();
+    foreach (QUrl url, urls)
+      emit fileDropped(url.toLocalFile());
+  }
+} // dropEvent
+
+// ====================================================
+//  SCROLL CONTENTS BY (inherited)
+// ====================================================
+void LargeFileEditor::scrollContentsBy(int dx, int dy)
+{
+  // The scroll bars are positions in the file rather than pixels, so the
+  // view is repainted instead of scrolled
+  if (dy != 0)
+  {
+    qint64 top = mBuffer.lineStart(verticalScrollBar()->value() * mScrollScale);
+
+    // A small step down can land on the same line, so it always moves at
+    // least one line
+    if (dy < 0 && top <= mTopLine)
+      top = qMin(findLineEnd(mTopLine) + 1, mBuffer.size());
+    mTopLine = mBuffer.lineStart(top);
+  }
+
+  if (dx != 0)
+    mLeftColumn = horizontalScrollBar()->value();
+
+  updateScrollBars();
+  viewport()->update();
+} // scrollContentsBy
+
+// ====================================================
+//  FOCUS NEXT PREV CHILD (inherited)
+// ====================================================
+bool LargeFileEditor::focusNextPrevChild(bool next)
+{
+  Q_UNUSED(next);
+
+  // Tab inserts spaces rather than moving the focus
+  return false;
+} // focusNextPrevChild
+
+// ====================================================
+//  INSERT TEXT
+// ====================================================
+void LargeFileEditor::insertText(const QByteArray& text)
+{
+  if (text.isEmpty())
+    return;
+
+  qint64 pos = mCursor;
+  recordEdit(pos, 0, text);
+  applyEdit(pos, 0, text);
+  mCursor = pos + text.size();
+} // insertText
+
+// ====================================================
+//  REMOVE TEXT
+// ====================================================
+void LargeFileEditor::removeText(qint64 pos, qint64 length)
+{
+  if (length <= 0)
+    return;
+
+  recordEdit(pos, length, QByteArray());
+  applyEdit(pos, length, QByteArray());
+} // removeText
+
+// ====================================================
+//  REMOVE SELECTION
+// ====================================================
+void LargeFileEditor::removeSelection(void)
+{
+  qint64 start = qMin(mAnchor, mCursor);
+  removeText(start, qAbs(mCursor - mAnchor));
+  mCursor = start;
+  mAnchor = start;
+} // removeSelection
+
+// ====================================================
+//  RECORD EDIT
+// ====================================================
+void LargeFileEditor::recordEdit(qint64 pos, qint64 removed, const QByteArray& inserted)
+{
+  bool chained = mChainEdits;
+  mChainEdits = true;
+
+  // Whatever was taken back can't be made again once something else is
+  // edited
+  foreach (const Edit& edit, mRedo)
+    mHistoryMemory -= editMemory(edit.removed.size(), edit.inserted.size());
+  mRedo.clear();
+
+  qint64 memory = editMemory(removed, inserted.size());
+  if (memory > MAX_HISTORY_MEMORY)
+  {
+    clearHistory();
+    return;
+  }
+
+  // A typed character that follows the last one extends its edit, so a
+  // word is undone at once
+  bool typed = (removed == 0 && inserted.size() == 1 && inserted[0] != '\n');
+  if (typed && !chained && !mUndo.isEmpty())
+  {
+    Edit& last = mUndo.last();
+    if (last.typed && last.pos + last.inserted.size() == pos)
+    {
+      last.inserted += inserted;
+      mHistoryMemory += inserted.size();
+      return;
+    }
+  }
+
+  Edit edit;
+  edit.pos = pos;
+  edit.removed = mBuffer.read(pos, removed);
+  edit.inserted = inserted;
+  edit.cursor = mCursor;
+  edit.chained = chained;
+  edit.typed = typed;
+  mUndo.push_back(edit);
+  mHistoryMemory += memory;
+
+  // Forget the oldest edits, along with those chained to them, until the
+  // history is back within its limit
+  int forget = 0;
+  qint64 freed = 0;
+  while (forget < mUndo.size() && (mHistoryMemory - freed > MAX_HISTORY_MEMORY || (forget > 0 && mUndo[forget].chained)))
+  {
+    freed += editMemory(mUndo[forget].removed.size(), mUndo[forget].inserted.size());
+    ++forget;
+  }
+  mUndo.remove(0, forget);
+  mHistoryMemory -= freed;
+} // recordEdit
+
+// ====================================================
+//  APPLY EDIT
+// ====================================================
+void LargeFileEditor::applyEdit(qint64 pos, qint64 removed, const QByteArray& inserted)
+{
+  invalidateChunks(pos);
+  editRows(pos, removed, inserted);
+  if (removed > 0)
+    mBuffer.remove(pos, removed);
+  if (!inserted.isEmpty())
+    mBuffer.insert(pos, inserted);
+
+  mCursor = movePosition(mCursor, pos, removed, inserted.size());
+  mAnchor = movePosition(mAnchor, pos, removed, inserted.size());
+  if (mTopLine > pos)
+    mTopLine = mBuffer.lineStart(movePosition(mTopLine, pos, removed, inserted.size()));
+
+  mUnsavedChanges = true;
+  viewport()->update();
+} // applyEdit
+
+// ====================================================
+//  CLEAR HISTORY
+// ====================================================
+void LargeFileEditor::clearHistory(void)
+{
+  mUndo.clear();
+  mRedo.clear();
+  mHistoryMemory = 0;
+} // clearHistory
+
+// ====================================================
+//  POSITION AT
+// ====================================================
+qint64 LargeFileEditor::positionAt(const QPoint& point)
+{
+  // Find the line under the point, keeping to the rows in view
+  updateRows();
+  int row = qBound(0, point.y() / lineHeight(), mRowEnds.size() - 1);
+  qint64 line = (row > 0 ? mRowEnds[row - 1] + 1 : mTopLine);
+
+  int column = qMax(0, (point.x() + charWidth() / 2) / charWidth() + mLeftColumn);
+  return qMin(line + column, textEnd(line));
+} // positionAt
+
+// ====================================================
+//  TEXT END
+// ====================================================
+qint64 LargeFileEditor::textEnd(qint64 line) const
+{
+  qint64 end = findLineEnd(line);
+  return (end > line && mBuffer.at(end - 1) == '\r' ? end - 1 : end);
+} // textEnd
+
+// ====================================================
+//  GET NUM INDENT
+// ====================================================
+int LargeFileEditor::getNumIndent(bool toPrevBraceOnly) const
+{
+  qint64 limit = qMax(Q_INT64_C(0), mCursor - MAX_INDENT_SCAN);
+  qint64 line = findLineStart(mCursor);
+  qint64 end = mCursor;
+  int closes = 0;
+
+  // Walk back a line at a time.  Within a line the braces that aren't
+  // matched on it are some closes followed by some opens, so the opens
+  // (last first) are matched against the closes found after them, and then
+  // the line's closes are added to those.
+  for (;;)
+  {
+    qint64 from = qMax(line, end - MAX_INDENT_SCAN);
+    QByteArray text = mBuffer.read(from, end - from);
+
+    QVector<int> opens;
+    int lineCloses = 0;
+    for (int i = 0; i < text.size(); ++i)
+    {
+      // Skip comments
+      if (text[i] == '/' && i + 1 < text.size() && text[i + 1] == '/')
+        break;
+      else if (text[i] == '{')
+        opens.push_back(i);
+      else if (text[i] == '}')
+      {
+        if (opens.isEmpty())
+          ++lineCloses;
+        else
+          opens.pop_back();
+      }
+    }
+
+    for (int i = opens.size() - 1; i >= 0; --i)
+    {
+      if (closes > 0)
+      {
+        --closes;
+        continue;
+      }
+
+      // Get indentation of the last open brace, and include the tab
+      // indentation unless only that is wanted
+      int indent = static_cast<int>(from - line) + opens[i];
+      return (toPrevBraceOnly ? indent : indent + mTabSpaces.size());
+    }
+    closes += lineCloses;
+
+    if (line == 0)
+      return 0;
+    if (line <= limit)
+      break;
+
+    end = line - 1;
+    line = findLineStart(end);
+  }
+
+  // No brace within reach, so keep the indentation of the current line
+  QByteArray current = mBuffer.read(findLineStart(mCursor), 256);
+  int spaces = 0;
+  while (spaces < current.size() && current[spaces] == ' ')
+    ++spaces;
+  return spaces;
+} // getNumIndent
+
+// ====================================================
+//  MATCH BRACES
+// ====================================================
+void LargeFileEditor::matchBraces(void)
+{
+  // If there's only whitespace between the start of the line and the
+  // cursor, remove it and line the brace up with its open brace
+  qint64 line = findLineStart(mCursor);
+  if (mCursor - line <= MAX_HIGHLIGHT_LINE && mBuffer.read(line, mCursor - line).trimmed().isEmpty())
+  {
+    removeText(line, mCursor - line);
+    insertText(QByteArray(getNumIndent(true), ' '));
+  }
+
+  // Insert the closing brace
+  insertText("}");
+} // matchBraces
+
+// ====================================================
+//  MOVE LINES
+// ====================================================
+void LargeFileEditor::moveLines(int count)
+{
+  qint64 line = findLineStart(mCursor);
+  for (int i = 0; i < qAbs(count); ++i)
+  {
+    if (count > 0)
+    {
+      qint64 lineEnd = findLineEnd(line);
+      if (lineEnd >= mBuffer.size())
+        break;
+      line = lineEnd + 1;
+    }
+    else
+    {
+      if (line == 0)
+        break;
+      line = findLineStart(line - 1);
+    }
+  }
+
+  mCursor = qMin(line + mGoalColumn, textEnd(line));
+} // moveLines
+
+// ====================================================
+//  ENSURE CURSOR VISIBLE
+// ====================================================
+void LargeFileEditor::ensureCursorVisible(void)
+{
+  qint64 line = findLineStart(mCursor);
+  int visible = visibleLines();
+
+  if (line < mTopLine)
+  {
+    mTopLine = line;
+  }
+  else
+  {
+    // Count the lines down to the cursor's, as far as the bottom of the view
+    updateRows();
+    int row = 0;
+    while (row < visible && row < mRowEnds.size() && mRowEnds[row] < line)
+      ++row;
+
+    // Below the view, so it becomes the bottom line
+    if (row >= visible)
+    {
+      mTopLine = line;
+      for (int i = 1; i < visible && mTopLine > 0; ++i)
+        mTopLine = findLineStart(mTopLine - 1);
+    }
+  }
+
+  int column = static_cast<int>(mCursor - line);
+  if (column < mLeftColumn)
+    mLeftColumn = column;
+  else if (column >= mLeftColumn + visibleColumns())
+    mLeftColumn = column - visibleColumns() + 1;
+
+  updateScrollBars();
+  updateKeyword();
+  viewport()->update();
+} // ensureCursorVisible
+
+// ====================================================
+//  UPDATE SCROLL BARS
+// ====================================================
+void LargeFileEditor::updateScrollBars(void)
+{
+  qint64 size = mBuffer.size();
+  int visible = visibleLines();
+
+  // The vertical scroll bar goes through the file by byte, scaled down to
+  // fit an int
+  mScrollScale = 1 + size / INT_MAX;
+  QScrollBar* vertical = verticalScrollBar();
+  vertical->blockSignals(true);
+  vertical->setRange(0, static_cast<int>(size / mScrollScale));
+  vertical->setSingleStep(1);
+  vertical->setPageStep(qMax(1, static_cast<int>(visible * 40 / mScrollScale)));
+  vertical->setValue(static_cast<int>(mTopLine / mScrollScale));
+  vertical->blockSignals(false);
+
+  // The horizontal one is in columns, as far as the longest visible line goes
+  updateRows();
+  qint64 longest = 0;
+  qint64 line = mTopLine;
+  for (int row = 0; row < visible && row < mRowEnds.size(); ++row)
+  {
+    longest = qMax(longest, mRowEnds[row] - line);
+    line = mRowEnds[row] + 1;
+  }
+
+  // Offer to break up lines too long for a TextEditor, such as those of
+  // materials exported on a single line
+  if (longest > TextEditor::MAX_LINE_LENGTH && mpReflowBar->isHidden())
+    setReflowOffered(true);
+  longest = qMax(longest, static_cast<qint64>(mLeftColumn));
+
+  QScrollBar* horizontal = horizontalScrollBar();
+  horizontal->blockSignals(true);
+  horizontal->setRange(0, static_cast<int>(qMin(qMax(longest - visibleColumns() + 1, Q_INT64_C(0)), static_cast<qint64>(INT_MAX))));
+  horizontal->setPageStep(visibleColumns());
+  horizontal->setValue(mLeftColumn);
+  horizontal->blockSignals(false);
+} // updateScrollBars
+
+// ====================================================
+//  UPDATE KEYWORD
+// ====================================================
+void LargeFileEditor::updateKeyword(void)
+{
+  // Get the first word on this line
+  QByteArray text = mBuffer.read(findLineStart(mCursor), 256);
+  int start = 0;
+  while (start < text.size() && (text[start] == ' ' || text[start] == '\t'))
+    ++start;
+  int end = start;
+  while (end < text.size() && isWordChar(text[end]))
+    ++end;
+
+  // Only words that were interned can be keywords
+  Atom keyword = Atom::find(QString::fromLatin1(text.constData() + start, end - start));
+  if (keyword != mFocusedKeyword)
+  {
+    mFocusedKeyword = keyword;
+    emit keywordChanged(mFocusedKeyword, mFormat);
+  }
+} // updateKeyword
+
+// ====================================================
+//  CHUNK STATE
+// ====================================================
+char LargeFileEditor::chunkState(qint64 line, qint64 end, int chunk)
+{
+  // Long lines are rare, so when too many have been seen it's simplest to
+  // start again
+  if (mChunkStates.size() >= MAX_CHUNK_LINES && !mChunkStates.contains(line))
+    mChunkStates.clear();
+
+  QByteArray& states = mChunkStates[line];
+  if (states.isEmpty())
+    states.append(LEX_CODE);
+
+  // Scan on a chunk at a time from the last state known.  A byte past the
+  // chunk is read so that a "//" across the boundary is seen.
+  while (states.size() <= chunk)
+  {
+    qint64 start = line + static_cast<qint64>(states.size() - 1) * MAX_HIGHLIGHT_LINE;
+    QByteArray text = mBuffer.read(start, qMin(end - start, static_cast<qint64>(MAX_HIGHLIGHT_LINE + 1)));
+    int length = qMin(text.size(), MAX_HIGHLIGHT_LINE);
+
+    char state = states.at(states.size() - 1);
+    for (int i = 0; i < length && state != LEX_COMMENT; ++i)
+    {
+      if (state == LEX_STRING)
+      {
+        if (text[i] == '"')
+          state = LEX_CODE;
+      }
+      else if (text[i] == '"')
+      {
+        state = LEX_STRING;
+      }
+      else if (text[i] == '/' && i + 1 < text.size() && text[i + 1] == '/')
+      {
+        state = LEX_COMMENT;
+      }
+    }
+    states.append(state);
+  }
+
+  return states.at(chunk);
+} // chunkState
+
+// ====================================================
+//  INVALIDATE CHUNKS
+// ====================================================
+void LargeFileEditor::invalidateChunks(qint64 pos)
+{
+  if (mChunkStates.isEmpty())
+    return;
+
+  // The states of the edited line up to the edit still hold, as do those of
+  // the lines before it.  The lines after it have moved.
+  qint64 line = findLineStart(pos);
+  QHash<qint64, QByteArray>::iterator itr = mChunkStates.begin();
+  while (itr != mChunkStates.end())
+  {
+    if (itr.key() > line)
+    {
+      itr = mChunkStates.erase(itr);
+    }
+    else
+    {
+      // A chunk's state depends on its first byte as well as those before it
+      if (itr.key() == line)
+        itr->truncate(pos > line ? static_cast<int>((pos - line - 1) / MAX_HIGHLIGHT_LINE) + 1 : 1);
+      ++itr;
+    }
+  }
+} // invalidateChunks
+
+// ====================================================
+//  UPDATE ROWS
+// ====================================================
+void LargeFileEditor::updateRows(void)
+{
+  int rows = visibleLines() + 1;
+
+  if (!mRowEnds.isEmpty() && mRowsTop != mTopLine)
+  {
+    if (mTopLine > mRowsTop)
+    {
+      // Scrolled down, so the rows from the new top line on are kept if it
+      // was in view
+      QVector<qint64>::iterator itr = qLowerBound(mRowEnds.begin(), mRowEnds.end(), mTopLine - 1);
+      if (itr != mRowEnds.end() && *itr == mTopLine - 1)
+        mRowEnds.remove(0, static_cast<int>(itr - mRowEnds.begin()) + 1);
+      else
+        mRowEnds.clear();
+    }
+    else
+    {
+      // Scrolled up, so the lines above the old top line are looked up, and
+      // the old rows are kept below them if they're reached
+      QVector<qint64> above;
+      qint64 line = mTopLine;
+      while (above.size() < rows && line < mRowsTop)
+      {
+        above.append(mBuffer.lineEnd(line));
+        line = above.last() + 1;
+      }
+      if (line != mRowsTop)
+        mRowEnds.clear();
+      mRowEnds = above + mRowEnds;
+    }
+  }
+  mRowsTop = mTopLine;
+
+  // Look up the rest of the rows down to the bottom of the view
+  qint64 size = mBuffer.size();
+  while (mRowEnds.size() < rows && (mRowEnds.isEmpty() || mRowEnds.last() < size))
+    mRowEnds.append(mBuffer.lineEnd(mRowEnds.isEmpty() ? mRowsTop : mRowEnds.last() + 1));
+  if (mRowEnds.size() > rows)
+    mRowEnds.resize(rows);
+} // updateRows
+
+// ====================================================
+//  EDIT ROWS
+// ====================================================
+void LargeFileEditor::editRows(qint64 pos, qint64 removed, const QByteArray& inserted)
+{
+  if (mRowEnds.isEmpty() || pos > mRowEnds.last())
+    return;
+
+  // An edit above the rows moves all of them, and perhaps the top line too
+  if (pos < mRowsTop)
+  {
+    mRowEnds.clear();
+    return;
+  }
+
+  // The lines ending before the edit stay as they are
+  QVector<qint64> ends;
+  int row = 0;
+  while (row < mRowEnds.size() && mRowEnds[row] < pos)
+    ends.append(mRowEnds[row++]);
+
+  // A removal reaching past the last known line end may join lines that
+  // aren't known, so the rest are looked up again
+  if (pos + removed <= mRowEnds.last())
+  {
+    // Line breaks that were inserted end lines of their own, those that
+    // were removed join their lines to the next, and the rest move along.
+    // Only as many rows as fill the view are kept, however much is pasted.
+    int rows = visibleLines() + 1;
+    for (int i = inserted.indexOf('\n'); i >= 0 && ends.size() < rows; i = inserted.indexOf('\n', i + 1))
+      ends.append(pos + i);
+    if (ends.size() >= rows)
+      row = mRowEnds.size();
+    for (; row < mRowEnds.size(); ++row)
+    {
+      if (mRowEnds[row] >= pos + removed)
+        ends.append(mRowEnds[row] - removed + inserted.size());
+    }
+  }
+  mRowEnds = ends;
+} // editRows
+
+// ====================================================
+//  FIND LINE START
+// ====================================================
+qint64 LargeFileEditor::findLineStart(qint64 pos) const
+{
+  if (!mRowEnds.isEmpty() && pos >= mRowsTop && pos <= mRowEnds.last())
+  {
+    QVector<qint64>::const_iterator itr = qLowerBound(mRowEnds.begin(), mRowEnds.end(), pos);
+    return (itr == mRowEnds.begin() ? mRowsTop : *(itr - 1) + 1);
+  }
+  return mBuffer.lineStart(pos);
+} // findLineStart
+
+// ====================================================
+//  FIND LINE END
+// ====================================================
+qint64 LargeFileEditor::findLineEnd(qint64 line) const
+{
+  if (!mRowEnds.isEmpty() && line >= mRowsTop && line <= mRowEnds.last())
+  {
+    QVector<qint64>::const_iterator itr = qLowerBound(mRowEnds.begin(), mRowEnds.end(), line);
+    qint64 start = (itr == mRowEnds.begin() ? mRowsTop : *(itr - 1) + 1);
+    if (start == line)
+      return *itr;
+  }
+  return mBuffer.lineEnd(line);
+} // findLineEnd
+
+// ====================================================
+//  LAYOUT REFLOW BAR
+// ====================================================
+void LargeFileEditor::layoutReflowBar(void)
+{
+  QRect rect = contentsRect();
+  mpReflowBar->setGeometry(rect.left(), rect.top(), rect.width(), mpReflowBar->sizeHint().height());
+} // layoutReflowBar
+
+// ====================================================
+//  LINE HEIGHT
+// ====================================================
+int LargeFileEditor::lineHeight(void) const
+{
+  return fontMetrics().height();
+} // lineHeight
+
+// ====================================================
+//  CHAR WIDTH
+// ====================================================
+int LargeFileEditor::charWidth(void) const
+{
+  return qMax(1, fontMetrics().width(QLatin1Char(' ')));
+} // charWidth
+
+// ====================================================
+//  VISIBLE LINES
+// ====================================================
+int LargeFileEditor::visibleLines(void) const
+{
+  return qMax(1, viewport()->height() / lineHeight());
+} // visibleLines
+
+// ====================================================
+//  VISIBLE COLUMNS
+// ====================================================
+int LargeFileEditor::visibleColumns(void) const
+{
+  return qMax(1, viewport()->width() / charWidth());
+} // visibleColumns
\ No newline at end of file
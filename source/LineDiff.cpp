@@ -0,0 +1,144 @@
+#include "LineDiff.h" // class definition
+
+// ====================================================
+//  HASH LINE (static)
+// ====================================================
+quint64 LineDiff::hashLine(const QString& line)
+{
+  // 64 bit FNV-1a, so that two different lines of a file practically never
+  // compare equal
+  quint64 hash = Q_UINT64_C(14695981039346656037);
+  const ushort* text = line.utf16();
+  for (int i = 0; i < line.size(); ++i)
+  {
+    hash ^= text[i];
+    hash *= Q_UINT64_C(1099511628211);
+  }
+  return hash;
+} // hashLine
+
+// ====================================================
+//  COMPARE (static)
+// ====================================================
+QVector<DiffHunk> LineDiff::compare(const QVector<quint64>& oldLines, const QVector<quint64>& newLines,
+                                   int maxEdits)
+{
+  QVector<DiffHunk> hunks;
+
+  // Trim the common start and end, which is all a typical reload keeps
+  int first = 0;
+  while (first < oldLines.size() && first < newLines.size() && oldLines[first] == newLines[first])
+    ++first;
+
+  int oldEnd = oldLines.size();
+  int newEnd = newLines.size();
+  while (oldEnd > first && newEnd > first && oldLines[oldEnd - 1] == newLines[newEnd - 1])
+  {
+    --oldEnd;
+    --newEnd;
+  }
+
+  const int n = oldEnd - first;
+  const int m = newEnd - first;
+  if (n == 0 && m == 0)
+    return hunks;
+
+  if (n == 0 || m == 0)
+  {
+    DiffHunk hunk = { first, n, first, m };
+    hunks.push_back(hunk);
+    return hunks;
+  }
+
+  // Myers' greedy search for the shortest edit script.  v[k] is the furthest
+  // old line reached on diagonal k (old - new == k); a copy of v is kept for
+  // each number of edits d, holding diagonals -d..d, to trace the path back.
+  const quint64* a = oldLines.constData() + first;
+  const quint64* b = newLines.constData() + first;
+  const int limit = qMin(n + m, maxEdits);
+
+  QVector<int> v(2 * limit + 3, 0);
+  const int center = limit + 1;
+  QVector<QVector<int> > trace;
+  int edits = -1;
+
+  for (int d = 0; d <= limit && edits < 0; ++d)
+  {
+    for (int k = -d; k <= d; k += 2)
+    {
+      int x;
+      if (k == -d || (k != d && v[center + k - 1] < v[center + k + 1]))
+        x = v[center + k + 1];      // A line inserted
+      else
+        x = v[center + k - 1] + 1;  // A line removed
+
+      int y = x - k;
+      while (x < n && y < m && a[x] == b[y])
+      {
+        ++x;
+        ++y;
+      }
+      v[center + k] = x;
+
+      if (x >= n && y >= m)
+      {
+        edits = d;
+        break;
+      }
+    }
+    trace.push_back(v.mid(center - d, 2 * d + 1));
+  }
+
+  if (edits < 0)
+  {
+    // Too many changes to be worth finding exactly
+    DiffHunk hunk = { first, n, first, m };
+    hunks.push_back(hunk);
+    return hunks;
+  }
+
+  // Walk back from the end, finding the single edit that led to each d.  An
+  // edit's position is where it starts: a removal of old line x, or an
+  // insertion of new line y before old line x.
+  QVector<int> editX(edits);
+  QVector<int> editY(edits);
+  QVector<bool> editInsert(edits);
+  int x = n;
+  int y = m;
+  for (int d = edits; d > 0; --d)
+  {
+    const QVector<int>& prev = trace[d - 1];  // Diagonals -(d-1)..(d-1)
+    const int k = x - y;
+    bool insert = (k == -d || (k != d && prev[k - 1 + d - 1] < prev[k + 1 + d - 1]));
+    int prevK = (insert ? k + 1 : k - 1);
+    int prevX = prev[prevK + d - 1];
+    int prevY = prevX - prevK;
+
+    editX[d - 1] = prevX;
+    editY[d - 1] = prevY;
+    editInsert[d - 1] = insert;
+    x = prevX;
+    y = prevY;
+  }
+
+  // Adjacent edits make up a hunk
+  for (int i = 0; i < edits; ++i)
+  {
+    if (!hunks.isEmpty())
+    {
+      DiffHunk& last = hunks.last();
+      if (last.oldStart + last.oldCount == first + editX[i] && last.newStart + last.newCount == first + editY[i])
+      {
+        if (editInsert[i])
+          ++last.newCount;
+        else
+          ++last.oldCount;
+        continue;
+      }
+    }
+
+    DiffHunk hunk = { first + editX[i], editInsert[i] ? 0 : 1, first + editY[i], editInsert[i] ? 1 : 0 };
+    hunks.push_back(hunk);
+  }
+  return hunks;
+} // compare
\ No newline at end of file
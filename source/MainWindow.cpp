@@ -1,67 +1,177 @@
-#include <QtGui/QtGui>
-#include "MainWindow.h" // class definition
-#include "IDE.h"
-
-MainWindow::MainWindow(QWidget *parent)
-  : QMainWindow(parent)
-{
-  setupEditor();
-  setupFileMenu();
-  setupOptionsMenu();
-  setupHelpMenu();
-  
-  setWindowTitle(tr("Material IDE"));
-}
-
-void MainWindow::about()
-{
-  QMessageBox::about(this, "Material IDE", "No About");
-}
-
-void MainWindow::setupEditor()
-{
-  mpIde = new IDE(this);
-  setCentralWidget(mpIde);
-}
-
-void MainWindow::setupFileMenu()
-{
-  QMenu* fileMenu = new QMenu("&File", this);
-  menuBar()->addMenu(fileMenu);
-
-  fileMenu->addAction("&New", mpIde, SLOT(newFile()), QKeySequence::New);
-  fileMenu->addAction("&Open", mpIde, SLOT(open()), QKeySequence::Open);
-  fileMenu->addAction("&Save", mpIde, SLOT(save()), QKeySequence::Save);
-  fileMenu->addAction("Save &As", mpIde, SLOT(saveAs()), QKeySequence::SaveAs);
-  fileMenu->addSeparator();
-  fileMenu->addAction("E&xit", qApp, SLOT(quit()), QKeySequence::Close);
-}
-
-void MainWindow::setupOptionsMenu()
-{
-  QMenu* optMenu = new QMenu("&Options", this);
-  menuBar()->addMenu(optMenu);
-
-  QMenu* formatMenu = new QMenu("Change Format", optMenu);
-  connect(formatMenu, SIGNAL(triggered(QAction*)), this, SLOT(temp(QAction*)));
-  optMenu->addMenu(formatMenu);
-
-  // Add a menu option for all supported formats
-  QStringList formats = config::ConfigFile::instance()->getAllFormatNames();
-  foreach (QString format, formats)
-    formatMenu->addAction(format);
-}
-
-void MainWindow::setupHelpMenu()
-{
-  QMenu *helpMenu = new QMenu(tr("&Help"), this);
-  menuBar()->addMenu(helpMenu);
-
-  helpMenu->addAction(tr("&About"), this, SLOT(about()));
-  helpMenu->addAction(tr("About &Qt"), qApp, SLOT(aboutQt()));
-}
-
-void MainWindow::temp(QAction* act)
-{
-  mpIde->setCurrentFormat(act->text());
+#include <QtGui/QtGui>
+#include "MainWindow.h" // class definition
+#include "IDE.h"
+#include "Outline.h"
+#include "ProblemList.h"
+#include "EffectiveMaterial.h"
+#include "DiffView.h"
+#include "DocsSearch.h"
+#include "TextEditor.h"
+#include "Trace.h"
+
+MainWindow::MainWindow(QWidget *parent)
+  : QMainWindow(parent)
+{
+  setupEditor();
+  setupFileMenu();
+  setupViewMenu();
+  setupOptionsMenu();
+  setupHelpMenu();
+  
+  setWindowTitle(tr("Material IDE"));
+}
+
+void MainWindow::about()
+{
+  QMessageBox::about(this, "Material IDE", "No About");
+}
+
+void MainWindow::setupEditor()
+{
+  mpIde = new IDE(this);
+  setCentralWidget(mpIde);
+
+  // Outline of the current document, docked beside the tabs
+  Outline* outline = new Outline(this);
+  connect(mpIde, SIGNAL(currentEditorChanged(TextEditor*)), outline, SLOT(setEditor(TextEditor*)));
+  mpOutlineDock = new QDockWidget("Outline", this);
+  mpOutlineDock->setObjectName("outline");
+  mpOutlineDock->setWidget(outline);
+  addDockWidget(Qt::LeftDockWidgetArea, mpOutlineDock);
+
+  // Diagnostics of the current document, docked below the tabs
+  ProblemList* problems = new ProblemList(this);
+  connect(mpIde, SIGNAL(currentEditorChanged(TextEditor*)), problems, SLOT(setEditor(TextEditor*)));
+  mpProblemsDock = new QDockWidget("Problems", this);
+  mpProblemsDock->setObjectName("problems");
+  mpProblemsDock->setWidget(problems);
+  addDockWidget(Qt::BottomDockWidgetArea, mpProblemsDock);
+
+  // The material under the cursor as it ends up after inheritance, docked
+  // on the other side and hidden until asked for
+  EffectiveMaterial* effective = new EffectiveMaterial(this);
+  connect(mpIde, SIGNAL(currentEditorChanged(TextEditor*)), effective, SLOT(setEditor(TextEditor*)));
+  mpEffectiveDock = new QDockWidget("Effective Material", this);
+  mpEffectiveDock->setObjectName("effective");
+  mpEffectiveDock->setWidget(effective);
+  addDockWidget(Qt::RightDockWidgetArea, mpEffectiveDock);
+  mpEffectiveDock->hide();
+
+  // Structural differences, shown below the tabs whenever a comparison is
+  // made
+  DiffView* diff = new DiffView(this);
+  connect(mpIde, SIGNAL(currentEditorChanged(TextEditor*)), diff, SLOT(setEditor(TextEditor*)));
+  connect(mpIde, SIGNAL(compared(const QString&, const QVector<ScriptChange>&)), diff, SLOT(setChanges(const QString&, const QVector<ScriptChange>&)));
+  mpDiffDock = new QDockWidget("Structural Diff", this);
+  mpDiffDock->setObjectName("diff");
+  mpDiffDock->setWidget(diff);
+  addDockWidget(Qt::BottomDockWidgetArea, mpDiffDock);
+  mpDiffDock->hide();
+  connect(mpIde, SIGNAL(compared(const QString&, const QVector<ScriptChange>&)), mpDiffDock, SLOT(show()));
+
+  // Search of the Ogre manual, docked on the other side and hidden until
+  // asked for
+  mpDocsDock = new QDockWidget("Manual Search", this);
+  mpDocsDock->setObjectName("docs");
+  mpDocsDock->setWidget(new DocsSearch(this));
+  addDockWidget(Qt::RightDockWidgetArea, mpDocsDock);
+  mpDocsDock->hide();
+
+  // Put back the last session's tabs and offer to recover unsaved changes
+  // once the window is up
+  QTimer::singleShot(0, mpIde, SLOT(restoreSession()));
+  QTimer::singleShot(0, mpIde, SLOT(recoverJournals()));
+}
+
+void MainWindow::setupFileMenu()
+{
+  QMenu* fileMenu = new QMenu("&File", this);
+  menuBar()->addMenu(fileMenu);
+
+  fileMenu->addAction("&New", mpIde, SLOT(newFile()), QKeySequence::New);
+  fileMenu->addAction("&Open", mpIde, SLOT(open()), QKeySequence::Open);
+  fileMenu->addAction("Open From &Bundle...", mpIde, SLOT(openFromBundle()));
+  fileMenu->addAction("&Save", mpIde, SLOT(save()), QKeySequence::Save);
+  fileMenu->addAction("Save &As", mpIde, SLOT(saveAs()), QKeySequence::SaveAs);
+  fileMenu->addSeparator();
+  fileMenu->addAction("E&xit", qApp, SLOT(quit()), QKeySequence::Close);
+}
+
+void MainWindow::setupViewMenu()
+{
+  QMenu* viewMenu = new QMenu("&View", this);
+  menuBar()->addMenu(viewMenu);
+
+  viewMenu->addAction("&Fold All", mpIde, SLOT(foldAll()));
+  viewMenu->addAction("&Unfold All", mpIde, SLOT(unfoldAll()));
+  viewMenu->addSeparator();
+  viewMenu->addAction(mpOutlineDock->toggleViewAction());
+  viewMenu->addAction(mpProblemsDock->toggleViewAction());
+  viewMenu->addAction(mpEffectiveDock->toggleViewAction());
+  viewMenu->addAction(mpDiffDock->toggleViewAction());
+  viewMenu->addAction(mpDocsDock->toggleViewAction());
+  viewMenu->addSeparator();
+  viewMenu->addAction("Compare With &Saved", mpIde, SLOT(compareWithSaved()));
+  viewMenu->addAction("Compare With &File...", mpIde, SLOT(compareWithFile()));
+}
+
+void MainWindow::setupOptionsMenu()
+{
+  QMenu* optMenu = new QMenu("&Options", this);
+  menuBar()->addMenu(optMenu);
+
+  QMenu* formatMenu = new QMenu("Change Format", optMenu);
+  connect(formatMenu, SIGNAL(triggered(QAction*)), this, SLOT(temp(QAction*)));
+  optMenu->addMenu(formatMenu);
+
+  // Add a menu option for all supported formats
+  QStringList formats = config::ConfigFile::instance()->getAllFormatNames();
+  foreach (QString format, formats)
+    formatMenu->addAction(format);
+
+  // Record keystrokes for the replay harness
+  optMenu->addSeparator();
+  QAction* recordAction = optMenu->addAction("&Record Keystrokes");
+  recordAction->setCheckable(true);
+  connect(recordAction, SIGNAL(toggled(bool)), mpIde, SLOT(setRecording(bool)));
+
+  // Performance HUD
+  QAction* hudAction = optMenu->addAction("Performance &HUD");
+  hudAction->setCheckable(true);
+  connect(hudAction, SIGNAL(toggled(bool)), mpIde, SLOT(setPerformanceHudVisible(bool)));
+
+  // Tracing
+  QMenu* traceMenu = new QMenu("&Tracing", optMenu);
+  optMenu->addMenu(traceMenu);
+  QAction* traceAction = traceMenu->addAction("&Enable Tracing");
+  traceAction->setCheckable(true);
+  traceAction->setChecked(trace::isEnabled());
+  connect(traceAction, SIGNAL(toggled(bool)), this, SLOT(setTracing(bool)));
+  traceMenu->addAction("&Save Trace...", this, SLOT(saveTrace()));
+}
+
+void MainWindow::setupHelpMenu()
+{
+  QMenu *helpMenu = new QMenu(tr("&Help"), this);
+  menuBar()->addMenu(helpMenu);
+
+  helpMenu->addAction(tr("&About"), this, SLOT(about()));
+  helpMenu->addAction(tr("About &Qt"), qApp, SLOT(aboutQt()));
+}
+
+void MainWindow::temp(QAction* act)
+{
+  mpIde->setCurrentFormat(act->text());
+}
+
+void MainWindow::setTracing(bool enabled)
+{
+  trace::setEnabled(enabled);
+}
+
+void MainWindow::saveTrace()
+{
+  QString path = QFileDialog::getSaveFileName(this, "Save Trace", "trace.json", "Chrome Trace (*.json)");
+  if (!path.isNull() && !trace::dump(path))
+    QMessageBox::warning(this, "Save Trace", QString("Could not write %1").arg(path));
 }
\ No newline at end of file
@@ -0,0 +1,894 @@
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QRegExp>
+#include <QtCore/QSet>
+#include <QtCore/QTextCodec>
+#include <QtCore/QtAlgorithms>
+#include <QtCore/QtConcurrentMap>
+#include <QtCore/QtConcurrentRun>
+#include <math.h>
+#include "ManualIndex.h" // class definition
+#include "ConfigFile.h"
+#include "ConfigWatcher.h"
+#include "Trace.h"
+#include "Metrics.h"
+
+/// Identifies a saved index
+static const quint32 MANUAL_MAGIC = 0x4d4d414e;  // "MMAN"
+
+/// Changed whenever the layout of a saved index does
+static const quint32 MANUAL_VERSION = 1;
+
+/// How many times a word in a page's title counts
+static const int TITLE_WEIGHT = 3;
+
+/// Words longer than this are left out, since they are never typed
+static const int MAX_TERM_LENGTH = 64;
+
+/// Most words a prefix matches, in order, so one letter doesn't read them all
+static const int MAX_EXPANSIONS = 64;
+
+/// How quickly BM25 stops counting repeats of a word
+static const double BM25_K1 = 1.2;
+
+/// How much BM25 favours short pages
+static const double BM25_B = 0.75;
+
+/// Characters of context either side of the match in a snippet
+static const int SNIPPET_CONTEXT = 60;
+
+/// How long the indexer waits after a change on disk before it rebuilds,
+/// in milliseconds, so a burst of changes is handled at once
+static const int MANUAL_DELAY = 500;
+
+/// Elements that start a new line of text
+static const char* BLOCK_TAGS[] =
+{
+  "br", "p", "div", "tr", "li", "dt", "dd", "h1", "h2", "h3", "h4", "h5", "h6",
+  "pre", "table", "ul", "ol", "dl", "hr", "blockquote", "title", NULL
+};
+
+// Initialize Static Members
+ManualIndexer* ManualIndexer::mpMe = NULL;
+
+// ====================================================
+//  IS BLOCK TAG (local)
+// ====================================================
+static bool isBlockTag(const QString& name)
+{
+  for (int i = 0; BLOCK_TAGS[i]; ++i)
+  {
+    if (name == QLatin1String(BLOCK_TAGS[i]))
+      return true;
+  }
+  return false;
+} // isBlockTag
+
+// ====================================================
+//  IS WORD CHAR (local)
+// ====================================================
+static inline bool isWordChar(QChar ch)
+{
+  return ch.isLetterOrNumber() || ch == '_';
+} // isWordChar
+
+// ====================================================
+//  DECODE ENTITY (local)
+// ====================================================
+/** Decodes the entity at \e at, which is a '&'.
+ * @param length Receives how many characters it took.
+ * @returns The character, or a null QChar if it isn't an entity. */
+static QChar decodeEntity(const QString& html, int at, int& length)
+{
+  int end = html.indexOf(';', at);
+  if (end < 0 || end - at > 10)
+    return QChar();
+  length = end - at + 1;
+
+  QString name = html.mid(at + 1, end - at - 1);
+  if (name.startsWith('#'))
+  {
+    bool ok = false;
+    uint code = (name.startsWith("#x", Qt::CaseInsensitive) ? name.mid(2).toUInt(&ok, 16) : name.mid(1).toUInt(&ok));
+    return (ok && code > 0 && code <= 0xffff ? QChar(code) : QChar());
+  }
+
+  if (name == "lt")    return QChar('<');
+  if (name == "gt")    return QChar('>');
+  if (name == "amp")   return QChar('&');
+  if (name == "quot")  return QChar('"');
+  if (name == "apos")  return QChar('\'');
+  if (name == "nbsp")  return QChar(' ');
+  if (name == "copy")  return QChar(0xa9);
+  return QChar();
+} // decodeEntity
+
+// ====================================================
+//  SCORED PAGE (local)
+// ====================================================
+/** A page that matched a search, ordered best first. */
+struct ScoredPage
+{
+  double  score;
+  int     page;
+
+  bool operator<(const ScoredPage& rhs) const
+  {
+    return score > rhs.score || (score == rhs.score && page < rhs.page);
+  }
+};
+
+// ====================================================
+//  READ PAGE (local)
+// ====================================================
+/** Reads a page on one of QtConcurrent's threads.  A page that can't be
+ * read comes back with an empty path. */
+struct ReadPage
+{
+  typedef ManualPage result_type;
+
+  QString directory;
+
+  ManualPage operator()(const QString& path) const
+  {
+    ManualPage page;
+    if (!ManualPage::read(directory, path, page))
+      page.path.clear();
+    return page;
+  }
+};
+
+// ---------------------------------------------------------------------
+//                              MANUAL PAGE
+// ---------------------------------------------------------------------
+
+// ====================================================
+//  READ (static)
+// ====================================================
+bool ManualPage::read(const QString& directory, const QString& path, ManualPage& out)
+{
+  QFile file(directory + '/' + path);
+  if (!file.open(QFile::ReadOnly))
+    return false;
+
+  QFileInfo info(file);
+  QByteArray bytes = file.readAll();
+  QString html = QTextCodec::codecForHtml(bytes, QTextCodec::codecForName("ISO-8859-1"))->toUnicode(bytes);
+
+  out.path = path;
+  out.modified = info.lastModified().toMSecsSinceEpoch();
+  out.size = info.size();
+  out.text = ManualIndex::toPlainText(html);
+
+  QRegExp title("<title[^>]*>(.*)</title>", Qt::CaseInsensitive);
+  title.setMinimal(true);
+  if (title.indexIn(html) >= 0)
+    out.title = ManualIndex::toPlainText(title.cap(1)).simplified();
+  if (out.title.isEmpty())
+    out.title = info.fileName();
+
+  out.counts.clear();
+  foreach (const QString& term, ManualIndex::splitTerms(out.text, true))
+    ++out.counts[term];
+  foreach (const QString& term, ManualIndex::splitTerms(out.title, true))
+    out.counts[term] += TITLE_WEIGHT - 1;
+
+  out.length = 0;
+  foreach (int count, out.counts)
+    out.length += count;
+  return true;
+} // read
+
+// ---------------------------------------------------------------------
+//                              MANUAL INDEX
+// ---------------------------------------------------------------------
+
+// ====================================================
+//  CTOR
+// ====================================================
+ManualIndex::ManualIndex(void)
+  : mTotalLength(0), mModified(false)
+{
+} // ctor
+
+// ====================================================
+//  SET DIRECTORY
+// ====================================================
+void ManualIndex::setDirectory(const QString& directory)
+{
+  QString absolute = (directory.isEmpty() ? QString() : QDir(directory).absolutePath());
+  if (absolute == mDirectory)
+    return;
+
+  *this = ManualIndex();
+  mDirectory = absolute;
+  mModified = true;
+} // setDirectory
+
+// ====================================================
+//  DIRECTORY
+// ====================================================
+const QString& ManualIndex::directory(void) const
+{
+  return mDirectory;
+} // directory
+
+// ====================================================
+//  REFRESH
+// ====================================================
+int ManualIndex::refresh(void)
+{
+  TRACE_SCOPE("ManualIndex::refresh");
+
+  // Time stamps and sizes come with the listing, so nothing is read unless
+  // it changed
+  QSet<QString> present;
+  QStringList changed;
+  QDir root(mDirectory);
+  if (!mDirectory.isEmpty() && root.exists())
+  {
+    QDirIterator it(mDirectory, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+      QString path = it.next();
+      if (!isPage(path))
+        continue;
+      path = root.relativeFilePath(path);
+      present.insert(path);
+
+      int id = mPageIds.value(path, -1);
+      if (id < 0 || mPages[id].modified != it.fileInfo().lastModified().toMSecsSinceEpoch() ||
+          mPages[id].size != it.fileInfo().size())
+        changed << path;
+    }
+  }
+
+  QStringList removed;
+  QHash<QString, int>::const_iterator citr = mPageIds.begin();
+  for (; citr != mPageIds.end(); ++citr)
+  {
+    if (!present.contains(citr.key()))
+      removed << citr.key();
+  }
+  foreach (const QString& path, removed)
+    removePage(path);
+
+  ReadPage read;
+  read.directory = mDirectory;
+  QList<ManualPage> pages = QtConcurrent::blockingMapped<QList<ManualPage> >(changed, read);
+  for (int i = 0; i < changed.size(); ++i)
+  {
+    removePage(changed[i]);
+    if (!pages[i].path.isEmpty())
+      addPage(pages[i]);
+  }
+  return changed.size() + removed.size();
+} // refresh
+
+// ====================================================
+//  LOAD
+// ====================================================
+bool ManualIndex::load(const QString& path)
+{
+  TRACE_SCOPE("ManualIndex::load");
+
+  QFile file(path);
+  if (!file.open(QFile::ReadOnly))
+    return false;
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_4_6);
+
+  quint32 magic, version;
+  QString directory;
+  qint32 count;
+  stream >> magic >> version >> directory >> count;
+  if (stream.status() != QDataStream::Ok || magic != MANUAL_MAGIC || version != MANUAL_VERSION || count < 0)
+    return false;
+
+  ManualIndex index;
+  index.mDirectory = directory;
+  for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+  {
+    ManualPage page;
+    stream >> page.path >> page.title >> page.text >> page.modified >> page.size;
+    index.mPageIds.insert(page.path, i);
+    index.mPages.push_back(page);
+  }
+
+  // The counts of each page are the postings turned around
+  qint32 terms;
+  stream >> terms;
+  for (int t = 0; t < terms && stream.status() == QDataStream::Ok; ++t)
+  {
+    QString term;
+    qint32 numPostings;
+    stream >> term >> numPostings;
+    QVector<Posting>& postings = index.mPostings[term];
+    for (int p = 0; p < numPostings && stream.status() == QDataStream::Ok; ++p)
+    {
+      qint32 page, number;
+      stream >> page >> number;
+      if (page < 0 || page >= index.mPages.size() || number <= 0)
+        return false;
+
+      Posting posting;
+      posting.page = page;
+      posting.count = number;
+      postings.push_back(posting);
+      index.mPages[page].counts.insert(term, number);
+      index.mPages[page].length += number;
+      index.mTotalLength += number;
+    }
+  }
+
+  if (stream.status() != QDataStream::Ok)
+    return false;
+
+  *this = index;
+  mModified = false;
+  return true;
+} // load
+
+// ====================================================
+//  SAVE
+// ====================================================
+bool ManualIndex::save(const QString& path)
+{
+  TRACE_SCOPE("ManualIndex::save");
+
+  // Written next to the last good index and then swapped in, as the
+  // dependency graph is
+  QString temp = path + ".saving";
+  QFile file(temp);
+  if (!file.open(QFile::WriteOnly | QFile::Truncate))
+    return false;
+
+  // Free slots are left out, so pages are numbered afresh
+  QVector<int> numbers(mPages.size(), -1);
+  int count = 0;
+  for (int i = 0; i < mPages.size(); ++i)
+  {
+    if (!mPages[i].path.isEmpty())
+      numbers[i] = count++;
+  }
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_4_6);
+  stream << MANUAL_MAGIC << MANUAL_VERSION << mDirectory << static_cast<qint32>(count);
+  foreach (const ManualPage& page, mPages)
+  {
+    if (!page.path.isEmpty())
+      stream << page.path << page.title << page.text << page.modified << page.size;
+  }
+
+  stream << static_cast<qint32>(mPostings.size());
+  PostingMap::const_iterator citr = mPostings.begin();
+  for (; citr != mPostings.end(); ++citr)
+  {
+    stream << citr.key() << static_cast<qint32>(citr->size());
+    foreach (const Posting& posting, *citr)
+      stream << static_cast<qint32>(numbers[posting.page]) << static_cast<qint32>(posting.count);
+  }
+
+  bool written = (stream.status() == QDataStream::Ok && file.error() == QFile::NoError);
+  file.close();
+  if (written)
+  {
+    QFile::remove(path);
+    written = QFile::rename(temp, path);
+  }
+  if (!written)
+    QFile::remove(temp);
+  else
+    mModified = false;
+  return written;
+} // save
+
+// ====================================================
+//  IS MODIFIED
+// ====================================================
+bool ManualIndex::isModified(void) const
+{
+  return mModified;
+} // isModified
+
+// ====================================================
+//  SEARCH
+// ====================================================
+void ManualIndex::search(const QString& query, int maxHits, QVector<ManualHit>& out) const
+{
+  TRACE_SCOPE("ManualIndex::search");
+
+  QStringList terms = splitTerms(query, false);
+  if (terms.isEmpty())
+    return;
+  bool prefix = isWordChar(query[query.size() - 1]);
+
+  // Pages must have every word, and are scored by the sum over them
+  QHash<int, double> scores;
+  for (int t = 0; t < terms.size(); ++t)
+  {
+    QHash<int, double> termScores;
+    if (prefix && t == terms.size() - 1)
+    {
+      // A page is scored by the best of the words it has that the prefix
+      // matches
+      PostingMap::const_iterator citr = mPostings.lowerBound(terms[t]);
+      for (int n = 0; citr != mPostings.end() && n < MAX_EXPANSIONS && citr.key().startsWith(terms[t]); ++citr, ++n)
+      {
+        QHash<int, double> expansion;
+        scoreTerm(*citr, expansion);
+        QHash<int, double>::const_iterator eitr = expansion.begin();
+        for (; eitr != expansion.end(); ++eitr)
+          termScores[eitr.key()] = qMax(termScores.value(eitr.key()), *eitr);
+      }
+    }
+    else
+    {
+      PostingMap::const_iterator citr = mPostings.find(terms[t]);
+      if (citr != mPostings.end())
+        scoreTerm(*citr, termScores);
+    }
+
+    if (t == 0)
+      scores = termScores;
+    else
+    {
+      QHash<int, double> both;
+      QHash<int, double>::const_iterator sitr = scores.begin();
+      for (; sitr != scores.end(); ++sitr)
+      {
+        QHash<int, double>::const_iterator titr = termScores.find(sitr.key());
+        if (titr != termScores.end())
+          both.insert(sitr.key(), *sitr + *titr);
+      }
+      scores = both;
+    }
+    if (scores.isEmpty())
+      return;
+  }
+
+  QVector<ScoredPage> ranked;
+  ranked.reserve(scores.size());
+  QHash<int, double>::const_iterator sitr = scores.begin();
+  for (; sitr != scores.end(); ++sitr)
+  {
+    ScoredPage scored;
+    scored.score = *sitr;
+    scored.page = sitr.key();
+    ranked.push_back(scored);
+  }
+  qSort(ranked);
+
+  for (int i = 0; i < ranked.size() && i < maxHits; ++i)
+  {
+    const ManualPage& page = mPages[ranked[i].page];
+    ManualHit hit;
+    hit.path = page.path;
+    hit.title = page.title;
+    hit.score = ranked[i].score;
+
+    // The snippet is around the earliest of the words
+    int found = -1;
+    foreach (const QString& term, terms)
+    {
+      int at = page.text.indexOf(term, 0, Qt::CaseInsensitive);
+      if (at >= 0 && (found < 0 || at < found))
+        found = at;
+    }
+    if (found >= 0)
+    {
+      int start = found, end = found;
+      while (start > 0 && isWordChar(page.text[start - 1]))
+        --start;
+      while (end < page.text.size() && isWordChar(page.text[end]))
+        ++end;
+      hit.term = page.text.mid(start, end - start);
+    }
+
+    int from = qMax(0, found - SNIPPET_CONTEXT);
+    int to = qMin(page.text.size(), qMax(found, 0) + 2 * SNIPPET_CONTEXT);
+    hit.snippet = page.text.mid(from, to - from).simplified();
+    if (from > 0)
+      hit.snippet.prepend("...");
+    if (to < page.text.size())
+      hit.snippet.append("...");
+    out.push_back(hit);
+  }
+} // search
+
+// ====================================================
+//  PAGE TEXT
+// ====================================================
+QString ManualIndex::pageText(const QString& path) const
+{
+  int id = mPageIds.value(path, -1);
+  return (id < 0 ? QString() : mPages[id].text);
+} // pageText
+
+// ====================================================
+//  PAGES
+// ====================================================
+QStringList ManualIndex::pages(void) const
+{
+  return mPageIds.keys();
+} // pages
+
+// ====================================================
+//  PAGE COUNT
+// ====================================================
+int ManualIndex::pageCount(void) const
+{
+  return mPageIds.size();
+} // pageCount
+
+// ====================================================
+//  TERM COUNT
+// ====================================================
+int ManualIndex::termCount(void) const
+{
+  return mPostings.size();
+} // termCount
+
+// ====================================================
+//  IS PAGE (static)
+// ====================================================
+bool ManualIndex::isPage(const QString& path)
+{
+  QString suffix = QFileInfo(path).suffix().toLower();
+  return suffix == "html" || suffix == "htm";
+} // isPage
+
+// ====================================================
+//  TO PLAIN TEXT (static)
+// ====================================================
+QString ManualIndex::toPlainText(const QString& html)
+{
+  QString out;
+  out.reserve(html.size());
+  bool space = false;   // Whitespace since the last character written
+
+  int i = 0;
+  while (i < html.size())
+  {
+    QChar ch = html[i];
+    if (ch == '<')
+    {
+      if (html.midRef(i, 4) == QLatin1String("<!--"))
+      {
+        int end = html.indexOf("-->", i + 4);
+        i = (end < 0 ? html.size() : end + 3);
+        continue;
+      }
+
+      int end = html.indexOf('>', i);
+      if (end < 0)
+        break;
+      int start = i + 1;
+      bool closing = (start < end && html[start] == '/');
+      if (closing)
+        ++start;
+      int nameEnd = start;
+      while (nameEnd < end && html[nameEnd].isLetterOrNumber())
+        ++nameEnd;
+      QString name = html.mid(start, nameEnd - start).toLower();
+      i = end + 1;
+
+      // Scripts and styles aren't text
+      if (!closing && (name == "script" || name == "style"))
+      {
+        int close = html.indexOf("</" + name, i, Qt::CaseInsensitive);
+        i = (close < 0 ? html.size() : close);
+        continue;
+      }
+
+      if (isBlockTag(name) && !out.isEmpty() && !out.endsWith('\n'))
+      {
+        out += '\n';
+        space = false;
+      }
+      continue;
+    }
+
+    int length = 1;
+    if (ch == '&')
+    {
+      QChar decoded = decodeEntity(html, i, length);
+      if (decoded.isNull())
+        length = 1;
+      else
+        ch = decoded;
+    }
+    i += length;
+
+    if (ch.isSpace())
+    {
+      space = true;
+      continue;
+    }
+    if (space && !out.isEmpty() && !out.endsWith('\n'))
+      out += ' ';
+    space = false;
+    out += ch;
+  }
+  return out;
+} // toPlainText
+
+// ====================================================
+//  SPLIT TERMS (static)
+// ====================================================
+QStringList ManualIndex::splitTerms(const QString& text, bool parts)
+{
+  QStringList terms;
+  int i = 0;
+  while (i < text.size())
+  {
+    if (!isWordChar(text[i]))
+    {
+      ++i;
+      continue;
+    }
+
+    int start = i;
+    while (i < text.size() && isWordChar(text[i]))
+      ++i;
+    if (i - start < 2 || i - start > MAX_TERM_LENGTH)
+      continue;
+
+    QString term = text.mid(start, i - start).toLower();
+    terms << term;
+    if (parts && term.contains('_'))
+    {
+      foreach (const QString& part, term.split('_', QString::SkipEmptyParts))
+      {
+        if (part.size() >= 2)
+          terms << part;
+      }
+    }
+  }
+  return terms;
+} // splitTerms
+
+// ====================================================
+//  ADD PAGE
+// ====================================================
+void ManualIndex::addPage(const ManualPage& page)
+{
+  int id;
+  if (mFree.isEmpty())
+  {
+    id = mPages.size();
+    mPages.push_back(page);
+  }
+  else
+  {
+    id = mFree.last();
+    mFree.pop_back();
+    mPages[id] = page;
+  }
+  mPageIds.insert(page.path, id);
+  mTotalLength += page.length;
+
+  QHash<QString, int>::const_iterator citr = page.counts.begin();
+  for (; citr != page.counts.end(); ++citr)
+  {
+    Posting posting;
+    posting.page = id;
+    posting.count = *citr;
+    mPostings[citr.key()].push_back(posting);
+  }
+  mModified = true;
+} // addPage
+
+// ====================================================
+//  REMOVE PAGE
+// ====================================================
+void ManualIndex::removePage(const QString& path)
+{
+  QHash<QString, int>::iterator itr = mPageIds.find(path);
+  if (itr == mPageIds.end())
+    return;
+  int id = *itr;
+  mPageIds.erase(itr);
+
+  const ManualPage& page = mPages[id];
+  QHash<QString, int>::const_iterator citr = page.counts.begin();
+  for (; citr != page.counts.end(); ++citr)
+  {
+    PostingMap::iterator pitr = mPostings.find(citr.key());
+    if (pitr == mPostings.end())
+      continue;
+    QVector<Posting>& postings = *pitr;
+    for (int i = 0; i < postings.size(); ++i)
+    {
+      if (postings[i].page == id)
+      {
+        postings.remove(i);
+        break;
+      }
+    }
+    if (postings.isEmpty())
+      mPostings.erase(pitr);
+  }
+
+  mTotalLength -= page.length;
+  mPages[id] = ManualPage();
+  mFree.push_back(id);
+  mModified = true;
+} // removePage
+
+// ====================================================
+//  SCORE TERM
+// ====================================================
+/** Scores the pages with a word in them by BM25. */
+void ManualIndex::scoreTerm(const QVector<Posting>& postings, QHash<int, double>& scores) const
+{
+  double pages = mPageIds.size();
+  double average = (pages > 0 ? mTotalLength / pages : 1.0);
+  double idf = log(1.0 + (pages - postings.size() + 0.5) / (postings.size() + 0.5));
+  foreach (const Posting& posting, postings)
+  {
+    double norm = BM25_K1 * (1.0 - BM25_B + BM25_B * mPages[posting.page].length / qMax(average, 1.0));
+    scores.insert(posting.page, idf * posting.count * (BM25_K1 + 1.0) / (posting.count + norm));
+  }
+} // scoreTerm
+
+// ---------------------------------------------------------------------
+//                              MANUAL INDEXER
+// ---------------------------------------------------------------------
+
+// ====================================================
+//  INSTANCE (static)
+// ====================================================
+ManualIndexer* ManualIndexer::instance(void)
+{
+  if (mpMe == NULL)
+    mpMe = new ManualIndexer();
+  return mpMe;
+} // instance
+
+// ====================================================
+//  CTOR
+// ====================================================
+ManualIndexer::ManualIndexer(void)
+  : mPending(false)
+{
+  connect(&mBuild, SIGNAL(finished()), this, SLOT(onBuildFinished()));
+  connect(&mWatcher, SIGNAL(directoryChanged(const QString&)), this, SLOT(onPathChanged(const QString&)));
+  connect(&mWatcher, SIGNAL(fileChanged(const QString&)), this, SLOT(onPathChanged(const QString&)));
+
+  mTimer.setSingleShot(true);
+  mTimer.setInterval(MANUAL_DELAY);
+  connect(&mTimer, SIGNAL(timeout()), this, SLOT(rebuild()));
+  connect(config::ConfigWatcher::instance(), SIGNAL(changed(const QStringList&)), this, SLOT(onConfigChanged()));
+
+  mSavePath = QDir::current().absoluteFilePath("manual.dat");
+  rebuild();
+} // ctor
+
+// ====================================================
+//  INDEX
+// ====================================================
+const ManualIndex& ManualIndexer::index(void) const
+{
+  return mIndex;
+} // index
+
+// ====================================================
+//  IS BUILDING
+// ====================================================
+bool ManualIndexer::isBuilding(void) const
+{
+  return mBuild.isRunning();
+} // isBuilding
+
+// ====================================================
+//  REBUILD (slot)
+// ====================================================
+void ManualIndexer::rebuild(void)
+{
+  // One build at a time; changes during it are picked up by another
+  if (mBuild.isRunning())
+  {
+    mPending = true;
+    return;
+  }
+
+  mDirectory = config::ConfigFile::instance()->getManualPath();
+  if (mDirectory.isEmpty())
+  {
+    // The manual was taken out of config.xml, so there's nothing to search
+    if (!mIndex.directory().isEmpty())
+    {
+      mIndex = ManualIndex();
+      syncWatches();
+      emit changed();
+    }
+    return;
+  }
+
+  mSinceBuild.start();
+  mBuild.setFuture(QtConcurrent::run(&ManualIndexer::buildIndex, mIndex, mDirectory, mSavePath));
+} // rebuild
+
+// ====================================================
+//  BUILD INDEX (static)
+// ====================================================
+ManualIndex ManualIndexer::buildIndex(ManualIndex index, const QString& directory, const QString& savePath)
+{
+  if (index.pageCount() == 0)
+    index.load(savePath);
+
+  // An index of another directory is thrown away by setDirectory()
+  index.setDirectory(directory);
+  index.refresh();
+  if (index.isModified())
+    index.save(savePath);
+  return index;
+} // buildIndex
+
+// ====================================================
+//  ON BUILD FINISHED (slot)
+// ====================================================
+void ManualIndexer::onBuildFinished(void)
+{
+  mIndex = mBuild.result();
+  syncWatches();
+
+  metrics::Registry::instance()->metric("manual.index_ms")->sample(mSinceBuild.nsecsElapsed() / 1000000.0);
+  emit changed();
+
+  if (mPending)
+  {
+    mPending = false;
+    rebuild();
+  }
+} // onBuildFinished
+
+// ====================================================
+//  ON PATH CHANGED (slot)
+// ====================================================
+void ManualIndexer::onPathChanged(const QString& path)
+{
+  Q_UNUSED(path);
+  mTimer.start();
+} // onPathChanged
+
+// ====================================================
+//  ON CONFIG CHANGED (slot)
+// ====================================================
+void ManualIndexer::onConfigChanged(void)
+{
+  if (config::ConfigFile::instance()->getManualPath() != mDirectory)
+    rebuild();
+} // onConfigChanged
+
+// ====================================================
+//  SYNC WATCHES
+// ====================================================
+void ManualIndexer::syncWatches(void)
+{
+  QSet<QString> wanted;
+  if (!mIndex.directory().isEmpty() && QFileInfo(mIndex.directory()).isDir())
+  {
+    wanted.insert(mIndex.directory());
+    QDirIterator it(mIndex.directory(), QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext())
+      wanted.insert(it.next());
+    foreach (const QString& page, mIndex.pages())
+      wanted.insert(mIndex.directory() + '/' + page);
+  }
+  QSet<QString> watched = mWatcher.directories().toSet() + mWatcher.files().toSet();
+
+  QStringList added = (wanted - watched).toList();
+  QStringList removed = (watched - wanted).toList();
+  if (!removed.isEmpty())
+    mWatcher.removePaths(removed);
+  if (!added.isEmpty())
+    mWatcher.addPaths(added);
+} // syncWatches
\ No newline at end of file
@@ -0,0 +1,464 @@
+#include <QtCore/QDateTime>
+#include <QtCore/QFileInfo>
+#include "MaterialFlattener.h" // class definition
+#include "ScriptParser.h"
+#include "Trace.h"
+
+/// Attributes that may be repeated in a block with different first
+/// arguments, so a child only replaces the one with the same argument
+static const char* const KEYED_ATTRIBUTES[] =
+{
+  "param_named", "param_named_auto", "param_indexed", "param_indexed_auto", "set", "set_texture_alias"
+};
+static const int NUM_KEYED_ATTRIBUTES = sizeof(KEYED_ATTRIBUTES) / sizeof(KEYED_ATTRIBUTES[0]);
+
+// ====================================================
+//  FIND OBJECT (local)
+// ====================================================
+/** @returns The index of the object in \e base that \e object is laid over:
+ * the one with the same keyword and name, or if \e object has no name, the
+ * one with the same keyword in the same position.  -1 if there isn't one. */
+static int findObject(const MaterialStatement& base, const MaterialStatement& object, int position)
+{
+  for (int i = 0; i < base.children.size(); ++i)
+  {
+    const MaterialStatement& child = base.children[i];
+    if (!child.block || child.keyword != object.keyword)
+      continue;
+    if (object.args.isEmpty() ? position-- == 0 : (!child.args.isEmpty() && child.args.first() == object.args.first()))
+      return i;
+  }
+  return -1;
+} // findObject
+
+// ====================================================
+//  FIND ATTRIBUTE (local)
+// ====================================================
+/** @returns The index of the attribute in \e base that \e attribute
+ * replaces, or -1 if there isn't one. */
+static int findAttribute(const MaterialStatement& base, const MaterialStatement& attribute)
+{
+  bool keyed = MaterialStatement::isRepeatable(attribute.keyword);
+  for (int i = 0; i < base.children.size(); ++i)
+  {
+    const MaterialStatement& child = base.children[i];
+    if (child.block || child.keyword != attribute.keyword)
+      continue;
+    if (!keyed || (!child.args.isEmpty() && !attribute.args.isEmpty() && child.args.first() == attribute.args.first()))
+      return i;
+  }
+  return -1;
+} // findAttribute
+
+// ====================================================
+//  MERGE (local)
+// ====================================================
+/** Lays the statements in the block of \e over over the ones of \e base. */
+static void merge(MaterialStatement& base, const MaterialStatement& over)
+{
+  QHash<QString, int> positions;
+  foreach (const MaterialStatement& child, over.children)
+  {
+    if (child.block)
+    {
+      int match = findObject(base, child, positions[child.keyword]++);
+      if (match >= 0)
+        merge(base.children[match], child);
+      else
+        base.children.push_back(child);
+    }
+    else
+    {
+      int match = findAttribute(base, child);
+      if (match >= 0)
+        base.children[match] = child;
+      else
+        base.children.push_back(child);
+    }
+  }
+} // merge
+
+// ---------------------------------------------------------------------
+//                             MATERIAL STATEMENT
+// ---------------------------------------------------------------------
+
+// ====================================================
+//  TO STRING
+// ====================================================
+QString MaterialStatement::toString(int indent) const
+{
+  QString tabs(indent, '\t');
+  QString text = tabs + keyword;
+  foreach (const QString& arg, args)
+  {
+    if (arg.isEmpty() || arg.contains(' ') || arg.contains('\t'))
+      text += " \"" + arg + "\"";
+    else
+      text += ' ' + arg;
+  }
+  if (!block)
+    return text + '\n';
+
+  text += '\n' + tabs + "{\n";
+  foreach (const MaterialStatement& child, children)
+    text += child.toString(indent + 1);
+  return text + tabs + "}\n";
+} // toString
+
+// ====================================================
+//  FROM NODE (static)
+// ====================================================
+MaterialStatement MaterialStatement::fromNode(const script::Node* node)
+{
+  MaterialStatement statement;
+  statement.keyword = node->keyword.toString();
+  for (int i = 0; i < node->numArgs; ++i)
+    statement.args << node->args[i].toString();
+  statement.block = (node->type == script::NODE_OBJECT);
+  for (const script::Node* child = node->firstChild; child; child = child->next)
+    statement.children.push_back(fromNode(child));
+  return statement;
+} // fromNode
+
+// ====================================================
+//  IS REPEATABLE (static)
+// ====================================================
+bool MaterialStatement::isRepeatable(const QString& keyword)
+{
+  for (int i = 0; i < NUM_KEYED_ATTRIBUTES; ++i)
+  {
+    if (keyword == KEYED_ATTRIBUTES[i])
+      return true;
+  }
+  return false;
+} // isRepeatable
+
+// ====================================================
+//  OPERATOR ==
+// ====================================================
+bool MaterialStatement::operator==(const MaterialStatement& rhs) const
+{
+  return keyword == rhs.keyword && args == rhs.args && block == rhs.block && children == rhs.children;
+} // operator ==
+
+// ====================================================
+//  FROM SCRIPT (static)
+// ====================================================
+void MaterialDefinition::fromScript(const script::Node* root, QVector<MaterialDefinition>& out)
+{
+  if (root == NULL)
+    return;
+
+  for (const script::Node* node = root->firstChild; node; node = node->next)
+  {
+    if (node->keyword != "material" || node->name().isEmpty())
+      continue;
+
+    MaterialDefinition definition;
+    definition.name = node->name().toString();
+    definition.parent = node->inherits.toString();
+    definition.line = node->line;
+    definition.body = MaterialStatement::fromNode(node);
+    out.push_back(definition);
+  }
+} // fromScript
+
+// ---------------------------------------------------------------------
+//                             MATERIAL FLATTENER
+// ---------------------------------------------------------------------
+
+// ====================================================
+//  CTOR
+// ====================================================
+MaterialFlattener::MaterialFlattener(void)
+{
+} // ctor
+
+// ====================================================
+//  SET RESOURCES
+// ====================================================
+void MaterialFlattener::setResources(const ResourceIndex& resources)
+{
+  mResources = resources;
+} // setResources
+
+// ====================================================
+//  ADD SCRIPT
+// ====================================================
+void MaterialFlattener::addScript(const QString& path, const QVector<MaterialDefinition>& definitions)
+{
+  setDefinitions(path, definitions, false);
+} // addScript
+
+// ====================================================
+//  REMOVE SCRIPT
+// ====================================================
+void MaterialFlattener::removeScript(const QString& path)
+{
+  dropScript(path);
+} // removeScript
+
+// ====================================================
+//  REFRESH
+// ====================================================
+int MaterialFlattener::refresh(void)
+{
+  TRACE_SCOPE("MaterialFlattener::refresh");
+
+  QStringList changed;
+  QHash<QString, Script>::const_iterator citr = mScripts.begin();
+  for (; citr != mScripts.end(); ++citr)
+  {
+    QFileInfo info(citr.key());
+    if (citr->loaded && (!info.exists() || info.lastModified().toMSecsSinceEpoch() != citr->modified || info.size() != citr->size))
+      changed << citr.key();
+  }
+
+  foreach (const QString& path, changed)
+  {
+    if (!loadScript(path))
+      dropScript(path);
+  }
+  return changed.size();
+} // refresh
+
+// ====================================================
+//  FLATTEN
+// ====================================================
+bool MaterialFlattener::flatten(const QString& name, MaterialStatement& out, QString* error)
+{
+  QStringList visiting;
+  return flattenKey(name, visiting, out, error);
+} // flatten
+
+// ====================================================
+//  ANCESTRY
+// ====================================================
+QStringList MaterialFlattener::ancestry(const QString& name)
+{
+  QStringList names;
+  QString next = name;
+  while (!next.isEmpty() && !names.contains(next, Qt::CaseInsensitive))
+  {
+    const Definition* definition = findDefinition(next.toLower());
+    if (definition == NULL)
+      break;
+    names << definition->material.name;
+    next = definition->material.parent;
+  }
+  return names;
+} // ancestry
+
+// ====================================================
+//  DEFINING SCRIPT
+// ====================================================
+QString MaterialFlattener::definingScript(const QString& name)
+{
+  const Definition* definition = findDefinition(name.toLower());
+  return (definition ? definition->path : QString());
+} // definingScript
+
+// ====================================================
+//  FLATTENED COUNT
+// ====================================================
+int MaterialFlattener::flattenedCount(void) const
+{
+  return mFlattened.size();
+} // flattenedCount
+
+// ====================================================
+//  FIND DEFINITION
+// ====================================================
+const MaterialFlattener::Definition* MaterialFlattener::findDefinition(const QString& key)
+{
+  QHash<QString, Definition>::const_iterator citr = mDefinitions.find(key);
+  if (citr != mDefinitions.end())
+    return &(*citr);
+
+  // Read the script that defines it from the resource directories, once
+  const ResourceDefinition* resource = mResources.findDefinition(RESOURCE_MATERIAL, key);
+  if (resource == NULL || mScripts.contains(resource->path) || !loadScript(resource->path))
+    return NULL;
+
+  citr = mDefinitions.find(key);
+  return (citr != mDefinitions.end() ? &(*citr) : NULL);
+} // findDefinition
+
+// ====================================================
+//  LOAD SCRIPT
+// ====================================================
+bool MaterialFlattener::loadScript(const QString& path)
+{
+  script::ScriptFile file;
+  if (!file.open(path))
+    return false;
+
+  QVector<MaterialDefinition> definitions;
+  MaterialDefinition::fromScript(file.root(), definitions);
+  setDefinitions(path, definitions, true);
+
+  QFileInfo info(path);
+  Script& script = mScripts[path];
+  script.modified = info.lastModified().toMSecsSinceEpoch();
+  script.size = info.size();
+  return true;
+} // loadScript
+
+// ====================================================
+//  SET DEFINITIONS
+// ====================================================
+void MaterialFlattener::setDefinitions(const QString& path, const QVector<MaterialDefinition>& definitions, bool loaded)
+{
+  Script& script = mScripts[path];
+  QSet<QString> old = script.names.toSet();
+  script.names.clear();
+  script.loaded = loaded;
+  script.modified = 0;
+  script.size = 0;
+
+  foreach (const MaterialDefinition& material, definitions)
+  {
+    QString key = material.name.toLower();
+    script.names << key;
+    old.remove(key);
+
+    QHash<QString, Definition>::iterator itr = mDefinitions.find(key);
+    if (itr != mDefinitions.end())
+    {
+      // A script being edited takes precedence over the one on disk
+      if (itr->path != path && loaded && !mScripts.value(itr->path).loaded)
+        continue;
+
+      // Moving a material around its script changes nothing
+      if (itr->path == path && itr->material.parent == material.parent && itr->material.body == material.body)
+      {
+        itr->material.line = material.line;
+        continue;
+      }
+      linkParent(key, itr->material.parent, false);
+    }
+
+    Definition definition;
+    definition.material = material;
+    definition.path = path;
+    mDefinitions.insert(key, definition);
+    linkParent(key, material.parent, true);
+    forget(key);
+  }
+
+  // Whatever it no longer defines
+  foreach (const QString& key, old)
+  {
+    QHash<QString, Definition>::iterator itr = mDefinitions.find(key);
+    if (itr != mDefinitions.end() && itr->path == path)
+    {
+      linkParent(key, itr->material.parent, false);
+      mDefinitions.erase(itr);
+      forget(key);
+    }
+  }
+} // setDefinitions
+
+// ====================================================
+//  DROP SCRIPT
+// ====================================================
+void MaterialFlattener::dropScript(const QString& path)
+{
+  if (!mScripts.contains(path))
+    return;
+  setDefinitions(path, QVector<MaterialDefinition>(), mScripts[path].loaded);
+  mScripts.remove(path);
+} // dropScript
+
+// ====================================================
+//  LINK PARENT
+// ====================================================
+void MaterialFlattener::linkParent(const QString& key, const QString& parent, bool add)
+{
+  if (parent.isEmpty())
+    return;
+
+  QString parentKey = parent.toLower();
+  if (add)
+    mInheritors[parentKey].insert(key);
+  else
+  {
+    QHash<QString, QSet<QString> >::iterator itr = mInheritors.find(parentKey);
+    if (itr != mInheritors.end())
+    {
+      itr->remove(key);
+      if (itr->isEmpty())
+        mInheritors.erase(itr);
+    }
+  }
+} // linkParent
+
+// ====================================================
+//  FORGET
+// ====================================================
+void MaterialFlattener::forget(const QString& key)
+{
+  // A material is only ever worked out after its parent, so the walk can
+  // stop at whatever isn't kept; nothing below it is either
+  QStringList pending(key);
+  while (!pending.isEmpty())
+  {
+    QString next = pending.takeLast();
+    if (mFlattened.remove(next) == 0)
+      continue;
+    foreach (const QString& child, mInheritors.value(next))
+      pending << child;
+  }
+} // forget
+
+// ====================================================
+//  FLATTEN KEY
+// ====================================================
+bool MaterialFlattener::flattenKey(const QString& name, QStringList& visiting, MaterialStatement& out, QString* error)
+{
+  QString key = name.toLower();
+  QHash<QString, MaterialStatement>::const_iterator citr = mFlattened.find(key);
+  if (citr != mFlattened.end())
+  {
+    out = *citr;
+    return true;
+  }
+
+  if (visiting.contains(name, Qt::CaseInsensitive))
+  {
+    if (error)
+      *error = QString("Inheritance cycle: %1 : %2").arg(visiting.join(" : "), name);
+    return false;
+  }
+
+  const Definition* definition = findDefinition(key);
+  if (definition == NULL)
+  {
+    if (error)
+    {
+      if (visiting.isEmpty())
+        *error = QString("No material named '%1'").arg(name);
+      else
+        *error = QString("'%1' inherits from '%2', which isn't defined").arg(visiting.last(), name);
+    }
+    return false;
+  }
+
+  // Working out the parent may read scripts, which moves definitions around
+  MaterialDefinition material = definition->material;
+  if (material.parent.isEmpty())
+    out = material.body;
+  else
+  {
+    visiting << material.name;
+    if (!flattenKey(material.parent, visiting, out, error))
+      return false;
+    visiting.removeLast();
+
+    out.args = material.body.args;
+    merge(out, material.body);
+  }
+
+  mFlattened.insert(key, out);
+  return true;
+} // flattenKey
\ No newline at end of file
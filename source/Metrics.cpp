@@ -0,0 +1,149 @@
+#include <algorithm>
+#include "Metrics.h" // class definition
+
+namespace metrics
+{
+  // Initialize Static Members
+  Registry* Registry::mpMe = NULL;
+
+  // ---------------------------------------------------------------------
+  //                                METRIC
+  // ---------------------------------------------------------------------
+
+  // ====================================================
+  //  CTOR
+  // ====================================================
+  Metric::Metric(void)
+    : mNext(0), mCount(0), mTotal(0.0)
+  {
+    std::fill(mWindow, mWindow + WINDOW, 0.0);
+  } // ctor
+
+  // ====================================================
+  //  SAMPLE
+  // ====================================================
+  void Metric::sample(double value)
+  {
+    mWindow[mNext] = value;
+    mNext = (mNext + 1) % WINDOW;
+    mTotal += value;
+    ++mCount;
+  } // sample
+
+  // ====================================================
+  //  LAST
+  // ====================================================
+  double Metric::last(void) const
+  {
+    if (mCount == 0)
+      return 0.0;
+    return mWindow[(mNext + WINDOW - 1) % WINDOW];
+  } // last
+
+  // ====================================================
+  //  MEAN
+  // ====================================================
+  double Metric::mean(void) const
+  {
+    int n = static_cast<int>(qMin<qint64>(mCount, WINDOW));
+    if (n == 0)
+      return 0.0;
+
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i)
+      sum += mWindow[i];
+    return sum / n;
+  } // mean
+
+  // ====================================================
+  //  PEAK
+  // ====================================================
+  double Metric::peak(void) const
+  {
+    int n = static_cast<int>(qMin<qint64>(mCount, WINDOW));
+    if (n == 0)
+      return 0.0;
+    return *std::max_element(mWindow, mWindow + n);
+  } // peak
+
+  // ====================================================
+  //  PERCENTILE
+  // ====================================================
+  double Metric::percentile(double p) const
+  {
+    int n = static_cast<int>(qMin<qint64>(mCount, WINDOW));
+    if (n == 0)
+      return 0.0;
+
+    double sorted[WINDOW];
+    std::copy(mWindow, mWindow + n, sorted);
+    std::sort(sorted, sorted + n);
+
+    int index = static_cast<int>(p / 100.0 * (n - 1) + 0.5);
+    return sorted[qBound(0, index, n - 1)];
+  } // percentile
+
+  // ====================================================
+  //  TOTAL
+  // ====================================================
+  double Metric::total(void) const
+  {
+    return mTotal;
+  } // total
+
+  // ====================================================
+  //  COUNT
+  // ====================================================
+  qint64 Metric::count(void) const
+  {
+    return mCount;
+  } // count
+
+  // ---------------------------------------------------------------------
+  //                               REGISTRY
+  // ---------------------------------------------------------------------
+
+  // ====================================================
+  //  CTOR
+  // ====================================================
+  Registry::Registry(void)
+  {
+  } // ctor
+
+  // ====================================================
+  //  DTOR
+  // ====================================================
+  Registry::~Registry(void)
+  {
+    qDeleteAll(mMetrics);
+  } // dtor
+
+  // ====================================================
+  //  INSTANCE (static)
+  // ====================================================
+  Registry* Registry::instance()
+  {
+    if (mpMe == NULL)
+      mpMe = new Registry;
+    return mpMe;
+  } // instance
+
+  // ====================================================
+  //  METRIC
+  // ====================================================
+  Metric* Registry::metric(const QString& name)
+  {
+    Metric*& m = mMetrics[name];
+    if (m == NULL)
+      m = new Metric;
+    return m;
+  } // metric
+
+  // ====================================================
+  //  ALL
+  // ====================================================
+  const QMap<QString, Metric*>& Registry::all(void) const
+  {
+    return mMetrics;
+  } // all
+} // namespace metrics
\ No newline at end of file
@@ -0,0 +1,300 @@
+#include <QtGui/QtGui>
+#include "Outline.h" // class definition
+#include "TextEditor.h"
+#include "Highlighter.h"
+#include "ConfigFile.h"
+#include "Trace.h"
+#include "Metrics.h"
+
+/// How long the tree waits after an edit before it catches up, in milliseconds
+static const int OUTLINE_DELAY = 100;
+
+// ====================================================
+//  DEPTH AFTER (local)
+// ====================================================
+static int depthAfter(const QTextBlock& block)
+{
+  BlockData* data = (block.isValid() ? Highlighter::blockData(block) : NULL);
+  return (data ? data->state.stack.size() : 0);
+} // depthAfter
+
+// ====================================================
+//  STATEMENT BLOCK (local)
+// ====================================================
+/** @returns The block with the statement that opens the brace on \e brace.
+ * Scripts usually put the brace on a line of its own after it. */
+static QTextBlock statementBlock(const QTextBlock& brace)
+{
+  if (brace.text().trimmed().startsWith('{'))
+  {
+    QTextBlock block = brace.previous();
+    while (block.isValid() && block.text().trimmed().isEmpty())
+      block = block.previous();
+    if (block.isValid())
+      return block;
+  }
+  return brace;
+} // statementBlock
+
+// ====================================================
+//  STATEMENT TEXT (local)
+// ====================================================
+static QString statementText(const QTextBlock& block)
+{
+  QString text = block.text();
+  int end = text.indexOf('{');
+  int comment = text.indexOf("//");
+  if (comment >= 0 && (end < 0 || comment < end))
+    end = comment;
+
+  text = text.left(end).simplified();
+  return text.isEmpty() ? QString("{") : text;
+} // statementText
+
+// ====================================================
+//  COPY EXPANSION (local)
+// ====================================================
+/** Expands the entries of \e to that were expanded in \e from, matching
+ * children by position and text, so reading a scope again doesn't fold
+ * away what the user had open. */
+static void copyExpansion(const QTreeWidgetItem* from, QTreeWidgetItem* to)
+{
+  if (!from->isExpanded())
+    return;
+
+  to->setExpanded(true);
+  int count = qMin(from->childCount(), to->childCount());
+  for (int i = 0; i < count; ++i)
+  {
+    if (from->child(i)->text(0) == to->child(i)->text(0))
+      copyExpansion(from->child(i), to->child(i));
+  }
+} // copyExpansion
+
+// ====================================================
+//  CTOR
+// ====================================================
+Outline::Outline(QWidget* parent)
+  : QTreeWidget(parent), mDirtyFrom(-1), mDirtyTo(-1)
+{
+  setHeaderHidden(true);
+  setUniformRowHeights(true);
+  connect(this, SIGNAL(itemClicked(QTreeWidgetItem*, int)), this, SLOT(onItemClicked(QTreeWidgetItem*, int)));
+
+  mTimer.setSingleShot(true);
+  mTimer.setInterval(OUTLINE_DELAY);
+  connect(&mTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+} // ctor
+
+// ====================================================
+//  SET EDITOR (slot)
+// ====================================================
+void Outline::setEditor(TextEditor* editor)
+{
+  if (mpEditor)
+    disconnect(mpEditor->document(), NULL, this, NULL);
+
+  clear();
+  mTops.clear();
+  mDirtyFrom = -1;
+  mpEditor = editor;
+  if (mpEditor == NULL)
+    return;
+
+  connect(mpEditor->document(), SIGNAL(contentsChange(int, int, int)), this, SLOT(onContentsChange(int, int, int)));
+  onContentsChange(0, 0, mpEditor->document()->characterCount());
+  refresh();
+} // setEditor
+
+// ====================================================
+//  REFRESH
+// ====================================================
+void Outline::refresh(void)
+{
+  TRACE_SCOPE("Outline::refresh");
+
+  mTimer.stop();
+  if (mpEditor == NULL || mDirtyFrom < 0)
+    return;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  QTextDocument* doc = mpEditor->document();
+  QTextBlock first = doc->findBlock(mDirtyFrom);
+  QTextBlock last = doc->findBlock(mDirtyTo);
+  if (!first.isValid())
+    first = doc->lastBlock();
+  if (!last.isValid())
+    last = doc->lastBlock();
+  mDirtyFrom = -1;
+
+  // Widen the range to whole top-level scopes.  The line after it is read as
+  // well, since it may hold the brace of a statement on the last line.
+  while (first.previous().isValid() && depthAfter(first.previous()) > 0)
+    first = first.previous();
+  if (last.next().isValid())
+    last = last.next();
+  while (last.next().isValid() && depthAfter(last) > 0)
+    last = last.next();
+
+  // Replace the entries whose braces are in the range
+  int begin = findTop(first.position());
+  int end = findTop(last.position() + last.length());
+
+  QList<QTreeWidgetItem*> tops;
+  QList<QTextCursor> cursors;
+  scan(first, last, tops, cursors);
+
+  // The new entries go in ahead of the old ones, since expansion only
+  // means anything for entries in the tree
+  setUpdatesEnabled(false);
+  insertTopLevelItems(begin, tops);
+  for (int i = begin; i < end; ++i)
+  {
+    QTreeWidgetItem* old = takeTopLevelItem(begin + tops.size());
+    int index = i - begin;
+    if (index < tops.size() && old->text(0) == tops[index]->text(0))
+      copyExpansion(old, tops[index]);
+    delete old;
+  }
+  setUpdatesEnabled(true);
+
+  for (int i = begin; i < end; ++i)
+    mTops.removeAt(begin);
+  for (int i = 0; i < cursors.size(); ++i)
+    mTops.insert(begin + i, cursors[i]);
+
+  static metrics::Metric* refreshMs = metrics::Registry::instance()->metric("outline.refresh_ms");
+  refreshMs->sample(timer.nsecsElapsed() / 1000000.0);
+} // refresh
+
+// ====================================================
+//  SCAN
+// ====================================================
+void Outline::scan(const QTextBlock& first, const QTextBlock& last, QList<QTreeWidgetItem*>& tops, QList<QTextCursor>& cursors) const
+{
+  config::ConfigFile* config = config::ConfigFile::instance();
+  QString format = mpEditor->fileFormat();
+
+  // The entries of the scopes open at each depth, NULL where a scope
+  // doesn't get one
+  QVector<QTreeWidgetItem*> open;
+  int topPosition = first.position();
+
+  for (QTextBlock block = first; block.isValid(); block = block.next())
+  {
+    BlockData* previous = Highlighter::blockData(block.previous());
+    BlockData* data = Highlighter::blockData(block);
+    if (data)
+    {
+      // The scopes the block leaves open that weren't before it.  Closing
+      // and opening scopes with the same keywords on one line looks like
+      // nothing changed, which is only a problem for unusual scripts.
+      const QVector<Atom>& before = (previous ? previous->state.stack : QVector<Atom>());
+      const QVector<Atom>& after = data->state.stack;
+      int common = 0;
+      while (common < before.size() && common < after.size() && before[common] == after[common])
+        ++common;
+      open.resize(qMin(common, open.size()));
+
+      for (int level = open.size(); level < after.size(); ++level)
+      {
+        QTreeWidgetItem* parent = NULL;
+        for (int i = open.size() - 1; i >= 0 && parent == NULL; --i)
+          parent = open[i];
+
+        QTreeWidgetItem* item = NULL;
+        const config::FormatWord* word = config->findWord(format, after[level]);
+        if (level == 0 || (parent && word && word->highlightType == "strong_keyword"))
+        {
+          QTextBlock statement = statementBlock(block);
+          item = new QTreeWidgetItem(QStringList(statementText(statement)));
+          if (level == 0)
+          {
+            topPosition = block.position();
+            tops.append(item);
+            cursors.append(QTextCursor(block));
+          }
+          else
+          {
+            parent->addChild(item);
+          }
+
+          // Where to jump to, from the top-level scope's brace
+          item->setData(0, Qt::UserRole, statement.position() - topPosition);
+        }
+        open.append(item);
+      }
+    }
+
+    if (block == last)
+      break;
+  }
+} // scan
+
+// ====================================================
+//  FIND TOP
+// ====================================================
+int Outline::findTop(int position) const
+{
+  // The cursors stay in document order as it's edited
+  int low = 0, high = mTops.size();
+  while (low < high)
+  {
+    int middle = (low + high) / 2;
+    if (mTops[middle].position() < position)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low;
+} // findTop
+
+// ====================================================
+//  ON CONTENTS CHANGE (slot)
+// ====================================================
+void Outline::onContentsChange(int position, int removed, int added)
+{
+  if (mDirtyFrom < 0)
+  {
+    mDirtyFrom = position;
+    mDirtyTo = position + added;
+  }
+  else
+  {
+    // Keep the end of the range where it was in the text, unless the edit
+    // removed it or reaches past it
+    if (mDirtyTo >= position + removed)
+      mDirtyTo += added - removed;
+    else
+      mDirtyTo = position + added;
+    mDirtyFrom = qMin(mDirtyFrom, position);
+  }
+
+  mTimer.start();
+} // onContentsChange
+
+// ====================================================
+//  ON ITEM CLICKED (slot)
+// ====================================================
+void Outline::onItemClicked(QTreeWidgetItem* item, int column)
+{
+  Q_UNUSED(column);
+
+  QTreeWidgetItem* top = item;
+  while (top->parent())
+    top = top->parent();
+
+  int index = indexOfTopLevelItem(top);
+  if (mpEditor == NULL || index < 0 || index >= mTops.size())
+    return;
+
+  QTextDocument* doc = mpEditor->document();
+  int position = mTops[index].position() + item->data(0, Qt::UserRole).toInt();
+  QTextCursor cursor(doc);
+  cursor.setPosition(qBound(0, position, doc->characterCount() - 1));
+  mpEditor->setTextCursor(cursor);
+  mpEditor->ensureCursorVisible();
+  mpEditor->setFocus();
+} // onItemClicked
\ No newline at end of file
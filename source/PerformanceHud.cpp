@@ -0,0 +1,107 @@
+#include <QtGui/QtGui>
+#include "PerformanceHud.h" // class definition
+#include "TextEditor.h"
+#include "Highlighter.h"
+#include "Metrics.h"
+
+// ====================================================
+//  FORMAT BYTES (local)
+// ====================================================
+static QString formatBytes(double bytes)
+{
+  if (bytes >= 1024.0 * 1024.0)
+    return QString("%1 MB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+  if (bytes >= 1024.0)
+    return QString("%1 KB").arg(bytes / 1024.0, 0, 'f', 1);
+  return QString("%1 B").arg(bytes, 0, 'f', 0);
+} // formatBytes
+
+// ====================================================
+//  CTOR
+// ====================================================
+PerformanceHud::PerformanceHud(QWidget* parent)
+  : QLabel(parent)
+{
+  setTextFormat(Qt::PlainText);
+  setToolTip("Highlight time per frame | blocks per edit | keystroke latency | "
+             "document size | highlighter rules | memory of this tab / all tabs");
+
+  mTimer.setInterval(250);
+  connect(&mTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+} // ctor
+
+// ====================================================
+//  SET EDITOR
+// ====================================================
+void PerformanceHud::setEditor(TextEditor* editor)
+{
+  mpEditor = editor;
+  if (isVisible())
+    refresh();
+} // setEditor
+
+// ====================================================
+//  SET EDITORS
+// ====================================================
+void PerformanceHud::setEditors(const QVector<TextEditor*>& editors)
+{
+  mEditors.clear();
+  foreach (TextEditor* editor, editors)
+    mEditors.push_back(editor);
+} // setEditors
+
+// ====================================================
+//  SHOW EVENT (inherited)
+// ====================================================
+void PerformanceHud::showEvent(QShowEvent* e)
+{
+  // Only poll the metrics while they can be seen
+  refresh();
+  mTimer.start();
+  QLabel::showEvent(e);
+} // showEvent
+
+// ====================================================
+//  HIDE EVENT (inherited)
+// ====================================================
+void PerformanceHud::hideEvent(QHideEvent* e)
+{
+  mTimer.stop();
+  QLabel::hideEvent(e);
+} // hideEvent
+
+// ====================================================
+//  REFRESH (slot)
+// ====================================================
+void PerformanceHud::refresh(void)
+{
+  static metrics::Registry* registry = metrics::Registry::instance();
+  static metrics::Metric* frameMs   = registry->metric("highlight.frame_ms");
+  static metrics::Metric* blocks    = registry->metric("highlight.blocks_per_edit");
+  static metrics::Metric* keystroke = registry->metric("editor.keystroke_ms");
+
+  QString text = QString("hl %1 ms (max %2) | %3 blk/edit | key %4 ms (p99 %5)")
+                 .arg(frameMs->mean(), 0, 'f', 2).arg(frameMs->peak(), 0, 'f', 1)
+                 .arg(blocks->mean(), 0, 'f', 0)
+                 .arg(keystroke->mean(), 0, 'f', 2).arg(keystroke->percentile(99), 0, 'f', 1);
+
+  if (mpEditor)
+  {
+    qint64 total = 0;
+    foreach (const QPointer<TextEditor>& editor, mEditors)
+    {
+      if (editor)
+        total += editor->estimatedMemory();
+    }
+
+    QTextDocument* doc = mpEditor->document();
+    text += QString(" | %1, %2 blocks | rules %3 | mem %4 / %5")
+            .arg(formatBytes(doc->characterCount() * sizeof(QChar)))
+            .arg(doc->blockCount())
+            .arg(formatBytes(mpEditor->highlighter()->ruleMemory()))
+            .arg(formatBytes(mpEditor->estimatedMemory()))
+            .arg(formatBytes(total));
+  }
+
+  setText(text);
+} // refresh
\ No newline at end of file
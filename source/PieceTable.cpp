@@ -0,0 +1,380 @@
+#include <QtCore/QIODevice>
+#include <algorithm>
+#include <cstring>
+#include "PieceTable.h" // class definition
+
+// ====================================================
+//  CTOR
+// ====================================================
+PieceTable::PieceTable(void)
+{
+  mpOriginal = NULL;
+  mOriginalSize = 0;
+  mSize = 0;
+} // ctor
+
+// ====================================================
+//  DTOR
+// ====================================================
+PieceTable::~PieceTable(void)
+{
+  close();
+} // dtor
+
+// ====================================================
+//  OPEN
+// ====================================================
+bool PieceTable::open(const QString& path)
+{
+  close();
+
+  mFile.setFileName(path);
+  if (!mFile.open(QFile::ReadOnly))
+    return false;
+
+  mOriginalSize = mFile.size();
+  if (mOriginalSize > 0)
+  {
+    mpOriginal = reinterpret_cast<const char*>(mFile.map(0, mOriginalSize));
+
+    // Some files (on network shares, for one) can't be mapped, so fall back
+    // to reading them
+    if (mpOriginal == NULL)
+    {
+      mCopy = mFile.readAll();
+      mpOriginal = mCopy.constData();
+      mOriginalSize = mCopy.size();
+      mFile.close();
+    }
+
+    Piece piece = { false, 0, mOriginalSize };
+    mPieces.push_back(piece);
+  }
+
+  mSize = mOriginalSize;
+  updateOffsets(0);
+  return true;
+} // open
+
+// ====================================================
+//  SET DATA
+// ====================================================
+void PieceTable::setData(const QByteArray& data)
+{
+  close();
+
+  mCopy = data;
+  mpOriginal = mCopy.constData();
+  mOriginalSize = mCopy.size();
+  if (mOriginalSize > 0)
+  {
+    Piece piece = { false, 0, mOriginalSize };
+    mPieces.push_back(piece);
+  }
+
+  mSize = mOriginalSize;
+  updateOffsets(0);
+} // setData
+
+// ====================================================
+//  CLOSE
+// ====================================================
+void PieceTable::close(void)
+{
+  if (mFile.isOpen())
+  {
+    if (mpOriginal && mCopy.isNull())
+      mFile.unmap(reinterpret_cast<uchar*>(const_cast<char*>(mpOriginal)));
+    mFile.close();
+  }
+
+  mpOriginal = NULL;
+  mOriginalSize = 0;
+  mCopy.clear();
+  mAdded.clear();
+  mPieces.clear();
+  mOffsets.clear();
+  mSize = 0;
+} // close
+
+// ====================================================
+//  WRITE
+// ====================================================
+bool PieceTable::write(QIODevice* device) const
+{
+  foreach (const Piece& piece, mPieces)
+  {
+    if (device->write(data(piece), piece.length) != piece.length)
+      return false;
+  }
+  return true;
+} // write
+
+// ====================================================
+//  SIZE
+// ====================================================
+qint64 PieceTable::size(void) const
+{
+  return mSize;
+} // size
+
+// ====================================================
+//  AT
+// ====================================================
+char PieceTable::at(qint64 pos) const
+{
+  qint64 offset;
+  int i = findPiece(pos, &offset);
+  return data(mPieces[i])[offset];
+} // at
+
+// ====================================================
+//  READ
+// ====================================================
+QByteArray PieceTable::read(qint64 pos, qint64 length) const
+{
+  QByteArray text;
+  pos = qBound(Q_INT64_C(0), pos, mSize);
+  length = qMin(length, mSize - pos);
+  if (length <= 0)
+    return text;
+
+  text.reserve(static_cast<int>(length));
+
+  qint64 offset;
+  for (int i = findPiece(pos, &offset); length > 0; ++i, offset = 0)
+  {
+    qint64 count = qMin(length, mPieces[i].length - offset);
+    text.append(data(mPieces[i]) + offset, static_cast<int>(count));
+    length -= count;
+  }
+  return text;
+} // read
+
+// ====================================================
+//  INSERT
+// ====================================================
+void PieceTable::insert(qint64 pos, const QByteArray& text)
+{
+  if (text.isEmpty())
+    return;
+
+  pos = qBound(Q_INT64_C(0), pos, mSize);
+  qint64 length = text.size();
+
+  // Typing extends the piece of the last insert, so a run of keystrokes is
+  // a single piece
+  if (pos > 0)
+  {
+    qint64 offset;
+    int i = findPiece(pos - 1, &offset);
+    Piece& piece = mPieces[i];
+    if (piece.added && offset + 1 == piece.length && piece.start + piece.length == mAdded.size())
+    {
+      mAdded.append(text);
+      piece.length += length;
+      mSize += length;
+      updateOffsets(i + 1);
+      return;
+    }
+  }
+
+  Piece added = { true, mAdded.size(), length };
+  mAdded.append(text);
+
+  int first = mPieces.size();
+  if (pos == mSize)
+  {
+    mPieces.push_back(added);
+  }
+  else
+  {
+    qint64 offset;
+    first = findPiece(pos, &offset);
+    if (offset == 0)
+    {
+      mPieces.insert(first, added);
+    }
+    else
+    {
+      // Split the piece around the insert
+      Piece right = mPieces[first];
+      right.start += offset;
+      right.length -= offset;
+      mPieces[first].length = offset;
+      mPieces.insert(first + 1, right);
+      mPieces.insert(first + 1, added);
+    }
+  }
+
+  mSize += length;
+  updateOffsets(first);
+} // insert
+
+// ====================================================
+//  REMOVE
+// ====================================================
+void PieceTable::remove(qint64 pos, qint64 length)
+{
+  pos = qBound(Q_INT64_C(0), pos, mSize);
+  length = qMin(length, mSize - pos);
+  if (length <= 0)
+    return;
+
+  qint64 offset;
+  int first = findPiece(pos, &offset);
+  int i = first;
+  qint64 remaining = length;
+  while (remaining > 0)
+  {
+    Piece& piece = mPieces[i];
+    if (offset == 0 && remaining >= piece.length)
+    {
+      // The whole piece goes
+      remaining -= piece.length;
+      mPieces.remove(i);
+    }
+    else if (offset == 0)
+    {
+      // The front of the piece goes
+      piece.start += remaining;
+      piece.length -= remaining;
+      remaining = 0;
+    }
+    else if (offset + remaining >= piece.length)
+    {
+      // The back of the piece goes
+      remaining -= piece.length - offset;
+      piece.length = offset;
+      offset = 0;
+      ++i;
+    }
+    else
+    {
+      // The middle of the piece goes, so it splits in two
+      Piece right = piece;
+      right.start += offset + remaining;
+      right.length -= offset + remaining;
+      piece.length = offset;
+      mPieces.insert(i + 1, right);
+      remaining = 0;
+    }
+  }
+
+  mSize -= length;
+  updateOffsets(first);
+} // remove
+
+// ====================================================
+//  LINE START
+// ====================================================
+qint64 PieceTable::lineStart(qint64 pos) const
+{
+  pos = qMin(pos, mSize);
+  if (pos <= 0)
+    return 0;
+
+  qint64 offset;
+  for (int i = findPiece(pos - 1, &offset); i >= 0; --i)
+  {
+    const char* text = data(mPieces[i]);
+    for (qint64 j = offset; j >= 0; --j)
+    {
+      if (text[j] == '\n')
+        return mOffsets[i] + j + 1;
+    }
+
+    if (i > 0)
+      offset = mPieces[i - 1].length - 1;
+  }
+  return 0;
+} // lineStart
+
+// ====================================================
+//  LINE END
+// ====================================================
+qint64 PieceTable::lineEnd(qint64 pos) const
+{
+  if (pos >= mSize)
+    return mSize;
+
+  qint64 offset;
+  for (int i = findPiece(qMax(pos, Q_INT64_C(0)), &offset); i < mPieces.size(); ++i, offset = 0)
+  {
+    const char* text = data(mPieces[i]);
+    const void* found = memchr(text + offset, '\n', static_cast<size_t>(mPieces[i].length - offset));
+    if (found)
+      return mOffsets[i] + (static_cast<const char*>(found) - text);
+  }
+  return mSize;
+} // lineEnd
+
+// ====================================================
+//  NEXT LINE
+// ====================================================
+qint64 PieceTable::nextLine(qint64 pos) const
+{
+  qint64 end = lineEnd(pos);
+  return (end < mSize ? end + 1 : mSize);
+} // nextLine
+
+// ====================================================
+//  PREVIOUS LINE
+// ====================================================
+qint64 PieceTable::previousLine(qint64 pos) const
+{
+  qint64 start = lineStart(pos);
+  return (start > 0 ? lineStart(start - 1) : 0);
+} // previousLine
+
+// ====================================================
+//  EDIT MEMORY
+// ====================================================
+qint64 PieceTable::editMemory(void) const
+{
+  return mAdded.capacity() + mCopy.size() +
+         mPieces.capacity() * sizeof(Piece) +
+         mOffsets.capacity() * sizeof(qint64);
+} // editMemory
+
+// ====================================================
+//  PIECE COUNT
+// ====================================================
+int PieceTable::pieceCount(void) const
+{
+  return mPieces.size();
+} // pieceCount
+
+// ====================================================
+//  DATA
+// ====================================================
+const char* PieceTable::data(const Piece& piece) const
+{
+  return (piece.added ? mAdded.constData() : mpOriginal) + piece.start;
+} // data
+
+// ====================================================
+//  FIND PIECE
+// ====================================================
+int PieceTable::findPiece(qint64 pos, qint64* offset) const
+{
+  // The last piece starting at or before pos
+  int i = static_cast<int>(std::upper_bound(mOffsets.begin(), mOffsets.end(), pos) - mOffsets.begin()) - 1;
+  i = qMax(i, 0);
+  *offset = pos - (mOffsets.isEmpty() ? 0 : mOffsets[i]);
+  return i;
+} // findPiece
+
+// ====================================================
+//  UPDATE OFFSETS
+// ====================================================
+void PieceTable::updateOffsets(int first)
+{
+  mOffsets.resize(mPieces.size());
+  qint64 pos = (first > 0 ? mOffsets[first - 1] + mPieces[first - 1].length : 0);
+  for (int i = first; i < mPieces.size(); ++i)
+  {
+    mOffsets[i] = pos;
+    pos += mPieces[i].length;
+  }
+} // updateOffsets
\ No newline at end of file
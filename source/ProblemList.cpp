@@ -0,0 +1,96 @@
+#include <QtGui/QtGui>
+#include "ProblemList.h" // class definition
+#include "TextEditor.h"
+#include "Diagnostics.h"
+#include "Trace.h"
+
+// ====================================================
+//  CTOR
+// ====================================================
+ProblemList::ProblemList(QWidget* parent)
+  : QTreeWidget(parent), mStale(false)
+{
+  setRootIsDecorated(false);
+  setUniformRowHeights(true);
+  setHeaderLabels(QStringList() << "Line" << "Problem");
+  connect(this, SIGNAL(itemClicked(QTreeWidgetItem*, int)), this, SLOT(onItemClicked(QTreeWidgetItem*, int)));
+} // ctor
+
+// ====================================================
+//  SET EDITOR (slot)
+// ====================================================
+void ProblemList::setEditor(TextEditor* editor)
+{
+  if (mpEditor)
+    disconnect(mpEditor->diagnostics(), NULL, this, NULL);
+
+  mpEditor = editor;
+  if (mpEditor)
+    connect(mpEditor->diagnostics(), SIGNAL(changed()), this, SLOT(refresh()));
+  refresh();
+} // setEditor
+
+// ====================================================
+//  SHOW EVENT (inherited)
+// ====================================================
+void ProblemList::showEvent(QShowEvent* event)
+{
+  QTreeWidget::showEvent(event);
+  if (mStale)
+    refresh();
+} // showEvent
+
+// ====================================================
+//  REFRESH (slot)
+// ====================================================
+void ProblemList::refresh(void)
+{
+  // Walking the document is cheap, but there's no need while nobody looks
+  mStale = !isVisible();
+  if (mStale)
+    return;
+
+  TRACE_SCOPE("ProblemList::refresh");
+
+  clear();
+  if (mpEditor == NULL)
+    return;
+
+  QList<QTreeWidgetItem*> items;
+  for (QTextBlock block = mpEditor->document()->begin(); block.isValid(); block = block.next())
+  {
+    BlockData* data = Highlighter::blockData(block);
+    if (data == NULL)
+      continue;
+
+    foreach (const Diagnostic& diagnostic, data->diagnostics)
+    {
+      QTreeWidgetItem* item = new QTreeWidgetItem(QStringList() << QString::number(block.blockNumber() + 1) << diagnostic.message);
+      item->setData(0, Qt::UserRole, block.blockNumber());
+      item->setData(1, Qt::UserRole, diagnostic.start);
+      items.append(item);
+    }
+  }
+  addTopLevelItems(items);
+} // refresh
+
+// ====================================================
+//  ON ITEM CLICKED (slot)
+// ====================================================
+void ProblemList::onItemClicked(QTreeWidgetItem* item, int column)
+{
+  Q_UNUSED(column);
+
+  if (mpEditor == NULL)
+    return;
+
+  QTextBlock block = mpEditor->document()->findBlockByNumber(item->data(0, Qt::UserRole).toInt());
+  if (!block.isValid())
+    return;
+
+  QTextCursor cursor(block);
+  cursor.setPosition(block.position() + qMin(item->data(1, Qt::UserRole).toInt(), block.length() - 1));
+  mpEditor->setTextCursor(cursor);
+  mpEditor->ensureCursorVisible();
+  mpEditor->setFocus();
+} // onItemClicked
\ No newline at end of file
@@ -0,0 +1,782 @@
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFileInfo>
+#include <QtCore/QtConcurrentMap>
+#include <QtCore/QtConcurrentRun>
+#include "ResourceResolver.h" // class definition
+#include "ScriptParser.h"
+#include "ConfigFile.h"
+#include "ConfigWatcher.h"
+#include "Trace.h"
+#include "Metrics.h"
+
+/// How long the resolver waits after a change on disk before it catches
+/// up, in milliseconds, so a burst of changes is handled at once
+static const int RESOLVER_DELAY = 200;
+
+// Initialize Static Members
+ResourceResolver* ResourceResolver::mpMe = NULL;
+
+// ====================================================
+//  IS SCRIPT (local)
+// ====================================================
+/** @returns TRUE if the file may define or refer to programs or materials. */
+static bool isScript(const QString& file)
+{
+  return DependencyGraph::isScript(file);
+} // isScript
+
+// ====================================================
+//  LIST DIRECTORY (local)
+// ====================================================
+/** Reads a directory's entries once, with the modification time and size
+ * of each script, so a script that changed can be told by its listing.
+ * @returns FALSE if the directory doesn't exist. */
+static bool listDirectory(const QString& path, QStringList& files, QStringList& directories, QHash<QString, qint64>& stamps)
+{
+  QDir dir(path);
+  if (!dir.exists())
+    return false;
+
+  files.clear();
+  stamps.clear();
+  foreach (const QFileInfo& fi, dir.entryInfoList(QDir::Files | QDir::Hidden, QDir::Name))
+  {
+    files << fi.fileName();
+    if (isScript(fi.fileName()))
+      stamps.insert(fi.fileName(), fi.lastModified().toMSecsSinceEpoch() * 31 + fi.size());
+  }
+  directories = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+  return true;
+} // listDirectory
+
+// ====================================================
+//  READ DEFINITIONS (local)
+// ====================================================
+/** Reads the definitions of a script on one of QtConcurrent's threads. */
+struct ReadDefinitions
+{
+  typedef QVector<ResourceDefinition> result_type;
+
+  QVector<ResourceDefinition> operator()(const QString& path) const
+  {
+    QVector<ResourceDefinition> definitions;
+    script::ScriptFile file;
+    if (file.open(path))
+      ResourceIndex::findDefinitions(file.root(), path, definitions);
+    return definitions;
+  }
+};
+
+// ---------------------------------------------------------------------
+//                              RESOURCE INDEX
+// ---------------------------------------------------------------------
+
+// ====================================================
+//  CTOR
+// ====================================================
+ResourceIndex::ResourceIndex(void)
+{
+} // ctor
+
+// ====================================================
+//  SET DIRECTORIES
+// ====================================================
+void ResourceIndex::setDirectories(const QStringList& directories)
+{
+  mDirectories.clear();
+  foreach (const QString& directory, directories)
+    mDirectories << QDir::cleanPath(QDir::current().absoluteFilePath(directory));
+
+  mListings.clear();
+  mFiles.clear();
+  mDefinitions.clear();
+  mScripts.clear();
+} // setDirectories
+
+// ====================================================
+//  DIRECTORIES
+// ====================================================
+const QStringList& ResourceIndex::directories(void) const
+{
+  return mDirectories;
+} // directories
+
+// ====================================================
+//  SCAN
+// ====================================================
+void ResourceIndex::scan(void)
+{
+  TRACE_SCOPE("ResourceIndex::scan");
+
+  QStringList scripts;
+  foreach (const QString& directory, mDirectories)
+  {
+    if (!mListings.contains(directory))
+      listTree(directory, scripts);
+  }
+  readScripts(scripts);
+} // scan
+
+// ====================================================
+//  UPDATE DIRECTORY
+// ====================================================
+QStringList ResourceIndex::updateDirectory(const QString& directory)
+{
+  QStringList scripts;
+  QString path = QDir::cleanPath(directory);
+  QHash<QString, Listing>::iterator itr = mListings.find(path);
+  if (itr == mListings.end())
+    return scripts;
+
+  Listing now;
+  if (!listDirectory(path, now.files, now.directories, now.stamps))
+  {
+    removeTree(path);
+    return scripts;
+  }
+
+  Listing old = *itr;
+  *itr = now;
+
+  QSet<QString> oldFiles = old.files.toSet();
+  QSet<QString> newFiles = now.files.toSet();
+  foreach (const QString& file, old.files)
+  {
+    if (!newFiles.contains(file))
+      removeFile(path + "/" + file);
+  }
+  foreach (const QString& file, now.files)
+  {
+    if (!oldFiles.contains(file))
+    {
+      addFile(path + "/" + file);
+      if (isScript(file))
+        scripts << path + "/" + file;
+    }
+    else if (isScript(file) && old.stamps.value(file) != now.stamps.value(file))
+    {
+      scripts << path + "/" + file;
+    }
+  }
+
+  QSet<QString> oldDirectories = old.directories.toSet();
+  QSet<QString> newDirectories = now.directories.toSet();
+  foreach (const QString& sub, old.directories)
+  {
+    if (!newDirectories.contains(sub))
+      removeTree(path + "/" + sub);
+  }
+  foreach (const QString& sub, now.directories)
+  {
+    if (!oldDirectories.contains(sub))
+      listTree(path + "/" + sub, scripts);
+  }
+  return scripts;
+} // updateDirectory
+
+// ====================================================
+//  UPDATE SCRIPT
+// ====================================================
+bool ResourceIndex::updateScript(const QString& path)
+{
+  if (isListed(path) && QFileInfo(path).exists())
+    return true;
+  removeDefinitions(path);
+  return false;
+} // updateScript
+
+// ====================================================
+//  SET DEFINITIONS
+// ====================================================
+void ResourceIndex::setDefinitions(const QString& path, const QVector<ResourceDefinition>& definitions)
+{
+  if (!isListed(path))
+    return;
+  removeDefinitions(path);
+  addDefinitions(path, definitions);
+} // setDefinitions
+
+// ====================================================
+//  IS EMPTY
+// ====================================================
+bool ResourceIndex::isEmpty(void) const
+{
+  return mListings.isEmpty();
+} // isEmpty
+
+// ====================================================
+//  LISTED DIRECTORIES
+// ====================================================
+QStringList ResourceIndex::listedDirectories(void) const
+{
+  return mListings.keys();
+} // listedDirectories
+
+// ====================================================
+//  SCRIPTS
+// ====================================================
+QStringList ResourceIndex::scripts(void) const
+{
+  return mScripts.keys();
+} // scripts
+
+// ====================================================
+//  FILE COUNT
+// ====================================================
+int ResourceIndex::fileCount(void) const
+{
+  int count = 0;
+  QHash<QString, QStringList>::const_iterator citr = mFiles.begin();
+  for (; citr != mFiles.end(); ++citr)
+    count += citr->size();
+  return count;
+} // fileCount
+
+// ====================================================
+//  FIND FILE
+// ====================================================
+QString ResourceIndex::findFile(const QString& name) const
+{
+  QString path = QDir::fromNativeSeparators(name);
+  int slash = path.lastIndexOf('/');
+
+  QHash<QString, QStringList>::const_iterator citr = mFiles.find(path.mid(slash + 1).toLower());
+  if (citr == mFiles.end() || citr->isEmpty())
+    return QString();
+  if (slash < 0)
+    return citr->first();
+
+  // A name with a path has to be found under one of the directories
+  foreach (const QString& candidate, *citr)
+  {
+    foreach (const QString& directory, mDirectories)
+    {
+      if (candidate.compare(directory + "/" + path, Qt::CaseInsensitive) == 0)
+        return candidate;
+    }
+  }
+  return QString();
+} // findFile
+
+// ====================================================
+//  FIND DEFINITION
+// ====================================================
+const ResourceDefinition* ResourceIndex::findDefinition(ResourceKind kind, const QString& name) const
+{
+  QString key = name.toLower();
+  QHash<QString, ResourceDefinition>::const_iterator citr = mDefinitions.find(key);
+  for (; citr != mDefinitions.end() && citr.key() == key; ++citr)
+  {
+    if (citr->kind == kind)
+      return &(*citr);
+  }
+  return NULL;
+} // findDefinition
+
+// ====================================================
+//  RESOLVE
+// ====================================================
+bool ResourceIndex::resolve(const ResourceReference& reference) const
+{
+  if (reference.kind == RESOURCE_TEXTURE)
+    return !findFile(reference.name).isEmpty();
+  return findDefinition(reference.kind, reference.name) != NULL;
+} // resolve
+
+// ====================================================
+//  REFERENCE KIND (static)
+// ====================================================
+bool ResourceIndex::referenceKind(const QString& keyword, ResourceKind& kind)
+{
+  // The shadow caster and receiver references name programs too
+  if (keyword == "texture")
+    kind = RESOURCE_TEXTURE;
+  else if (keyword.endsWith("vertex_program_ref"))
+    kind = RESOURCE_VERTEX_PROGRAM;
+  else if (keyword.endsWith("fragment_program_ref"))
+    kind = RESOURCE_FRAGMENT_PROGRAM;
+  else if (keyword == "material")
+    kind = RESOURCE_MATERIAL;
+  else
+    return false;
+  return true;
+} // referenceKind
+
+// ====================================================
+//  FIND REFERENCES (static)
+// ====================================================
+void ResourceIndex::findReferences(const script::Node* root, QVector<ResourceReference>& out)
+{
+  if (root == NULL)
+    return;
+
+  for (const script::Node* node = root->firstChild; node; node = node->next)
+  {
+    ResourceKind kind;
+    bool topLevel = (node->parent == root && root->type == script::NODE_ROOT);
+    if (referenceKind(node->keyword.toString(), kind))
+    {
+      // A material at the top level refers to its parent; anywhere else,
+      // as in an overlay element, to the material it names
+      script::StringRef name = ((kind == RESOURCE_MATERIAL && topLevel) ? node->inherits : node->name());
+      if (!name.isEmpty())
+      {
+        ResourceReference reference;
+        reference.kind = kind;
+        reference.name = name.toString();
+        reference.line = node->line;
+        out.push_back(reference);
+      }
+    }
+    findReferences(node, out);
+  }
+} // findReferences
+
+// ====================================================
+//  FIND DEFINITIONS (static)
+// ====================================================
+void ResourceIndex::findDefinitions(const script::Node* root, const QString& path, QVector<ResourceDefinition>& out)
+{
+  if (root == NULL)
+    return;
+
+  // Programs and materials are only defined at the top level
+  for (const script::Node* node = root->firstChild; node; node = node->next)
+  {
+    ResourceDefinition definition;
+    if (node->keyword == "material")
+      definition.kind = RESOURCE_MATERIAL;
+    else if (node->keyword == "vertex_program")
+      definition.kind = RESOURCE_VERTEX_PROGRAM;
+    else if (node->keyword == "fragment_program")
+      definition.kind = RESOURCE_FRAGMENT_PROGRAM;
+    else
+      continue;
+
+    if (node->name().isEmpty())
+      continue;
+    definition.name = node->name().toString();
+    definition.path = path;
+    definition.line = node->line;
+    out.push_back(definition);
+  }
+} // findDefinitions
+
+// ====================================================
+//  DESCRIBE UNRESOLVED (static)
+// ====================================================
+QString ResourceIndex::describeUnresolved(const ResourceReference& reference)
+{
+  switch (reference.kind)
+  {
+  case RESOURCE_TEXTURE:
+    return QString("Texture '%1' isn't in any resource directory").arg(reference.name);
+  case RESOURCE_VERTEX_PROGRAM:
+    return QString("No vertex program named '%1'").arg(reference.name);
+  case RESOURCE_FRAGMENT_PROGRAM:
+    return QString("No fragment program named '%1'").arg(reference.name);
+  case RESOURCE_MATERIAL:
+    break;
+  }
+  return QString("No material named '%1'").arg(reference.name);
+} // describeUnresolved
+
+// ====================================================
+//  LIST TREE
+// ====================================================
+void ResourceIndex::listTree(const QString& directory, QStringList& scripts)
+{
+  // Breadth first, so a deep tree doesn't recurse deeply
+  QStringList pending(directory);
+  while (!pending.isEmpty())
+  {
+    QString path = pending.takeFirst();
+    Listing listing;
+    if (mListings.contains(path) || !listDirectory(path, listing.files, listing.directories, listing.stamps))
+      continue;
+
+    mListings.insert(path, listing);
+    foreach (const QString& file, listing.files)
+    {
+      addFile(path + "/" + file);
+      if (isScript(file))
+        scripts << path + "/" + file;
+    }
+    foreach (const QString& sub, listing.directories)
+      pending << path + "/" + sub;
+  }
+} // listTree
+
+// ====================================================
+//  REMOVE TREE
+// ====================================================
+void ResourceIndex::removeTree(const QString& directory)
+{
+  QHash<QString, Listing>::iterator itr = mListings.find(directory);
+  if (itr == mListings.end())
+    return;
+
+  Listing listing = *itr;
+  mListings.erase(itr);
+  foreach (const QString& file, listing.files)
+    removeFile(directory + "/" + file);
+  foreach (const QString& sub, listing.directories)
+    removeTree(directory + "/" + sub);
+} // removeTree
+
+// ====================================================
+//  ADD FILE
+// ====================================================
+void ResourceIndex::addFile(const QString& path)
+{
+  mFiles[path.mid(path.lastIndexOf('/') + 1).toLower()].push_back(path);
+} // addFile
+
+// ====================================================
+//  REMOVE FILE
+// ====================================================
+void ResourceIndex::removeFile(const QString& path)
+{
+  QString key = path.mid(path.lastIndexOf('/') + 1).toLower();
+  QHash<QString, QStringList>::iterator itr = mFiles.find(key);
+  if (itr != mFiles.end())
+  {
+    itr->removeAll(path);
+    if (itr->isEmpty())
+      mFiles.erase(itr);
+  }
+  if (isScript(path))
+    removeDefinitions(path);
+} // removeFile
+
+// ====================================================
+//  IS LISTED
+// ====================================================
+bool ResourceIndex::isListed(const QString& path) const
+{
+  int slash = path.lastIndexOf('/');
+  QHash<QString, Listing>::const_iterator citr = mListings.find(path.left(slash));
+  return citr != mListings.end() && citr->files.contains(path.mid(slash + 1));
+} // isListed
+
+// ====================================================
+//  ADD DEFINITIONS
+// ====================================================
+void ResourceIndex::addDefinitions(const QString& path, const QVector<ResourceDefinition>& definitions)
+{
+  mScripts.insert(path, definitions);
+  foreach (const ResourceDefinition& definition, definitions)
+    mDefinitions.insertMulti(definition.name.toLower(), definition);
+} // addDefinitions
+
+// ====================================================
+//  REMOVE DEFINITIONS
+// ====================================================
+void ResourceIndex::removeDefinitions(const QString& path)
+{
+  QHash<QString, QVector<ResourceDefinition> >::iterator script = mScripts.find(path);
+  if (script == mScripts.end())
+    return;
+
+  foreach (const ResourceDefinition& definition, *script)
+  {
+    QString key = definition.name.toLower();
+    QHash<QString, ResourceDefinition>::iterator itr = mDefinitions.find(key);
+    while (itr != mDefinitions.end() && itr.key() == key)
+    {
+      if (itr->path == path)
+        itr = mDefinitions.erase(itr);
+      else
+        ++itr;
+    }
+  }
+  mScripts.erase(script);
+} // removeDefinitions
+
+// ====================================================
+//  READ SCRIPTS
+// ====================================================
+void ResourceIndex::readScripts(const QStringList& paths)
+{
+  if (paths.isEmpty())
+    return;
+
+  // Reading is what takes the time, so the scripts are read in parallel
+  // and only indexed here
+  QList<QVector<ResourceDefinition> > definitions =
+    QtConcurrent::blockingMapped<QList<QVector<ResourceDefinition> > >(paths, ReadDefinitions());
+  for (int i = 0; i < paths.size(); ++i)
+    addDefinitions(paths[i], definitions[i]);
+} // readScripts
+
+// ---------------------------------------------------------------------
+//                            RESOURCE RESOLVER
+// ---------------------------------------------------------------------
+
+// ====================================================
+//  INSTANCE (static)
+// ====================================================
+ResourceResolver* ResourceResolver::instance(void)
+{
+  if (mpMe == NULL)
+    mpMe = new ResourceResolver();
+  return mpMe;
+} // instance
+
+// ====================================================
+//  CTOR
+// ====================================================
+ResourceResolver::ResourceResolver(void)
+  : mPending(false)
+{
+  connect(&mScan, SIGNAL(finished()), this, SLOT(onScanFinished()));
+  connect(&mRead, SIGNAL(finished()), this, SLOT(onReadFinished()));
+  connect(&mWatcher, SIGNAL(directoryChanged(const QString&)), this, SLOT(onDirectoryChanged(const QString&)));
+
+  mTimer.setSingleShot(true);
+  mTimer.setInterval(RESOLVER_DELAY);
+  connect(&mTimer, SIGNAL(timeout()), this, SLOT(update()));
+  connect(config::ConfigWatcher::instance(), SIGNAL(changed(const QStringList&)), this, SLOT(onConfigChanged()));
+
+  mGraphPath = QDir::current().absoluteFilePath("dependencies.dat");
+  mDirectories = config::ConfigFile::instance()->getResourcePaths();
+  if (!mDirectories.isEmpty())
+    scan();
+} // ctor
+
+// ====================================================
+//  SCAN
+// ====================================================
+void ResourceResolver::scan(void)
+{
+  if (mDirectories.isEmpty())
+  {
+    mIndex = ResourceIndex();
+    mGraph = DependencyGraph();
+    mChangedDirectories.clear();
+    mChangedScripts.clear();
+    syncWatches();
+    emit changed();
+    return;
+  }
+
+  mSinceScan.start();
+  mScan.setFuture(QtConcurrent::run(&ResourceResolver::scanDirectories, mDirectories, mGraphPath));
+} // scan
+
+// ====================================================
+//  INDEX
+// ====================================================
+const ResourceIndex& ResourceResolver::index(void) const
+{
+  return mIndex;
+} // index
+
+// ====================================================
+//  DEPENDENCIES
+// ====================================================
+const DependencyGraph& ResourceResolver::dependencies(void) const
+{
+  return mGraph;
+} // dependencies
+
+// ====================================================
+//  FILE SAVED
+// ====================================================
+bool ResourceResolver::fileSaved(const QString& path)
+{
+  // Only scripts in the resource directories are indexed; the watcher would
+  // see the change too, but only after the delay
+  if (!isScript(path) || !mIndex.listedDirectories().contains(QFileInfo(path).absolutePath()))
+    return false;
+
+  mChangedDirectories.insert(QFileInfo(path).absolutePath());
+  mChangedScripts.insert(path);
+  mTimer.stop();
+  update();
+  return true;
+} // fileSaved
+
+// ====================================================
+//  SAVE DEPENDENCIES
+// ====================================================
+void ResourceResolver::saveDependencies(void)
+{
+  if (mGraph.isModified())
+    mGraph.save(mGraphPath);
+} // saveDependencies
+
+// ====================================================
+//  SCAN DIRECTORIES (static)
+// ====================================================
+ResourceResolver::Scan ResourceResolver::scanDirectories(const QStringList& directories, const QString& graphPath)
+{
+  Scan scan;
+  scan.index.setDirectories(directories);
+  scan.index.scan();
+
+  // A graph of other directories is thrown away by setDirectories()
+  scan.graph.load(graphPath);
+  scan.graph.setDirectories(directories);
+  scan.graph.refresh();
+  return scan;
+} // scanDirectories
+
+// ====================================================
+//  READ SCRIPT (static)
+// ====================================================
+ResourceResolver::Read ResourceResolver::readScript(const QString& path)
+{
+  Read read;
+  script::ScriptFile file;
+  bool opened = file.open(path);
+  if (opened)
+    ResourceIndex::findDefinitions(file.root(), path, read.definitions);
+  read.hasEntry = DependencyGraph::readFile(path, opened ? file.root() : NULL, read.entry);
+  return read;
+} // readScript
+
+// ====================================================
+//  ON SCAN FINISHED (slot)
+// ====================================================
+void ResourceResolver::onScanFinished(void)
+{
+  Scan result = mScan.result();
+  mIndex = result.index;
+  mGraph = result.graph;
+  syncWatches();
+  saveDependencies();
+
+  metrics::Registry::instance()->metric("resources.scan_ms")->sample(mSinceScan.nsecsElapsed() / 1000000.0);
+  emit changed();
+
+  if (mPending)
+  {
+    mPending = false;
+    scan();
+  }
+} // onScanFinished
+
+// ====================================================
+//  ON DIRECTORY CHANGED (slot)
+// ====================================================
+void ResourceResolver::onDirectoryChanged(const QString& path)
+{
+  mChangedDirectories.insert(path);
+  mTimer.start();
+} // onDirectoryChanged
+
+
+// ====================================================
+//  ON CONFIG CHANGED (slot)
+// ====================================================
+void ResourceResolver::onConfigChanged(void)
+{
+  const QStringList& directories = config::ConfigFile::instance()->getResourcePaths();
+  if (directories == mDirectories)
+    return;
+
+  // One scan at a time; the directories are scanned again once it ends
+  mDirectories = directories;
+  if (mScan.isRunning())
+    mPending = true;
+  else
+    scan();
+} // onConfigChanged
+
+// ====================================================
+//  UPDATE (slot)
+// ====================================================
+void ResourceResolver::update(void)
+{
+  TRACE_SCOPE("ResourceResolver::update");
+
+  // One read at a time; changes during it wait for it to end
+  if (mRead.isRunning())
+  {
+    mTimer.start();
+    return;
+  }
+
+  // Directories first, since scripts that were removed are dropped with them
+  QStringList scripts;
+  mReadBefore = mIndex.scripts().toSet();
+  foreach (const QString& directory, mChangedDirectories)
+    scripts += mIndex.updateDirectory(directory);
+  foreach (const QString& script, mChangedScripts)
+  {
+    if (mIndex.updateScript(script))
+      scripts << script;
+  }
+  mChangedDirectories.clear();
+  mChangedScripts.clear();
+  syncWatches();
+
+  // Reading is what takes the time, so the scripts are read in parallel
+  // off the GUI thread
+  scripts.removeDuplicates();
+  mReadScripts = scripts;
+  if (mReadScripts.isEmpty())
+    onReadFinished();
+  else
+    mRead.setFuture(QtConcurrent::mapped(mReadScripts, &ResourceResolver::readScript));
+} // update
+
+// ====================================================
+//  ON READ FINISHED (slot)
+// ====================================================
+void ResourceResolver::onReadFinished(void)
+{
+  QList<Read> reads;
+  if (!mReadScripts.isEmpty())
+    reads = mRead.future().results();
+  for (int i = 0; i < mReadScripts.size() && i < reads.size(); ++i)
+    mIndex.setDefinitions(mReadScripts[i], reads[i].definitions);
+  QStringList scripts = updateDependencies(mReadBefore, mReadScripts, reads);
+  mReadScripts.clear();
+  mReadBefore.clear();
+
+  emit changed();
+  if (!scripts.isEmpty())
+    emit dependenciesChanged(scripts);
+} // onReadFinished
+
+// ====================================================
+//  UPDATE DEPENDENCIES
+// ====================================================
+QStringList ResourceResolver::updateDependencies(const QSet<QString>& before, const QStringList& scripts, const QList<Read>& reads)
+{
+  // The scripts were parsed on the thread pool, so this only swaps edges
+  QStringList changed;
+  for (int i = 0; i < scripts.size() && i < reads.size(); ++i)
+  {
+    if (reads[i].hasEntry)
+      mGraph.setFile(scripts[i], reads[i].entry);
+    else
+      mGraph.removeFile(scripts[i]);
+    changed << scripts[i];
+  }
+  foreach (const QString& script, before - mIndex.scripts().toSet())
+  {
+    mGraph.removeFile(script);
+    changed << script;
+  }
+  return changed;
+} // updateDependencies
+
+// ====================================================
+//  SYNC WATCHES
+// ====================================================
+void ResourceResolver::syncWatches(void)
+{
+  QSet<QString> wanted = mIndex.listedDirectories().toSet();
+  QSet<QString> watched = mWatcher.directories().toSet() + mWatcher.files().toSet();
+
+  QStringList added = (wanted - watched).toList();
+  QStringList removed = (watched - wanted).toList();
+  if (!removed.isEmpty())
+    mWatcher.removePaths(removed);
+  if (!added.isEmpty())
+    mWatcher.addPaths(added);
+} // syncWatches
\ No newline at end of file
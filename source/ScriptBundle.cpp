@@ -0,0 +1,393 @@
+#include <QtCore/QFile>
+#include <QtCore/QtEndian>
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+#include "ScriptBundle.h" // class definition
+#include "ScriptParser.h"
+#include "Trace.h"
+
+/// Identifies a bundle
+static const char BUNDLE_MAGIC[4] = { 'M', 'B', 'D', 'L' };
+
+/// Changed whenever the layout of a bundle does
+static const quint32 BUNDLE_VERSION = 1;
+
+/// Size of the header: magic, version, number of entries and size of the names
+static const int HEADER_SIZE = 16;
+
+/// Size of an entry in the index: offset and length of the name, offset and
+/// length of the data, and checksum
+static const int ENTRY_SIZE = 24;
+
+/// Most bytes Adler-32 can sum before its sums must be reduced
+static const int ADLER_BLOCK = 5552;
+
+// ====================================================
+//  COMPARE NAMES (local)
+// ====================================================
+/** Orders names by their UTF-8 bytes, the order the index is in. */
+static int compareNames(const char* a, int aLength, const char* b, int bLength)
+{
+  int result = memcmp(a, b, qMin(aLength, bLength));
+  if (result != 0)
+    return result;
+  return aLength - bLength;
+} // compareNames
+
+// ====================================================
+//  ENCODED ENTRY (local)
+// ====================================================
+/** An entry being written, with its name already encoded. */
+struct EncodedEntry
+{
+  QByteArray          name;
+  const QByteArray*   pData;
+
+  bool operator<(const EncodedEntry& rhs) const
+  {
+    return compareNames(name.constData(), name.size(), rhs.name.constData(), rhs.name.size()) < 0;
+  }
+};
+
+// ====================================================
+//  APPEND WORD (local)
+// ====================================================
+/** Appends a word of a statement, quoted if it wouldn't read back as one. */
+static void appendWord(QByteArray& out, const script::StringRef& word)
+{
+  bool quote = word.isEmpty() || (word.length == 1 && word.data[0] == ':') ||
+               (word.length >= 2 && word.data[0] == '/' && (word.data[1] == '/' || word.data[1] == '*'));
+  for (int i = 0; i < word.length && !quote; ++i)
+  {
+    char ch = word.data[i];
+    quote = (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\f' || ch == '\v' || ch == '{' || ch == '}');
+  }
+
+  if (quote)
+    out += '"';
+  out.append(word.data, word.length);
+  if (quote)
+    out += '"';
+} // appendWord
+
+// ====================================================
+//  APPEND BLOCK (local)
+// ====================================================
+static void appendBlock(QByteArray& out, const script::Node* node)
+{
+  for (const script::Node* child = node->firstChild; child; child = child->next)
+  {
+    // A block without a header is written back as one
+    if (!child->keyword.isEmpty())
+      appendWord(out, child->keyword);
+    for (int i = 0; i < child->numArgs; ++i)
+    {
+      out += ' ';
+      appendWord(out, child->args[i]);
+    }
+    if (!child->inherits.isEmpty())
+    {
+      out += " : ";
+      appendWord(out, child->inherits);
+    }
+
+    if (child->type == script::NODE_OBJECT)
+    {
+      out += (child->keyword.isEmpty() ? "{\n" : " {\n");
+      appendBlock(out, child);
+      out += "}";
+    }
+    out += '\n';
+  }
+} // appendBlock
+
+// ====================================================
+//  READ 32 (local)
+// ====================================================
+static inline quint32 read32(const uchar* at)
+{
+  return qFromLittleEndian<quint32>(at);
+} // read32
+
+// ====================================================
+//  WRITE 32 (local)
+// ====================================================
+static inline void write32(QByteArray& out, quint32 value)
+{
+  uchar bytes[4];
+  qToLittleEndian(value, bytes);
+  out.append(reinterpret_cast<const char*>(bytes), 4);
+} // write32
+
+// ====================================================
+//  CTOR
+// ====================================================
+ScriptBundle::ScriptBundle(void)
+  : mpMapping(NULL), mSize(0), mCount(0), mpNames(NULL)
+{
+} // ctor
+
+// ====================================================
+//  DTOR
+// ====================================================
+ScriptBundle::~ScriptBundle(void)
+{
+  close();
+} // dtor
+
+// ====================================================
+//  OPEN
+// ====================================================
+bool ScriptBundle::open(const QString& path)
+{
+  TRACE_SCOPE("ScriptBundle::open");
+
+  close();
+
+  mFile.setFileName(path);
+  if (!mFile.open(QFile::ReadOnly))
+    return false;
+
+  mSize = mFile.size();
+  if (mSize >= HEADER_SIZE)
+    mpMapping = mFile.map(0, mSize);
+  if (mpMapping == NULL)
+  {
+    close();
+    return false;
+  }
+
+  // Everything the index points at must be in the file, and the names in
+  // order, so nothing read later can run off the end or miss an entry
+  quint32 count = read32(mpMapping + 8);
+  quint32 namesSize = read32(mpMapping + 12);
+  qint64 namesStart = HEADER_SIZE + qint64(count) * ENTRY_SIZE;
+  bool sound = (memcmp(mpMapping, BUNDLE_MAGIC, 4) == 0 && read32(mpMapping + 4) == BUNDLE_VERSION &&
+                count <= quint32(INT_MAX / ENTRY_SIZE) && namesStart + namesSize <= mSize);
+
+  mCount = (sound ? int(count) : 0);
+  mpNames = mpMapping + namesStart;
+  for (int i = 0; i < mCount && sound; ++i)
+  {
+    const uchar* at = entry(i);
+    quint64 dataOffset = qFromLittleEndian<quint64>(at + 8);
+    quint32 dataLength = read32(at + 16);
+    sound = (quint64(read32(at)) + read32(at + 4) <= namesSize && dataLength <= quint32(INT_MAX) &&
+             dataOffset <= quint64(mSize) && dataLength <= quint64(mSize) - dataOffset);
+
+    if (sound && i > 0)
+    {
+      const uchar* previous = entry(i - 1);
+      sound = compareNames(reinterpret_cast<const char*>(mpNames + read32(previous)), int(read32(previous + 4)),
+                           reinterpret_cast<const char*>(mpNames + read32(at)), int(read32(at + 4))) < 0;
+    }
+  }
+
+  if (!sound)
+  {
+    close();
+    return false;
+  }
+  return true;
+} // open
+
+// ====================================================
+//  CLOSE
+// ====================================================
+void ScriptBundle::close(void)
+{
+  if (mpMapping)
+  {
+    mFile.unmap(const_cast<uchar*>(mpMapping));
+    mpMapping = NULL;
+  }
+  if (mFile.isOpen())
+    mFile.close();
+
+  mSize = 0;
+  mCount = 0;
+  mpNames = NULL;
+} // close
+
+// ====================================================
+//  IS OPEN
+// ====================================================
+bool ScriptBundle::isOpen(void) const
+{
+  return mpMapping != NULL;
+} // isOpen
+
+// ====================================================
+//  COUNT
+// ====================================================
+int ScriptBundle::count(void) const
+{
+  return mCount;
+} // count
+
+// ====================================================
+//  NAME
+// ====================================================
+QString ScriptBundle::name(int index) const
+{
+  const uchar* at = entry(index);
+  return QString::fromUtf8(reinterpret_cast<const char*>(mpNames + read32(at)), int(read32(at + 4)));
+} // name
+
+// ====================================================
+//  FIND
+// ====================================================
+int ScriptBundle::find(const QString& name) const
+{
+  QByteArray key = name.toUtf8();
+  int low = 0, high = mCount - 1;
+  while (low <= high)
+  {
+    int middle = low + (high - low) / 2;
+    const uchar* at = entry(middle);
+    int result = compareNames(reinterpret_cast<const char*>(mpNames + read32(at)), int(read32(at + 4)),
+                              key.constData(), key.size());
+    if (result < 0)
+      low = middle + 1;
+    else if (result > 0)
+      high = middle - 1;
+    else
+      return middle;
+  }
+  return -1;
+} // find
+
+// ====================================================
+//  DATA
+// ====================================================
+const char* ScriptBundle::data(int index) const
+{
+  return reinterpret_cast<const char*>(mpMapping + qFromLittleEndian<quint64>(entry(index) + 8));
+} // data
+
+// ====================================================
+//  SIZE
+// ====================================================
+int ScriptBundle::size(int index) const
+{
+  return int(read32(entry(index) + 16));
+} // size
+
+// ====================================================
+//  VERIFY
+// ====================================================
+bool ScriptBundle::verify(int index) const
+{
+  return checksum(data(index), size(index)) == read32(entry(index) + 20);
+} // verify
+
+// ====================================================
+//  ENTRY
+// ====================================================
+const uchar* ScriptBundle::entry(int index) const
+{
+  Q_ASSERT(index >= 0 && index < mCount);
+  return mpMapping + HEADER_SIZE + index * ENTRY_SIZE;
+} // entry
+
+// ====================================================
+//  WRITE (static)
+// ====================================================
+bool ScriptBundle::write(const QString& path, const QVector<BundleEntry>& entries)
+{
+  TRACE_SCOPE("ScriptBundle::write");
+
+  QVector<EncodedEntry> sorted(entries.size());
+  quint32 namesSize = 0;
+  for (int i = 0; i < entries.size(); ++i)
+  {
+    sorted[i].name = entries[i].name.toUtf8();
+    sorted[i].pData = &entries[i].data;
+    namesSize += sorted[i].name.size();
+  }
+  std::sort(sorted.begin(), sorted.end());
+  for (int i = 1; i < sorted.size(); ++i)
+  {
+    if (sorted[i].name == sorted[i - 1].name)
+      return false;
+  }
+
+  QByteArray head;
+  head.append(BUNDLE_MAGIC, 4);
+  write32(head, BUNDLE_VERSION);
+  write32(head, sorted.size());
+  write32(head, namesSize);
+
+  quint32 nameOffset = 0;
+  quint64 dataOffset = HEADER_SIZE + quint64(sorted.size()) * ENTRY_SIZE + namesSize;
+  foreach (const EncodedEntry& encoded, sorted)
+  {
+    write32(head, nameOffset);
+    write32(head, encoded.name.size());
+    uchar bytes[8];
+    qToLittleEndian(dataOffset, bytes);
+    head.append(reinterpret_cast<const char*>(bytes), 8);
+    write32(head, encoded.pData->size());
+    write32(head, checksum(encoded.pData->constData(), encoded.pData->size()));
+
+    nameOffset += encoded.name.size();
+    dataOffset += encoded.pData->size();
+  }
+  foreach (const EncodedEntry& encoded, sorted)
+    head += encoded.name;
+
+  // Written next to the last good bundle and then swapped in, as the
+  // dependency graph is
+  QString temp = path + ".saving";
+  QFile file(temp);
+  if (!file.open(QFile::WriteOnly | QFile::Truncate))
+    return false;
+
+  bool written = (file.write(head) == head.size());
+  for (int i = 0; i < sorted.size() && written; ++i)
+    written = (file.write(*sorted[i].pData) == sorted[i].pData->size());
+  written = written && file.error() == QFile::NoError;
+  file.close();
+  if (written)
+  {
+    QFile::remove(path);
+    written = QFile::rename(temp, path);
+  }
+  if (!written)
+    QFile::remove(temp);
+  return written;
+} // write
+
+// ====================================================
+//  MINIFY (static)
+// ====================================================
+QByteArray ScriptBundle::minify(const script::Node* root)
+{
+  QByteArray out;
+  if (root)
+    appendBlock(out, root);
+  return out;
+} // minify
+
+// ====================================================
+//  CHECKSUM (static)
+// ====================================================
+quint32 ScriptBundle::checksum(const char* data, int size)
+{
+  const uchar* bytes = reinterpret_cast<const uchar*>(data);
+  quint32 a = 1, b = 0;
+  while (size > 0)
+  {
+    int block = qMin(size, ADLER_BLOCK);
+    size -= block;
+    while (block-- > 0)
+    {
+      a += *bytes++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return (b << 16) | a;
+} // checksum
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+#include "ScriptDiff.h" // class definition
+#include "ScriptParser.h"
+#include "MaterialFlattener.h"
+#include "Trace.h"
+
+// ====================================================
+//  SUBTREE HASH (local)
+// ====================================================
+/** The hash of a subtree, in two halves, so objects whose blocks are the
+ * same can be found whatever they are called. */
+struct SubtreeHash
+{
+  uint statement;   ///< Of the keyword, arguments and parent
+  uint block;       ///< Of the statements in the block, each with its identity
+};
+
+typedef QHash<const script::Node*, SubtreeHash> SubtreeHashes;
+
+// ====================================================
+//  MIX (local)
+// ====================================================
+/** Spreads the bits of \e h, so sums of hashes don't cancel out. */
+static uint mix(uint h)
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6bU;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35U;
+  h ^= h >> 16;
+  return h;
+} // mix
+
+// ====================================================
+//  IDENTITY (local)
+// ====================================================
+/** @returns What \e node is matched up by in its block: the keyword and
+ * name of an object, the keyword (and first argument) of an attribute, or
+ * the keyword and position of anything else.
+ * @param ordinals The positions so far of each keyword in the block.
+ * @param label Receives how the node is shown in a location, if not NULL. */
+static QString identity(const script::Node* node, QHash<QString, int>& ordinals, QString* label = NULL)
+{
+  QString keyword = node->keyword.toString();
+  QString id;
+  if (node->type == script::NODE_OBJECT)
+  {
+    if (!node->name().isEmpty())
+      id = "o " + keyword + ' ' + node->name().toString();
+    else
+    {
+      int ordinal = ordinals["o " + keyword]++;
+      id = "o " + keyword + " #" + QString::number(ordinal);
+      if (label)
+        *label = QString("%1 #%2").arg(keyword).arg(ordinal + 1);
+    }
+  }
+  else if (node->numArgs > 0 && MaterialStatement::isRepeatable(keyword))
+    id = "a " + keyword + ' ' + node->args[0].toString();
+  else
+    id = "a " + keyword + " #" + QString::number(ordinals["a " + keyword]++);
+
+  if (label && label->isEmpty())
+    *label = id.mid(2);
+  return id;
+} // identity
+
+// ====================================================
+//  STATEMENT TEXT (local)
+// ====================================================
+static QString statementText(const script::Node* node)
+{
+  QString text = node->keyword.toString();
+  for (int i = 0; i < node->numArgs; ++i)
+    text += ' ' + node->args[i].toString();
+  if (!node->inherits.isEmpty())
+    text += " : " + node->inherits.toString();
+  return text;
+} // statementText
+
+// ====================================================
+//  HASH TREE (local)
+// ====================================================
+/** Hashes \e node and everything under it, bottom up.
+ * @returns The hash of the whole subtree. */
+static uint hashTree(const script::Node* node, SubtreeHashes& hashes)
+{
+  SubtreeHash hash;
+  hash.statement = mix(script::qHash(node->keyword) ^ node->type);
+  for (int i = 0; i < node->numArgs; ++i)
+    hash.statement = mix(hash.statement + script::qHash(node->args[i]));
+  hash.statement = mix(hash.statement ^ script::qHash(node->inherits));
+
+  // Statements are summed, each with what it's matched up by, so the hash
+  // doesn't change when they are reordered but does when they move between
+  // positions that matter
+  hash.block = 0;
+  QHash<QString, int> ordinals;
+  for (const script::Node* child = node->firstChild; child; child = child->next)
+    hash.block += mix(hashTree(child, hashes) ^ qHash(identity(child, ordinals)));
+
+  hashes.insert(node, hash);
+  return mix(hash.statement + mix(hash.block));
+} // hashTree
+
+// ====================================================
+//  MAKE CHANGE (local)
+// ====================================================
+static ScriptChange makeChange(ScriptChangeKind kind, const QString& location, const script::Node* before, const script::Node* after)
+{
+  ScriptChange change;
+  change.kind = kind;
+  change.location = location;
+  change.before = (before ? statementText(before) : QString());
+  change.after = (after ? statementText(after) : QString());
+  change.oldLine = (before ? before->line : 0);
+  change.newLine = (after ? after->line : 0);
+  return change;
+} // makeChange
+
+// ====================================================
+//  FIND RENAMED (local)
+// ====================================================
+/** Finds the object that went from the old block that \e node is, renamed:
+ * one with the same keyword, parent and block, and takes it out of
+ * \e removed.
+ * @returns NULL if there isn't one. */
+static const script::Node* findRenamed(const script::Node* node, const SubtreeHashes& hashes,
+                                       QHash<uint, const script::Node*>& removed)
+{
+  if (node->type != script::NODE_OBJECT)
+    return NULL;
+
+  uint block = hashes.value(node).block;
+  QHash<uint, const script::Node*>::iterator itr = removed.find(block);
+  for (; itr != removed.end() && itr.key() == block; ++itr)
+  {
+    const script::Node* candidate = *itr;
+    if (candidate->keyword == node->keyword && candidate->inherits == node->inherits)
+    {
+      removed.erase(itr);
+      return candidate;
+    }
+  }
+  return NULL;
+} // findRenamed
+
+// ====================================================
+//  DIFF BLOCK (local)
+// ====================================================
+/** Compares the blocks of two statements that were matched up. */
+static void diffBlock(const script::Node* before, const script::Node* after, const QString& location,
+                      const SubtreeHashes& hashes, QVector<ScriptChange>& out)
+{
+  // The first of each identity in the old block is what it's matched with
+  QHash<QString, const script::Node*> old;
+  QHash<QString, int> ordinals;
+  for (const script::Node* child = before->firstChild; child; child = child->next)
+  {
+    QString id = identity(child, ordinals);
+    if (!old.contains(id))
+      old.insert(id, child);
+  }
+
+  QVector<const script::Node*> twins;
+  QStringList labels;
+  QSet<const script::Node*> matched;
+  ordinals.clear();
+  for (const script::Node* child = after->firstChild; child; child = child->next)
+  {
+    QString label;
+    const script::Node* twin = old.value(identity(child, ordinals, &label));
+    if (twin && matched.contains(twin))
+      twin = NULL;
+    if (twin)
+      matched.insert(twin);
+    twins.push_back(twin);
+    labels << label;
+  }
+
+  // Objects left over in the old block, by their blocks, for renames
+  QHash<uint, const script::Node*> removed;
+  for (const script::Node* child = before->firstChild; child; child = child->next)
+  {
+    if (!matched.contains(child) && child->type == script::NODE_OBJECT)
+      removed.insertMulti(hashes.value(child).block, child);
+  }
+
+  int index = 0;
+  for (const script::Node* child = after->firstChild; child; child = child->next, ++index)
+  {
+    const script::Node* twin = twins[index];
+    if (twin == NULL)
+    {
+      twin = findRenamed(child, hashes, removed);
+      if (twin)
+        matched.insert(twin);
+      out.push_back(makeChange(twin ? SCRIPT_RENAMED : SCRIPT_ADDED, location, twin, child));
+      continue;
+    }
+
+    // The same all the way down
+    const SubtreeHash& a = hashes.value(twin);
+    const SubtreeHash& b = hashes.value(child);
+    if (a.statement == b.statement && a.block == b.block)
+      continue;
+
+    if (a.statement != b.statement)
+      out.push_back(makeChange(SCRIPT_CHANGED, location, twin, child));
+    if (child->type == script::NODE_OBJECT && a.block != b.block)
+      diffBlock(twin, child, location.isEmpty() ? labels[index] : location + " > " + labels[index], hashes, out);
+  }
+
+  for (const script::Node* child = before->firstChild; child; child = child->next)
+  {
+    if (!matched.contains(child))
+      out.push_back(makeChange(SCRIPT_REMOVED, location, child, NULL));
+  }
+} // diffBlock
+
+// ====================================================
+//  TO STRING
+// ====================================================
+QString ScriptChange::toString(void) const
+{
+  QString where = (location.isEmpty() ? QString() : location + ": ");
+  switch (kind)
+  {
+  case SCRIPT_ADDED:
+    return "+ " + where + after;
+  case SCRIPT_REMOVED:
+    return "- " + where + before;
+  case SCRIPT_CHANGED:
+    return "~ " + where + before + " -> " + after;
+  case SCRIPT_RENAMED:
+    break;
+  }
+  return "= " + where + before + " -> " + after;
+} // toString
+
+// ====================================================
+//  DIFF (static)
+// ====================================================
+void ScriptDiff::diff(const script::Node* before, const script::Node* after, QVector<ScriptChange>& out)
+{
+  TRACE_SCOPE("ScriptDiff::diff");
+
+  if (before == NULL || after == NULL)
+    return;
+
+  SubtreeHashes hashes;
+  hashTree(before, hashes);
+  hashTree(after, hashes);
+  diffBlock(before, after, QString(), hashes, out);
+} // diff
\ No newline at end of file
@@ -0,0 +1,796 @@
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <algorithm>
+#include <QtCore/QVarLengthArray>
+#include "ScriptParser.h" // class definition
+
+namespace script
+{
+  // ====================================================
+  //  HASH BYTES (local)
+  // ====================================================
+  static inline uint hashBytes(const char* data, int length)
+  {
+    // FNV-1a
+    uint h = 2166136261u;
+    for (int i = 0; i < length; ++i)
+    {
+      h ^= static_cast<uchar>(data[i]);
+      h *= 16777619u;
+    }
+    return h;
+  } // hashBytes
+
+  // ---------------------------------------------------------------------
+  //                              STRING REF
+  // ---------------------------------------------------------------------
+
+  // ====================================================
+  //  OPERATOR ==
+  // ====================================================
+  bool StringRef::operator==(const StringRef& other) const
+  {
+    return length == other.length && memcmp(data, other.data, length) == 0;
+  } // operator==
+
+  // ====================================================
+  //  OPERATOR == (const char*)
+  // ====================================================
+  bool StringRef::operator==(const char* str) const
+  {
+    int i = 0;
+    for (; i < length; ++i)
+    {
+      if (str[i] == '\0' || str[i] != data[i])
+        return false;
+    }
+    return str[i] == '\0';
+  } // operator==
+
+  // ====================================================
+  //  TO STRING
+  // ====================================================
+  QString StringRef::toString(void) const
+  {
+    return QString::fromUtf8(data, length);
+  } // toString
+
+  // ====================================================
+  //  QHASH
+  // ====================================================
+  uint qHash(const StringRef& ref)
+  {
+    return hashBytes(ref.data, ref.length);
+  } // qHash
+
+  // ---------------------------------------------------------------------
+  //                                ARENA
+  // ---------------------------------------------------------------------
+
+  // ====================================================
+  //  CTOR
+  // ====================================================
+  Arena::Arena(int blockSize)
+    : mpBlocks(NULL), mBlockSize(blockSize), mBytesUsed(0), mBlockCount(0)
+  {
+  } // ctor
+
+  // ====================================================
+  //  DTOR
+  // ====================================================
+  Arena::~Arena(void)
+  {
+    clear();
+  } // dtor
+
+  // ====================================================
+  //  ALLOCATE
+  // ====================================================
+  void* Arena::allocate(int size)
+  {
+    // The block header is padded to 8 bytes as well, so the data that
+    // follows it stays aligned.
+    const int header = (sizeof(Block) + 7) & ~7;
+
+    // Sizes that would overflow once rounded up and given a header
+    if (size < 0 || size > INT_MAX - header - 7)
+      return NULL;
+
+    // Keep every allocation 8 byte aligned
+    size = (size + 7) & ~7;
+
+    if (mpBlocks == NULL || mpBlocks->used + size > mpBlocks->size)
+    {
+      int blockSize = std::max(mBlockSize, size);
+      Block* block = static_cast<Block*>(malloc(header + blockSize));
+      if (block == NULL)
+        return NULL;
+      block->next = mpBlocks;
+      block->size = blockSize;
+      block->used = 0;
+      mpBlocks = block;
+      ++mBlockCount;
+    }
+
+    char* base = reinterpret_cast<char*>(mpBlocks) + header;
+    void* ptr = base + mpBlocks->used;
+    mpBlocks->used += size;
+    mBytesUsed += size;
+    return ptr;
+  } // allocate
+
+  // ====================================================
+  //  CLEAR
+  // ====================================================
+  void Arena::clear(void)
+  {
+    while (mpBlocks)
+    {
+      Block* next = mpBlocks->next;
+      free(mpBlocks);
+      mpBlocks = next;
+    }
+
+    mBytesUsed = 0;
+    mBlockCount = 0;
+  } // clear
+
+  // ====================================================
+  //  BYTES USED
+  // ====================================================
+  int Arena::bytesUsed(void) const
+  {
+    return mBytesUsed;
+  } // bytesUsed
+
+  // ====================================================
+  //  BLOCK COUNT
+  // ====================================================
+  int Arena::blockCount(void) const
+  {
+    return mBlockCount;
+  } // blockCount
+
+  // ---------------------------------------------------------------------
+  //                            KEYWORD TABLE
+  // ---------------------------------------------------------------------
+
+  // ====================================================
+  //  CTOR
+  // ====================================================
+  KeywordTable::KeywordTable(void)
+    : mMask(0), mCount(0)
+  {
+  } // ctor
+
+  // ====================================================
+  //  CTOR (FormatWordMap)
+  // ====================================================
+  KeywordTable::KeywordTable(const config::FormatWordMap& words)
+    : mMask(0), mCount(0)
+  {
+    build(words);
+  } // ctor
+
+  // ====================================================
+  //  BUILD
+  // ====================================================
+  void KeywordTable::build(const config::FormatWordMap& words)
+  {
+    mKeys.clear();
+    mSlots.clear();
+    mCount = 0;
+
+    // Copy all of the keys into one buffer first so that the StringRefs in the
+    // slots never point into a buffer that later gets reallocated.
+    QVector<int> offsets;
+    config::FormatWordMap::const_iterator citr = words.begin();
+    for (; citr != words.end(); ++citr)
+    {
+      offsets.push_back(mKeys.size());
+      mKeys.append(citr.key().toUtf8());
+    }
+    offsets.push_back(mKeys.size());
+
+    // Keep the load factor at or below 50%
+    uint capacity = 16;
+    while (capacity < static_cast<uint>(words.size()) * 2)
+      capacity <<= 1;
+    mMask = capacity - 1;
+    mSlots.resize(capacity);
+
+    int i = 0;
+    for (citr = words.begin(); citr != words.end(); ++citr, ++i)
+    {
+      StringRef key(mKeys.constData() + offsets[i], offsets[i+1] - offsets[i]);
+      uint hash = hashBytes(key.data, key.length);
+
+      uint index = hash & mMask;
+      while (mSlots[index].key.data != NULL)
+        index = (index + 1) & mMask;
+
+      Slot& slot = mSlots[index];
+      slot.hash = hash;
+      slot.key  = key;
+      slot.word = *citr;
+      ++mCount;
+    }
+  } // build
+
+  // ====================================================
+  //  FIND
+  // ====================================================
+  const config::FormatWord* KeywordTable::find(const StringRef& word) const
+  {
+    if (mCount == 0)
+      return NULL;
+
+    uint hash = hashBytes(word.data, word.length);
+    uint index = hash & mMask;
+    const Slot* slots = mSlots.constData();
+
+    while (slots[index].key.data != NULL)
+    {
+      if (slots[index].hash == hash && slots[index].key == word)
+        return &slots[index].word;
+      index = (index + 1) & mMask;
+    }
+
+    return NULL;
+  } // find
+
+  // ====================================================
+  //  COUNT
+  // ====================================================
+  int KeywordTable::count(void) const
+  {
+    return mCount;
+  } // count
+
+  // ---------------------------------------------------------------------
+  //                                LEXER
+  // ---------------------------------------------------------------------
+
+  // ====================================================
+  //  IS SPACE (local)
+  // ====================================================
+  static inline bool isSpace(char ch)
+  {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\f' || ch == '\v';
+  } // isSpace
+
+  // ====================================================
+  //  IS DELIMITER (local)
+  // ====================================================
+  static inline bool isDelimiter(char ch)
+  {
+    return isSpace(ch) || ch == '\n' || ch == '{' || ch == '}' || ch == '"';
+  } // isDelimiter
+
+  // ====================================================
+  //  CTOR
+  // ====================================================
+  Lexer::Lexer(const char* data, int length)
+    : mpCur(data), mpEnd(data + length), mLine(1)
+  {
+    // Skip a UTF-8 byte order mark
+    if (length >= 3 && static_cast<uchar>(data[0]) == 0xEF &&
+        static_cast<uchar>(data[1]) == 0xBB && static_cast<uchar>(data[2]) == 0xBF)
+      mpCur += 3;
+  } // ctor
+
+  // ====================================================
+  //  NEXT
+  // ====================================================
+  Token Lexer::next(void)
+  {
+    Token token;
+
+    for (;;)
+    {
+      // Skip whitespace (but not newlines, they're tokens)
+      while (mpCur < mpEnd && isSpace(*mpCur))
+        ++mpCur;
+
+      if (mpCur >= mpEnd)
+      {
+        token.type = TOKEN_END;
+        token.text = StringRef(mpEnd, 0);
+        token.line = mLine;
+        return token;
+      }
+
+      // Line comment.  Comments are only looked for here, at the start of a
+      // token; the word loop below runs on through any "//" or "/*".
+      if (*mpCur == '/' && mpEnd - mpCur >= 2 && mpCur[1] == '/')
+      {
+        const char* nl = static_cast<const char*>(memchr(mpCur, '\n', mpEnd - mpCur));
+        mpCur = nl ? nl : mpEnd;
+        continue;
+      }
+
+      // Block comment
+      if (*mpCur == '/' && mpEnd - mpCur >= 2 && mpCur[1] == '*')
+      {
+        mpCur += 2;
+        while (mpEnd - mpCur >= 2 && !(mpCur[0] == '*' && mpCur[1] == '/'))
+        {
+          if (*mpCur == '\n')
+            ++mLine;
+          ++mpCur;
+        }
+
+        // Past the "*/", or to the end of an unterminated comment
+        if (mpEnd - mpCur >= 2)
+          mpCur += 2;
+        else
+          mpCur = mpEnd;
+        continue;
+      }
+
+      break;
+    }
+
+    token.line = mLine;
+    const char* start = mpCur;
+
+    switch (*mpCur)
+    {
+    case '\n':
+      ++mpCur;
+      ++mLine;
+      token.type = TOKEN_NEWLINE;
+      token.text = StringRef(start, 1);
+      return token;
+
+    case '{':
+      ++mpCur;
+      token.type = TOKEN_OPEN_BRACE;
+      token.text = StringRef(start, 1);
+      return token;
+
+    case '}':
+      ++mpCur;
+      token.type = TOKEN_CLOSE_BRACE;
+      token.text = StringRef(start, 1);
+      return token;
+
+    case '"':
+      {
+        // Strings may not span lines
+        ++mpCur;
+        while (mpCur < mpEnd && *mpCur != '"' && *mpCur != '\n')
+          ++mpCur;
+        token.type = TOKEN_STRING;
+        token.text = StringRef(start + 1, mpCur - start - 1);
+        if (mpCur < mpEnd && *mpCur == '"')
+          ++mpCur;
+        return token;
+      }
+    }
+
+    // A word is everything up to the next delimiter
+    while (mpCur < mpEnd && !isDelimiter(*mpCur))
+      ++mpCur;
+
+    token.text = StringRef(start, mpCur - start);
+    token.type = (token.text.length == 1 && *start == ':') ? TOKEN_COLON : TOKEN_WORD;
+    return token;
+  } // next
+
+  // ---------------------------------------------------------------------
+  //                                PARSER
+  // ---------------------------------------------------------------------
+
+  /// Deepest nesting of blocks the parser follows.  Each level is a couple
+  /// of stack frames, so a file of nothing but '{' can't run the thread it's
+  /// parsed on out of stack; real scripts nest a handful deep.
+  static const int MAX_BLOCK_DEPTH = 128;
+
+  /** Recursive descent parser that builds the AST of a ScriptFile.  A statement
+   * is every token up to the end of the line; if the next token (possibly on
+   * a following line) is a '{', the statement is an object and its block is
+   * parsed as its children.  Blocks nested deeper than MAX_BLOCK_DEPTH are
+   * reported and skipped. */
+  class Parser
+  {
+  public:
+    Parser(Lexer& lexer, Arena& arena, const KeywordTable* keywords, QVector<ParseError>& errors)
+      : mLexer(lexer), mArena(arena), mpKeywords(keywords), mErrors(errors),
+        mHasPending(false), mNodeCount(0), mDepth(0), mOutOfMemory(false)
+    {
+    }
+
+    /** @returns The root of the AST, or NULL if the Arena ran out of memory. */
+    Node* parse(void)
+    {
+      Node* root = createNode(NODE_ROOT, StringRef(), 0, NULL);
+      if (root == NULL)
+        return NULL;
+
+      parseBlock(root, true);
+      return mOutOfMemory ? NULL : root;
+    }
+
+    int nodeCount(void) const { return mNodeCount; }
+
+  private:
+    Token next(void)
+    {
+      if (mHasPending)
+      {
+        mHasPending = false;
+        return mPending;
+      }
+      return mLexer.next();
+    }
+
+    void pushBack(const Token& token)
+    {
+      mPending = token;
+      mHasPending = true;
+    }
+
+    void error(int line, const char* message)
+    {
+      ParseError e;
+      e.line = line;
+      e.message = message;
+      mErrors.push_back(e);
+    }
+
+    Node* createNode(NodeType type, const StringRef& keyword, int line, Node* parent)
+    {
+      Node* node = static_cast<Node*>(mArena.allocate(sizeof(Node)));
+      if (node == NULL)
+      {
+        // Unwinds the parse; see parseBlock()
+        mOutOfMemory = true;
+        return NULL;
+      }
+
+      node->type       = type;
+      node->keyword    = keyword;
+      node->word       = (mpKeywords && !keyword.isEmpty()) ? mpKeywords->find(keyword) : NULL;
+      node->args       = NULL;
+      node->numArgs    = 0;
+      node->line       = line;
+      node->parent     = parent;
+      node->firstChild = NULL;
+      node->lastChild  = NULL;
+      node->next       = NULL;
+
+      if (parent)
+      {
+        if (parent->lastChild)
+          parent->lastChild->next = node;
+        else
+          parent->firstChild = node;
+        parent->lastChild = node;
+        ++mNodeCount;
+      }
+
+      return node;
+    }
+
+    void parseBlock(Node* parent, bool topLevel)
+    {
+      while (!mOutOfMemory)
+      {
+        Token token = next();
+        switch (token.type)
+        {
+        case TOKEN_NEWLINE:
+          break;
+
+        case TOKEN_END:
+          if (!topLevel)
+            error(token.line, "Missing closing brace '}'");
+          return;
+
+        case TOKEN_CLOSE_BRACE:
+          if (!topLevel)
+            return;
+          error(token.line, "Unexpected closing brace '}'");
+          break;
+
+        case TOKEN_OPEN_BRACE:
+          {
+            // A block without a header.  Keep its contents so the rest of the
+            // file still parses sensibly.
+            error(token.line, "Block has no header");
+            Node* node = createNode(NODE_OBJECT, StringRef(), token.line, parent);
+            if (node)
+              parseChildren(node);
+          }
+          break;
+
+        default:
+          parseStatement(parent, token);
+          break;
+        }
+      }
+    }
+
+    void parseStatement(Node* parent, const Token& first)
+    {
+      QVarLengthArray<StringRef, 32> args;
+      StringRef inherits;
+      bool afterColon = false;
+      bool isObject = false;
+
+      for (;;)
+      {
+        Token token = next();
+
+        if (token.type == TOKEN_WORD || token.type == TOKEN_STRING)
+        {
+          if (afterColon)
+          {
+            inherits = token.text;
+            afterColon = false;
+          }
+          else
+            args.append(token.text);
+        }
+        else if (token.type == TOKEN_COLON)
+        {
+          afterColon = true;
+        }
+        else if (token.type == TOKEN_OPEN_BRACE)
+        {
+          isObject = true;
+          break;
+        }
+        else if (token.type == TOKEN_NEWLINE)
+        {
+          // An object's opening brace may be on a following line
+          Token peek = next();
+          while (peek.type == TOKEN_NEWLINE)
+            peek = next();
+
+          if (peek.type == TOKEN_OPEN_BRACE)
+            isObject = true;
+          else
+            pushBack(peek);
+          break;
+        }
+        else
+        {
+          // TOKEN_CLOSE_BRACE or TOKEN_END ends the statement, but belongs
+          // to the enclosing block.
+          pushBack(token);
+          break;
+        }
+      }
+
+      Node* node = createNode(isObject ? NODE_OBJECT : NODE_PROPERTY, first.text, first.line, parent);
+      if (node == NULL)
+        return;
+
+      node->inherits = inherits;
+      if (args.size() > 0)
+      {
+        node->args = mArena.allocateArray<StringRef>(args.size());
+        if (node->args == NULL)
+        {
+          mOutOfMemory = true;
+          return;
+        }
+        memcpy(node->args, args.constData(), sizeof(StringRef) * args.size());
+        node->numArgs = args.size();
+      }
+
+      if (isObject)
+        parseChildren(node);
+    }
+
+    /** Parses the block of an object after its '{', unless it's nested too
+     * deeply, in which case it's skipped up to its '}'. */
+    void parseChildren(Node* node)
+    {
+      if (mDepth < MAX_BLOCK_DEPTH)
+      {
+        ++mDepth;
+        parseBlock(node, false);
+        --mDepth;
+        return;
+      }
+
+      error(node->line, "Blocks are nested too deeply");
+      for (int depth = 1; depth > 0; )
+      {
+        Token token = next();
+        if (token.type == TOKEN_END)
+        {
+          // Left for the enclosing blocks, which are missing braces too
+          error(token.line, "Missing closing brace '}'");
+          pushBack(token);
+          return;
+        }
+        if (token.type == TOKEN_OPEN_BRACE)
+          ++depth;
+        else if (token.type == TOKEN_CLOSE_BRACE)
+          --depth;
+      }
+    }
+
+  private:
+    Lexer&                mLexer;
+    Arena&                mArena;
+    const KeywordTable*   mpKeywords;
+    QVector<ParseError>&  mErrors;
+    Token                 mPending;
+    bool                  mHasPending;
+    int                   mNodeCount;
+    int                   mDepth;       ///< Blocks open around the one being parsed
+    bool                  mOutOfMemory; ///< The Arena failed; stop parsing
+  };
+
+  // ---------------------------------------------------------------------
+  //                             SCRIPT FILE
+  // ---------------------------------------------------------------------
+
+  // ====================================================
+  //  CTOR
+  // ====================================================
+  ScriptFile::ScriptFile(const KeywordTable* keywords)
+    : mpKeywords(keywords), mpMapping(NULL), mpData(NULL), mSize(0),
+      mpRoot(NULL), mNodeCount(0)
+  {
+  } // ctor
+
+  // ====================================================
+  //  DTOR
+  // ====================================================
+  ScriptFile::~ScriptFile(void)
+  {
+    close();
+  } // dtor
+
+  // ====================================================
+  //  OPEN
+  // ====================================================
+  bool ScriptFile::open(const QString& path)
+  {
+    close();
+
+    mFile.setFileName(path);
+    if (!mFile.open(QFile::ReadOnly))
+      return false;
+
+    // Offsets into the buffer are ints, so bigger files can't be parsed
+    if (mFile.size() > INT_MAX)
+    {
+      mFile.close();
+      error("File is too large");
+      return false;
+    }
+
+    // Empty files can't be mapped, but they're still valid (empty) scripts
+    if (mFile.size() > 0)
+    {
+      mpMapping = mFile.map(0, mFile.size());
+      if (mpMapping == NULL)
+      {
+        mFile.close();
+        return false;
+      }
+    }
+
+    parse(reinterpret_cast<const char*>(mpMapping), static_cast<int>(mFile.size()));
+    return true;
+  } // open
+
+  // ====================================================
+  //  PARSE
+  // ====================================================
+  void ScriptFile::parse(const char* data, int length)
+  {
+    mArena.clear();
+    mErrors.clear();
+
+    mpData = data;
+    mSize = length;
+
+    Lexer lexer(data, length);
+    Parser parser(lexer, mArena, mpKeywords, mErrors);
+    mpRoot = parser.parse();
+    mNodeCount = parser.nodeCount();
+
+    if (mpRoot == NULL)
+    {
+      // Whatever was parsed before the Arena failed is incomplete, so fall
+      // back to an empty AST.  Callers can rely on root() not being NULL.
+      mArena.clear();
+      mErrors.clear();
+      error("Out of memory");
+
+      mEmptyRoot = Node();
+      mEmptyRoot.type = NODE_ROOT;
+      mpRoot = &mEmptyRoot;
+      mNodeCount = 0;
+    }
+  } // parse
+
+  // ====================================================
+  //  ERROR
+  // ====================================================
+  void ScriptFile::error(const char* message)
+  {
+    ParseError e;
+    e.line = 0;
+    e.message = message;
+    mErrors.push_back(e);
+  } // error
+
+  // ====================================================
+  //  CLOSE
+  // ====================================================
+  void ScriptFile::close(void)
+  {
+    mArena.clear();
+    mErrors.clear();
+    mpRoot = NULL;
+    mNodeCount = 0;
+    mpData = NULL;
+    mSize = 0;
+
+    if (mpMapping)
+    {
+      mFile.unmap(mpMapping);
+      mpMapping = NULL;
+    }
+    if (mFile.isOpen())
+      mFile.close();
+  } // close
+
+  // ====================================================
+  //  ROOT
+  // ====================================================
+  const Node* ScriptFile::root(void) const
+  {
+    return mpRoot;
+  } // root
+
+  // ====================================================
+  //  ERRORS
+  // ====================================================
+  const QVector<ParseError>& ScriptFile::errors(void) const
+  {
+    return mErrors;
+  } // errors
+
+  // ====================================================
+  //  NODE COUNT
+  // ====================================================
+  int ScriptFile::nodeCount(void) const
+  {
+    return mNodeCount;
+  } // nodeCount
+
+  // ====================================================
+  //  DATA
+  // ====================================================
+  const char* ScriptFile::data(void) const
+  {
+    return mpData;
+  } // data
+
+  // ====================================================
+  //  SIZE
+  // ====================================================
+  int ScriptFile::size(void) const
+  {
+    return mSize;
+  } // size
+
+  // ====================================================
+  //  ARENA
+  // ====================================================
+  const Arena& ScriptFile::arena(void) const
+  {
+    return mArena;
+  } // arena
+} // namespace script
\ No newline at end of file
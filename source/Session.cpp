@@ -0,0 +1,134 @@
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include "Session.h" // class definition
+#include "Trace.h"
+
+/// Identifies a session file
+static const quint32 SESSION_MAGIC = 0x4d455353;  // "MESS"
+
+/// Changed whenever the layout of a session file does
+static const quint32 SESSION_VERSION = 1;
+
+// ====================================================
+//  CTOR
+// ====================================================
+SessionTab::SessionTab(void)
+  : large(false), cursorPosition(0), horizontalScroll(0), verticalScroll(0)
+{
+} // ctor
+
+// ====================================================
+//  CTOR
+// ====================================================
+Session::Session(void)
+  : currentTab(-1)
+{
+} // ctor
+
+// ====================================================
+//  CLEAR
+// ====================================================
+void Session::clear(void)
+{
+  currentTab = -1;
+  tabs.clear();
+} // clear
+
+// ====================================================
+//  TO BYTE ARRAY
+// ====================================================
+QByteArray Session::toByteArray(void) const
+{
+  QByteArray data;
+  QDataStream stream(&data, QIODevice::WriteOnly);
+  stream.setVersion(QDataStream::Qt_4_6);
+
+  stream << SESSION_MAGIC << SESSION_VERSION << static_cast<qint32>(currentTab) << static_cast<qint32>(tabs.size());
+  foreach (const SessionTab& tab, tabs)
+  {
+    stream << tab.path << tab.format << tab.large << tab.cursorPosition
+           << static_cast<qint32>(tab.horizontalScroll) << static_cast<qint32>(tab.verticalScroll)
+           << tab.highlight;
+  }
+  return data;
+} // toByteArray
+
+// ====================================================
+//  FROM BYTE ARRAY
+// ====================================================
+bool Session::fromByteArray(const QByteArray& data)
+{
+  clear();
+
+  QDataStream stream(data);
+  stream.setVersion(QDataStream::Qt_4_6);
+
+  quint32 magic, version;
+  qint32 current, count;
+  stream >> magic >> version >> current >> count;
+  if (stream.status() != QDataStream::Ok || magic != SESSION_MAGIC || version != SESSION_VERSION || count < 0)
+    return false;
+
+  // The count comes from the file, so tabs are only added as they're read;
+  // a file cut short or corrupted stops the stream instead of allocating
+  for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+  {
+    SessionTab tab;
+    qint32 horizontal, vertical;
+    stream >> tab.path >> tab.format >> tab.large >> tab.cursorPosition >> horizontal >> vertical >> tab.highlight;
+    tab.horizontalScroll = horizontal;
+    tab.verticalScroll = vertical;
+    if (stream.status() == QDataStream::Ok)
+      tabs.push_back(tab);
+  }
+
+  if (stream.status() != QDataStream::Ok)
+  {
+    clear();
+    return false;
+  }
+
+  currentTab = current;
+  return true;
+} // fromByteArray
+
+// ====================================================
+//  LOAD
+// ====================================================
+bool Session::load(const QString& path)
+{
+  TRACE_SCOPE("Session::load");
+
+  QFile file(path);
+  if (!file.open(QFile::ReadOnly))
+    return false;
+  return fromByteArray(file.readAll());
+} // load
+
+// ====================================================
+//  SAVE
+// ====================================================
+bool Session::save(const QString& path) const
+{
+  TRACE_SCOPE("Session::save");
+
+  // Sessions are saved while the editor runs, so a crash mid-write mustn't
+  // cost the last good one
+  QString temp = path + ".saving";
+  QFile file(temp);
+  if (!file.open(QFile::WriteOnly | QFile::Truncate))
+    return false;
+
+  QByteArray data = toByteArray();
+  bool written = (file.write(data) == data.size());
+  file.close();
+
+  if (written)
+  {
+    QFile::remove(path);
+    written = QFile::rename(temp, path);
+  }
+  if (!written)
+    QFile::remove(temp);
+  return written;
+} // save
\ No newline at end of file
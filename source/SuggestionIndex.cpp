@@ -0,0 +1,196 @@
+#include <QtCore/QPair>
+#include <QtCore/QVarLengthArray>
+#include <QtCore/QtAlgorithms>
+#include "SuggestionIndex.h" // class definition
+
+namespace config
+{
+  /// A word and its distance from the query, ordered nearest first
+  typedef QPair<int, int> Candidate;
+
+  // ====================================================
+  //  CTOR
+  // ====================================================
+  SuggestionIndex::SuggestionIndex(void)
+  {
+  } // ctor
+
+  // ====================================================
+  //  BUILD
+  // ====================================================
+  void SuggestionIndex::build(const QStringList& words)
+  {
+    mWords.clear();
+    foreach (const QString& word, words)
+      mWords.push_back(word.toLower());
+    mWords.sort();
+    mWords.removeDuplicates();
+
+    mNodes.clear();
+    mEdges.clear();
+    if (!mWords.isEmpty())
+    {
+      QVector<int> all(mWords.size());
+      for (int i = 0; i < all.size(); ++i)
+        all[i] = i;
+      buildNode(all);
+    }
+    mNodes.squeeze();
+    mEdges.squeeze();
+  } // build
+
+  // ====================================================
+  //  BUILD NODE
+  // ====================================================
+  int SuggestionIndex::buildNode(const QVector<int>& members)
+  {
+    // The first member becomes the node, and the rest are grouped by their
+    // distance to it, each group becoming a child
+    int index = mNodes.size();
+    Node node = { members[0], 0, 0 };
+    mNodes.push_back(node);
+
+    QVector<Candidate> rest;
+    rest.reserve(members.size() - 1);
+    for (int i = 1; i < members.size(); ++i)
+      rest.push_back(Candidate(distance(mWords[members[0]], mWords[members[i]]), members[i]));
+    qSort(rest);
+
+    // Reserve this node's edges first so they stay contiguous, then fill
+    // them in as the children are built
+    int first = mEdges.size();
+    int count = 0;
+    for (int i = 0; i < rest.size(); ++count)
+    {
+      int d = rest[i].first;
+      while (i < rest.size() && rest[i].first == d)
+        ++i;
+    }
+    mEdges.resize(first + count);
+    mNodes[index].firstEdge = first;
+    mNodes[index].numEdges = count;
+
+    int edge = first;
+    for (int i = 0; i < rest.size(); ++edge)
+    {
+      int d = rest[i].first;
+      QVector<int> group;
+      for (; i < rest.size() && rest[i].first == d; ++i)
+        group.push_back(rest[i].second);
+
+      int child = buildNode(group);
+      mEdges[edge].distance = d;
+      mEdges[edge].child = child;
+    }
+
+    return index;
+  } // buildNode
+
+  // ====================================================
+  //  SUGGEST
+  // ====================================================
+  void SuggestionIndex::suggest(const QString& word, QVector<int>& out, int limit, int maxDistance) const
+  {
+    if (mNodes.isEmpty() || limit <= 0)
+      return;
+
+    // A typo or two in a short word, a few more in a long one
+    QString query = word.toLower();
+    int radius = (maxDistance >= 0 ? maxDistance : qBound(1, (query.size() + 2) / 4, 3));
+
+    QVarLengthArray<Candidate, 16> found;
+    QVarLengthArray<int, 64> stack;
+    stack.append(0);
+    while (!stack.isEmpty())
+    {
+      const Node& n = mNodes[stack[stack.size() - 1]];
+      stack.resize(stack.size() - 1);
+
+      int d = distance(query, mWords[n.word]);
+      if (d <= radius)
+      {
+        // Keep the nearest, and once there are enough of them, only look
+        // for words at least as near as the furthest kept
+        Candidate candidate(d, n.word);
+        int at = found.size();
+        while (at > 0 && candidate < found[at - 1])
+          --at;
+        if (at < limit)
+        {
+          if (found.size() < limit)
+            found.resize(found.size() + 1);
+          for (int i = found.size() - 1; i > at; --i)
+            found[i] = found[i - 1];
+          found[at] = candidate;
+          if (found.size() == limit)
+            radius = found[limit - 1].first;
+        }
+      }
+
+      // Only children within the radius of d can be within it of the query.
+      // Edges are sorted, so a binary search finds the first.
+      int lo = n.firstEdge;
+      int hi = n.firstEdge + n.numEdges;
+      while (lo < hi)
+      {
+        int mid = (lo + hi) / 2;
+        if (mEdges[mid].distance < d - radius)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      for (int e = lo; e < n.firstEdge + n.numEdges && mEdges[e].distance <= d + radius; ++e)
+        stack.append(mEdges[e].child);
+    }
+
+    for (int i = 0; i < found.size(); ++i)
+      out.push_back(found[i].second);
+  } // suggest
+
+  // ====================================================
+  //  WORDS
+  // ====================================================
+  const QStringList& SuggestionIndex::words(void) const
+  {
+    return mWords;
+  } // words
+
+  // ====================================================
+  //  NODE COUNT
+  // ====================================================
+  int SuggestionIndex::nodeCount(void) const
+  {
+    return mNodes.size();
+  } // nodeCount
+
+  // ====================================================
+  //  DISTANCE (static)
+  // ====================================================
+  int SuggestionIndex::distance(const QString& a, const QString& b)
+  {
+    // Two rows of the usual table, which is all keywords ever need on the stack
+    const QChar* s = a.constData();
+    const QChar* t = b.constData();
+    int m = a.size();
+    int n = b.size();
+
+    QVarLengthArray<int, 64> rowA(n + 1);
+    QVarLengthArray<int, 64> rowB(n + 1);
+    int* previous = rowA.data();
+    int* current = rowB.data();
+    for (int j = 0; j <= n; ++j)
+      previous[j] = j;
+
+    for (int i = 1; i <= m; ++i)
+    {
+      current[0] = i;
+      for (int j = 1; j <= n; ++j)
+      {
+        int cost = (s[i - 1] == t[j - 1] ? 0 : 1);
+        current[j] = qMin(qMin(previous[j] + 1, current[j - 1] + 1), previous[j - 1] + cost);
+      }
+      qSwap(previous, current);
+    }
+    return previous[n];
+  } // distance
+} // namespace config
\ No newline at end of file
@@ -1,474 +1,1188 @@
-#include <QtGui/QtGui>
-#include <QtCore/QFile>
-#include <QtCore/QStack>
-#include "TextEditor.h" // class definition
-#include "Highlighter.h"
-
-// ====================================================
-//  CTOR
-// ====================================================
-TextEditor::TextEditor(QWidget* parent)
-  : QTextEdit(parent)
-{
-  mUnsavedChanges = false;
-
-  // Set default format to whatever the first one is
-  QStringList formats = config::ConfigFile::instance()->getAllFormatNames();
-  if (formats.empty() == false)
-    mFormat = formats.first();
-
-  // Create a syntax highlighter for this editor
-  mpHighlighter = new Highlighter(document());
-  mpHighlighter->setFileFormat(mFormat);
-
-  // Set default number of spaces per tab
-  mTabSpaces.fill(' ', 2);
-
-  // Enable drag and drop events
-  setAcceptDrops(true);
-  setWordWrapMode(QTextOption::NoWrap);
-
-  // Connect some local signals
-  connect(this, SIGNAL(textChanged()), this, SLOT(onTextChanged()));
-  connect(this, SIGNAL(cursorPositionChanged()), this, SLOT(onCursorPositionChanged()));
-
-} // ctor
-
-// ====================================================
-//  DTOR
-// ====================================================
-TextEditor::~TextEditor(void)
-{
-} // dtor
-
-// ====================================================
-//  HAS UNSAVED CHANGES
-// ====================================================
-bool TextEditor::hasUnsavedChanges() const
-{
-  return mUnsavedChanges;
-} // hasUnsavedChanges
-
-// ====================================================
-//  SET TAB SPACES
-// ====================================================
-void TextEditor::setTabSpaces(int spaces)
-{
-  if (spaces > 0)
-    mTabSpaces.fill(' ', spaces);
-} // setTabSpaces
-
-// ====================================================
-//  LOAD
-// ====================================================
-bool TextEditor::load(const QString& path)
-{
-  bool loaded = false;
-
-  QFile file(path);
-  if (file.open(QFile::ReadOnly | QFile::Text))
-  {
-    // Load the proper format based on the file extension
-    QFileInfo fi(file);
-    mFormat = config::ConfigFile::instance()->getFormatByExtension(fi.suffix());
-    mpHighlighter->setFileFormat(mFormat);
-
-    // Read the file
-    setPlainText(file.readAll());
-    file.close();
-
-    // This gets set to true when setPlainText() is called because the
-    // text changes, but we just loaded the file so there's obviously
-    // no unsaved changes.  Reset this flag.
-    mUnsavedChanges = false;
-    loaded = true;
-  }
-
-  return loaded;
-} // load
-
-// ====================================================
-//  SAVE
-// ====================================================
-bool TextEditor::save(const QString& path)
-{
-  bool saved = false;
-
-  QFile file(path);
-  if (file.open(QFile::WriteOnly | QFile::Text))
-  {
-    // Write the file
-    file.write(toPlainText().toAscii());
-    file.close();
-
-    mUnsavedChanges = false;
-    saved = true;
-  }
-
-  return saved;
-} // save
-
-// ====================================================
-//  GET LINE
-// ====================================================
-QString TextEditor::getLine(int lineNumber) const
-{
-  QTextCursor cursor(document());
-
-  // Move to the necessary line
-  if (lineNumber > 0)
-  {
-    if (cursor.movePosition(QTextCursor::Down, QTextCursor::MoveAnchor, lineNumber) == false)
-      return QString::null;
-    cursor.movePosition(QTextCursor::StartOfLine);
-  }
-
-  cursor.anchor();
-  cursor.movePosition(QTextCursor::EndOfLine, QTextCursor::KeepAnchor);
-  return cursor.selectedText();
-} // getLine
-
-// ====================================================
-//  CURRENT LINE NUMBER
-// ====================================================
-int TextEditor::currentLineNumber(void) const
-{
-  return toPlainText().left(textCursor().position()).count("\n");
-} // currentLineNumber
-
-// ====================================================
-//  REPLACE LINE
-// ====================================================
-bool TextEditor::replaceLine(int lineNumber, const QString& str)
-{
-  bool replaced = true;
-
-  QTextCursor cursor(document());
-
-  // Move to the necessary line
-  bool inPlace = true;
-  if (lineNumber > 0)
-  {
-    if (cursor.movePosition(QTextCursor::Down, QTextCursor::MoveAnchor, lineNumber) == false)
-      inPlace = false;
-    else
-      cursor.movePosition(QTextCursor::StartOfLine);
-  }
-
-  // If the cursor is in place, select the entire line, remove it, and insert
-  // the new line
-  if (inPlace)
-  {
-    cursor.anchor();
-    cursor.movePosition(QTextCursor::EndOfLine, QTextCursor::KeepAnchor);
-    cursor.removeSelectedText();
-    cursor.insertText(str);
-
-    replaced = true;
-  }
-
-  return replaced;
-} // replaceLine
-
-// ====================================================
-//  LINE NUMBER AT POS
-// ====================================================
-int TextEditor::lineNumberAtPos(int pos)
-{
-  return toPlainText().left(pos).count("\n");
-} // lineNumberAtPos
-
-// ====================================================
-//  SET FILE FORMAT
-// ====================================================
-void TextEditor::setFileFormat(const QString& format)
-{
-  if (format != mFormat)
-  {
-    mFormat = format;
-    mpHighlighter->setFileFormat(mFormat);
-  }
-} // setFileFormat
-
-// ====================================================
-//  KEY PRESS EVENT (inherited)
-// ====================================================
-void TextEditor::keyPressEvent(QKeyEvent* event)
-{
-  int k = event->key();
-  
-  // Enter (Auto Indent)
-  if (event->key() == Qt::Key_Enter || event->key() == Qt::Key_Return)
-  {
-    // If Ctrl+Enter is pressed, insert a newline at the beginning of this
-    // line and move the cursor up one line.
-    if (event->modifiers() & Qt::ControlModifier)
-    {
-      // Move cursor to the begining of the line
-      QTextCursor cursor = textCursor();
-      cursor.movePosition(QTextCursor::StartOfLine);
-      setTextCursor(cursor);
-
-      // Insert a new line
-      insertPlainText("\n");
-
-      // Move cursor up one line
-      cursor.movePosition(QTextCursor::Up);
-      setTextCursor(cursor);
-    }
-    else
-    {
-      // Pass through (normal behavior)
-      QTextEdit::keyPressEvent(event);
-    }
-    
-    // Insert appropriate number of spaces
-    int numIndent = getNumIndent();
-    insertPlainText(QString().fill(' ', numIndent));
-  }
-
-  // Tab (but not CTRL+Tab)
-  else if (event->key() == Qt::Key_Tab)
-  {
-    if (!(event->modifiers() & Qt::ControlModifier))
-    {
-      // If there is a selection highlighted, indent it
-      if (textCursor().hasSelection())
-          increaseIndent();
-
-      // Insert spaces instead of tabs
-      else
-        insertPlainText(mTabSpaces);
-    }
-  }
-
-  // Back Tab (Shift+Tab...handled seperately from Tab by Qt)
-  else if (event->key() == Qt::Key_Backtab)
-  {
-    // If there is a selection highlighted, decrease its indentation
-    if (textCursor().hasSelection())
-      decreaseIndent();
-  }
-
-  // Brace Match
-  else if (event->key() == Qt::Key_BraceRight)
-  {
-    matchBraces();
-  }
-
-  // Pass Through
-  else
-  {
-    QTextEdit::keyPressEvent(event);
-  }
-
-  // emit signal
-  emit keyPressed(event);
-} // keyPressEvent
-
-// ====================================================
-//  GET NUM INDENT
-// ====================================================
-int TextEditor::getNumIndent(bool toPrevBraceOnly)
-{
-  QTextCursor cursor = textCursor();
-  int cursorPos = cursor.position();
-	int retval = 0;
-  QStack<int> openBraces;
-	
-  // Find the position of the last un-closed left brace {
-	QString str = toPlainText();
-	for (int i = 0; i < cursorPos; i++)
-	{
-		char ch = str[i].toAscii();
-
-		// Skip comments
-		if (ch == '/' && str[i+1] == '/')
-			while (str[i] != '\n' && i < cursorPos) i++;
-
-    // Open brace
-		else if (ch == '{')
-      openBraces.push(i);
-
-    // Close brace
-		else if (ch == '}')
-    {
-      if (openBraces.empty() == false)
-			  openBraces.pop();
-    }
-	}
-
-  // If there's any open braces left, get the indentation of the last one
-  if (openBraces.empty() == false)
-  {
-    int lastOpenBrace = openBraces.pop();
-    int lastNewLine = str.lastIndexOf('\n', lastOpenBrace);
-
-    // Get indentation of the last open brace
-    retval = (lastOpenBrace - (lastNewLine+1));
-
-    // If toPrevBraceOnly is false, include the tab indentation
-    if (!toPrevBraceOnly)
-	    retval += mTabSpaces.length();
-  }
-
-  return retval;
-} // getNumIndent
-
-// ====================================================
-//  MATCH BRACES
-// ====================================================
-void TextEditor::matchBraces()
-{
-  // Get the string between the current cursor pos and the previous line.  If it's
-  // just whitespace, remove it and auto indent.
-  QTextCursor cursor(textCursor());
-  QString str = toPlainText();
-  int cPos = cursor.position();
-  int prevNewLine = str.lastIndexOf('\n', cursor.position()-1);
-  if (prevNewLine != -1)
-  {
-    QString trimmed = str.mid(prevNewLine, cursor.position()-prevNewLine).trimmed();
-    if (trimmed.isEmpty())
-    {
-      // If trimmed is not empty, that means there's something other than whitespace
-      // between the current cursor pos and the previous line, so remove it and auto
-      // indent.
-      cursor.anchor();
-      if (cursor.movePosition(QTextCursor::StartOfLine, QTextCursor::KeepAnchor))
-      {
-        cursor.removeSelectedText();
-      }
-      //cursor.setPosition(lastEndLine+1);
-      setTextCursor(cursor);
-
-      int numIndent = getNumIndent(true);
-      insertPlainText(QString().fill(' ', numIndent));
-    }
-  }  
-  
-  // Insert the closing brace
-  insertPlainText("}");
-} // matchBraces
-
-// ====================================================
-//  CAN INSERT FROM MIME DATA (inherited)
-// ====================================================
-bool TextEditor::canInsertFromMimeData(const QMimeData* source) const
-{
-  return source->hasUrls() || QTextEdit::canInsertFromMimeData(source);
-} // canInsertFromMimeData
-
-// ====================================================
-//  INSERT FROM MIME DATA (inherited)
-// ====================================================
-void TextEditor::insertFromMimeData(const QMimeData* source)
-{
-  if (source->hasUrls())
-  {
-    QList<QUrl> urls = source->urls();
-    foreach (QUrl url, urls)
-      emit fileDropped(url.toLocalFile());
-  }
-} // insertFromMimeData
-
-// ====================================================
-//  ON TEXT CHANGED (slot)
-// ====================================================
-void TextEditor::onTextChanged(void)
-{
-  mUnsavedChanges = true;
-} // onTextChanged
-
-// ====================================================
-//  ON CURSOR POSITION CHANGED (slot)
-// ====================================================
-void TextEditor::onCursorPositionChanged(void)
-{
-  // Get the first word on this line
-  QTextCursor cursor = textCursor();
-  cursor.movePosition(QTextCursor::StartOfLine);
-  int startPos = cursor.position();
-  cursor.movePosition(QTextCursor::EndOfWord, QTextCursor::KeepAnchor);
-
-  // If the cursor didn't move, then we need to move to the beginning
-  // of the next word
-  if (cursor.position() == startPos)
-  {
-    cursor.movePosition(QTextCursor::NextWord);
-    cursor.movePosition(QTextCursor::EndOfWord, QTextCursor::KeepAnchor);
-  }
-  
-  QString keyword = cursor.selectedText();
-  
-  // If the focused keyword changed, emit keywordChanged() signal
-  if (keyword != mFocusedKeyword)
-  {
-    mFocusedKeyword = keyword;
-    emit keywordChanged(mFocusedKeyword, mFormat);
-  }
-
-} // onCursorPositionChanged
-
-// ====================================================
-//  INCREASE INDENT (slot)
-// ====================================================
-void TextEditor::increaseIndent(void)
-{
-  QTextCursor cursor = textCursor();
-  int start = cursor.selectionStart();
-  int end = cursor.selectionEnd();
-  
-  // Move the cursor to the start of the selection, and then to the
-  // begining of that line
-  cursor.setPosition(start);
-  cursor.movePosition(QTextCursor::StartOfLine);
-  
-  // Until we reach the end of the document or past the end of the 
-  // selection, insert a tab and then move to the next line
-  while (cursor.position() < end && cursor.position() >= 0)
-  {
-    cursor.insertText(mTabSpaces);
-    cursor.movePosition(QTextCursor::EndOfLine);
-    cursor.movePosition(QTextCursor::NextCharacter);
-    end += mTabSpaces.length();
-  }
-  
-} // increaseIndent
-
-// ====================================================
-//  DECREASE INDENT (slot)
-// ====================================================
-void TextEditor::decreaseIndent(void)
-{
-  static QChar qCh(' ');
-  QTextCursor cursor = textCursor();
-  
-  // Find out how many lines are selected
-  int startPos = cursor.selectionStart();
-  int endPos = cursor.selectionEnd();
-  int lineStart = lineNumberAtPos(startPos);
-  int lineEnd = lineNumberAtPos(endPos);
-
-  for (int i = lineStart; i <= lineEnd; ++i)
-  {
-    // Get the line
-    QString line = getLine(i);
-
-    // Figure out how many spaces to remove
-    int length = std::min(mTabSpaces.length(), line.length());
-    int spaces = 0;
-    for (; spaces < length; ++spaces)
-    {
-      if (line[spaces].isSpace() == false)
-        break;
-    }
-
-    // Remove the spaces
-    if (spaces > 0)
-    {
-      line.remove(0, spaces);
-      replaceLine(i, line);
-    }
-  }
+#include <QtGui/QtGui>
+#include <QtCore/QFile>
+#include <QtCore/QStack>
+#include <cstring>
+#include "TextEditor.h" // class definition
+#include "Highlighter.h"
+#include "Autocompleter.h"
+#include "Diagnostics.h"
+#include "LineDiff.h"
+#include "Trace.h"
+#include "Metrics.h"
+
+/// Width of the strip beside the text that holds the fold markers, in pixels
+static const int FOLD_GUTTER_WIDTH = 14;
+
+/// Longest that restyling after the rules were reloaded may hold up the
+/// event loop at a time, in milliseconds
+static const int RESTYLE_SLICE = 4;
+
+// ====================================================
+//  HAS LONG LINE (local)
+// ====================================================
+static bool hasLongLine(const char* data, qint64 size, qint64 limit)
+{
+  // Stops at the first line over the limit, so a minified script is turned
+  // away after reading no more than its first line
+  const char* end = data + size;
+  while (end - data > limit)
+  {
+    const char* newline = static_cast<const char*>(memchr(data, '\n', static_cast<size_t>(limit + 1)));
+    if (newline == NULL)
+      return true;
+    data = newline + 1;
+  }
+  return false;
+} // hasLongLine
+
+// ====================================================
+//  DEPTH AFTER (local)
+// ====================================================
+/** @returns The number of braces open at the end of \e block, as the
+ * highlighter last found it. */
+static int depthAfter(const QTextBlock& block)
+{
+  BlockData* data = (block.isValid() ? Highlighter::blockData(block) : NULL);
+  return (data ? data->state.stack.size() : 0);
+} // depthAfter
+
+// ====================================================
+//  OPENS SCOPE (local)
+// ====================================================
+static bool opensScope(const QTextBlock& block)
+{
+  return depthAfter(block) > depthAfter(block.previous());
+} // opensScope
+
+// ====================================================
+//  IS STATEMENT LINE (local)
+// ====================================================
+/** @returns TRUE if \e block has something on it and leaves the brace
+ * depth as it was, like the keyword line before a brace. */
+static bool isStatementLine(const QTextBlock& block)
+{
+  return depthAfter(block) == depthAfter(block.previous()) && !block.text().trimmed().isEmpty();
+} // isStatementLine
+
+// ====================================================
+//  STARTS WITH BRACE (local)
+// ====================================================
+static bool startsWithBrace(const QTextBlock& block)
+{
+  return block.text().trimmed().startsWith('{');
+} // startsWithBrace
+
+// ====================================================
+//  FOLD GUTTER (local)
+// ====================================================
+/** The strip down the left of a TextEditor with a box on each line that
+ * starts a scope, clicked to fold or unfold it. */
+class FoldGutter : public QWidget
+{
+public:
+  FoldGutter(TextEditor* editor)
+    : QWidget(editor), mpEditor(editor) {}
+
+protected:
+  void paintEvent(QPaintEvent* event)
+  {
+    QPainter painter(this);
+    painter.fillRect(event->rect(), palette().color(QPalette::Window));
+    painter.setPen(palette().color(QPalette::Dark));
+
+    QAbstractTextDocumentLayout* layout = mpEditor->document()->documentLayout();
+    int offset = mpEditor->verticalScrollBar()->value();
+    int size = 8;
+    QTextBlock block = mpEditor->cursorForPosition(QPoint(0, 0)).block();
+    for (; block.isValid(); block = block.next())
+    {
+      if (!block.isVisible())
+        continue;
+
+      QRectF rect = layout->blockBoundingRect(block);
+      int top = qRound(rect.top()) - offset;
+      if (top > height())
+        break;
+      if (!mpEditor->isFoldHeader(block))
+        continue;
+
+      // A minus to fold the scope, or a plus to unfold it
+      int lineHeight = (block.layout()->lineCount() > 0 ? qRound(block.layout()->lineAt(0).height()) : qRound(rect.height()));
+      QRect box((width() - size) / 2, top + (lineHeight - size) / 2, size, size);
+      painter.drawRect(box);
+      painter.drawLine(box.left() + 2, box.center().y(), box.right() - 2, box.center().y());
+      if (mpEditor->isFolded(block))
+        painter.drawLine(box.center().x(), box.top() + 2, box.center().x(), box.bottom() - 2);
+    }
+  }
+
+  void mousePressEvent(QMouseEvent* event)
+  {
+    QTextBlock block = mpEditor->cursorForPosition(QPoint(0, event->pos().y())).block();
+    if (mpEditor->isFoldHeader(block))
+      mpEditor->setFolded(block, !mpEditor->isFolded(block));
+  }
+
+private:
+  TextEditor* mpEditor;
+};
+
+// ====================================================
+//  CTOR
+// ====================================================
+TextEditor::TextEditor(QWidget* parent)
+  : QTextEdit(parent)
+{
+  mUnsavedChanges = false;
+  mFileHash = 0;
+
+  // Set default format to whatever the first one is
+  QStringList formats = config::ConfigFile::instance()->getAllFormatNames();
+  if (formats.empty() == false)
+    mFormat = formats.first();
+
+  // Create a syntax highlighter for this editor
+  mpHighlighter = new Highlighter(document());
+  mpHighlighter->setFileFormat(mFormat);
+
+  // Suggest words as they are typed
+  mpAutocompleter = new Autocompleter(this);
+
+  // Check the document as it's edited, after the highlighter has seen each edit
+  mpDiagnostics = new Diagnostics(this);
+
+  // Make room for the fold markers
+  mpFoldGutter = new FoldGutter(this);
+  setViewportMargins(FOLD_GUTTER_WIDTH, 0, 0, 0);
+  connect(verticalScrollBar(), SIGNAL(valueChanged(int)), mpFoldGutter, SLOT(update()));
+  connect(document()->documentLayout(), SIGNAL(update(const QRectF&)), mpFoldGutter, SLOT(update()));
+
+  // Restyle the document a slice at a time once the rules are reloaded
+  mRestyleBlock = 0;
+  mRestyleLeft = 0;
+  mpRestyleTimer = new QTimer(this);
+  connect(mpRestyleTimer, SIGNAL(timeout()), this, SLOT(restyle()));
+
+  // Set default number of spaces per tab
+  mTabSpaces.fill(' ', 2);
+
+  // Enable drag and drop events
+  setAcceptDrops(true);
+  setWordWrapMode(QTextOption::NoWrap);
+
+  // Connect some local signals
+  connect(this, SIGNAL(textChanged()), this, SLOT(onTextChanged()));
+  connect(this, SIGNAL(cursorPositionChanged()), this, SLOT(onCursorPositionChanged()));
+  connect(document(), SIGNAL(contentsChange(int, int, int)), this, SLOT(onContentsChange(int, int, int)));
+
+} // ctor
+
+// ====================================================
+//  DTOR
+// ====================================================
+TextEditor::~TextEditor(void)
+{
+} // dtor
+
+// ====================================================
+//  CAN LAY OUT (static)
+// ====================================================
+bool TextEditor::canLayOut(const QString& path, bool* longLines)
+{
+  if (longLines)
+    *longLines = false;
+
+  QFile file(path);
+  if (file.size() > MAX_FILE_SIZE)
+    return false;
+  if (file.size() <= MAX_LINE_LENGTH || !file.open(QFile::ReadOnly))
+    return true;
+
+  // Map the file rather than reading it, since it's only scanned once
+  uchar* data = file.map(0, file.size());
+  if (data == NULL)
+    return canLayOut(file.readAll(), longLines);
+
+  bool tooLong = hasLongLine(reinterpret_cast<const char*>(data), file.size(), MAX_LINE_LENGTH);
+  file.unmap(data);
+
+  if (longLines)
+    *longLines = tooLong;
+  return !tooLong;
+} // canLayOut
+
+// ====================================================
+//  CAN LAY OUT (static)
+// ====================================================
+bool TextEditor::canLayOut(const QByteArray& text, bool* longLines)
+{
+  bool tooLong = hasLongLine(text.constData(), text.size(), MAX_LINE_LENGTH);
+  if (longLines)
+    *longLines = tooLong;
+  return !tooLong && text.size() <= MAX_FILE_SIZE;
+} // canLayOut
+
+// ====================================================
+//  HAS UNSAVED CHANGES
+// ====================================================
+bool TextEditor::hasUnsavedChanges() const
+{
+  return mUnsavedChanges;
+} // hasUnsavedChanges
+
+// ====================================================
+//  SET TAB SPACES
+// ====================================================
+void TextEditor::setTabSpaces(int spaces)
+{
+  if (spaces > 0)
+    mTabSpaces.fill(' ', spaces);
+} // setTabSpaces
+
+// ====================================================
+//  LOAD
+// ====================================================
+bool TextEditor::load(const QString& path, const HighlightCache* cache)
+{
+  TRACE_SCOPE("TextEditor::load");
+
+  bool loaded = false;
+
+  QFile file(path);
+  if (file.open(QFile::ReadOnly | QFile::Text))
+  {
+    // Load the proper format based on the file extension
+    QFileInfo fi(file);
+    mFormat = config::ConfigFile::instance()->getFormatByExtension(fi.suffix());
+    mpHighlighter->setFileFormat(mFormat);
+
+    // Read the file.  Saved highlighting is used if it's of this text,
+    // highlighted the same way.
+    QString text = file.readAll();
+    file.close();
+    mFileHash = HighlightCache::hash(text);
+    bool cached = (cache && cache->fileHash == mFileHash && cache->format == mFormat &&
+                   cache->rulesStamp == config::ConfigFile::instance()->getRulesStamp());
+
+    if (cached)
+      mpHighlighter->setCache(cache);
+    setPlainText(text);
+    mpHighlighter->setCache(NULL);
+
+    // This gets set to true when setPlainText() is called because the
+    // text changes, but we just loaded the file so there's obviously
+    // no unsaved changes.  Reset this flag.
+    mUnsavedChanges = false;
+    loaded = true;
+  }
+
+  return loaded;
+} // load
+
+// ====================================================
+//  RELOAD
+// ====================================================
+int TextEditor::reload(const QString& path)
+{
+  TRACE_SCOPE("TextEditor::reload");
+
+  QFile file(path);
+  if (!file.open(QFile::ReadOnly | QFile::Text))
+    return -1;
+
+  // Split the file the way setPlainText() would into blocks, and compare the
+  // lines with the document's
+  QString text = file.readAll();
+  file.close();
+  mFileHash = HighlightCache::hash(text);
+  QStringList lines = text.split('\n');
+
+  QVector<quint64> newLines(lines.size());
+  for (int i = 0; i < lines.size(); ++i)
+    newLines[i] = LineDiff::hashLine(lines[i]);
+
+  QTextDocument* doc = document();
+  QVector<quint64> oldLines;
+  oldLines.reserve(doc->blockCount());
+  for (QTextBlock block = doc->begin(); block.isValid(); block = block.next())
+    oldLines.push_back(LineDiff::hashLine(block.text()));
+
+  QVector<DiffHunk> hunks = LineDiff::compare(oldLines, newLines);
+  int changed = 0;
+  if (!hunks.isEmpty())
+  {
+    int hScroll = horizontalScrollBar()->value();
+    int vScroll = verticalScrollBar()->value();
+
+    // Replace the hunks from the bottom up, so the block numbers of the ones
+    // above stay valid.  Only the replaced blocks are rehighlighted.
+    QTextCursor cursor(doc);
+    cursor.beginEditBlock();
+    for (int i = hunks.size() - 1; i >= 0; --i)
+    {
+      const DiffHunk& hunk = hunks[i];
+      QString replacement = QStringList(lines.mid(hunk.newStart, hunk.newCount)).join("\n");
+      int end = hunk.oldStart + hunk.oldCount;
+
+      if (end < doc->blockCount())
+      {
+        // Replace whole lines, up to the start of the next kept one
+        cursor.setPosition(doc->findBlockByNumber(hunk.oldStart).position());
+        cursor.setPosition(doc->findBlockByNumber(end).position(), QTextCursor::KeepAnchor);
+        if (hunk.newCount > 0)
+          replacement += '\n';
+      }
+      else if (hunk.oldStart > 0)
+      {
+        // The hunk runs to the end of the document, which has no line break
+        // to replace, so take the one before it instead
+        QTextBlock previous = doc->findBlockByNumber(hunk.oldStart - 1);
+        cursor.setPosition(previous.position() + previous.length() - 1);
+        cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+        if (hunk.newCount > 0)
+          replacement.prepend('\n');
+      }
+      else
+      {
+        cursor.select(QTextCursor::Document);
+      }
+
+      if (replacement.isEmpty())
+        cursor.removeSelectedText();
+      else
+        cursor.insertText(replacement);
+      changed += qMax(hunk.oldCount, hunk.newCount);
+    }
+    cursor.endEditBlock();
+
+    horizontalScrollBar()->setValue(hScroll);
+    verticalScrollBar()->setValue(vScroll);
+  }
+
+  // The document matches the file again
+  mUnsavedChanges = false;
+  return changed;
+} // reload
+
+// ====================================================
+//  SAVE
+// ====================================================
+bool TextEditor::save(const QString& path)
+{
+  TRACE_SCOPE("TextEditor::save");
+
+  bool saved = false;
+
+  QFile file(path);
+  if (file.open(QFile::WriteOnly | QFile::Text))
+  {
+    // Write the file
+    QString text = toPlainText();
+    file.write(text.toAscii());
+    file.close();
+    mFileHash = HighlightCache::hash(text);
+
+    mUnsavedChanges = false;
+    saved = true;
+  }
+
+  return saved;
+} // save
+
+// ====================================================
+//  FILE HASH
+// ====================================================
+quint64 TextEditor::fileHash(void) const
+{
+  return mFileHash;
+} // fileHash
+
+// ====================================================
+//  HIGHLIGHT CACHE
+// ====================================================
+HighlightCache TextEditor::highlightCache(void) const
+{
+  HighlightCache cache = Highlighter::capture(document());
+  cache.fileHash = mFileHash;
+  cache.format = mFormat;
+  cache.rulesStamp = config::ConfigFile::instance()->getRulesStamp();
+
+  // Blocks not restyled yet still have the formats of the old rules
+  if (mRestyleLeft > 0)
+    cache.rulesStamp = 0;
+  return cache;
+} // highlightCache
+
+// ====================================================
+//  ESTIMATED MEMORY
+// ====================================================
+qint64 TextEditor::estimatedMemory(void) const
+{
+  // QTextDocument doesn't report its memory use, so estimate it from the
+  // text itself plus a fixed cost for each block's layout and fragments.
+  static const qint64 BLOCK_OVERHEAD = 256;
+
+  QTextDocument* doc = document();
+  return doc->characterCount() * sizeof(QChar) +
+         doc->blockCount() * BLOCK_OVERHEAD +
+         mpHighlighter->ruleMemory();
+} // estimatedMemory
+
+// ====================================================
+//  HIGHLIGHTER
+// ====================================================
+Highlighter* TextEditor::highlighter(void) const
+{
+  return mpHighlighter;
+} // highlighter
+
+// ====================================================
+//  DIAGNOSTICS
+// ====================================================
+Diagnostics* TextEditor::diagnostics(void) const
+{
+  return mpDiagnostics;
+} // diagnostics
+
+// ====================================================
+//  FILE FORMAT
+// ====================================================
+const QString& TextEditor::fileFormat(void) const
+{
+  return mFormat;
+} // fileFormat
+
+// ====================================================
+//  GET LINE
+// ====================================================
+QString TextEditor::getLine(int lineNumber) const
+{
+  QTextCursor cursor(document());
+
+  // Move to the necessary line
+  if (lineNumber > 0)
+  {
+    if (cursor.movePosition(QTextCursor::Down, QTextCursor::MoveAnchor, lineNumber) == false)
+      return QString::null;
+    cursor.movePosition(QTextCursor::StartOfLine);
+  }
+
+  cursor.anchor();
+  cursor.movePosition(QTextCursor::EndOfLine, QTextCursor::KeepAnchor);
+  return cursor.selectedText();
+} // getLine
+
+// ====================================================
+//  CURRENT LINE NUMBER
+// ====================================================
+int TextEditor::currentLineNumber(void) const
+{
+  return toPlainText().left(textCursor().position()).count("\n");
+} // currentLineNumber
+
+// ====================================================
+//  REPLACE LINE
+// ====================================================
+bool TextEditor::replaceLine(int lineNumber, const QString& str)
+{
+  bool replaced = true;
+
+  QTextCursor cursor(document());
+
+  // Move to the necessary line
+  bool inPlace = true;
+  if (lineNumber > 0)
+  {
+    if (cursor.movePosition(QTextCursor::Down, QTextCursor::MoveAnchor, lineNumber) == false)
+      inPlace = false;
+    else
+      cursor.movePosition(QTextCursor::StartOfLine);
+  }
+
+  // If the cursor is in place, select the entire line, remove it, and insert
+  // the new line
+  if (inPlace)
+  {
+    cursor.anchor();
+    cursor.movePosition(QTextCursor::EndOfLine, QTextCursor::KeepAnchor);
+    cursor.removeSelectedText();
+    cursor.insertText(str);
+
+    replaced = true;
+  }
+
+  return replaced;
+} // replaceLine
+
+// ====================================================
+//  LINE NUMBER AT POS
+// ====================================================
+int TextEditor::lineNumberAtPos(int pos)
+{
+  return toPlainText().left(pos).count("\n");
+} // lineNumberAtPos
+
+// ====================================================
+//  SET FILE FORMAT
+// ====================================================
+void TextEditor::setFileFormat(const QString& format)
+{
+  if (format != mFormat)
+  {
+    mFormat = format;
+    mpHighlighter->setFileFormat(mFormat);
+    mpDiagnostics->revalidate();
+  }
+} // setFileFormat
+
+// ====================================================
+//  RELOAD RULES
+// ====================================================
+void TextEditor::reloadRules(void)
+{
+  mpHighlighter->reloadRules(mFormat);
+  mpDiagnostics->revalidate();
+
+  // paintEvent() restyles the blocks in view, and restyle() the rest,
+  // starting from the top of the view and wrapping around
+  viewport()->update();
+  mRestyleBlock = cursorForPosition(QPoint(0, 0)).blockNumber();
+  mRestyleLeft = document()->blockCount();
+  if (isVisible())
+    mpRestyleTimer->start();
+} // reloadRules
+
+// ====================================================
+//  RESTYLE (slot)
+// ====================================================
+void TextEditor::restyle(void)
+{
+  TRACE_SCOPE("TextEditor::restyle");
+
+  // A hidden editor carries on when it's shown again
+  if (!isVisible())
+  {
+    mpRestyleTimer->stop();
+    return;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+
+  // Edits since the rules were reloaded may have moved the blocks about,
+  // which only changes the order the stale ones are found in
+  QTextBlock block = document()->findBlockByNumber(mRestyleBlock);
+  while (mRestyleLeft > 0 && timer.nsecsElapsed() < RESTYLE_SLICE * 1000000LL)
+  {
+    if (!block.isValid())
+      block = document()->begin();
+
+    // Folded blocks are highlighted as they're shown
+    BlockData* data = Highlighter::blockData(block);
+    if (data && data->stale && block.isVisible())
+      mpHighlighter->rehighlightBlock(block);
+
+    block = block.next();
+    --mRestyleLeft;
+  }
+
+  mRestyleBlock = (block.isValid() ? block.blockNumber() : 0);
+  if (mRestyleLeft <= 0)
+    mpRestyleTimer->stop();
+} // restyle
+
+// ====================================================
+//  KEY PRESS EVENT (inherited)
+// ====================================================
+void TextEditor::keyPressEvent(QKeyEvent* event)
+{
+  TRACE_SCOPE("TextEditor::keyPressEvent");
+
+  QElapsedTimer timer;
+  timer.start();
+
+  int k = event->key();
+
+  // Let the completion popup have the keys that choose or dismiss a completion
+  if (mpAutocompleter->isPopupVisible())
+  {
+    if (k == Qt::Key_Enter || k == Qt::Key_Return || k == Qt::Key_Escape || 
+        k == Qt::Key_Tab || k == Qt::Key_Backtab)
+    {
+      event->ignore();
+      return;
+    }
+  }
+  
+  // Complete (CTRL+Space)
+  if (event->key() == Qt::Key_Space && (event->modifiers() & Qt::ControlModifier))
+  {
+    mpAutocompleter->update(true);
+  }
+
+  // Enter (Auto Indent)
+  else if (event->key() == Qt::Key_Enter || event->key() == Qt::Key_Return)
+  {
+    // If Ctrl+Enter is pressed, insert a newline at the beginning of this
+    // line and move the cursor up one line.
+    if (event->modifiers() & Qt::ControlModifier)
+    {
+      // Move cursor to the begining of the line
+      QTextCursor cursor = textCursor();
+      cursor.movePosition(QTextCursor::StartOfLine);
+      setTextCursor(cursor);
+
+      // Insert a new line
+      insertPlainText("\n");
+
+      // Move cursor up one line
+      cursor.movePosition(QTextCursor::Up);
+      setTextCursor(cursor);
+    }
+    else
+    {
+      // Pass through (normal behavior)
+      QTextEdit::keyPressEvent(event);
+    }
+    
+    // Insert appropriate number of spaces
+    int numIndent = getNumIndent();
+    insertPlainText(QString().fill(' ', numIndent));
+  }
+
+  // Tab (but not CTRL+Tab)
+  else if (event->key() == Qt::Key_Tab)
+  {
+    if (!(event->modifiers() & Qt::ControlModifier))
+    {
+      // If there is a selection highlighted, indent it
+      if (textCursor().hasSelection())
+          increaseIndent();
+
+      // Insert spaces instead of tabs
+      else
+        insertPlainText(mTabSpaces);
+    }
+  }
+
+  // Back Tab (Shift+Tab...handled seperately from Tab by Qt)
+  else if (event->key() == Qt::Key_Backtab)
+  {
+    // If there is a selection highlighted, decrease its indentation
+    if (textCursor().hasSelection())
+      decreaseIndent();
+  }
+
+  // Brace Match
+  else if (event->key() == Qt::Key_BraceRight)
+  {
+    mpAutocompleter->hidePopup();
+    matchBraces();
+  }
+
+  // Pass Through
+  else
+  {
+    QTextEdit::keyPressEvent(event);
+
+    // Keep the completions in step with what's typed
+    if (!event->text().isEmpty() || mpAutocompleter->isPopupVisible())
+      mpAutocompleter->update();
+  }
+
+  // emit signal
+  emit keyPressed(event);
+
+  // Highlighting and the status bar update synchronously, so they are
+  // included in the latency
+  static metrics::Metric* latency = metrics::Registry::instance()->metric("editor.keystroke_ms");
+  latency->sample(timer.nsecsElapsed() / 1000000.0);
+} // keyPressEvent
+
+// ====================================================
+//  PAINT EVENT (inherited)
+// ====================================================
+void TextEditor::paintEvent(QPaintEvent* event)
+{
+  // Painting is where QTextEdit lays out whatever part of the document has
+  // changed, so this covers document layout as well.
+  TRACE_SCOPE("TextEditor::paintEvent");
+
+  QAbstractTextDocumentLayout* layout = document()->documentLayout();
+  int top = verticalScrollBar()->value();
+  int bottom = top + viewport()->height();
+  QTextBlock first = cursorForPosition(QPoint(0, 0)).block();
+
+  // Blocks that were highlighted while they were folded away get their
+  // formats as they come into view
+  for (QTextBlock block = first; block.isValid(); block = block.next())
+  {
+    if (!block.isVisible())
+      continue;
+    if (layout->blockBoundingRect(block).top() > bottom)
+      break;
+
+    BlockData* data = Highlighter::blockData(block);
+    if (data && data->stale)
+      mpHighlighter->rehighlightBlock(block);
+  }
+
+  QTextEdit::paintEvent(event);
+
+  // Mark the end of each folded line, so it's clear that there is more
+  QPainter painter(viewport());
+  painter.setPen(palette().color(QPalette::Dark));
+  QFontMetrics metrics(font());
+  int left = horizontalScrollBar()->value();
+  for (QTextBlock block = first; block.isValid(); block = block.next())
+  {
+    if (!block.isVisible())
+      continue;
+    QRectF rect = layout->blockBoundingRect(block);
+    if (rect.top() > bottom)
+      break;
+    if (!isFolded(block) || block.layout()->lineCount() == 0)
+      continue;
+
+    QTextLine line = block.layout()->lineAt(0);
+    QRect box(qRound(rect.left() + line.naturalTextWidth()) + metrics.width(' ') - left,
+              qRound(rect.top()) - top + 1, metrics.width("...") + 4, qRound(line.height()) - 2);
+    painter.drawRect(box);
+    painter.drawText(box, Qt::AlignCenter, "...");
+  }
+} // paintEvent
+
+// ====================================================
+//  RESIZE EVENT (inherited)
+// ====================================================
+void TextEditor::resizeEvent(QResizeEvent* event)
+{
+  QTextEdit::resizeEvent(event);
+
+  QRect rect = contentsRect();
+  mpFoldGutter->setGeometry(rect.left(), rect.top(), FOLD_GUTTER_WIDTH, rect.height());
+} // resizeEvent
+
+// ====================================================
+//  SHOW EVENT (inherited)
+// ====================================================
+void TextEditor::showEvent(QShowEvent* event)
+{
+  QTextEdit::showEvent(event);
+
+  if (mRestyleLeft > 0)
+    mpRestyleTimer->start();
+} // showEvent
+
+// ====================================================
+//  IS FOLD HEADER
+// ====================================================
+bool TextEditor::isFoldHeader(const QTextBlock& block) const
+{
+  if (!block.isValid())
+    return false;
+
+  // A keyword line followed by the brace it opens
+  QTextBlock next = block.next();
+  if (isStatementLine(block) && next.isValid() && startsWithBrace(next) && opensScope(next))
+    return true;
+
+  // A line that opens a brace, unless it's the brace of the line above
+  if (opensScope(block))
+    return !(startsWithBrace(block) && block.previous().isValid() && isStatementLine(block.previous()));
+
+  return false;
+} // isFoldHeader
+
+// ====================================================
+//  FOLD END
+// ====================================================
+QTextBlock TextEditor::foldEnd(const QTextBlock& header) const
+{
+  if (!isFoldHeader(header) || !header.next().isValid())
+    return QTextBlock();
+
+  // The scope ends where the depth drops back to what it was before it
+  int depth = depthAfter(header.previous());
+  QTextBlock block = header.next();
+  for (; block.next().isValid(); block = block.next())
+  {
+    if (depthAfter(block) <= depth)
+      break;
+  }
+  return block;
+} // foldEnd
+
+// ====================================================
+//  IS FOLDED
+// ====================================================
+bool TextEditor::isFolded(const QTextBlock& header) const
+{
+  BlockData* data = (header.isValid() ? Highlighter::blockData(header) : NULL);
+  return data && data->folded;
+} // isFolded
+
+// ====================================================
+//  SET FOLDED
+// ====================================================
+void TextEditor::setFolded(const QTextBlock& header, bool folded)
+{
+  TRACE_SCOPE("TextEditor::setFolded");
+
+  BlockData* data = (header.isValid() ? Highlighter::blockData(header) : NULL);
+  QTextBlock end = foldEnd(header);
+  if (data == NULL || !end.isValid() || data->folded == folded)
+    return;
+
+  data->folded = folded;
+
+  // A scope inside another folded scope stays hidden either way.  The
+  // header is where the fold starts, so it has to be in the run.
+  if (header.isVisible())
+    applyFolds(header, end);
+} // setFolded
+
+// ====================================================
+//  APPLY FOLDS
+// ====================================================
+void TextEditor::applyFolds(const QTextBlock& first, const QTextBlock& last)
+{
+  if (!first.isValid() || !last.isValid())
+    return;
+
+  // Only the outermost folded scopes are looked for, so this takes one pass
+  // however deeply they're nested
+  QTextBlock hiddenEnd;
+  for (QTextBlock block = first; block.isValid(); block = block.next())
+  {
+    bool visible = !hiddenEnd.isValid();
+    if (block.isVisible() != visible)
+      block.setVisible(visible);
+
+    if (block == hiddenEnd)
+      hiddenEnd = QTextBlock();
+    else if (visible && isFolded(block))
+      hiddenEnd = foldEnd(block);
+
+    if (block == last)
+      break;
+  }
+
+  // The text is the same, only the layout needs redoing, so this doesn't
+  // go through the highlighter or count as a change
+  document()->markContentsDirty(first.position(), last.position() + last.length() - first.position());
+
+  // Keep the cursor out of hidden text, on the line that hides it
+  QTextBlock block = textCursor().block();
+  if (!block.isVisible())
+  {
+    while (block.isValid() && !block.isVisible())
+      block = block.previous();
+    if (block.isValid())
+    {
+      QTextCursor cursor(block);
+      cursor.movePosition(QTextCursor::EndOfBlock);
+      setTextCursor(cursor);
+    }
+  }
+
+  viewport()->update();
+  mpFoldGutter->update();
+} // applyFolds
+
+// ====================================================
+//  REVEAL BLOCK
+// ====================================================
+void TextEditor::revealBlock(const QTextBlock& block)
+{
+  // The nearest shown line above a hidden block is the header of the
+  // outermost fold hiding it.  Unfolding that may leave it inside a fold
+  // nested in the first, so keep going until it's shown.
+  while (block.isValid() && !block.isVisible())
+  {
+    QTextBlock header = block.previous();
+    while (header.isValid() && !header.isVisible())
+      header = header.previous();
+
+    BlockData* data = (header.isValid() ? Highlighter::blockData(header) : NULL);
+    if (data)
+      data->folded = false;
+
+    // An edit may have changed where the fold ends, so show whatever run of
+    // blocks it hid rather than working it out again
+    QTextBlock start = (header.isValid() ? header.next() : document()->begin());
+    QTextBlock end = start;
+    while (end.next().isValid() && !end.next().isVisible())
+      end = end.next();
+    applyFolds(start, end);
+  }
+} // revealBlock
+
+// ====================================================
+//  GET NUM INDENT
+// ====================================================
+int TextEditor::getNumIndent(bool toPrevBraceOnly)
+{
+  QTextCursor cursor = textCursor();
+  int cursorPos = cursor.position();
+	int retval = 0;
+  QStack<int> openBraces;
+	
+  // Find the position of the last un-closed left brace {
+	QString str = toPlainText();
+	for (int i = 0; i < cursorPos; i++)
+	{
+		char ch = str[i].toAscii();
+
+		// Skip comments
+		if (ch == '/' && str[i+1] == '/')
+			while (str[i] != '\n' && i < cursorPos) i++;
+
+    // Open brace
+		else if (ch == '{')
+      openBraces.push(i);
+
+    // Close brace
+		else if (ch == '}')
+    {
+      if (openBraces.empty() == false)
+			  openBraces.pop();
+    }
+	}
+
+  // If there's any open braces left, get the indentation of the last one
+  if (openBraces.empty() == false)
+  {
+    int lastOpenBrace = openBraces.pop();
+    int lastNewLine = str.lastIndexOf('\n', lastOpenBrace);
+
+    // Get indentation of the last open brace
+    retval = (lastOpenBrace - (lastNewLine+1));
+
+    // If toPrevBraceOnly is false, include the tab indentation
+    if (!toPrevBraceOnly)
+	    retval += mTabSpaces.length();
+  }
+
+  return retval;
+} // getNumIndent
+
+// ====================================================
+//  MATCH BRACES
+// ====================================================
+void TextEditor::matchBraces()
+{
+  // Get the string between the current cursor pos and the previous line.  If it's
+  // just whitespace, remove it and auto indent.
+  QTextCursor cursor(textCursor());
+  QString str = toPlainText();
+  int cPos = cursor.position();
+  int prevNewLine = str.lastIndexOf('\n', cursor.position()-1);
+  if (prevNewLine != -1)
+  {
+    QString trimmed = str.mid(prevNewLine, cursor.position()-prevNewLine).trimmed();
+    if (trimmed.isEmpty())
+    {
+      // If trimmed is not empty, that means there's something other than whitespace
+      // between the current cursor pos and the previous line, so remove it and auto
+      // indent.
+      cursor.anchor();
+      if (cursor.movePosition(QTextCursor::StartOfLine, QTextCursor::KeepAnchor))
+      {
+        cursor.removeSelectedText();
+      }
+      //cursor.setPosition(lastEndLine+1);
+      setTextCursor(cursor);
+
+      int numIndent = getNumIndent(true);
+      insertPlainText(QString().fill(' ', numIndent));
+    }
+  }  
+  
+  // Insert the closing brace
+  insertPlainText("}");
+} // matchBraces
+
+// ====================================================
+//  CAN INSERT FROM MIME DATA (inherited)
+// ====================================================
+bool TextEditor::canInsertFromMimeData(const QMimeData* source) const
+{
+  return source->hasUrls() || QTextEdit::canInsertFromMimeData(source);
+} // canInsertFromMimeData
+
+// ====================================================
+//  INSERT FROM MIME DATA (inherited)
+// ====================================================
+void TextEditor::insertFromMimeData(const QMimeData* source)
+{
+  if (source->hasUrls())
+  {
+    QList<QUrl> urls = source->urls();
+    foreach (QUrl url, urls)
+      emit fileDropped(url.toLocalFile());
+  }
+} // insertFromMimeData
+
+// ====================================================
+//  ON TEXT CHANGED (slot)
+// ====================================================
+void TextEditor::onTextChanged(void)
+{
+  mUnsavedChanges = true;
+} // onTextChanged
+
+// ====================================================
+//  ON CURSOR POSITION CHANGED (slot)
+// ====================================================
+void TextEditor::onCursorPositionChanged(void)
+{
+  // Moving into a folded scope, by searching for example, unfolds it
+  if (!textCursor().block().isVisible())
+    revealBlock(textCursor().block());
+
+  // Get the first word on this line
+  QTextCursor cursor = textCursor();
+  cursor.movePosition(QTextCursor::StartOfLine);
+  int startPos = cursor.position();
+  cursor.movePosition(QTextCursor::EndOfWord, QTextCursor::KeepAnchor);
+
+  // If the cursor didn't move, then we need to move to the beginning
+  // of the next word
+  if (cursor.position() == startPos)
+  {
+    cursor.movePosition(QTextCursor::NextWord);
+    cursor.movePosition(QTextCursor::EndOfWord, QTextCursor::KeepAnchor);
+  }
+  
+  // Only words that were interned can be keywords, so anything else is
+  // the null atom
+  Atom keyword = Atom::find(cursor.selectedText());
+  
+  // If the focused keyword changed, emit keywordChanged() signal
+  if (keyword != mFocusedKeyword)
+  {
+    mFocusedKeyword = keyword;
+    emit keywordChanged(mFocusedKeyword, mFormat);
+  }
+
+} // onCursorPositionChanged
+
+// ====================================================
+//  ON CONTENTS CHANGE (slot)
+// ====================================================
+void TextEditor::onContentsChange(int position, int removed, int added)
+{
+  Q_UNUSED(removed);
+
+  // Unfold anything the edit touched, including the line after it, which
+  // may have been hidden by a header the edit removed
+  QTextBlock first = document()->findBlock(position);
+  QTextBlock last = document()->findBlock(position + added).next();
+  for (QTextBlock block = first; block.isValid(); block = block.next())
+  {
+    if (!block.isVisible())
+      revealBlock(block);
+    if (isFolded(block))
+      setFolded(block, false);
+    if (block == last)
+      break;
+  }
+} // onContentsChange
+
+// ====================================================
+//  FOLD ALL (slot)
+// ====================================================
+void TextEditor::foldAll(void)
+{
+  TRACE_SCOPE("TextEditor::foldAll");
+
+  QTextDocument* doc = document();
+  for (QTextBlock block = doc->begin(); block.isValid(); block = block.next())
+  {
+    BlockData* data = Highlighter::blockData(block);
+    if (data)
+      data->folded = isFoldHeader(block);
+  }
+  applyFolds(doc->begin(), doc->lastBlock());
+} // foldAll
+
+// ====================================================
+//  UNFOLD ALL (slot)
+// ====================================================
+void TextEditor::unfoldAll(void)
+{
+  TRACE_SCOPE("TextEditor::unfoldAll");
+
+  QTextDocument* doc = document();
+  for (QTextBlock block = doc->begin(); block.isValid(); block = block.next())
+  {
+    BlockData* data = Highlighter::blockData(block);
+    if (data)
+      data->folded = false;
+  }
+  applyFolds(doc->begin(), doc->lastBlock());
+} // unfoldAll
+
+// ====================================================
+//  INCREASE INDENT (slot)
+// ====================================================
+void TextEditor::increaseIndent(void)
+{
+  QTextCursor cursor = textCursor();
+  int start = cursor.selectionStart();
+  int end = cursor.selectionEnd();
+  
+  // Move the cursor to the start of the selection, and then to the
+  // begining of that line
+  cursor.setPosition(start);
+  cursor.movePosition(QTextCursor::StartOfLine);
+  
+  // Until we reach the end of the document or past the end of the 
+  // selection, insert a tab and then move to the next line
+  while (cursor.position() < end && cursor.position() >= 0)
+  {
+    cursor.insertText(mTabSpaces);
+    cursor.movePosition(QTextCursor::EndOfLine);
+    cursor.movePosition(QTextCursor::NextCharacter);
+    end += mTabSpaces.length();
+  }
+  
+} // increaseIndent
+
+// ====================================================
+//  DECREASE INDENT (slot)
+// ====================================================
+void TextEditor::decreaseIndent(void)
+{
+  static QChar qCh(' ');
+  QTextCursor cursor = textCursor();
+  
+  // Find out how many lines are selected
+  int startPos = cursor.selectionStart();
+  int endPos = cursor.selectionEnd();
+  int lineStart = lineNumberAtPos(startPos);
+  int lineEnd = lineNumberAtPos(endPos);
+
+  for (int i = lineStart; i <= lineEnd; ++i)
+  {
+    // Get the line
+    QString line = getLine(i);
+
+    // Figure out how many spaces to remove
+    int length = std::min(mTabSpaces.length(), line.length());
+    int spaces = 0;
+    for (; spaces < length; ++spaces)
+    {
+      if (line[spaces].isSpace() == false)
+        break;
+    }
+
+    // Remove the spaces
+    if (spaces > 0)
+    {
+      line.remove(0, spaces);
+      replaceLine(i, line);
+    }
+  }
 } // decreaseIndent
\ No newline at end of file
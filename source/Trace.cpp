@@ -0,0 +1,195 @@
+#include <QtCore/QAtomicInt>
+#include <QtCore/QAtomicPointer>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QTextStream>
+#include <QtCore/QThread>
+#include <QtCore/QThreadStorage>
+#include <QtCore/QVector>
+#include <QtCore/QCoreApplication>
+#include "Trace.h" // declarations
+
+namespace trace
+{
+  /** A completed scope, as stored in a ring buffer. */
+  struct Event
+  {
+    const char* name;
+    qint64      start;
+    qint64      duration;
+  };
+
+  /** The events recorded by one thread.  Only the owning thread writes to it;
+   * head is published with release semantics after each event is written so
+   * that dump() can read the buffer from another thread.  head is read as
+   * unsigned, so it wraps to 0 rather than going negative.  Buffers are never
+   * freed, so events from threads that have finished can still be dumped. */
+  struct RingBuffer
+  {
+    Event         events[BUFFER_SIZE];
+    QAtomicInt    head;       ///< Total number of events ever written, modulo 2^32
+    int           threadId;
+    QString       threadName;
+    RingBuffer*   next;
+  };
+
+  /** Lives in thread local storage and points at the thread's buffer.  The
+   * QThreadStorage deletes this when the thread exits, but not the buffer. */
+  struct BufferHandle
+  {
+    RingBuffer* buffer;
+  };
+
+  // Slots are found by masking head, which only works for a power of two
+  typedef char BufferSizeIsPowerOfTwo[(BUFFER_SIZE & (BUFFER_SIZE - 1)) == 0 ? 1 : -1];
+  static const uint BUFFER_MASK = BUFFER_SIZE - 1;
+
+  // Initialize globals
+  QAtomicInt gEnabled(0);
+
+  static QAtomicPointer<RingBuffer> gBuffers(NULL);
+  static QAtomicInt                 gNextThreadId(1);
+  static QThreadStorage<BufferHandle*> gLocalBuffer;
+  static QElapsedTimer              gClock;
+  static QMutex                     gClockMutex;
+
+  // ====================================================
+  //  LOCAL BUFFER (local)
+  // ====================================================
+  static RingBuffer* localBuffer(void)
+  {
+    if (!gLocalBuffer.hasLocalData())
+    {
+      RingBuffer* buffer = new RingBuffer;
+      buffer->head = 0;
+      buffer->threadId = gNextThreadId.fetchAndAddRelaxed(1);
+      buffer->next = NULL;
+
+      QThread* thread = QThread::currentThread();
+      if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread())
+        buffer->threadName = "GUI";
+      else if (thread && !thread->objectName().isEmpty())
+        buffer->threadName = thread->objectName();
+      else
+        buffer->threadName = QString("Thread %1").arg(buffer->threadId);
+
+      // Push onto the global list without locking
+      RingBuffer* head;
+      do
+      {
+        head = gBuffers;
+        buffer->next = head;
+      } while (!gBuffers.testAndSetOrdered(head, buffer));
+
+      BufferHandle* handle = new BufferHandle;
+      handle->buffer = buffer;
+      gLocalBuffer.setLocalData(handle);
+    }
+
+    return gLocalBuffer.localData()->buffer;
+  } // localBuffer
+
+  // ====================================================
+  //  SET ENABLED
+  // ====================================================
+  void setEnabled(bool enabled)
+  {
+    {
+      QMutexLocker lock(&gClockMutex);
+      if (!gClock.isValid())
+        gClock.start();
+    }
+    // Released so the clock started above is seen by any probe that sees
+    // tracing enabled
+    gEnabled.fetchAndStoreRelease(enabled ? 1 : 0);
+  } // setEnabled
+
+  // ====================================================
+  //  NOW
+  // ====================================================
+  qint64 now(void)
+  {
+    return gClock.nsecsElapsed();
+  } // now
+
+  // ====================================================
+  //  RECORD
+  // ====================================================
+  void record(const char* name, qint64 start, qint64 end)
+  {
+    RingBuffer* buffer = localBuffer();
+
+    uint head = uint(int(buffer->head));
+    Event& e = buffer->events[head & BUFFER_MASK];
+    e.name = name;
+    e.start = start;
+    e.duration = end - start;
+
+    // Publish the event
+    buffer->head.fetchAndStoreRelease(int(head + 1));
+  } // record
+
+  // ====================================================
+  //  CLEAR
+  // ====================================================
+  void clear(void)
+  {
+    // Only the owning thread writes events, so resetting head from here can
+    // race with a probe that is finishing.  The worst case is one stale
+    // event, which is acceptable for a debugging aid.
+    for (RingBuffer* buffer = gBuffers; buffer; buffer = buffer->next)
+      buffer->head.fetchAndStoreRelease(0);
+  } // clear
+
+  // ====================================================
+  //  DUMP
+  // ====================================================
+  bool dump(const QString& path)
+  {
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly | QFile::Text))
+      return false;
+
+    QTextStream out(&file);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+
+    bool first = true;
+    for (RingBuffer* buffer = gBuffers; buffer; buffer = buffer->next)
+    {
+      // Name the thread
+      out << (first ? "" : ",\n")
+          << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->threadId
+          << ", \"args\": {\"name\": \"" << buffer->threadName << "\"}}";
+      first = false;
+
+      // Copy the events out before writing them, so the window in which the
+      // owning thread can overwrite them is as small as possible
+      uint head = uint(buffer->head.fetchAndAddAcquire(0));
+      int count = int(qMin(head, uint(BUFFER_SIZE)));
+      QVector<Event> events(count);
+      for (int i = 0; i < count; ++i)
+        events[i] = buffer->events[(head - count + i) & BUFFER_MASK];
+
+      // Anything the owning thread wrote over while we were copying is
+      // dropped rather than written out half-updated.  That includes the
+      // slot at newHead, which may be mid-write and not yet published.  The
+      // copy starts BUFFER_SIZE - count slots ahead of the next free one.
+      // The difference is taken unsigned so it stays right across a wrap.
+      uint newHead = uint(buffer->head.fetchAndAddAcquire(0));
+      int written = int(qMin(newHead - head, uint(BUFFER_SIZE)));
+      int skip = qBound(0, written + 1 - (BUFFER_SIZE - count), count);
+
+      for (int i = skip; i < count; ++i)
+      {
+        const Event& e = events[i];
+        out << ",\n{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->threadId
+            << ", \"ts\": " << QString::number(e.start / 1000.0, 'f', 3)
+            << ", \"dur\": " << QString::number(e.duration / 1000.0, 'f', 3) << "}";
+      }
+    }
+
+    out << "\n]}\n";
+    return true;
+  } // dump
+} // namespace trace
\ No newline at end of file
@@ -0,0 +1,977 @@
+/* materialtool: batch checks of material and overlay scripts, for build
+ * pipelines and anything else that can't open the editor.
+ *
+ * Usage: materialtool <command> [options] <files or directories>...
+ *
+ * Commands:
+ *   validate           Reports unknown keywords (with the keywords they
+ *                      were probably meant to be), attributes in the wrong
+ *                      block, unbalanced braces and names that don't
+ *                      resolve, the same as the editor's Problems list
+ *   resolve            Reports the textures, programs and materials that
+ *                      scripts refer to but the resource directories don't
+ *                      have
+ *   deps affected <node>...
+ *                      Lists everything in the resource directories that
+ *                      depends on the nodes, directly or not, and the
+ *                      scripts that define it
+ *   deps depends <node>...
+ *                      Lists everything the nodes depend on
+ *   flatten            Writes every material the scripts define as it ends
+ *                      up after inheritance, with no parents left.  Parents
+ *                      the scripts don't define are looked up in the
+ *                      resource directories.
+ *   diff OLD NEW       Lists the materials, techniques, passes and
+ *                      attributes added, removed, changed or renamed
+ *                      between two versions of a script, ignoring layout,
+ *                      comments and order.  Given two directories, compares
+ *                      the scripts with the same paths under each.
+ *   dupes              Lists materials that are identical apart from their
+ *                      names, and groups of materials that are nearly, with
+ *                      what each has that the rest of its group doesn't, as
+ *                      candidates for a common parent
+ *   pack BUNDLE <files or directories>...
+ *                      Packs scripts into one bundle file, named by their
+ *                      paths under the directories given.  With --minify,
+ *                      comments and layout are stripped.
+ *   list BUNDLE        Lists the scripts in a bundle, checking each against
+ *                      its checksum
+ *   unpack BUNDLE DIR [name]...
+ *                      Writes the scripts in a bundle, or the ones named,
+ *                      back out under DIR
+ *
+ * Options:
+ *   --data DIR         Directory with config.xml and the .words/.highlights
+ *                      files (exe dir)
+ *   --format NAME      Format of files whose extension config.xml doesn't
+ *                      list.  Without one, they are skipped.
+ *   --resources DIR    A resource directory to look names up in, on top
+ *                      of config.xml's ResourcePaths.  May be repeated.
+ *   --graph FILE       Where deps keeps the dependency graph between runs
+ *                      (dependencies.dat in the data directory, which the
+ *                      editor shares)
+ *   --output FILE      Where flatten writes the materials (standard output)
+ *   --similarity PCT   How much of their contents materials must share for
+ *                      dupes to report them as similar (80)
+ *   --minify           Packs scripts in their canonical form: no comments,
+ *                      no indentation and one space between words
+ *
+ * Nodes are written "kind:name", with kind one of file, material,
+ * vertex_program, fragment_program, texture or overlay.  An existing script
+ * stands for itself, any other existing file for the texture of that name,
+ * and anything else for the material of that name.
+ *
+ * Directories are searched recursively for files with the extensions of the
+ * formats in config.xml.  Files are checked in parallel, and problems are
+ * printed as "file:line:column: message", in the order the files were found.
+ * Returns 1 if there were any problems and 2 if the tool couldn't run. */
+#include <QtGui/QApplication>
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+#include <QtCore/QtConcurrentMap>
+#include "ConfigFile.h"
+#include "DependencyGraph.h"
+#include "MaterialFlattener.h"
+#include "ScriptDiff.h"
+#include "DuplicateFinder.h"
+#include "ScriptBundle.h"
+#include "Diagnostics.h"
+#include "ResourceResolver.h"
+#include "ScriptParser.h"
+
+/** A script to work on, and the format it is in. */
+struct ScriptPath
+{
+  QString path;
+  QString format;
+};
+
+/** What checking a script found. */
+struct ValidateReport
+{
+  QStringList lines;    ///< One per problem, ready to print
+  bool        readable;
+};
+
+// ====================================================
+//  COLLECT SCRIPTS (local)
+// ====================================================
+/** Finds the scripts named by the command line, in the order they were
+ * named, with the contents of each directory sorted by path. */
+static QVector<ScriptPath> collectScripts(const QStringList& paths, const QString& defaultFormat)
+{
+  config::ConfigFile* config = config::ConfigFile::instance();
+  QVector<ScriptPath> scripts;
+
+  foreach (const QString& path, paths)
+  {
+    QFileInfo info(path);
+    if (info.isDir())
+    {
+      QStringList found;
+      QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+      while (it.hasNext())
+      {
+        it.next();
+        if (!config->getFormatByExtension(it.fileInfo().suffix()).isEmpty())
+          found << it.filePath();
+      }
+      found.sort();
+
+      foreach (const QString& file, found)
+      {
+        ScriptPath script;
+        script.path = file;
+        script.format = config->getFormatByExtension(QFileInfo(file).suffix());
+        scripts.push_back(script);
+      }
+    }
+    else
+    {
+      ScriptPath script;
+      script.path = path;
+      script.format = config->getFormatByExtension(info.suffix());
+      if (script.format.isEmpty())
+        script.format = defaultFormat;
+      if (!script.format.isEmpty())
+        scripts.push_back(script);
+    }
+  }
+  return scripts;
+} // collectScripts
+
+// ====================================================
+//  FIND UNCLOSED BRACE (local)
+// ====================================================
+/** Finds the innermost '{' that is never closed, reading back from the end
+ * of the script, the way the editor does from its brace depths. */
+static void findUnclosedBrace(const QVector<QString>& lines, int& line, int& column)
+{
+  int depth = 0;
+  for (line = lines.size() - 1; line >= 0; --line)
+  {
+    QString text = lines[line];
+    int comment = text.indexOf("//");
+    if (comment >= 0)
+      text.truncate(comment);
+
+    for (column = text.size() - 1; column >= 0; --column)
+    {
+      if (text[column] == '}')
+        ++depth;
+      else if (text[column] == '{' && depth-- == 0)
+        return;
+    }
+  }
+  line = lines.size() - 1;
+  column = 0;
+} // findUnclosedBrace
+
+// ====================================================
+//  VALIDATE SCRIPT (local)
+// ====================================================
+/** Checks a script on one of QtConcurrent's threads.  The words, the
+ * suggestion index and the resource index are shared read-only between them. */
+struct ValidateScript
+{
+  typedef ValidateReport result_type;
+
+  Atom          script;
+  ResourceIndex resources;
+
+  ValidateReport operator()(const ScriptPath& file) const
+  {
+    ValidateReport report;
+    QFile in(file.path);
+    report.readable = in.open(QFile::ReadOnly | QFile::Text);
+    if (!report.readable)
+      return report;
+
+    config::ConfigFile* config = config::ConfigFile::instance();
+    DiagnosticJob job;
+    job.firstBlock = 0;
+    job.script = script;
+    job.words = config->getWordsByFormat(file.format);
+    job.suggestions = config->getSuggestionsByFormat(file.format);
+    job.resources = resources;
+    job.lines = QTextStream(&in).readAll().split('\n').toVector();
+
+    DiagnosticResult result = Diagnostics::check(job);
+    for (int line = 0; line < result.lines.size(); ++line)
+    {
+      foreach (const Diagnostic& diagnostic, result.lines[line])
+        report.lines << QString("%1:%2:%3: %4").arg(file.path).arg(line + 1).arg(diagnostic.start + 1).arg(diagnostic.message);
+    }
+
+    if (!result.state.stack.isEmpty())
+    {
+      int line, column;
+      findUnclosedBrace(job.lines, line, column);
+      report.lines << QString("%1:%2:%3: '{' is never closed").arg(file.path).arg(line + 1).arg(column + 1);
+    }
+    return report;
+  }
+};
+
+// ====================================================
+//  VALIDATE (local)
+// ====================================================
+static int validate(const QVector<ScriptPath>& scripts, const ResourceIndex& resources, QTextStream& out)
+{
+  ValidateScript check;
+  check.script = Atom::intern("script");
+  check.resources = resources;
+  QList<ValidateReport> reports = QtConcurrent::blockingMapped<QList<ValidateReport> >(scripts, check);
+
+  int problems = 0;
+  int failed = 0;
+  for (int i = 0; i < reports.size(); ++i)
+  {
+    if (!reports[i].readable)
+    {
+      out << scripts[i].path << ": could not be read" << endl;
+      ++failed;
+    }
+    foreach (const QString& line, reports[i].lines)
+      out << line << endl;
+    problems += reports[i].lines.size();
+  }
+
+  out << problems << " problem(s) in " << scripts.size() << " file(s)" << endl;
+  if (failed > 0)
+    return 2;
+  return (problems > 0 ? 1 : 0);
+} // validate
+
+// ====================================================
+//  RESOLVE SCRIPT (local)
+// ====================================================
+/** Finds the names a script refers to that don't resolve, on one of
+ * QtConcurrent's threads.  Scripts are read with the memory mapped parser,
+ * so this is bound by reading the files; the index never goes to the disk. */
+struct ResolveScript
+{
+  typedef ValidateReport result_type;
+
+  const ResourceIndex* resources;
+
+  ValidateReport operator()(const ScriptPath& file) const
+  {
+    ValidateReport report;
+    script::ScriptFile parsed;
+    report.readable = parsed.open(file.path);
+    if (!report.readable)
+      return report;
+
+    QVector<ResourceReference> references;
+    QVector<ResourceDefinition> definitions;
+    ResourceIndex::findReferences(parsed.root(), references);
+    ResourceIndex::findDefinitions(parsed.root(), file.path, definitions);
+
+    foreach (const ResourceReference& reference, references)
+    {
+      if (resources->resolve(reference))
+        continue;
+
+      // Scripts may refer to what they define themselves
+      bool local = false;
+      for (int i = 0; i < definitions.size() && !local; ++i)
+        local = (definitions[i].kind == reference.kind && definitions[i].name.compare(reference.name, Qt::CaseInsensitive) == 0);
+      if (!local)
+        report.lines << QString("%1:%2: %3").arg(file.path).arg(reference.line).arg(ResourceIndex::describeUnresolved(reference));
+    }
+    return report;
+  }
+};
+
+// ====================================================
+//  RESOLVE (local)
+// ====================================================
+static int resolve(const QVector<ScriptPath>& scripts, const ResourceIndex& resources, QTextStream& out)
+{
+  if (resources.isEmpty())
+  {
+    out << "No resource directories were found.  Add ResourcePaths to config.xml or use --resources." << endl;
+    return 2;
+  }
+
+  ResolveScript check;
+  check.resources = &resources;
+  QList<ValidateReport> reports = QtConcurrent::blockingMapped<QList<ValidateReport> >(scripts, check);
+
+  int unresolved = 0;
+  int failed = 0;
+  for (int i = 0; i < reports.size(); ++i)
+  {
+    if (!reports[i].readable)
+    {
+      out << scripts[i].path << ": could not be read" << endl;
+      ++failed;
+    }
+    foreach (const QString& line, reports[i].lines)
+      out << line << endl;
+    unresolved += reports[i].lines.size();
+  }
+
+  out << unresolved << " unresolved name(s) in " << scripts.size() << " file(s), against "
+      << resources.fileCount() << " resource file(s)" << endl;
+  if (failed > 0)
+    return 2;
+  return (unresolved > 0 ? 1 : 0);
+} // resolve
+
+// ====================================================
+//  PARSE NODE (local)
+// ====================================================
+static DependencyNode parseNode(const QString& spec)
+{
+  DependencyNode node;
+  if (DependencyNode::fromString(spec, node))
+    return node;
+
+  QFileInfo info(spec);
+  if (info.isFile() && DependencyGraph::isScript(spec))
+  {
+    node.kind = DEPENDENCY_FILE;
+    node.name = QDir::cleanPath(info.absoluteFilePath());
+  }
+  else if (info.isFile())
+  {
+    node.kind = DEPENDENCY_TEXTURE;
+    node.name = info.fileName().toLower();
+  }
+  else
+  {
+    node.kind = DEPENDENCY_MATERIAL;
+    node.name = spec;
+  }
+  return node;
+} // parseNode
+
+// ====================================================
+//  DEPENDENCIES (local)
+// ====================================================
+static int dependencies(const QString& mode, const QVector<DependencyNode>& nodes, const QStringList& directories,
+                        const QString& graphPath, QTextStream& out)
+{
+  if (mode != "affected" && mode != "depends")
+  {
+    out << "deps takes 'affected' or 'depends', not '" << mode << "'" << endl;
+    return 2;
+  }
+  if (directories.isEmpty())
+  {
+    out << "No resource directories were found.  Add ResourcePaths to config.xml or use --resources." << endl;
+    return 2;
+  }
+
+  // Only the scripts that changed since the last run are read.  A graph of
+  // other directories is thrown away.
+  DependencyGraph graph;
+  graph.load(graphPath);
+  graph.setDirectories(directories);
+  int read = graph.refresh();
+  if (graph.isModified() && !graph.save(graphPath))
+    out << "Could not save the graph to " << graphPath << endl;
+
+  foreach (const DependencyNode& node, nodes)
+  {
+    QVector<DependencyNode> found;
+    if (mode == "affected")
+      graph.affectedBy(node, found);
+    else
+      graph.dependenciesOf(node, found);
+
+    QStringList names;
+    foreach (const DependencyNode& other, found)
+    {
+      if (other.kind != DEPENDENCY_FILE)
+        names << other.toString();
+    }
+    names.sort();
+
+    out << node.toString() << ": " << names.size() << (mode == "affected" ? " dependent(s)" : " dependency(ies)") << endl;
+    foreach (const QString& name, names)
+      out << "  " << name << endl;
+
+    QStringList files = graph.definingFiles(found);
+    files.sort();
+    foreach (const QString& file, files)
+      out << "  in " << file << endl;
+  }
+
+  out << graph.fileCount() << " script(s) with " << graph.edgeCount() << " edge(s) in the graph, "
+      << read << " read or dropped since the last run" << endl;
+  return 0;
+} // dependencies
+
+// ====================================================
+//  READ MATERIALS (local)
+// ====================================================
+/** Reads the materials a script defines on one of QtConcurrent's threads. */
+struct ReadMaterials
+{
+  typedef QVector<MaterialDefinition> result_type;
+
+  QVector<MaterialDefinition> operator()(const ScriptPath& file) const
+  {
+    QVector<MaterialDefinition> definitions;
+    script::ScriptFile parsed;
+    if (parsed.open(file.path))
+      MaterialDefinition::fromScript(parsed.root(), definitions);
+    return definitions;
+  }
+};
+
+// ====================================================
+//  FLATTEN (local)
+// ====================================================
+static int flatten(const QVector<ScriptPath>& scripts, const ResourceIndex& resources, const QString& outputPath, QTextStream& out)
+{
+  // Reading is what takes the time, so it's done in parallel; working out
+  // each material once is cheap next to it
+  QList<QVector<MaterialDefinition> > definitions =
+    QtConcurrent::blockingMapped<QList<QVector<MaterialDefinition> > >(scripts, ReadMaterials());
+
+  MaterialFlattener flattener;
+  flattener.setResources(resources);
+  for (int i = 0; i < scripts.size(); ++i)
+    flattener.addScript(scripts[i].path, definitions[i]);
+
+  QFile file(outputPath);
+  QTextStream written(stdout);
+  if (!outputPath.isEmpty())
+  {
+    if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text))
+    {
+      out << "Could not write " << outputPath << endl;
+      return 2;
+    }
+    written.setDevice(&file);
+  }
+
+  QTextStream err(stderr);
+  int count = 0;
+  int failed = 0;
+  for (int i = 0; i < scripts.size(); ++i)
+  {
+    foreach (const MaterialDefinition& definition, definitions[i])
+    {
+      MaterialStatement effective;
+      QString error;
+      if (!flattener.flatten(definition.name, effective, &error))
+      {
+        err << scripts[i].path << ":" << definition.line << ": " << error << endl;
+        ++failed;
+        continue;
+      }
+      written << "// " << definition.name << " from " << scripts[i].path << endl << effective.toString() << endl;
+      ++count;
+    }
+  }
+  written.flush();
+
+  err << count << " material(s) flattened from " << scripts.size() << " file(s), " << failed << " failed" << endl;
+  return (failed > 0 ? 1 : 0);
+} // flatten
+
+// ====================================================
+//  DIFF SCRIPTS (local)
+// ====================================================
+/** Compares the two versions of a script on one of QtConcurrent's threads.
+ * A script missing on one side is compared with an empty one. */
+struct DiffScripts
+{
+  typedef QVector<ScriptChange> result_type;
+
+  QString oldRoot;
+  QString newRoot;
+
+  QVector<ScriptChange> operator()(const QString& path) const
+  {
+    script::ScriptFile before, after;
+    if (!before.open(oldRoot + path))
+      before.parse("", 0);
+    if (!after.open(newRoot + path))
+      after.parse("", 0);
+
+    QVector<ScriptChange> changes;
+    ScriptDiff::diff(before.root(), after.root(), changes);
+    return changes;
+  }
+};
+
+// ====================================================
+//  LIST SCRIPTS (local)
+// ====================================================
+/** Adds the paths of the scripts under \e directory, relative to it. */
+static void listScripts(const QString& directory, QSet<QString>& out)
+{
+  QDir dir(directory);
+  QDirIterator it(directory, QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext())
+  {
+    QString path = it.next();
+    if (DependencyGraph::isScript(path))
+      out.insert("/" + dir.relativeFilePath(path));
+  }
+} // listScripts
+
+// ====================================================
+//  DIFF (local)
+// ====================================================
+static int diff(const QString& oldPath, const QString& newPath, QTextStream& out)
+{
+  // Two files are one pair; two directories are a pair per script in either
+  DiffScripts compare;
+  QStringList paths;
+  if (QFileInfo(oldPath).isDir() && QFileInfo(newPath).isDir())
+  {
+    QSet<QString> found;
+    listScripts(oldPath, found);
+    listScripts(newPath, found);
+    paths = found.toList();
+    paths.sort();
+    compare.oldRoot = oldPath;
+    compare.newRoot = newPath;
+  }
+  else if (QFileInfo(oldPath).isFile() && QFileInfo(newPath).isFile())
+  {
+    paths << QString();
+    compare.oldRoot = oldPath;
+    compare.newRoot = newPath;
+  }
+  else
+  {
+    out << "diff takes two files or two directories" << endl;
+    return 2;
+  }
+
+  QList<QVector<ScriptChange> > changes = QtConcurrent::blockingMapped<QList<QVector<ScriptChange> > >(paths, compare);
+
+  int total = 0;
+  int files = 0;
+  for (int i = 0; i < paths.size(); ++i)
+  {
+    if (changes[i].isEmpty())
+      continue;
+
+    // Lines are in the new version, unless the statement was removed
+    QString name = (paths[i].isEmpty() ? newPath : paths[i].mid(1));
+    foreach (const ScriptChange& change, changes[i])
+      out << name << ":" << (change.newLine > 0 ? change.newLine : change.oldLine) << ": " << change.toString() << endl;
+    total += changes[i].size();
+    ++files;
+  }
+
+  out << total << " difference(s) in " << files << " of " << paths.size() << " file(s)" << endl;
+  return (total > 0 ? 1 : 0);
+} // diff
+
+// ====================================================
+//  FINGERPRINT SCRIPT (local)
+// ====================================================
+/** Fingerprints the materials of a script on one of QtConcurrent's threads. */
+struct FingerprintScript
+{
+  typedef QVector<MaterialFingerprint> result_type;
+
+  QVector<MaterialFingerprint> operator()(const ScriptPath& file) const
+  {
+    QVector<MaterialFingerprint> fingerprints;
+    script::ScriptFile parsed;
+    if (parsed.open(file.path))
+      MaterialFingerprint::fromScript(parsed.root(), file.path, fingerprints);
+    return fingerprints;
+  }
+};
+
+// ====================================================
+//  DUPLICATES (local)
+// ====================================================
+static int duplicates(const QVector<ScriptPath>& scripts, double threshold, QTextStream& out)
+{
+  QList<QVector<MaterialFingerprint> > found =
+    QtConcurrent::blockingMapped<QList<QVector<MaterialFingerprint> > >(scripts, FingerprintScript());
+  QVector<MaterialFingerprint> fingerprints;
+  foreach (const QVector<MaterialFingerprint>& script, found)
+    fingerprints += script;
+
+  QVector<DuplicateGroup> groups;
+  DuplicateFinder::find(fingerprints, threshold, groups);
+
+  int identical = 0;
+  foreach (const DuplicateGroup& group, groups)
+  {
+    if (group.exact)
+    {
+      out << "identical, " << group.members.size() << " materials with " << group.common.size() << " statement(s):" << endl;
+      ++identical;
+    }
+    else
+    {
+      out << "similar (" << qRound(group.similarity * 100) << "%), " << group.members.size() << " materials with "
+          << group.common.size() << " statement(s) in common:" << endl;
+    }
+
+    // What each member has on top of what they share is what it would
+    // override in a common parent
+    QSet<QString> common = group.common.toSet();
+    foreach (int member, group.members)
+    {
+      const MaterialFingerprint& fingerprint = fingerprints[member];
+      out << "  " << fingerprint.path << ":" << fingerprint.line << ": " << fingerprint.name << endl;
+      if (group.exact)
+        continue;
+      foreach (const QString& feature, fingerprint.features)
+      {
+        if (!common.contains(feature))
+          out << "      " << feature << endl;
+      }
+    }
+  }
+
+  out << fingerprints.size() << " material(s) in " << scripts.size() << " file(s): " << identical
+      << " identical group(s), " << groups.size() - identical << " similar group(s)" << endl;
+  return (groups.isEmpty() ? 0 : 1);
+} // duplicates
+
+// ====================================================
+//  PACK SOURCE (local)
+// ====================================================
+/** A script to pack, and the name it is packed under. */
+struct PackSource
+{
+  QString path;
+  QString name;
+};
+
+// ====================================================
+//  PACK SCRIPT (local)
+// ====================================================
+/** Reads a script to pack on one of QtConcurrent's threads, minified if
+ * asked to.  Scripts with syntax errors are packed as they are, since what
+ * the parser made of them may not be what was meant.  The name is left
+ * empty if the script can't be read. */
+struct PackScript
+{
+  typedef BundleEntry result_type;
+
+  bool minify;
+
+  BundleEntry operator()(const PackSource& source) const
+  {
+    BundleEntry entry;
+    QFile in(source.path);
+    if (!in.open(QFile::ReadOnly))
+      return entry;
+    entry.name = source.name;
+    entry.data = in.readAll();
+
+    if (minify)
+    {
+      script::ScriptFile parsed;
+      parsed.parse(entry.data.constData(), entry.data.size());
+      if (parsed.errors().isEmpty())
+        entry.data = ScriptBundle::minify(parsed.root());
+    }
+    return entry;
+  }
+};
+
+// ====================================================
+//  PACK (local)
+// ====================================================
+/** Packs scripts into a bundle.  Scripts found in a directory are named by
+ * their paths under it, and scripts named directly by their file names. */
+static int pack(const QString& bundlePath, const QStringList& paths, bool minify, QTextStream& out)
+{
+  QVector<PackSource> sources;
+  foreach (const QString& path, paths)
+  {
+    QFileInfo info(path);
+    if (!info.isDir())
+    {
+      PackSource source;
+      source.path = path;
+      source.name = info.fileName();
+      sources.push_back(source);
+      continue;
+    }
+
+    QSet<QString> found;
+    listScripts(path, found);
+    QStringList names = found.toList();
+    names.sort();
+    foreach (const QString& name, names)
+    {
+      PackSource source;
+      source.path = path + name;
+      source.name = name.mid(1);
+      sources.push_back(source);
+    }
+  }
+
+  PackScript read;
+  read.minify = minify;
+  QList<BundleEntry> packed = QtConcurrent::blockingMapped<QList<BundleEntry> >(sources, read);
+
+  QVector<BundleEntry> entries;
+  qint64 before = 0;
+  qint64 after = 0;
+  for (int i = 0; i < sources.size(); ++i)
+  {
+    if (packed[i].name.isEmpty())
+    {
+      out << sources[i].path << ": could not be read" << endl;
+      return 2;
+    }
+    before += QFileInfo(sources[i].path).size();
+    after += packed[i].data.size();
+    entries.push_back(packed[i]);
+  }
+
+  if (!ScriptBundle::write(bundlePath, entries))
+  {
+    out << "Could not write " << bundlePath << ".  Are two scripts packed under the same name?" << endl;
+    return 2;
+  }
+
+  out << entries.size() << " script(s), " << before << " bytes packed into " << after << " bytes of scripts, "
+      << QFileInfo(bundlePath).size() << " bytes in all" << endl;
+  return 0;
+} // pack
+
+// ====================================================
+//  LIST BUNDLE (local)
+// ====================================================
+static int listBundle(const QString& bundlePath, QTextStream& out)
+{
+  ScriptBundle bundle;
+  if (!bundle.open(bundlePath))
+  {
+    out << bundlePath << ": not a script bundle" << endl;
+    return 2;
+  }
+
+  int corrupt = 0;
+  for (int i = 0; i < bundle.count(); ++i)
+  {
+    bool sound = bundle.verify(i);
+    out << bundle.name(i) << "\t" << bundle.size(i) << (sound ? "" : "\tchecksum mismatch") << endl;
+    if (!sound)
+      ++corrupt;
+  }
+
+  out << bundle.count() << " script(s), " << corrupt << " corrupt" << endl;
+  return (corrupt > 0 ? 1 : 0);
+} // listBundle
+
+// ====================================================
+//  UNPACK (local)
+// ====================================================
+/** Writes scripts out of a bundle, all of them unless \e names are given.
+ * Scripts that don't match their checksums, or whose names would put them
+ * outside \e directory, are not written. */
+static int unpack(const QString& bundlePath, const QString& directory, const QStringList& names, QTextStream& out)
+{
+  ScriptBundle bundle;
+  if (!bundle.open(bundlePath))
+  {
+    out << bundlePath << ": not a script bundle" << endl;
+    return 2;
+  }
+
+  QVector<int> indices;
+  int failed = 0;
+  if (names.isEmpty())
+  {
+    for (int i = 0; i < bundle.count(); ++i)
+      indices.push_back(i);
+  }
+  foreach (const QString& name, names)
+  {
+    int index = bundle.find(name);
+    if (index < 0)
+    {
+      out << name << ": not in " << bundlePath << endl;
+      ++failed;
+    }
+    else
+      indices.push_back(index);
+  }
+
+  QDir root(directory);
+  foreach (int index, indices)
+  {
+    QString name = bundle.name(index);
+    QString clean = QDir::cleanPath(name);
+    if (QDir::isAbsolutePath(clean) || clean == ".." || clean.startsWith("../"))
+    {
+      out << name << ": outside the directory, skipped" << endl;
+      ++failed;
+      continue;
+    }
+    if (!bundle.verify(index))
+    {
+      out << name << ": checksum mismatch, skipped" << endl;
+      ++failed;
+      continue;
+    }
+
+    QString target = root.absoluteFilePath(clean);
+    QFile file(target);
+    if (!root.mkpath(QFileInfo(target).absolutePath()) || !file.open(QFile::WriteOnly | QFile::Truncate) ||
+        file.write(bundle.data(index), bundle.size(index)) != bundle.size(index))
+    {
+      out << target << ": could not be written" << endl;
+      ++failed;
+    }
+  }
+
+  out << indices.size() - failed << " script(s) unpacked into " << directory << ", " << failed << " failed" << endl;
+  return (failed > 0 ? 1 : 0);
+} // unpack
+
+// ====================================================
+//  USAGE (local)
+// ====================================================
+static int usage(QTextStream& out)
+{
+  out << "Usage: materialtool <command> [options] <files or directories>..." << endl
+      << "Commands:" << endl
+      << "  validate    Report unknown keywords, misplaced attributes, unbalanced braces and unresolved names" << endl
+      << "  resolve     Report textures, programs and materials the resource directories don't have" << endl
+      << "  deps affected|depends <node>...   List what depends on the nodes, or what they depend on" << endl
+      << "  flatten     Write every material as it ends up after inheritance" << endl
+      << "  diff OLD NEW   List structural differences between two scripts or directories" << endl
+      << "  dupes       List identical and similar materials" << endl
+      << "  pack BUNDLE <files or directories>...   Pack scripts into a bundle" << endl
+      << "  list BUNDLE   List the scripts in a bundle and check them" << endl
+      << "  unpack BUNDLE DIR [name]...   Write scripts out of a bundle" << endl
+      << "Options:" << endl
+      << "  --data DIR        Directory with config.xml (exe dir)" << endl
+      << "  --format NAME     Format of files with an unknown extension" << endl
+      << "  --resources DIR   Resource directory, on top of config.xml's (repeatable)" << endl
+      << "  --graph FILE      Dependency graph kept between runs (dependencies.dat in the data dir)" << endl
+      << "  --output FILE     Where flatten writes the materials (standard output)" << endl
+      << "  --similarity PCT  Least similarity dupes reports (80)" << endl
+      << "  --minify          Pack scripts without comments or layout" << endl;
+  return 2;
+} // usage
+
+// ====================================================
+//  MAIN
+// ====================================================
+int main(int argc, char** argv)
+{
+  // Nothing is shown, so there's no need for a display
+  QApplication app(argc, argv, false);
+  QTextStream out(stdout);
+
+  QStringList args = QCoreApplication::arguments();
+  if (args.size() < 2)
+    return usage(out);
+  QString command = args[1];
+
+  // Options
+  QString dataDir = QCoreApplication::applicationDirPath();
+  QString format;
+  QStringList paths;
+  QStringList raw;
+  QStringList resourcePaths;
+  QString graphPath;
+  QString outputPath;
+  int similarity = 80;
+  bool minify = false;
+
+  for (int i = 2; i < args.size(); ++i)
+  {
+    const QString& opt = args[i];
+    if (!opt.startsWith("--"))
+    {
+      paths << QDir::current().absoluteFilePath(opt);
+      raw << opt;
+      continue;
+    }
+    if (opt == "--minify")
+    {
+      minify = true;
+      continue;
+    }
+
+    if (i + 1 >= args.size())
+      return usage(out);
+    const QString& val = args[++i];
+    if      (opt == "--data")      dataDir = QDir(val).absolutePath();
+    else if (opt == "--format")    format = val;
+    else if (opt == "--resources") resourcePaths << QDir::current().absoluteFilePath(val);
+    else if (opt == "--graph")     graphPath = QDir::current().absoluteFilePath(val);
+    else if (opt == "--output")    outputPath = QDir::current().absoluteFilePath(val);
+    else if (opt == "--similarity") similarity = qBound(1, val.toInt(), 100);
+    else
+    {
+      out << "Unknown option " << opt << endl;
+      return 2;
+    }
+  }
+
+  // Comparing scripts only needs the parser, so it works without config.xml
+  if (command == "diff")
+    return (paths.size() == 2 ? diff(paths[0], paths[1], out) : usage(out));
+
+  // Bundles only hold what they were given, so they don't need it either
+  if (command == "pack")
+    return (paths.size() >= 2 ? pack(paths[0], paths.mid(1), minify, out) : usage(out));
+  if (command == "list")
+    return (paths.size() == 1 ? listBundle(paths[0], out) : usage(out));
+  if (command == "unpack")
+    return (paths.size() >= 2 ? unpack(paths[0], paths[1], raw.mid(2), out) : usage(out));
+
+  // ConfigFile reads config.xml, and the files it names, from the working
+  // directory
+  QDir::setCurrent(dataDir);
+  if (!QFile::exists("config.xml"))
+  {
+    out << "There is no config.xml in " << dataDir << ".  Is --data pointing at the bin directory?" << endl;
+    return 2;
+  }
+
+  if (command == "deps")
+  {
+    if (raw.size() < 2)
+      return usage(out);
+
+    // Files were named relative to where the tool was run from
+    QVector<DependencyNode> nodes;
+    for (int i = 1; i < raw.size(); ++i)
+      nodes.push_back(parseNode(QFileInfo(paths[i]).exists() ? paths[i] : raw[i]));
+    if (graphPath.isEmpty())
+      graphPath = QDir::current().absoluteFilePath("dependencies.dat");
+    return dependencies(raw[0], nodes, config::ConfigFile::instance()->getResourcePaths() + resourcePaths, graphPath, out);
+  }
+
+  QVector<ScriptPath> scripts = collectScripts(paths, format);
+
+  // Every file in the resource directories is listed up front, so resolving
+  // a name never has to go to the disk
+  ResourceIndex resources;
+  resources.setDirectories(config::ConfigFile::instance()->getResourcePaths() + resourcePaths);
+  if (command == "validate" || command == "resolve" || command == "flatten")
+    resources.scan();
+
+  if (command == "validate")
+    return validate(scripts, resources, out);
+  if (command == "resolve")
+    return resolve(scripts, resources, out);
+  if (command == "flatten")
+    return flatten(scripts, resources, outputPath, out);
+  if (command == "dupes")
+    return duplicates(scripts, similarity / 100.0, out);
+  return usage(out);
+} // main
\ No newline at end of file
@@ -0,0 +1,473 @@
+// wordsgen: compiles the formats listed in config.xml (their .highlights and
+// .words files) into the perfect hash tables of source/BuiltinFormats.inc.
+//
+//   wordsgen <config.xml> <output.inc>
+//
+// Only the standard library is used, so the tables can be regenerated before
+// anything that needs Qt is built (see build/qmake/wordsgen.pro).
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "BuiltinFormats.h"
+
+using config::builtin::hash;
+
+struct HighlightSpec
+{
+  std::string name;
+  std::string color;
+  bool        bold;
+  bool        italics;
+};
+
+struct WordSpec
+{
+  std::string word;
+  int         highlight;
+  std::string doc;
+  std::string scope;
+};
+
+struct FormatSpec
+{
+  std::string                 name;
+  std::string                 extension;
+  std::vector<HighlightSpec>  highlights;
+  std::vector<WordSpec>       words;      ///< In slot order once placed
+  std::vector<int>            displacements;
+};
+
+struct Element
+{
+  std::map<std::string, std::string>  attributes;
+  std::string                         text;
+};
+
+// ====================================================
+//  READ FILE
+// ====================================================
+static bool readFile(const std::string& path, std::string& contents)
+{
+  std::ifstream file(path.c_str());
+  if (!file)
+    return false;
+
+  std::ostringstream stream;
+  stream << file.rdbuf();
+  contents = stream.str();
+
+  // Drop comments so commented out entries aren't picked up
+  std::string::size_type start;
+  while ((start = contents.find("<!--")) != std::string::npos)
+  {
+    std::string::size_type end = contents.find("-->", start);
+    contents.erase(start, end == std::string::npos ? std::string::npos : end + 3 - start);
+  }
+  return true;
+} // readFile
+
+// ====================================================
+//  FIND ELEMENTS
+// ====================================================
+static std::vector<Element> findElements(const std::string& xml, const std::string& tag)
+{
+  // The config files are flat lists of <Tag a="b">text</Tag> or <Tag a="b"/>,
+  // which is all that needs to be understood here
+  std::vector<Element> elements;
+  std::string open = "<" + tag;
+
+  std::string::size_type pos = 0;
+  while ((pos = xml.find(open, pos)) != std::string::npos)
+  {
+    pos += open.size();
+    char next = xml[pos];
+    if (next != ' ' && next != '\t' && next != '>' && next != '/')
+      continue;
+
+    std::string::size_type close = xml.find('>', pos);
+    if (close == std::string::npos)
+      break;
+
+    Element element;
+    std::string attributes = xml.substr(pos, close - pos);
+    std::string::size_type eq = 0;
+    while ((eq = attributes.find('=', eq)) != std::string::npos)
+    {
+      std::string::size_type nameEnd = attributes.find_last_not_of(" \t\r\n", eq - 1) + 1;
+      std::string::size_type nameStart = attributes.find_last_of(" \t\r\n", nameEnd - 1) + 1;
+      std::string::size_type valueStart = attributes.find('"', eq) + 1;
+      std::string::size_type valueEnd = attributes.find('"', valueStart);
+      element.attributes[attributes.substr(nameStart, nameEnd - nameStart)] =
+        attributes.substr(valueStart, valueEnd - valueStart);
+      eq = valueEnd + 1;
+    }
+
+    if (xml[close - 1] != '/')
+    {
+      std::string::size_type end = xml.find("</" + tag + ">", close);
+      element.text = xml.substr(close + 1, end - close - 1);
+      pos = end;
+    }
+    else
+    {
+      pos = close;
+    }
+
+    elements.push_back(element);
+  }
+
+  return elements;
+} // findElements
+
+// ====================================================
+//  ATTRIBUTE
+// ====================================================
+static std::string attribute(const Element& element, const std::string& name, const std::string& def = "")
+{
+  std::map<std::string, std::string>::const_iterator citr = element.attributes.find(name);
+  return (citr != element.attributes.end() ? citr->second : def);
+} // attribute
+
+// ====================================================
+//  LOAD FORMAT
+// ====================================================
+static bool loadFormat(const std::string& dir, const Element& config, FormatSpec& format)
+{
+  format.name = config.text;
+  format.extension = attribute(config, "file_extensions");
+
+  std::string xml;
+  if (!readFile(dir + attribute(config, "highlights_file"), xml))
+  {
+    std::fprintf(stderr, "wordsgen: can't read %s\n", attribute(config, "highlights_file").c_str());
+    return false;
+  }
+
+  std::vector<Element> highlights = findElements(xml, "Highlight");
+  for (size_t i = 0; i < highlights.size(); ++i)
+  {
+    HighlightSpec spec;
+    spec.name = attribute(highlights[i], "name");
+    spec.color = attribute(highlights[i], "color", "#000000");
+    spec.bold = (attribute(highlights[i], "bold") == "true");
+    spec.italics = (attribute(highlights[i], "italics") == "true");
+    format.highlights.push_back(spec);
+  }
+
+  if (!readFile(dir + attribute(config, "words_file"), xml))
+  {
+    std::fprintf(stderr, "wordsgen: can't read %s\n", attribute(config, "words_file").c_str());
+    return false;
+  }
+
+  std::vector<Element> words = findElements(xml, "Word");
+  std::map<std::string, size_t> seen;
+  for (size_t i = 0; i < words.size(); ++i)
+  {
+    // Like ConfigFile, skip words whose highlight type doesn't exist, and let
+    // a repeated word replace the earlier one
+    WordSpec spec;
+    spec.word = words[i].text;
+    spec.highlight = -1;
+    for (size_t h = 0; h < format.highlights.size(); ++h)
+    {
+      if (format.highlights[h].name == attribute(words[i], "highlight"))
+        spec.highlight = static_cast<int>(h);
+    }
+    if (spec.highlight < 0 || spec.word.empty())
+      continue;
+
+    spec.doc = attribute(words[i], "documentation");
+    spec.scope = attribute(words[i], "scope");
+
+    std::map<std::string, size_t>::iterator itr = seen.find(spec.word);
+    if (itr != seen.end())
+    {
+      format.words[itr->second] = spec;
+    }
+    else
+    {
+      seen[spec.word] = format.words.size();
+      format.words.push_back(spec);
+    }
+  }
+
+  return true;
+} // loadFormat
+
+// ====================================================
+//  LARGER BUCKET
+// ====================================================
+struct LargerBucket
+{
+  const std::vector<std::vector<int> >* buckets;
+
+  bool operator()(int a, int b) const
+  {
+    return (*buckets)[a].size() > (*buckets)[b].size();
+  }
+};
+
+// ====================================================
+//  PLACE WORDS
+// ====================================================
+static bool placeWords(FormatSpec& format)
+{
+  // Hash and displace: words are split into buckets by a first hash, then,
+  // biggest bucket first, a displacement is searched for that sends all of a
+  // bucket's words to free slots.  Single word buckets simply take the
+  // remaining slots.
+  int n = static_cast<int>(format.words.size());
+  if (n == 0)
+    return true;
+
+  int numBuckets = std::max(1, n / 3);
+  std::vector<std::vector<int> > buckets(numBuckets);
+  for (int i = 0; i < n; ++i)
+  {
+    const std::string& word = format.words[i].word;
+    buckets[hash(0, word.data(), static_cast<int>(word.size())) % numBuckets].push_back(i);
+  }
+
+  std::vector<int> order(numBuckets);
+  for (int b = 0; b < numBuckets; ++b)
+    order[b] = b;
+  LargerBucket larger = { &buckets };
+  std::stable_sort(order.begin(), order.end(), larger);
+
+  std::vector<int> slots(n, -1);
+  format.displacements.assign(numBuckets, 0);
+
+  for (int o = 0; o < numBuckets; ++o)
+  {
+    const std::vector<int>& bucket = buckets[order[o]];
+    if (bucket.size() < 2)
+      break;
+
+    bool placed = false;
+    for (int d = 1; d < 1000000 && !placed; ++d)
+    {
+      std::vector<int> taken;
+      placed = true;
+      for (size_t i = 0; i < bucket.size() && placed; ++i)
+      {
+        const std::string& word = format.words[bucket[i]].word;
+        int slot = hash(d, word.data(), static_cast<int>(word.size())) % n;
+        if (slots[slot] >= 0 || std::find(taken.begin(), taken.end(), slot) != taken.end())
+          placed = false;
+        else
+          taken.push_back(slot);
+      }
+
+      if (placed)
+      {
+        for (size_t i = 0; i < bucket.size(); ++i)
+          slots[taken[i]] = bucket[i];
+        format.displacements[order[o]] = d;
+      }
+    }
+
+    if (!placed)
+    {
+      std::fprintf(stderr, "wordsgen: no displacement found for a bucket of %s\n", format.name.c_str());
+      return false;
+    }
+  }
+
+  int free = 0;
+  for (int o = 0; o < numBuckets; ++o)
+  {
+    const std::vector<int>& bucket = buckets[order[o]];
+    if (bucket.size() != 1)
+      continue;
+
+    while (slots[free] >= 0)
+      ++free;
+    slots[free] = bucket[0];
+    format.displacements[order[o]] = -free - 1;
+  }
+
+  std::vector<WordSpec> placedWords(n);
+  for (int i = 0; i < n; ++i)
+    placedWords[i] = format.words[slots[i]];
+  format.words = placedWords;
+  return true;
+} // placeWords
+
+// ====================================================
+//  QUOTE
+// ====================================================
+static std::string quote(const std::string& str)
+{
+  std::string quoted = "\"";
+  for (size_t i = 0; i < str.size(); ++i)
+  {
+    if (str[i] == '"' || str[i] == '\\')
+      quoted += '\\';
+    quoted += str[i];
+  }
+  return quoted + "\"";
+} // quote
+
+// ====================================================
+//  IDENTIFIER
+// ====================================================
+static std::string identifier(const std::string& name)
+{
+  std::string id;
+  for (size_t i = 0; i < name.size(); ++i)
+    id += (isalnum(static_cast<unsigned char>(name[i])) ? static_cast<char>(toupper(name[i])) : '_');
+  return id;
+} // identifier
+
+// ====================================================
+//  WRITE FORMATS
+// ====================================================
+static void writeFormats(std::ostream& out, const std::vector<FormatSpec>& formats)
+{
+  out << "// Generated by wordsgen (tools/wordsgen.cpp) from bin/config.xml.  Do not edit;\n"
+      << "// rebuild build/qmake/wordsgen.pro after changing the .words or .highlights files.\n";
+
+  for (size_t f = 0; f < formats.size(); ++f)
+  {
+    const FormatSpec& format = formats[f];
+    std::string id = identifier(format.name);
+
+    out << "\n// " << format.name << "\n";
+    out << "static const Highlight " << id << "_HIGHLIGHTS[] = {\n";
+    for (size_t i = 0; i < format.highlights.size(); ++i)
+    {
+      const HighlightSpec& h = format.highlights[i];
+      out << "  { " << quote(h.name) << ", " << quote(h.color) << ", "
+          << (h.bold ? "true" : "false") << ", " << (h.italics ? "true" : "false") << " },\n";
+    }
+    out << "};\n\n";
+
+    out << "static const Word " << id << "_WORDS[] = {\n";
+    for (size_t i = 0; i < format.words.size(); ++i)
+    {
+      const WordSpec& w = format.words[i];
+      out << "  { " << quote(w.word) << ", " << w.word.size() << ", " << w.highlight << ", "
+          << quote(w.doc) << ", " << quote(w.scope) << " },\n";
+    }
+    if (format.words.empty())
+      out << "  { \"\", 0, 0, \"\", \"\" }\n";
+    out << "};\n\n";
+
+    out << "static const int " << id << "_DISPLACEMENTS[] = {";
+    for (size_t i = 0; i < format.displacements.size(); ++i)
+      out << (i % 12 == 0 ? "\n  " : " ") << format.displacements[i] << ",";
+    if (format.displacements.empty())
+      out << " 0";
+    out << "\n};\n";
+  }
+
+  out << "\nstatic const Format FORMATS[] = {\n";
+  for (size_t f = 0; f < formats.size(); ++f)
+  {
+    const FormatSpec& format = formats[f];
+    std::string id = identifier(format.name);
+    out << "  { " << quote(format.name) << ", " << quote(format.extension) << ", "
+        << id << "_HIGHLIGHTS, " << format.highlights.size() << ", "
+        << id << "_WORDS, " << format.words.size() << ", "
+        << id << "_DISPLACEMENTS, " << format.displacements.size() << " },\n";
+  }
+  out << "};\n";
+} // writeFormats
+
+// ====================================================
+//  VERIFY
+// ====================================================
+static bool verify(const FormatSpec& spec)
+{
+  // Build the runtime view of the table and look every word up through it
+  std::vector<config::builtin::Word> words;
+  for (size_t i = 0; i < spec.words.size(); ++i)
+  {
+    config::builtin::Word w = { spec.words[i].word.c_str(), static_cast<int>(spec.words[i].word.size()),
+                                spec.words[i].highlight, "", "" };
+    words.push_back(w);
+  }
+
+  config::builtin::Format format = { "", "", NULL, 0, words.empty() ? NULL : &words[0], static_cast<int>(words.size()),
+                                     spec.displacements.empty() ? NULL : &spec.displacements[0],
+                                     static_cast<int>(spec.displacements.size()) };
+
+  for (size_t i = 0; i < words.size(); ++i)
+  {
+    if (config::builtin::find(format, words[i].word, words[i].length) != &words[i])
+    {
+      std::fprintf(stderr, "wordsgen: %s doesn't look up in %s\n", words[i].word, spec.name.c_str());
+      return false;
+    }
+  }
+  return true;
+} // verify
+
+// ====================================================
+//  MAIN
+// ====================================================
+int main(int argc, char* argv[])
+{
+  if (argc != 3)
+  {
+    std::fprintf(stderr, "usage: wordsgen <config.xml> <output.inc>\n");
+    return 1;
+  }
+
+  std::string configPath = argv[1];
+  std::string::size_type slash = configPath.find_last_of("/\\");
+  std::string dir = (slash == std::string::npos ? "" : configPath.substr(0, slash + 1));
+
+  std::string xml;
+  if (!readFile(configPath, xml))
+  {
+    std::fprintf(stderr, "wordsgen: can't read %s\n", configPath.c_str());
+    return 1;
+  }
+
+  std::vector<FormatSpec> formats;
+  std::vector<Element> configs = findElements(xml, "Format");
+  for (size_t i = 0; i < configs.size(); ++i)
+  {
+    FormatSpec format;
+    if (!loadFormat(dir, configs[i], format) || !placeWords(format) || !verify(format))
+      return 1;
+    formats.push_back(format);
+  }
+
+  // Only touch the output if it changes, so it isn't rebuilt needlessly
+  std::ostringstream generated;
+  writeFormats(generated, formats);
+
+  std::string existing;
+  std::ifstream current(argv[2]);
+  if (current)
+  {
+    std::ostringstream stream;
+    stream << current.rdbuf();
+    existing = stream.str();
+  }
+
+  if (existing != generated.str())
+  {
+    std::ofstream out(argv[2]);
+    out << generated.str();
+    if (!out)
+    {
+      std::fprintf(stderr, "wordsgen: can't write %s\n", argv[2]);
+      return 1;
+    }
+  }
+
+  for (size_t i = 0; i < formats.size(); ++i)
+    std::printf("%s: %d words\n", formats[i].name.c_str(), static_cast<int>(formats[i].words.size()));
+  return 0;
+} // main
\ No newline at end of file